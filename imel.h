@@ -26,6 +26,17 @@
 /** function @ file: src/miscellaneous.c **/
 extern bool             imel_enable_brush                          (ImelImage *brush);
 extern bool             imel_disable_brush                         (void);
+
+/** function @ file: src/brush.c **/
+extern bool             imel_brush_set_mode                        (ImelBrushMode mode);
+extern bool             imel_brush_set_spacing                     (ImelSize spacing);
+
+/** function @ file: src/cpu.c **/
+extern ImelCpuLevel     imel_cpu_get_level                         (void);
+
+/** function @ file: src/thread.c **/
+extern ImelSize         imel_thread_get_count                      (void);
+extern void             imel_thread_set_count                      (ImelSize count);
                         
 /** function @ file: src/image.c **/ 
 extern void             imel_image_apply_color                     (ImelImage *image, ImelColor red, ImelColor green, ImelColor blue,
@@ -35,6 +46,7 @@ extern void             imel_image_apply_convolution               (ImelImage *i
                                                                     double factor, double bias);
 extern void             imel_image_apply_effect                    (ImelImage *image, ImelEffect effect, ...);
 extern void             imel_image_apply_filter                    (ImelImage *image, ImelMask mask);
+extern void             imel_image_apply_gaussian_blur             (ImelImage *image, double sigma);
 extern ImelImage       *imel_image_apply_logic_operation           (ImelImage *img1, ImelImage *img2, ImelLogicOperation logic_operation);
 extern void             imel_image_apply_noise                     (ImelImage *image, ImelColor noise_range, ImelSize noise_quantity, 
                                                                     ImelMask mask, ImelNoiseOperation operation, bool nepc);
@@ -60,6 +72,7 @@ extern ImelImage       *imel_image_new_with_background_color       (ImelSize wid
 extern ImelImage       *imel_image_perspective                     (ImelImage *image, double rad_angle, ImelOrientation orientation);
 extern void             imel_image_remove_base_color               (ImelImage *image, ImelMask mask);
 extern void             imel_image_remove_noise                    (ImelImage *image, ImelSize size_q, ImelMask mask, ImelColor tollerance);
+extern void             imel_image_remove_noise_median             (ImelImage *image, ImelSize size_q, ImelMask mask, ImelColor tollerance);
 extern void             imel_image_replace_area_color              (ImelImage *image, ImelPixel src, ImelPixel dest, ImelSize tollerance,
                                                                     ImelSize _x1, ImelSize _y1, ImelSize _x2, ImelSize _y2);
 extern void             imel_image_replace_color                   (ImelImage *image, ImelPixel src, ImelPixel dest, ImelSize tollerance);
@@ -76,15 +89,37 @@ extern bool             imel_image_shift_lines                     (ImelImage *i
                                                                     ImelSize width, long int move_pixel, bool lengthens);
 extern ImelImage       *imel_image_slant                           (ImelImage *image, ImelSize x0, ImelSize y0, ImelSize x1, ImelSize y1, 
                                                                     ImelOrientation orientation, bool lengthens);
+extern void             imel_image_touch                           (ImelImage *image);
 extern ImelImage       *imel_image_union                           (ImelImage *img1, ImelImage *img2, unsigned char opacity, 
                                                                     ImelAlignment alignment);
 
+/** function @ file: src/effect_chain.c **/
+extern bool             imel_effect_chain_add                      (ImelEffectChain *chain, ImelEffect effect, ...);
+extern void             imel_effect_chain_apply                    (ImelImage *image, ImelEffectChain *chain);
+extern void             imel_effect_chain_free                     (ImelEffectChain *chain);
+extern ImelEffectChain *imel_effect_chain_new                      (void);
+
+/** function @ file: src/histogram.c **/
+extern void             imel_histograms_free                       (ImelHistograms *histograms);
+extern ImelHistograms  *imel_image_get_histograms                  (ImelImage *image);
+extern const ImelImageStats *imel_image_get_stats                  (ImelImage *image);
+
+/** function @ file: src/equalize.c **/
+extern void             imel_image_equalize                        (ImelImage *image);
+extern void             imel_image_equalize_adaptive               (ImelImage *image, ImelSize tiles_x, ImelSize tiles_y,
+                                                                    double clip_limit);
+
 /** function @ file: src/image_fill.c **/
 extern void             imel_image_fill_color_with_color           (ImelImage *image, ImelPoint *point, ImelSize tollerance);
 extern void             imel_image_fill_color_with_level           (ImelImage *image, ImelPoint *point, ImelSize tollerance);
 extern void             imel_image_fill_level_with_color           (ImelImage *image, ImelPoint *point, ImelSize tollerance);
 extern void             imel_image_fill_level_with_level           (ImelImage *image, ImelPoint *point, ImelSize tollerance);
 
+/** function @ file: src/label.c **/
+extern ImelLabels      *imel_image_get_labels                      (ImelImage *image, ImelRef reference, ImelSize tollerance,
+                                                                    ImelConnectivity connectivity);
+extern void             imel_labels_free                           (ImelLabels *labels);
+
 /** function @ file: src/image_new_from.c **/
 extern ImelImage       *imel_image_new_from                        (const char *filename, ImelLevel level, ImelError *error);
 extern ImelImage       *imel_image_new_from_bmp                    (const char *filename, ImelLevel level, ImelError *error);
@@ -249,10 +284,15 @@ extern void             imel_pixel_set_from_string                 (ImelPixel *p
 extern ImelPixel        imel_pixel_union                           (ImelPixel a, ImelPixel b, unsigned char opacity);
 
 /** function @ file: src/draw.c **/
+extern void             imel_draw_antialiased_circle               (ImelImage *image, double x, double y, double radius, ImelPixel pxl);
+extern void             imel_draw_antialiased_ellipse              (ImelImage *image, double x, double y, double a, double b, ImelPixel pxl);
+extern bool             imel_draw_antialiased_line                 (ImelImage *image, double x1, double y1, double x2, double y2, 
+                                                                    ImelPixel pixel);
 extern bool             imel_draw_arch                             (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius, 
                                                                     double start_angle, double end_angle, ImelPixel pxl);
 extern void             imel_draw_circle                           (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius, ImelPixel pxl);
 extern void             imel_draw_contiguous_figure                (ImelImage *image, ImelSize n_points, ImelPoint **points, ImelPixel pixel);
+extern void             imel_draw_contiguous_figure_array          (ImelImage *image, const ImelPointArray *points, ImelPixel pixel);
 extern void             imel_draw_curve                            (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2, 
                                                                     ImelSize x3, ImelSize y3, ImelSize x4, ImelSize y4, int _p, 
                                                                     ImelPixel pixel);
@@ -264,6 +304,8 @@ extern bool             imel_draw_dashed_line                      (ImelImage *i
 extern void             imel_draw_ellipse                          (ImelImage *image, ImelSize x, ImelSize y, double a, double b, ImelPixel pxl);
 extern void             imel_draw_figure                           (ImelImage *image, ImelSize n_points, ImelPoint **starts, 
                                                                     ImelPoint **ends, ImelPixel pixel);
+extern void             imel_draw_figure_array                     (ImelImage *image, const ImelPointArray *starts, 
+                                                                    const ImelPointArray *ends, ImelPixel pixel);
 extern bool             imel_draw_filled_arch                      (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius, 
                                                                     double start_angle, double end_angle, ImelPixel pxl);
 extern void             imel_draw_filled_ellipse                   (ImelImage *image, ImelSize x, ImelSize y, double a, double b, ImelPixel pxl);
@@ -283,10 +325,14 @@ extern void             imel_draw_grid                             (ImelImage *i
 extern bool             imel_draw_line                             (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, 
                                                                     ImelSize y2, ImelPixel pixel);
 extern void             imel_draw_line_connecting_all_points       (ImelImage *image, ImelPoint **points, ImelPixel pxl);
+extern void             imel_draw_line_connecting_point_array      (ImelImage *image, const ImelPointArray *points, ImelPixel pxl);
 extern bool             imel_draw_partial_reg_shape                (ImelImage *image, ImelSize x, ImelSize y, ImelSize r, long v, short p, 
                                                                     double start_angle, ImelPixel pxl);
 extern void             imel_draw_point                            (ImelImage *image, ImelSize x, ImelSize y, ImelPixel pixel);
+extern void             imel_draw_point_array                      (ImelImage *image, const ImelPointArray *points);
 extern void             imel_draw_point_from_array                 (ImelImage *image, ImelSize n_points, ImelPoint **points);
+extern void             imel_draw_quadratic_curve                  (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2,
+                                                                    ImelSize x3, ImelSize y3, ImelPixel pixel);
 extern void             imel_draw_rect                             (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2, 
                                                                     ImelPixel pixel, bool fill);
 extern bool             imel_draw_rect_with_rounded_angles         (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2,
@@ -296,11 +342,75 @@ extern bool             imel_draw_reg_shape                        (ImelImage *i
 extern bool             imel_draw_spiral                           (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius, 
                                                                     ImelSize distance, ImelPixel pxl);
                        
+/** function @ file: src/polygon.c **/
+extern void             imel_draw_filled_antialiased_polygon       (ImelImage *image, const ImelPointArray *points, ImelFillRule rule, 
+                                                                    ImelPixel pixel);
+extern void             imel_draw_filled_polygon                   (ImelImage *image, const ImelPointArray *points, ImelFillRule rule, 
+                                                                    ImelPixel pixel);
+extern bool             imel_draw_filled_reg_shape                 (ImelImage *image, ImelSize x, ImelSize y, ImelSize r, long v, 
+                                                                    double start_angle, ImelPixel pxl);
+                       
+/** function @ file: src/canvas.c **/
+extern void             imel_canvas_clear                          (ImelCanvas *canvas);
+extern bool             imel_canvas_draw_antialiased_circle        (ImelCanvas *canvas, double x, double y, double radius, ImelPixel pxl);
+extern bool             imel_canvas_draw_antialiased_line          (ImelCanvas *canvas, double x1, double y1, double x2, double y2,
+                                                                    ImelPixel pixel);
+extern bool             imel_canvas_draw_filled_antialiased_polygon (ImelCanvas *canvas, const ImelPointArray *points, ImelFillRule rule,
+                                                                    ImelPixel pixel);
+extern bool             imel_canvas_draw_filled_circle             (ImelCanvas *canvas, ImelSize x, ImelSize y, ImelSize radius, ImelPixel pxl);
+extern bool             imel_canvas_draw_filled_polygon            (ImelCanvas *canvas, const ImelPointArray *points, ImelFillRule rule,
+                                                                    ImelPixel pixel);
+extern bool             imel_canvas_draw_line                      (ImelCanvas *canvas, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2,
+                                                                    ImelPixel pixel);
+extern bool             imel_canvas_draw_point                     (ImelCanvas *canvas, ImelSize x, ImelSize y, ImelPixel pixel);
+extern bool             imel_canvas_draw_rect                      (ImelCanvas *canvas, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2,
+                                                                    ImelPixel pixel, bool fill);
+extern void             imel_canvas_free                           (ImelCanvas *canvas);
+extern bool             imel_canvas_insert_image                   (ImelCanvas *canvas, ImelImage *image, ImelSize x, ImelSize y);
+extern ImelCanvas      *imel_canvas_new                            (void);
+extern void             imel_canvas_render                         (ImelCanvas *canvas, ImelImage *image);
+extern bool             imel_canvas_write_string                   (ImelCanvas *canvas, ImelSize x, ImelSize y, const char *string, ImelSize px,
+                                                                    ImelPixel pixel);
+
+/** function @ file: src/gradient.c **/
+extern void             imel_draw_gradient_fill                    (ImelImage *image, const ImelGradient *gradient);
+extern bool             imel_gradient_add_stop                     (ImelGradient *gradient, double offset, ImelPixel pixel);
+extern void             imel_gradient_free                         (ImelGradient *gradient);
+extern ImelGradient    *imel_gradient_new_conic                    (double x, double y, double angle);
+extern ImelGradient    *imel_gradient_new_linear                   (double x1, double y1, double x2, double y2);
+extern ImelGradient    *imel_gradient_new_radial                   (double x, double y, double radius);
+
+/** function @ file: src/path.c **/
+extern void             imel_draw_filled_antialiased_path          (ImelImage *image, const ImelPath *path, ImelFillRule rule,
+                                                                    ImelPixel pixel);
+extern void             imel_draw_filled_path                      (ImelImage *image, const ImelPath *path, ImelFillRule rule, ImelPixel pixel);
+extern void             imel_draw_path                             (ImelImage *image, const ImelPath *path, ImelPixel pixel);
+extern bool             imel_path_close                            (ImelPath *path);
+extern bool             imel_path_cubic_to                         (ImelPath *path, double cx1, double cy1, double cx2, double cy2, double x, double y);
+extern void             imel_path_free                             (ImelPath *path);
+extern bool             imel_path_line_to                          (ImelPath *path, double x, double y);
+extern bool             imel_path_move_to                          (ImelPath *path, double x, double y);
+extern ImelPath        *imel_path_new                              (void);
+extern bool             imel_path_quadratic_to                     (ImelPath *path, double cx, double cy, double x, double y);
+extern bool             imel_path_set_tolerance                    (ImelPath *path, double tolerance);
+
 /** function @ file: src/point.c **/
+extern bool             imel_point_array_add                       (ImelPointArray *array, ImelSize x, ImelSize y, ImelPixel pixel);
+extern void             imel_point_array_destroy                   (ImelPointArray *array);
 extern void             imel_point_array_free                      (ImelPoint **points);
+extern ImelPointArray  *imel_point_array_from_list                 (ImelPoint **points);
+extern ImelPointArray  *imel_point_array_new                       (ImelSize size);
+extern ImelPoint      **imel_point_array_to_list                   (const ImelPointArray *array);
 extern void             imel_point_free                            (ImelPoint *point);
+extern ImelPointArray  *imel_point_get_array_from_line             (ImelSize _x1, ImelSize _y1, ImelSize _x2, ImelSize _y2, long int *lx, 
+                                                                    long int *ly, ImelValue value_type, double value);
+extern ImelPointArray  *imel_point_get_array_from_reg_shape        (ImelSize x, ImelSize y, ImelSize r, long v, double start_angle);
+extern ImelPointArray  *imel_point_get_brightest_array             (ImelImage *image);
+extern ImelPointArray  *imel_point_get_brightest_n_points          (ImelImage *image, ImelSize n);
 extern ImelPoint       *imel_point_get_brightest_point             (ImelImage *image);
 extern ImelPoint      **imel_point_get_brightest_points            (ImelImage *image);
+extern ImelPointArray  *imel_point_get_darkest_array               (ImelImage *image);
+extern ImelPointArray  *imel_point_get_darkest_n_points            (ImelImage *image, ImelSize n);
 extern ImelPoint       *imel_point_get_darkest_point               (ImelImage *image);
 extern ImelPoint      **imel_point_get_darkest_points              (ImelImage *image);
 extern ImelPoint      **imel_point_get_from_line                   (ImelSize _x1, ImelSize _y1, ImelSize _x2, ImelSize _y2, long int *lx, 
@@ -309,16 +419,38 @@ extern ImelPoint      **imel_point_get_from_reg_shape              (ImelSize x,
 extern ImelPoint       *imel_point_get_point_from_image            (ImelImage *image, ImelSize x, ImelSize y);
 extern ImelPoint       *imel_point_new                             (ImelImage *image, ImelSize x, ImelSize y, ImelPixel pixel);
 
+
+/** function @ file: src/point_op.c **/
+extern void             imel_image_apply_point_op                  (ImelImage *image, ImelPointOp *point_op);
+extern void             imel_point_op_add_brightness               (ImelPointOp *point_op, int perc);
+extern void             imel_point_op_add_color                    (ImelPointOp *point_op, ImelColor red, ImelColor green, ImelColor blue);
+extern void             imel_point_op_add_contrast                 (ImelPointOp *point_op, int s);
+extern void             imel_point_op_add_filter                   (ImelPointOp *point_op, ImelMask mask);
+extern void             imel_point_op_add_invert                   (ImelPointOp *point_op);
+extern void             imel_point_op_add_remove_base_color        (ImelPointOp *point_op, ImelMask mask);
+extern void             imel_point_op_add_shift_bpc                (ImelPointOp *point_op, int bpc_shift_red, int bpc_shift_green,
+                                                                    int bpc_shift_blue);
+extern void             imel_point_op_free                         (ImelPointOp *point_op);
+extern ImelPointOp     *imel_point_op_new                          (void);
+extern void             imel_point_op_reset                        (ImelPointOp *point_op);
                                       
 /** function @ file: src/font.c **/
+extern void             imel_font_close                            (ImelFont *font);
+extern ImelFont        *imel_font_open                             (const char *ttf_file);
+extern bool             imel_font_select_charmap                   (ImelFont *font, FT_Encoding encoding);
+extern bool             imel_font_set_cache_size                   (ImelFont *font, ImelSize n_glyphs);
 extern void             imel_font_write_string                     (ImelImage *image, ImelSize x, ImelSize y, const char *string, 
                                                                     ImelSize px,  ImelPixel pixel);
 extern void             imel_font_write_string_with_truetype_font  (ImelImage **image, char *ttf_file, ImelSize _x, ImelSize y,
                                                                     char *string, ImelSize px, ImelPixel pixel, ...);
+extern bool             imel_font_write_text                       (ImelFont *font, ImelImage *image, ImelSize x, ImelSize y, const char *string,
+                                                                    ImelSize px, ImelPixel pixel);
 extern void             imel_font_write_vstring                    (ImelImage *image, ImelSize x, ImelSize y, const char *string, 
                                                                     ImelSize px, ImelPixel pixel);
 extern void             imel_font_write_vstring_with_truetype_font (ImelImage **image, char *ttf_file, ImelSize _x, ImelSize y,
                                                                     char *string, ImelSize px, ImelPixel pixel, ...);
+extern bool             imel_font_write_vtext                      (ImelFont *font, ImelImage *image, ImelSize x, ImelSize y, const char *string,
+                                                                    ImelSize px, ImelPixel pixel);
                                                                
 /** function @ file: src/value.c **/ 
 extern double           imel_value_convert                         (ImelValue from_value, double value, ImelValue to_value, ...);
@@ -0,0 +1,399 @@
+/*
+ * "brush.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <limits.h>
+#include "header.h"
+/**
+ * @file brush.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to draw with the brush.
+ *
+ * The brush is compiled in runs: for each row the ranges of pixels that
+ * aren't transparent. A stamp copies the runs clipped to the image, the
+ * transparent pixels are never visited.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+extern void imel_pixel_copy (ImelPixel *dest, ImelPixel src);
+extern void __imel_draw_pixels (ImelPixel *p, long length, ImelPixel pixel);
+
+/* Pixels of a row of the brush from @x to @x + @length excluded */
+typedef struct ___imel_brush_run {
+               long x;
+               long length;
+               bool opaque;   /* All the pixels have a level, not an alpha */
+        } __ImelBrushRun;
+
+/* Points of a line on the row @y, from @x0 to @x1 included */
+typedef struct ___imel_brush_anchor {
+               long y;
+               long x0;
+               long x1;
+        } __ImelBrushAnchor;
+
+typedef struct ___imel_brush {
+               ImelImage *source;         /* Brush compiled in @run */
+               uint64_t generation;       /* Generation of @source when compiled */
+               size_t *first;             /* Runs of the row r from first[r] to first[r + 1] */
+               __ImelBrushRun *run;
+               ImelSize spacing;
+               ImelBrushMode mode;
+               long last_x;               /* Last point of the path */
+               long last_y;
+               ImelSize count;            /* Points of the path after the last stamp */
+               bool path;                 /* TRUE if last_x and last_y are valid */
+               bool sweep;                /* TRUE between sweep_begin and sweep_end */
+               __ImelBrushAnchor *anchor; /* Points of the line in the sweep */
+               ImelSize n_anchors;
+               ImelSize size;
+        } __ImelBrush;
+
+static __ImelBrush brush_state = { NULL, 0, NULL, NULL, 1, IMEL_BRUSH_MODE_STAMP, 0, 0, 0,
+                                   false, false, NULL, 0, 0 };
+
+static bool __imel_brush_is_clear (ImelPixel pixel)
+{
+ return pixel.level <= -255;
+}
+
+static bool __imel_brush_compile (ImelImage *image)
+{
+ ImelPixel *row;
+ size_t n = 0;
+ ImelSize x, y, start;
+
+ free (brush_state.first);
+ free (brush_state.run);
+ brush_state.first = NULL;
+ brush_state.run = NULL;
+ brush_state.source = NULL;
+
+ if ( ! image )
+      return false;
+
+ for ( y = 0; y < image->height; y++ ) {
+       for ( x = 0; x < image->width; x++ )
+             n += ! __imel_brush_is_clear (image->pixel[y][x]) &&
+                  ( ! x || __imel_brush_is_clear (image->pixel[y][x - 1]) );
+ }
+
+ brush_state.first = (size_t *) malloc (sizeof (size_t) * (image->height + 1));
+ brush_state.run = (__ImelBrushRun *) malloc (sizeof (__ImelBrushRun) * (n ? n : 1));
+ if ( ! brush_state.first || ! brush_state.run ) {
+      free (brush_state.first);
+      free (brush_state.run);
+      brush_state.first = NULL;
+      brush_state.run = NULL;
+      return false;
+ }
+
+ for ( n = 0, y = 0; y < image->height; y++ ) {
+       row = image->pixel[y];
+       brush_state.first[y] = n;
+
+       for ( x = 0; x < image->width; ) {
+             if ( __imel_brush_is_clear (row[x]) ) {
+                  x++;
+                  continue;
+             }
+
+             brush_state.run[n].x = x;
+             brush_state.run[n].opaque = true;
+             for ( start = x; x < image->width && ! __imel_brush_is_clear (row[x]); x++ )
+                   brush_state.run[n].opaque &= row[x].level >= 0;
+             brush_state.run[n++].length = x - start;
+       }
+ }
+ brush_state.first[image->height] = n;
+
+ brush_state.source = image;
+ brush_state.generation = image->generation;
+
+ return true;
+}
+
+/* TRUE if the brush is enabled and compiled, it's compiled again if it was
+ * changed */
+static bool __imel_brush_ready (void)
+{
+ extern ImelImage *global_brush;
+
+ if ( ! global_brush )
+      return false;
+
+ if ( global_brush == brush_state.source && global_brush->generation == brush_state.generation )
+      return true;
+
+ return __imel_brush_compile (global_brush);
+}
+
+/* Copy the brush with the top left corner at (x, y) */
+static void __imel_brush_stamp (ImelImage *image, long x, long y)
+{
+ const __ImelBrushRun *run;
+ ImelImage *source = brush_state.source;
+ ImelPixel *d, *s;
+ long r, x0, x1;
+ size_t k;
+
+ for ( r = ( y < 0 ) ? -y : 0; r < (long) source->height && y + r < (long) image->height; r++ ) {
+       for ( k = brush_state.first[r]; k < brush_state.first[r + 1]; k++ ) {
+             run = &(brush_state.run[k]);
+             x0 = ( x + run->x < 0 ) ? 0 : x + run->x;
+             x1 = ( x + run->x + run->length > (long) image->width ) ? (long) image->width :
+                  x + run->x + run->length;
+             if ( x0 >= x1 )
+                  continue;
+
+             d = image->pixel[y + r] + x0;
+             s = source->pixel[r] + (x0 - x);
+
+             /* Same as imel_pixel_copy () for pixels with a level */
+             if ( run->opaque ) {
+                  for ( ; x0 < x1; x0++, d++, s++ )
+                        *d = ( d->level > s->level ) ? *d : *s;
+             }
+             else {
+                  for ( ; x0 < x1; x0++, d++, s++ )
+                        imel_pixel_copy (d, *s);
+             }
+       }
+ }
+}
+
+/* TRUE if the point (x, y) gets a stamp: a point next to the previous one
+ * continues the path and gets a stamp every spacing points, the others
+ * start a new path. */
+static bool __imel_brush_next (long x, long y)
+{
+ bool near = brush_state.path && labs (x - brush_state.last_x) <= 1 && labs (y - brush_state.last_y) <= 1;
+
+ brush_state.path = true;
+ brush_state.last_x = x;
+ brush_state.last_y = y;
+
+ if ( near && ++brush_state.count < brush_state.spacing )
+      return false;
+
+ brush_state.count = 0;
+
+ return true;
+}
+
+static int __imel_brush_compare_anchor (const void *a, const void *b)
+{
+ const __ImelBrushAnchor *sa = (const __ImelBrushAnchor *) a, *sb = (const __ImelBrushAnchor *) b;
+
+ if ( sa->y != sb->y )
+      return ( sa->y > sb->y ) - ( sa->y < sb->y );
+
+ return ( sa->x0 > sb->x0 ) - ( sa->x0 < sb->x0 );
+}
+
+/* Fill with @pixel the union of the brush shapes with the top left corner
+ * on the points of @anchor, sorted here by row. Each pixel is drawn once. */
+static void __imel_brush_sweep (ImelImage *image, __ImelBrushAnchor *anchor, ImelSize n_anchors,
+                                ImelPixel pixel)
+{
+ ImelImage *source = brush_state.source;
+ __ImelBrushAnchor *span;
+ long ymin, ymax, y, r, x0, x1;
+ size_t *first, n_runs, most = 0, m, k, a;
+ ImelSize i;
+
+ n_runs = brush_state.first[source->height];
+ if ( ! n_anchors || ! n_runs )
+      return;
+
+ qsort (anchor, n_anchors, sizeof (__ImelBrushAnchor), __imel_brush_compare_anchor);
+ ymin = anchor[0].y;
+ ymax = anchor[n_anchors - 1].y;
+
+ /* Anchors of the row y from first[y - ymin] to first[y - ymin + 1] */
+ first = (size_t *) calloc (ymax - ymin + 2, sizeof (size_t));
+ return_if_fail (first);
+
+ for ( i = 0; i < n_anchors; i++ )
+       first[anchor[i].y - ymin + 1]++;
+ for ( y = 0; y <= ymax - ymin; y++ ) {
+       most = ( first[y + 1] > most ) ? first[y + 1] : most;
+       first[y + 1] += first[y];
+ }
+
+ span = (__ImelBrushAnchor *) malloc (sizeof (__ImelBrushAnchor) * most * n_runs);
+ if ( ! span ) {
+      free (first);
+      return;
+ }
+
+ for ( y = ( ymin < 0 ) ? 0 : ymin; y < (long) image->height && y <= ymax + (long) source->height - 1; y++ ) {
+       /* Runs of the brush rows that reach the row y from the anchors */
+       m = 0;
+       for ( r = ( y - ymax > 0 ) ? y - ymax : 0; r < (long) source->height && r <= y - ymin; r++ ) {
+             for ( a = first[y - r - ymin]; a < first[y - r - ymin + 1]; a++ ) {
+                   for ( k = brush_state.first[r]; k < brush_state.first[r + 1]; k++ ) {
+                         span[m].y = y;
+                         span[m].x0 = anchor[a].x0 + brush_state.run[k].x;
+                         span[m++].x1 = anchor[a].x1 + brush_state.run[k].x + brush_state.run[k].length - 1;
+                   }
+             }
+       }
+
+       qsort (span, m, sizeof (__ImelBrushAnchor), __imel_brush_compare_anchor);
+
+       for ( k = 0; k < m; ) {
+             x0 = span[k].x0;
+             x1 = span[k].x1;
+             for ( k++; k < m && span[k].x0 <= x1 + 1; k++ )
+                   x1 = ( span[k].x1 > x1 ) ? span[k].x1 : x1;
+
+             x0 = ( x0 < 0 ) ? 0 : x0;
+             x1 = ( x1 >= (long) image->width ) ? (long) image->width - 1 : x1;
+             if ( x0 <= x1 )
+                  __imel_draw_pixels (image->pixel[y] + x0, x1 - x0 + 1, pixel);
+       }
+ }
+
+ free (first);
+ free (span);
+}
+
+/* Draw the brush on @length points of the row @y from @x, inside @image.
+ * In swept mode the points are added to the open sweep, if any. */
+void __imel_brush_draw_span (ImelImage *image, long x, long y, long length, ImelPixel pixel)
+{
+ __ImelBrushAnchor *anchor, point;
+
+ if ( length <= 0 || ! __imel_brush_ready () )
+      return;
+
+ if ( brush_state.mode == IMEL_BRUSH_MODE_SWEPT ) {
+      point.y = y;
+      point.x0 = x;
+      point.x1 = x + length - 1;
+
+      if ( ! brush_state.sweep ) {
+           __imel_brush_sweep (image, &point, 1, pixel);
+           return;
+      }
+
+      if ( brush_state.n_anchors == brush_state.size ) {
+           anchor = (__ImelBrushAnchor *) realloc (brush_state.anchor, sizeof (__ImelBrushAnchor) *
+                                                   (brush_state.size ? brush_state.size << 1 : 256));
+           return_if_fail (anchor);
+
+           brush_state.anchor = anchor;
+           brush_state.size = brush_state.size ? brush_state.size << 1 : 256;
+      }
+
+      brush_state.anchor[brush_state.n_anchors++] = point;
+      return;
+ }
+
+ for ( ; length > 0; length--, x++ ) {
+       if ( __imel_brush_next (x, y) )
+            __imel_brush_stamp (image, x, y);
+ }
+}
+
+/* Start collecting the points of a line, FALSE if the brush isn't used in
+ * swept mode or if a sweep is already open: the points are collected by
+ * the open sweep. */
+bool __imel_brush_sweep_begin (void)
+{
+ if ( brush_state.mode != IMEL_BRUSH_MODE_SWEPT || brush_state.sweep || ! __imel_brush_ready () )
+      return false;
+
+ brush_state.sweep = true;
+ brush_state.n_anchors = 0;
+
+ return true;
+}
+
+/* Draw the shape swept by the brush along the points collected */
+void __imel_brush_sweep_end (ImelImage *image, ImelPixel pixel)
+{
+ brush_state.sweep = false;
+
+ if ( ! brush_state.n_anchors || ! __imel_brush_ready () )
+      return;
+
+ __imel_brush_sweep (image, brush_state.anchor, brush_state.n_anchors, pixel);
+}
+
+/* Forget the compiled brush and the current path */
+void __imel_brush_reset (void)
+{
+ __imel_brush_compile (NULL);
+ brush_state.path = false;
+ brush_state.count = 0;
+}
+
+#endif
+
+/**
+ * @brief Set the spacing of the brush
+ *
+ * This function sets every how many points of a path the brush is
+ * copied: with a spacing of 1, the default, the brush is copied on every
+ * point, with a spacing of 4 on a point every 4. A point that isn't next
+ * to the previous one starts a new path and always gets a copy of the
+ * brush. The spacing isn't used in #IMEL_BRUSH_MODE_SWEPT mode.
+ *
+ * @param spacing Points from a copy of the brush to the next one
+ * @return TRUE on success, FALSE if @p spacing is 0.
+ * @see imel_enable_brush
+ * @see imel_brush_set_mode
+ */
+bool imel_brush_set_spacing (ImelSize spacing)
+{
+ return_var_if_fail (spacing, false);
+
+ brush_state.spacing = spacing;
+ brush_state.path = false;
+ brush_state.count = 0;
+
+ return true;
+}
+
+/**
+ * @brief Set how the brush is drawn
+ *
+ * In #IMEL_BRUSH_MODE_STAMP mode, the default, a copy of the brush is
+ * drawn with the top left corner on the points of the shapes. In
+ * #IMEL_BRUSH_MODE_SWEPT mode the pixels of the brush that aren't
+ * transparent are a shape: the area swept by that shape along a line is
+ * drawn once with the color and level of the line, so the pixels with an
+ * alpha aren't blended again by each point of the line.
+ *
+ * @param mode Mode of the brush
+ * @return TRUE on success, FALSE if @p mode isn't valid.
+ * @see ImelBrushMode
+ * @see imel_enable_brush
+ */
+bool imel_brush_set_mode (ImelBrushMode mode)
+{
+ return_var_if_fail (mode == IMEL_BRUSH_MODE_STAMP || mode == IMEL_BRUSH_MODE_SWEPT, false);
+
+ brush_state.mode = mode;
+
+ return true;
+}
@@ -0,0 +1,790 @@
+/*
+ * "canvas.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "header.h"
+#include "polygon.h"
+/**
+ * @file canvas.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to record draw commands and draw
+ *        them later tile by tile.
+ *
+ * The image is split in square tiles and each command is assigned to the
+ * tiles touched by its bounding box. Each tile is drawn by a thread through
+ * a view: an #ImelImage whose rows point inside the rows of the image, so
+ * the draw functions clip each command to the tile on their own.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+extern void imel_pixel_copy (ImelPixel *, ImelPixel);
+extern ImelImage *imel_image_new (ImelSize width, ImelSize height);
+extern void imel_image_free (ImelImage *image);
+extern void imel_font_write_string (ImelImage *image, ImelSize x, ImelSize y,
+                                    const char *string, ImelSize px, ImelPixel pixel);
+extern ImelPointArray *imel_point_array_new (ImelSize size);
+extern void imel_point_array_destroy (ImelPointArray *array);
+extern bool imel_draw_antialiased_line (ImelImage *image, double x1, double y1, double x2, double y2,
+                                        ImelPixel pixel);
+extern void imel_draw_antialiased_circle (ImelImage *image, double x, double y, double radius, ImelPixel pxl);
+
+extern void __imel_draw_line_raster (ImelImage *image, long x0, long y0, long x1, long y1, bool brush,
+                                     ImelPixel pixel);
+extern void __imel_draw_fill_round_box (ImelImage *image, long x0, long y0, long x1, long y1,
+                                        long a, long b, bool closed, bool brush, ImelPixel pixel);
+extern void __imel_thread_run (ImelSize n, ImelSize grain, ImelBandFuncPtr func, ImelGenericPtr data);
+
+/* Side of the tiles */
+#define __IMEL_CANVAS_TILE 64
+
+/* Coordinates of the bounding boxes are kept far from the limits of long */
+#define __IMEL_CANVAS_BOUND 1e15
+
+typedef struct ___imel_canvas_run {
+               ImelCanvas *canvas;
+               ImelImage *image;
+               ImelSize tiles_x;
+               ImelSize *active;   /* Tiles touched by at least a command */
+               size_t *first;      /* First entry of each tile in @command */
+               ImelSize *command;  /* Commands of each tile, in order */
+               __ImelPolygon *polygon;   /* Sorted edges of each filled polygon */
+               __ImelCoverage *coverage; /* Sides of each filled anti-aliased polygon */
+        } __ImelCanvasRun;
+
+static long __imel_canvas_bound (double value)
+{
+ if ( ! (value > -__IMEL_CANVAS_BOUND) )
+      return (long) -__IMEL_CANVAS_BOUND;
+
+ return ( value < __IMEL_CANVAS_BOUND ) ? (long) value : (long) __IMEL_CANVAS_BOUND;
+}
+
+/* Add a command of @type with the bounding box from (x1, y1) to (x2, y2) */
+static ImelCanvasCommand *__imel_canvas_add (ImelCanvas *canvas, ImelCanvasCommandType type, ImelPixel pixel,
+                                             long x1, long y1, long x2, long y2)
+{
+ ImelCanvasCommand *command;
+
+ if ( canvas->n_commands == canvas->size ) {
+      command = (ImelCanvasCommand *) realloc (canvas->commands, sizeof (ImelCanvasCommand) *
+                                               (canvas->size ? canvas->size << 1 : 64));
+      return_var_if_fail (command, NULL);
+
+      canvas->commands = command;
+      canvas->size = canvas->size ? canvas->size << 1 : 64;
+ }
+
+ command = &(canvas->commands[canvas->n_commands++]);
+ command->type = type;
+ command->pixel = pixel;
+ command->x1 = ( x1 < x2 ) ? x1 : x2;
+ command->y1 = ( y1 < y2 ) ? y1 : y2;
+ command->x2 = ( x1 < x2 ) ? x2 : x1;
+ command->y2 = ( y1 < y2 ) ? y2 : y1;
+
+ return command;
+}
+
+/* Polygons keep a copy of their vertices, @pad grows the bounding box */
+static bool __imel_canvas_add_polygon (ImelCanvas *canvas, ImelCanvasCommandType type, const ImelPointArray *points,
+                                       ImelFillRule rule, ImelPixel pixel, long pad)
+{
+ ImelCanvasCommand *command;
+ ImelPointArray *copy;
+ long x1, y1, x2, y2;
+ ImelSize i;
+
+ x1 = x2 = points->point[0].x;
+ y1 = y2 = points->point[0].y;
+ for ( i = 1; i < points->n_points; i++ ) {
+       x1 = ( (long) points->point[i].x < x1 ) ? (long) points->point[i].x : x1;
+       x2 = ( (long) points->point[i].x > x2 ) ? (long) points->point[i].x : x2;
+       y1 = ( (long) points->point[i].y < y1 ) ? (long) points->point[i].y : y1;
+       y2 = ( (long) points->point[i].y > y2 ) ? (long) points->point[i].y : y2;
+ }
+
+ copy = imel_point_array_new (points->n_points);
+ return_var_if_fail (copy, false);
+
+ memcpy (copy->point, points->point, sizeof (ImelPoint) * points->n_points);
+ copy->n_points = points->n_points;
+
+ command = __imel_canvas_add (canvas, type, pixel, x1 - pad, y1 - pad, x2 + pad, y2 + pad);
+ if ( ! command ) {
+      imel_point_array_destroy (copy);
+      return false;
+ }
+
+ command->argument.polygon.points = copy;
+ command->argument.polygon.rule = rule;
+
+ return true;
+}
+
+static bool __imel_canvas_add_image (ImelCanvas *canvas, ImelImage *image, long x, long y, bool owned)
+{
+ ImelCanvasCommand *command;
+
+ command = __imel_canvas_add (canvas, IMEL_CANVAS_IMAGE, image->pixel[0][0], x, y,
+                              x + (long) image->width - 1, y + (long) image->height - 1);
+ return_var_if_fail (command, false);
+
+ command->argument.image.image = image;
+ command->argument.image.x = x;
+ command->argument.image.y = y;
+ command->argument.image.owned = owned;
+
+ return true;
+}
+
+static void __imel_canvas_command_free (ImelCanvasCommand *command)
+{
+ if ( command->type == IMEL_CANVAS_FILLED_POLYGON || command->type == IMEL_CANVAS_FILLED_ANTIALIASED_POLYGON )
+      imel_point_array_destroy (command->argument.polygon.points);
+ else if ( command->type == IMEL_CANVAS_IMAGE && command->argument.image.owned )
+      imel_image_free (command->argument.image.image);
+}
+
+/* Sides of the polygons of @run, made once for all the tiles */
+static void __imel_canvas_polygons (__ImelCanvasRun *run)
+{
+ const ImelCanvasCommand *command;
+ const ImelPointArray *points;
+ ImelSize k, i, j;
+
+ for ( k = 0; k < run->canvas->n_commands; k++ ) {
+       command = &(run->canvas->commands[k]);
+       __imel_polygon_init (&(run->polygon[k]));
+       __imel_coverage_init (&(run->coverage[k]));
+
+       if ( command->type == IMEL_CANVAS_FILLED_POLYGON ) {
+            points = command->argument.polygon.points;
+            for ( i = 0; i < points->n_points; i++ ) {
+                  j = ( i + 1 < points->n_points ) ? i + 1 : 0;
+                  __imel_polygon_add_edge (&(run->polygon[k]), points->point[i].x, points->point[i].y,
+                                           points->point[j].x, points->point[j].y);
+            }
+            __imel_polygon_sort (&(run->polygon[k]));
+       }
+       else if ( command->type == IMEL_CANVAS_FILLED_ANTIALIASED_POLYGON ) {
+            points = command->argument.polygon.points;
+            for ( i = 0; i < points->n_points; i++ ) {
+                  j = ( i + 1 < points->n_points ) ? i + 1 : 0;
+                  __imel_coverage_add_line (&(run->coverage[k]), points->point[i].x, points->point[i].y,
+                                            points->point[j].x, points->point[j].y);
+            }
+       }
+ }
+}
+
+/* Draw the command @k of @run in @view, a tile of the image with the top
+ * left corner at (tx, ty) */
+static void __imel_canvas_draw (const __ImelCanvasRun *run, ImelImage *view, long tx, long ty, ImelSize k)
+{
+ const ImelCanvasCommand *command = &(run->canvas->commands[k]);
+ const long *v = command->argument.value;
+ const double *c = command->argument.coord;
+ ImelImage *image;
+ long x, y, x1, x2;
+
+ switch ( command->type ) {
+    case IMEL_CANVAS_POINT:
+          x = v[0] - tx;
+          y = v[1] - ty;
+          if ( x < (long) view->width && y < (long) view->height )
+               imel_pixel_copy (&(view->pixel[y][x]), command->pixel);
+          break;
+    case IMEL_CANVAS_LINE:
+          __imel_draw_line_raster (view, v[0] - tx, v[1] - ty, v[2] - tx, v[3] - ty, false, command->pixel);
+          break;
+    case IMEL_CANVAS_RECT:
+          if ( v[4] ) {
+               __imel_draw_fill_round_box (view, v[0] - tx, v[1] - ty, v[2] - tx, v[3] - ty,
+                                           0, 0, true, false, command->pixel);
+               break;
+          }
+
+          /* The same lines of imel_draw_rect () */
+          __imel_draw_line_raster (view, v[0] - tx, v[1] - ty, v[2] - tx, v[1] - ty, false, command->pixel);
+          __imel_draw_line_raster (view, v[0] - tx, v[1] - ty, v[0] - tx, v[3] - ty, false, command->pixel);
+          __imel_draw_line_raster (view, v[2] - tx, v[1] - ty, v[2] - tx, v[3] - ty, false, command->pixel);
+          __imel_draw_line_raster (view, v[0] - tx, v[3] - ty, v[2] + 1 - tx, v[3] - ty, false, command->pixel);
+          break;
+    case IMEL_CANVAS_FILLED_CIRCLE:
+          __imel_draw_fill_round_box (view, v[0] - tx, v[1] - ty, v[0] - tx, v[1] - ty,
+                                      v[2], v[2], false, false, command->pixel);
+          break;
+    case IMEL_CANVAS_ANTIALIASED_LINE:
+          imel_draw_antialiased_line (view, c[0] - tx, c[1] - ty, c[2] - tx, c[3] - ty, command->pixel);
+          break;
+    case IMEL_CANVAS_ANTIALIASED_CIRCLE:
+          imel_draw_antialiased_circle (view, c[0] - tx, c[1] - ty, c[2], command->pixel);
+          break;
+    case IMEL_CANVAS_FILLED_POLYGON:
+          __imel_polygon_fill_at (view, &(run->polygon[k]), tx, ty, command->argument.polygon.rule,
+                                  false, command->pixel);
+          break;
+    case IMEL_CANVAS_FILLED_ANTIALIASED_POLYGON:
+          __imel_coverage_fill_at (view, &(run->coverage[k]), tx, ty, command->argument.polygon.rule,
+                                   command->pixel);
+          break;
+    case IMEL_CANVAS_IMAGE:
+          /* Same as imel_image_insert_image (), clipped to the tile */
+          image = command->argument.image.image;
+          x1 = ( command->x1 > tx ) ? command->x1 - tx : 0;
+          x2 = ( command->x2 - tx < (long) view->width ) ? command->x2 - tx : (long) view->width - 1;
+          y = ( command->y1 > ty ) ? command->y1 - ty : 0;
+
+          for ( ; y < (long) view->height && y + ty <= command->y2; y++ ) {
+                for ( x = x1; x <= x2; x++ )
+                      imel_pixel_copy (&(view->pixel[y][x]),
+                                       image->pixel[y + ty - command->y1][x + tx - command->x1]);
+          }
+          break;
+    default: break;
+ }
+}
+
+/* Draw the active tiles [start, end) */
+static void __imel_canvas_tiles (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelCanvasRun *run = (__ImelCanvasRun *) data;
+ ImelPixel *rows[__IMEL_CANVAS_TILE];
+ ImelImage view;
+ ImelSize i, tile, y;
+ long tx, ty;
+ size_t k;
+
+ (void) band;
+
+ for ( i = start; i < end; i++ ) {
+       tile = run->active[i];
+       tx = (long) (tile % run->tiles_x) * __IMEL_CANVAS_TILE;
+       ty = (long) (tile / run->tiles_x) * __IMEL_CANVAS_TILE;
+
+       view.width = ( run->image->width - tx < __IMEL_CANVAS_TILE ) ? run->image->width - tx : __IMEL_CANVAS_TILE;
+       view.height = ( run->image->height - ty < __IMEL_CANVAS_TILE ) ? run->image->height - ty : __IMEL_CANVAS_TILE;
+       view.pixel = rows;
+       view.generation = 0;
+       view.stats = NULL;
+       for ( y = 0; y < view.height; y++ )
+             rows[y] = run->image->pixel[ty + y] + tx;
+
+       for ( k = run->first[tile]; k < run->first[tile + 1]; k++ )
+             __imel_canvas_draw (run, &view, tx, ty, run->command[k]);
+ }
+}
+
+/* Tiles touched by @command, FALSE if it's outside the image */
+static bool __imel_canvas_tile_range (const ImelCanvasCommand *command, ImelSize tiles_x, ImelSize tiles_y,
+                                      ImelSize *x1, ImelSize *y1, ImelSize *x2, ImelSize *y2)
+{
+ if ( command->x2 < 0 || command->y2 < 0 || command->x1 > command->x2 || command->y1 > command->y2 )
+      return false;
+
+ if ( command->x1 / __IMEL_CANVAS_TILE >= (long) tiles_x || command->y1 / __IMEL_CANVAS_TILE >= (long) tiles_y )
+      return false;
+
+ *x1 = ( command->x1 < 0 ) ? 0 : command->x1 / __IMEL_CANVAS_TILE;
+ *y1 = ( command->y1 < 0 ) ? 0 : command->y1 / __IMEL_CANVAS_TILE;
+ *x2 = ( command->x2 / __IMEL_CANVAS_TILE < (long) tiles_x ) ? command->x2 / __IMEL_CANVAS_TILE : tiles_x - 1;
+ *y2 = ( command->y2 / __IMEL_CANVAS_TILE < (long) tiles_y ) ? command->y2 / __IMEL_CANVAS_TILE : tiles_y - 1;
+
+ return true;
+}
+
+#endif
+
+/**
+ * @brief Make a new canvas
+ *
+ * This function makes a new empty canvas. The draw commands added to the
+ * canvas aren't drawn immediately but recorded, with their bounding box,
+ * and drawn by #imel_canvas_render: the image is split in tiles, each
+ * command is clipped to the tiles it touches and the tiles are drawn by
+ * many threads at the same time. Commands are drawn in the order they
+ * were added, so the result is the same of calling the draw functions
+ * one after the other.
+ *
+ * @code
+ * ImelImage *image = imel_image_new (800, 600);
+ * ImelCanvas *canvas = imel_canvas_new ();
+ * ImelPixel red = imel_pixel_new (0xff, 0, 0, 0);
+ * ImelSize i;
+ *
+ * for ( i = 0; i < 1000; i++ )
+ *       imel_canvas_draw_line (canvas, 0, i % 600, 799, (i * 7) % 600, red);
+ * imel_canvas_write_string (canvas, 10, 10, "Imel", IMEL_FONT_SIZE_MEDIUM, red);
+ *
+ * imel_canvas_render (canvas, image);
+ * imel_canvas_free (canvas);
+ * @endcode
+ *
+ * @return A new canvas or NULL on error.
+ * @see imel_canvas_render
+ * @see imel_canvas_free
+ */
+ImelCanvas *imel_canvas_new (void)
+{
+ ImelCanvas *canvas;
+
+ canvas = (ImelCanvas *) malloc (sizeof (ImelCanvas));
+ return_var_if_fail (canvas, NULL);
+
+ canvas->n_commands = 0;
+ canvas->size = 0;
+ canvas->commands = NULL;
+
+ return canvas;
+}
+
+/**
+ * @brief Remove all the commands of a canvas
+ *
+ * @param canvas Canvas to clear
+ * @see imel_canvas_new
+ */
+void imel_canvas_clear (ImelCanvas *canvas)
+{
+ ImelSize i;
+
+ return_if_fail (canvas);
+
+ for ( i = 0; i < canvas->n_commands; i++ )
+       __imel_canvas_command_free (&(canvas->commands[i]));
+
+ canvas->n_commands = 0;
+}
+
+/**
+ * @brief Free a canvas
+ *
+ * @param canvas Canvas to free
+ * @see imel_canvas_new
+ */
+void imel_canvas_free (ImelCanvas *canvas)
+{
+ return_if_fail (canvas);
+
+ imel_canvas_clear (canvas);
+ free (canvas->commands);
+ free (canvas);
+}
+
+/**
+ * @brief Record a point
+ *
+ * @param canvas Canvas where record the command
+ * @param x Coordinate x of the point
+ * @param y Coordinate y of the point
+ * @param pixel Color and level of the point
+ * @return TRUE on success, FALSE on error.
+ * @see imel_draw_point
+ */
+bool imel_canvas_draw_point (ImelCanvas *canvas, ImelSize x, ImelSize y, ImelPixel pixel)
+{
+ ImelCanvasCommand *command;
+
+ return_var_if_fail (canvas, false);
+
+ command = __imel_canvas_add (canvas, IMEL_CANVAS_POINT, pixel, x, y, x, y);
+ return_var_if_fail (command, false);
+
+ command->argument.value[0] = x;
+ command->argument.value[1] = y;
+
+ return true;
+}
+
+/**
+ * @brief Record a line
+ *
+ * @param canvas Canvas where record the command
+ * @param x1 Start x coordinate
+ * @param y1 Start y coordinate
+ * @param x2 End x coordinate
+ * @param y2 End y coordinate
+ * @param pixel Color and level of the line
+ * @return TRUE on success, FALSE on error.
+ * @see imel_draw_line
+ */
+bool imel_canvas_draw_line (ImelCanvas *canvas, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2, ImelPixel pixel)
+{
+ ImelCanvasCommand *command;
+
+ return_var_if_fail (canvas, false);
+
+ command = __imel_canvas_add (canvas, IMEL_CANVAS_LINE, pixel, x1, y1, x2, y2);
+ return_var_if_fail (command, false);
+
+ command->argument.value[0] = x1;
+ command->argument.value[1] = y1;
+ command->argument.value[2] = x2;
+ command->argument.value[3] = y2;
+
+ return true;
+}
+
+/**
+ * @brief Record a rectangle ( filled or not )
+ *
+ * @param canvas Canvas where record the command
+ * @param x1 Start x coordinate of the rectangle
+ * @param y1 Start y coordinate of the rectangle
+ * @param x2 End x coordinate of the rectangle
+ * @param y2 End y coordinate of the rectangle
+ * @param pixel Color and level of the rectangle
+ * @param fill TRUE for filled rectangle, else FALSE
+ * @return TRUE on success, FALSE on error.
+ * @see imel_draw_rect
+ */
+bool imel_canvas_draw_rect (ImelCanvas *canvas, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2,
+                            ImelPixel pixel, bool fill)
+{
+ ImelCanvasCommand *command;
+ long *v;
+
+ return_var_if_fail (canvas, false);
+
+ command = __imel_canvas_add (canvas, IMEL_CANVAS_RECT, pixel, x1, y1, (long) x2 + 1, y2);
+ return_var_if_fail (command, false);
+
+ /* Same order of imel_draw_rect () */
+ v = command->argument.value;
+ v[0] = ( y1 > y2 ) ? x2 : x1;
+ v[1] = ( y1 > y2 ) ? y2 : y1;
+ v[2] = ( y1 > y2 ) ? x1 : x2;
+ v[3] = ( y1 > y2 ) ? y1 : y2;
+ if ( fill && v[0] > v[2] ) {
+      v[4] = v[0];
+      v[0] = v[2];
+      v[2] = v[4];
+ }
+ v[4] = fill;
+
+ command->x1 = ( x1 < x2 ) ? x1 : x2;
+ command->x2 = ( x1 < x2 ) ? (long) x2 + 1 : (long) x1 + 1;
+
+ return true;
+}
+
+/**
+ * @brief Record a filled circle
+ *
+ * @param canvas Canvas where record the command
+ * @param x Coordinate x of the circle center
+ * @param y Coordinate y of the circle center
+ * @param radius Radius of the circle in pixels
+ * @param pxl Color and level of the circle
+ * @return TRUE on success, FALSE on error.
+ * @see imel_draw_filled_circle
+ */
+bool imel_canvas_draw_filled_circle (ImelCanvas *canvas, ImelSize x, ImelSize y, ImelSize radius, ImelPixel pxl)
+{
+ ImelCanvasCommand *command;
+
+ return_var_if_fail (canvas, false);
+
+ command = __imel_canvas_add (canvas, IMEL_CANVAS_FILLED_CIRCLE, pxl, (long) x - radius, (long) y - radius,
+                              (long) x + radius, (long) y + radius);
+ return_var_if_fail (command, false);
+
+ command->argument.value[0] = x;
+ command->argument.value[1] = y;
+ command->argument.value[2] = radius;
+
+ return true;
+}
+
+/**
+ * @brief Record a filled polygon
+ *
+ * The vertices in @p points are copied in the canvas.
+ *
+ * @param canvas Canvas where record the command
+ * @param points Vertices of the polygon, at least 3
+ * @param rule Rule to choose the points inside the polygon
+ * @param pixel Color and level of the polygon
+ * @return TRUE on success, FALSE on error.
+ * @see imel_draw_filled_polygon
+ */
+bool imel_canvas_draw_filled_polygon (ImelCanvas *canvas, const ImelPointArray *points, ImelFillRule rule,
+                                      ImelPixel pixel)
+{
+ return_var_if_fail (canvas && points && points->n_points > 2, false);
+
+ return __imel_canvas_add_polygon (canvas, IMEL_CANVAS_FILLED_POLYGON, points, rule, pixel, 0);
+}
+
+/**
+ * @brief Record an anti-aliased line
+ *
+ * @param canvas Canvas where record the command
+ * @param x1 Start x coordinate
+ * @param y1 Start y coordinate
+ * @param x2 End x coordinate
+ * @param y2 End y coordinate
+ * @param pixel Color and level of the line
+ * @return TRUE on success, FALSE on error or if a coordinate isn't finite.
+ * @see imel_draw_antialiased_line
+ */
+bool imel_canvas_draw_antialiased_line (ImelCanvas *canvas, double x1, double y1, double x2, double y2,
+                                        ImelPixel pixel)
+{
+ ImelCanvasCommand *command;
+
+ return_var_if_fail (canvas && __IMEL_FINITE (x1) && __IMEL_FINITE (y1) && __IMEL_FINITE (x2) &&
+                     __IMEL_FINITE (y2), false);
+
+ command = __imel_canvas_add (canvas, IMEL_CANVAS_ANTIALIASED_LINE, pixel,
+                              __imel_canvas_bound (floor (( x1 < x2 ) ? x1 : x2) - 1),
+                              __imel_canvas_bound (floor (( y1 < y2 ) ? y1 : y2) - 1),
+                              __imel_canvas_bound (ceil (( x1 > x2 ) ? x1 : x2) + 1),
+                              __imel_canvas_bound (ceil (( y1 > y2 ) ? y1 : y2) + 1));
+ return_var_if_fail (command, false);
+
+ command->argument.coord[0] = x1;
+ command->argument.coord[1] = y1;
+ command->argument.coord[2] = x2;
+ command->argument.coord[3] = y2;
+
+ return true;
+}
+
+/**
+ * @brief Record an anti-aliased circle
+ *
+ * @param canvas Canvas where record the command
+ * @param x Center coordinate x
+ * @param y Center coordinate y
+ * @param radius Radius of the circle
+ * @param pxl Color and level of the circle
+ * @return TRUE on success, FALSE on error or if a value isn't valid.
+ * @see imel_draw_antialiased_circle
+ */
+bool imel_canvas_draw_antialiased_circle (ImelCanvas *canvas, double x, double y, double radius, ImelPixel pxl)
+{
+ ImelCanvasCommand *command;
+
+ return_var_if_fail (canvas && __IMEL_FINITE (x) && __IMEL_FINITE (y) && radius > 0 && __IMEL_FINITE (radius),
+                     false);
+
+ command = __imel_canvas_add (canvas, IMEL_CANVAS_ANTIALIASED_CIRCLE, pxl,
+                              __imel_canvas_bound (floor (x - radius) - 1),
+                              __imel_canvas_bound (floor (y - radius) - 1),
+                              __imel_canvas_bound (ceil (x + radius) + 1),
+                              __imel_canvas_bound (ceil (y + radius) + 1));
+ return_var_if_fail (command, false);
+
+ command->argument.coord[0] = x;
+ command->argument.coord[1] = y;
+ command->argument.coord[2] = radius;
+
+ return true;
+}
+
+/**
+ * @brief Record a filled anti-aliased polygon
+ *
+ * The vertices in @p points are copied in the canvas.
+ *
+ * @param canvas Canvas where record the command
+ * @param points Vertices of the polygon, at least 3
+ * @param rule Rule to choose the points inside the polygon
+ * @param pixel Color and level of the polygon
+ * @return TRUE on success, FALSE on error.
+ * @see imel_draw_filled_antialiased_polygon
+ */
+bool imel_canvas_draw_filled_antialiased_polygon (ImelCanvas *canvas, const ImelPointArray *points,
+                                                  ImelFillRule rule, ImelPixel pixel)
+{
+ return_var_if_fail (canvas && points && points->n_points > 2, false);
+
+ return __imel_canvas_add_polygon (canvas, IMEL_CANVAS_FILLED_ANTIALIASED_POLYGON, points, rule, pixel, 1);
+}
+
+/**
+ * @brief Record the insertion of an image
+ *
+ * Only a reference to @p image is kept: it must not be changed or freed
+ * before the canvas is drawn.
+ *
+ * @param canvas Canvas where record the command
+ * @param image Image to insert
+ * @param x Coordinate x of the top left corner of @p image
+ * @param y Coordinate y of the top left corner of @p image
+ * @return TRUE on success, FALSE on error.
+ * @see imel_image_insert_image
+ */
+bool imel_canvas_insert_image (ImelCanvas *canvas, ImelImage *image, ImelSize x, ImelSize y)
+{
+ return_var_if_fail (canvas && image && image->width && image->height, false);
+
+ return __imel_canvas_add_image (canvas, image, x, y, false);
+}
+
+/**
+ * @brief Record a string written with the internal font
+ *
+ * The string is drawn once by this function in an image kept by the
+ * canvas, so writing it again in other tiles or other renders costs only
+ * the copy of its pixels.
+ *
+ * @param canvas Canvas where record the command
+ * @param x Start x coordinate
+ * @param y Start y coordinate
+ * @param string String to write
+ * @param px Font size, can be specified through ImelFontSize enum.
+ * @param pixel Color and level of the string
+ * @return TRUE on success, FALSE on error.
+ * @see imel_font_write_string
+ */
+bool imel_canvas_write_string (ImelCanvas *canvas, ImelSize x, ImelSize y, const char *string, ImelSize px,
+                               ImelPixel pixel)
+{
+ ImelSize columns = 0, rows = 1, length = 0;
+ ImelImage *text;
+ const char *c;
+
+ return_var_if_fail (canvas && string, false);
+
+ for ( c = string; *c; c++ ) {
+       length = ( *c == '\n' ) ? 0 : length + 1;
+       rows += ( *c == '\n' );
+       columns = ( length > columns ) ? length : columns;
+ }
+
+ if ( ! columns || ! px )
+      return true;
+
+ text = imel_image_new (columns * px, rows * px * 2);
+ return_var_if_fail (text, false);
+
+ imel_font_write_string (text, 0, 0, string, px, pixel);
+
+ if ( ! __imel_canvas_add_image (canvas, text, x, y, true) ) {
+      imel_image_free (text);
+      return false;
+ }
+
+ return true;
+}
+
+/**
+ * @brief Draw the commands of a canvas
+ *
+ * This function draws in @p image all the commands recorded in
+ * @p canvas, in the order they were added. The image is split in tiles of
+ * 64 x 64 pixels: each command is assigned to the tiles touched by its
+ * bounding box, the tiles without commands are skipped and the others are
+ * split between threads. Each command is clipped to each tile once, by
+ * the same functions that draw it directly in an image, so the result is
+ * the same of drawing the commands directly except for the anti-aliased
+ * ones, that can differ by one in the rounding of the pixels crossed by
+ * the side of a tile.
+ *
+ * The brush isn't used while drawing the canvas. The commands are kept,
+ * so the same canvas can be drawn again.
+ *
+ * @param canvas Canvas to draw
+ * @param image Image where draw the commands
+ * @see imel_canvas_new
+ * @see imel_thread_set_count
+ */
+void imel_canvas_render (ImelCanvas *canvas, ImelImage *image)
+{
+ __ImelCanvasRun run;
+ ImelSize tiles_y, n_active = 0, i, tx, ty, x1, y1, x2, y2;
+ size_t n_tiles, *next;
+
+ return_if_fail (canvas && image);
+
+ if ( ! canvas->n_commands || ! image->width || ! image->height )
+      return;
+
+ run.canvas = canvas;
+ run.image = image;
+ run.tiles_x = (image->width + __IMEL_CANVAS_TILE - 1) / __IMEL_CANVAS_TILE;
+ tiles_y = (image->height + __IMEL_CANVAS_TILE - 1) / __IMEL_CANVAS_TILE;
+ n_tiles = (size_t) run.tiles_x * tiles_y;
+
+ run.first = (size_t *) calloc (n_tiles + 1, sizeof (size_t));
+ next = (size_t *) malloc (sizeof (size_t) * n_tiles);
+ run.active = (ImelSize *) malloc (sizeof (ImelSize) * n_tiles);
+ run.command = NULL;
+ run.polygon = NULL;
+ run.coverage = NULL;
+ if ( ! run.first || ! next || ! run.active )
+      goto end;
+
+ /* Count the commands of each tile, then list them in order */
+ for ( i = 0; i < canvas->n_commands; i++ ) {
+       if ( ! __imel_canvas_tile_range (&(canvas->commands[i]), run.tiles_x, tiles_y, &x1, &y1, &x2, &y2) )
+            continue;
+
+       for ( ty = y1; ty <= y2; ty++ )
+             for ( tx = x1; tx <= x2; tx++ )
+                   run.first[ty * run.tiles_x + tx + 1]++;
+ }
+
+ for ( i = 0; i < n_tiles; i++ ) {
+       if ( run.first[i + 1] )
+            run.active[n_active++] = i;
+       run.first[i + 1] += run.first[i];
+       next[i] = run.first[i];
+ }
+
+ if ( ! n_active )
+      goto end;
+
+ run.command = (ImelSize *) malloc (sizeof (ImelSize) * run.first[n_tiles]);
+ run.polygon = (__ImelPolygon *) malloc (sizeof (__ImelPolygon) * canvas->n_commands);
+ run.coverage = (__ImelCoverage *) malloc (sizeof (__ImelCoverage) * canvas->n_commands);
+ if ( ! run.command || ! run.polygon || ! run.coverage )
+      goto end;
+
+ for ( i = 0; i < canvas->n_commands; i++ ) {
+       if ( ! __imel_canvas_tile_range (&(canvas->commands[i]), run.tiles_x, tiles_y, &x1, &y1, &x2, &y2) )
+            continue;
+
+       for ( ty = y1; ty <= y2; ty++ )
+             for ( tx = x1; tx <= x2; tx++ )
+                   run.command[next[ty * run.tiles_x + tx]++] = i;
+ }
+
+ __imel_canvas_polygons (&run);
+ __imel_thread_run (n_active, 1, __imel_canvas_tiles, &run);
+ image->generation++;
+
+ for ( i = 0; i < canvas->n_commands; i++ ) {
+       __imel_polygon_clear (&(run.polygon[i]));
+       __imel_coverage_clear (&(run.coverage[i]));
+ }
+
+end:
+ free (run.first);
+ free (next);
+ free (run.active);
+ free (run.command);
+ free (run.polygon);
+ free (run.coverage);
+}
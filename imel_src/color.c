@@ -62,7 +62,8 @@ void imel_color_set_background (ImelImage *image, ImelPixel pixel)
  for ( y = 0; y < image->height; y++ )
        for ( x = 0; x < image->width; x++ )
              imel_pixel_copy (&(image->pixel[y][x]), pixel);
-             
+
+ image->generation++;
 }
 
 static bool color_exists (ImelPixel **array, ImelPixel pxl)
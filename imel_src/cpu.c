@@ -0,0 +1,172 @@
+/*
+ * "cpu.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "header.h"
+#include "kernel.h"
+/**
+ * @file cpu.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to choose the kernels for the
+ *        instruction sets supported by the processor.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+#if defined (__x86_64__) || defined (__i386__)
+#define __IMEL_CPU_X86
+#elif defined (__aarch64__)
+#define __IMEL_CPU_NEON
+#endif
+
+extern bool imel_printf_debug (const char *function, const char *filename,
+                               const char *error_level, char *__format, ...);
+
+extern void __imel_kernels_generic (__ImelKernels *kernels);
+#ifdef __IMEL_CPU_X86
+extern void __imel_kernels_sse2 (__ImelKernels *kernels);
+extern void __imel_kernels_sse41 (__ImelKernels *kernels);
+extern void __imel_kernels_avx2 (__ImelKernels *kernels);
+extern void __imel_kernels_avx512 (__ImelKernels *kernels);
+#endif
+#ifdef __IMEL_CPU_NEON
+extern void __imel_kernels_neon (__ImelKernels *kernels);
+#endif
+
+static const char *cpu_level_name[] = { "generic", "sse2", "sse4.1", "avx2", "avx512", "neon" };
+
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+static ImelCpuLevel cpu_level;
+static __ImelKernels cpu_kernels;
+
+static ImelCpuLevel __imel_cpu_detect (void)
+{
+#ifdef __IMEL_CPU_X86
+ __builtin_cpu_init ();
+
+ if ( __builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512bw") )
+      return IMEL_CPU_LEVEL_AVX512;
+ if ( __builtin_cpu_supports ("avx2") )
+      return IMEL_CPU_LEVEL_AVX2;
+ if ( __builtin_cpu_supports ("sse4.1") )
+      return IMEL_CPU_LEVEL_SSE4_1;
+ if ( __builtin_cpu_supports ("sse2") )
+      return IMEL_CPU_LEVEL_SSE2;
+#endif
+#ifdef __IMEL_CPU_NEON
+ return IMEL_CPU_LEVEL_NEON;
+#endif
+
+ return IMEL_CPU_LEVEL_GENERIC;
+}
+
+/* TRUE if the kernels of @level can run where @detected is the best level */
+static bool __imel_cpu_is_available (ImelCpuLevel level, ImelCpuLevel detected)
+{
+ if ( level == IMEL_CPU_LEVEL_GENERIC || level == detected )
+      return true;
+
+ return detected != IMEL_CPU_LEVEL_NEON && level < detected;
+}
+
+static void __imel_cpu_init (void)
+{
+ const char *forced = getenv ("IMEL_CPU_LEVEL");
+ ImelCpuLevel detected = __imel_cpu_detect ();
+ int i;
+
+ cpu_level = detected;
+
+ if ( forced && *forced ) {
+      for ( i = 0; i <= IMEL_CPU_LEVEL_NEON; i++ ) {
+            if ( ! strcmp (forced, cpu_level_name[i]) )
+                 break;
+      }
+
+      if ( i > IMEL_CPU_LEVEL_NEON )
+           imel_printf_debug ("__imel_cpu_init", NULL, "warning",
+                              "IMEL_CPU_LEVEL '%s' unknown", forced);
+      else if ( ! __imel_cpu_is_available ((ImelCpuLevel) i, detected) )
+           imel_printf_debug ("__imel_cpu_init", NULL, "warning",
+                              "IMEL_CPU_LEVEL '%s' not supported, using '%s'",
+                              forced, cpu_level_name[detected]);
+      else cpu_level = (ImelCpuLevel) i;
+ }
+
+ switch ( cpu_level ) {
+#ifdef __IMEL_CPU_X86
+    case IMEL_CPU_LEVEL_AVX512:
+          __imel_kernels_avx512 (&cpu_kernels);
+          break;
+    case IMEL_CPU_LEVEL_AVX2:
+          __imel_kernels_avx2 (&cpu_kernels);
+          break;
+    case IMEL_CPU_LEVEL_SSE4_1:
+          __imel_kernels_sse41 (&cpu_kernels);
+          break;
+    case IMEL_CPU_LEVEL_SSE2:
+          __imel_kernels_sse2 (&cpu_kernels);
+          break;
+#endif
+#ifdef __IMEL_CPU_NEON
+    case IMEL_CPU_LEVEL_NEON:
+          __imel_kernels_neon (&cpu_kernels);
+          break;
+#endif
+    default:
+          cpu_level = IMEL_CPU_LEVEL_GENERIC;
+          __imel_kernels_generic (&cpu_kernels);
+          break;
+ }
+}
+
+/* Kernels for the best instruction set supported by the processor, chosen
+ * the first time this function is called. */
+const __ImelKernels *__imel_kernels (void)
+{
+ pthread_once (&cpu_once, __imel_cpu_init);
+
+ return &cpu_kernels;
+}
+
+#endif
+
+/**
+ * @brief Get the instruction set used by Imel
+ *
+ * This function returns the instruction set of the kernels used by Imel
+ * for the hot loops ( lookup tables, blending, convolution, resize,
+ * histograms, luma and pixel conversion ). The best one supported by the
+ * processor is chosen the first time Imel needs it.
+ *
+ * For testing, the environment variable IMEL_CPU_LEVEL can force a lower
+ * level: "generic", "sse2", "sse4.1", "avx2", "avx512" or "neon". Levels
+ * not supported by the processor are ignored.
+ *
+ * @return The instruction set used.
+ * @see ImelCpuLevel
+ */
+ImelCpuLevel imel_cpu_get_level (void)
+{
+ __imel_kernels ();
+
+ return cpu_level;
+}
@@ -22,6 +22,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include "header.h"
+#include "polygon.h"
+#include "kernel.h"
 
 /**
  * @file draw.c
@@ -45,7 +47,69 @@ extern void       imel_pixel_set_from_pixel (ImelPixel *, ImelPixel);
 extern void       imel_pixel_copy           (ImelPixel *, ImelPixel);
 extern ImelPixel  imel_pixel_new            (ImelColor, ImelColor, ImelColor, ImelLevel);
 extern ImelPixel  imel_pixel_union          (ImelPixel a, ImelPixel b, unsigned char _opacity);
-extern void       imel_image_insert_image   (ImelImage *dest, ImelImage *src, ImelSize sx, ImelSize sy);
+
+extern ImelImage *global_brush;
+
+extern void       __imel_brush_draw_span    (ImelImage *image, long x, long y, long length, ImelPixel pixel);
+extern bool       __imel_brush_sweep_begin  (void);
+extern void       __imel_brush_sweep_end    (ImelImage *image, ImelPixel pixel);
+extern void       __imel_gradient_fill      (ImelImage *image, const ImelGradient *gradient,
+                                             long x0, long y0, long x1, long y1);
+extern void       __imel_path_draw_curve    (ImelImage *image, const double *x, const double *y, int degree,
+                                             long steps, ImelPixel start, ImelPixel end);
+
+/* Axes up to this length keep the products of __imel_draw_ellipse_row in 64 bit */
+#define __IMEL_DRAW_AXIS_EXACT 46340
+
+/* Axes up to this length keep the decisions of the midpoint ellipse in 64 bit */
+#define __IMEL_DRAW_AXIS_MIDPOINT 32767
+
+/* Directions of the sides of an arc are scaled by this */
+#define __IMEL_DRAW_ARC_SCALE (1L << 24)
+
+typedef struct ___imel_ellipse_rows {
+               int64_t a;
+               int64_t b;
+               int64_t h;
+               uint64_t a2;
+               uint64_t b2;
+               uint64_t limit;
+               bool closed;
+               bool exact;
+        } __ImelEllipseRows;
+
+/* An outline drawn around (cx, cy), only the points inside the arc from
+ * the direction (ax, ay) to (bx, by) if @arc */
+typedef struct ___imel_outline {
+               ImelImage *image;
+               long cx;
+               long cy;
+               ImelPixel pixel;
+               bool clip;       /* Some points can be outside of image */
+               bool brush;
+               bool arc;
+               bool reflex;     /* The arc is longer than half a turn */
+               int64_t ax;
+               int64_t ay;
+               int64_t bx;
+               int64_t by;
+        } __ImelOutline;
+
+/* Dashes and shades of a line from (x, y) @length steps long along its
+ * longest axis: the pixels at the distance d along that axis are drawn if
+ * d modulo on + off is below @on, or all of them if @off is 0, and with
+ * each channel start + d * step, the step in 16.16 fixed point, if
+ * @shade */
+typedef struct ___imel_line_style {
+               long x;
+               long y;
+               bool x_major;
+               int64_t on;
+               int64_t off;
+               bool shade;
+               int64_t start[4];
+               int64_t step[4];
+        } __ImelLineStyle;
 
 #endif
 
@@ -76,14 +140,6 @@ static void long_int_swap (long int *a, long int *b)
  *b = c;
 }
 
-static void double_swap (double *a, double *b)
-{
- double c = *a;
- 
- *a = *b;
- *b = c;
-}
-
 /**
  * @brief Draw a single point in an image
  * 
@@ -118,16 +174,15 @@ void imel_draw_point (ImelImage *image, ImelSize x, ImelSize y, ImelPixel pixel)
  }
 
  imel_pixel_copy (&(image->pixel[y][x]), pixel);
+ image->generation++;
 }
 
 static void __imel_draw_point (ImelImage *image, ImelSize x, ImelSize y, ImelPixel pixel)
 {
- extern ImelImage *global_brush;
- 
  return_if_fail (image);
  
  if ( global_brush ) {
-      imel_image_insert_image (image, global_brush, x, y);
+      __imel_brush_draw_span (image, x, y, 1, pixel);
       return;
  }
  
@@ -162,11 +217,611 @@ void __imel_draw_put_pixel (ImelImage *image, ImelSize x, ImelSize y, ImelPixel
  imel_pixel_set_from_pixel (&(image->pixel[y][x]), pixel);
 }
 
+/* Copy @pixel on @length pixels from @p as imel_pixel_copy () does */
+void __imel_draw_pixels (ImelPixel *p, long length, ImelPixel pixel)
+{
+ ImelPixel *end = p + length;
+
+ if ( pixel.level < 0 ) {
+      for ( ; p < end; p++ )
+            imel_pixel_copy (p, pixel);
+ }
+ else {
+      for ( ; p < end; p++ )
+            *p = ( p->level > pixel.level ) ? *p : pixel;
+ }
+}
+
+/* Draw @length pixels of the row @y from @x as imel_pixel_copy () does,
+ * the span must be inside @image. With @brush each pixel is a point
+ * where the brush is drawn. */
+void __imel_draw_span (ImelImage *image, long x, long y, long length, bool brush, ImelPixel pixel)
+{
+ if ( brush ) {
+      __imel_brush_draw_span (image, x, y, length, pixel);
+      return;
+ }
+
+ __imel_draw_pixels (image->pixel[y] + x, length, pixel);
+}
+
+/* Steps of a line of @major steps, where the step i moves the minor
+ * coordinate by floor ((2 * i * minor + major) / (2 * major)), that keep
+ * that offset in [lo, hi]. [*first, *last] is narrowed to them, FALSE if
+ * there aren't. */
+static bool __imel_draw_clip_steps (int64_t major, int64_t minor, int64_t lo, int64_t hi,
+                                    int64_t *first, int64_t *last)
+{
+ int64_t n, d;
+
+ if ( hi < lo || hi < 0 )
+      return false;
+
+ if ( ! minor )
+      return lo <= 0;
+
+ d = 2 * minor;
+ if ( lo > 0 ) {
+      n = (2 * lo - 1) * major;
+      n = (n + d - 1) / d;
+      *first = ( n > *first ) ? n : *first;
+ }
+
+ n = (2 * hi + 1) * major;
+ n = (n + d - 1) / d - 1;
+ *last = ( n < *last ) ? n : *last;
+
+ return *first <= *last;
+}
+
+/* @style of a line from (x0, y0) to (x1, y1) with dashes @on pixels long
+ * and @off apart, the colors going from @start to @end */
+static void __imel_draw_line_style_init (__ImelLineStyle *style, long x0, long y0, long x1, long y1,
+                                         long on, long off, ImelPixel start, ImelPixel end)
+{
+ int64_t a[4], b[4], length;
+ int i;
+
+ style->x = x0;
+ style->y = y0;
+ style->x_major = labs (x1 - x0) > labs (y1 - y0);
+ style->on = on;
+ style->off = off;
+
+ a[0] = start.red;
+ a[1] = start.green;
+ a[2] = start.blue;
+ a[3] = start.level;
+ b[0] = end.red;
+ b[1] = end.green;
+ b[2] = end.blue;
+ b[3] = end.level;
+
+ length = style->x_major ? labs (x1 - x0) : labs (y1 - y0);
+ style->shade = false;
+ for ( i = 0; i < 4; i++ ) {
+       style->start[i] = a[i];
+       style->step[i] = ( length ) ? (b[i] - a[i]) * 65536 / length : 0;
+       style->shade = style->shade || style->step[i];
+ }
+}
+
+/* Distance of the pixel at (@x, @y) from the start of the line of @style */
+static int64_t __imel_draw_line_distance (const __ImelLineStyle *style, long x, long y)
+{
+ return style->x_major ? labs (x - style->x) : labs (y - style->y);
+}
+
+/* TRUE if the pixel at (@x, @y) is on a dash of @style */
+static bool __imel_draw_line_dash (const __ImelLineStyle *style, long x, long y)
+{
+ return ! style->off || __imel_draw_line_distance (style, x, y) % (style->on + style->off) < style->on;
+}
+
+/* Color of the pixel at (@x, @y) shaded by @style, rounded */
+static ImelPixel __imel_draw_line_shade (const __ImelLineStyle *style, long x, long y)
+{
+ int64_t d = __imel_draw_line_distance (style, x, y), c[4], v;
+ int i;
+
+ for ( i = 0; i < 4; i++ ) {
+       v = d * style->step[i];
+       c[i] = style->start[i] + (( v >= 0 ) ? (v + 32768) / 65536 : -((32768 - v) / 65536));
+ }
+
+ return imel_pixel_new ((ImelColor) c[0], (ImelColor) c[1], (ImelColor) c[2], (ImelLevel) c[3]);
+}
+
+/* Draw @length pixels of the row @y from @x as __imel_draw_span (), only
+ * the ones on the dashes of @style and shaded by it, if any */
+static void __imel_draw_line_span (ImelImage *image, long x, long y, long length, const __ImelLineStyle *style,
+                                   bool brush, ImelPixel pixel)
+{
+ long i, end;
+
+ if ( ! style || (! style->off && ! style->shade) ) {
+      __imel_draw_span (image, x, y, length, brush, pixel);
+      return;
+ }
+
+ if ( style->shade ) {
+      for ( i = 0; i < length; i++ )
+            if ( __imel_draw_line_dash (style, x + i, y) )
+                 __imel_draw_span (image, x + i, y, 1, brush, __imel_draw_line_shade (style, x + i, y));
+      return;
+ }
+
+ /* A span for each dash, the spaces are skipped */
+ for ( i = 0; i < length; ) {
+       for ( end = i; end < length && __imel_draw_line_dash (style, x + end, y); end++ );
+       if ( end > i )
+            __imel_draw_span (image, x + i, y, end - i, brush, pixel);
+
+       for ( i = end; i < length && ! __imel_draw_line_dash (style, x + i, y); i++ );
+ }
+}
+
+/* Integer Bresenham line from (x0, y0) to (x1, y1). The steps go along
+ * the longest axis from the lower to the higher coordinate, which is
+ * excluded, the lower one is excluded too if @lower is FALSE. The line is
+ * clipped to @image once and the pixels on the same row are drawn as a
+ * single span, with the brush only if @brush is TRUE, dashed and shaded
+ * by @style if it isn't NULL. */
+static void __imel_draw_line_style (ImelImage *image, long x0, long y0, long x1, long y1, bool lower, bool brush,
+                                    const __ImelLineStyle *style, ImelPixel pixel)
+{
+ int64_t u0, v0, major, minor, size_u, size_v, first, last, i, q, r, start;
+ bool x_major, sweep;
+ int sv;
+
+ return_if_fail (image);
+
+ x_major = labs (x1 - x0) > labs (y1 - y0);
+ if ( (x_major && x0 > x1) || (! x_major && y0 > y1) ) {
+      long_int_swap (&x0, &x1);
+      long_int_swap (&y0, &y1);
+ }
+
+ u0 = x_major ? x0 : y0;
+ v0 = x_major ? y0 : x0;
+ major = x_major ? x1 - x0 : y1 - y0;
+ minor = x_major ? y1 - y0 : x1 - x0;
+ sv = ( minor < 0 ) ? -1 : 1;
+ minor = ( minor < 0 ) ? -minor : minor;
+ size_u = x_major ? image->width : image->height;
+ size_v = x_major ? image->height : image->width;
+
+ if ( ! major || ! size_u || ! size_v )
+      return;
+
+ /* Keeps 2 * step * minor inside 64 bit */
+ if ( major > (1L << 30) ) {
+      __imel_draw_line_style (image, x0, y0, x0 + (x1 - x0) / 2, y0 + (y1 - y0) / 2, lower, brush,
+                              style, pixel);
+      __imel_draw_line_style (image, x0 + (x1 - x0) / 2, y0 + (y1 - y0) / 2, x1, y1, true, brush,
+                              style, pixel);
+      return;
+ }
+
+ first = ( u0 < 0 ) ? -u0 : ! lower;
+ last = ( u0 + major > size_u ) ? size_u - 1 - u0 : major - 1;
+ if ( first > last )
+      return;
+
+ if ( sv > 0 ) {
+      if ( ! __imel_draw_clip_steps (major, minor, -v0, size_v - 1 - v0, &first, &last) )
+           return;
+ }
+ else if ( ! __imel_draw_clip_steps (major, minor, v0 - (size_v - 1), v0, &first, &last) )
+      return;
+
+ q = (2 * first * minor + major) / (2 * major);
+ r = (2 * first * minor + major) % (2 * major);
+ sweep = brush && ! style && __imel_brush_sweep_begin ();
+
+ if ( ! x_major ) {
+      for ( i = first; i <= last; i++ ) {
+            __imel_draw_line_span (image, v0 + sv * q, u0 + i, 1, style, brush, pixel);
+
+            r += 2 * minor;
+            if ( r >= 2 * major ) {
+                 r -= 2 * major;
+                 q++;
+            }
+      }
+
+      if ( sweep )
+           __imel_brush_sweep_end (image, pixel);
+      return;
+ }
+
+ for ( i = start = first; i <= last; i++ ) {
+       r += 2 * minor;
+       if ( r >= 2 * major || i == last ) {
+            __imel_draw_line_span (image, u0 + start, v0 + sv * q, i - start + 1, style, brush, pixel);
+            start = i + 1;
+       }
+
+       if ( r >= 2 * major ) {
+            r -= 2 * major;
+            q++;
+       }
+ }
+
+ if ( sweep )
+      __imel_brush_sweep_end (image, pixel);
+}
+
+/* As __imel_draw_line_style (), without dashes and shades */
+void __imel_draw_line_part (ImelImage *image, long x0, long y0, long x1, long y1, bool lower, bool brush,
+                            ImelPixel pixel)
+{
+ __imel_draw_line_style (image, x0, y0, x1, y1, lower, brush, NULL, pixel);
+}
+
+/* As __imel_draw_line_part (), with the lower end */
+void __imel_draw_line_raster (ImelImage *image, long x0, long y0, long x1, long y1, bool brush, ImelPixel pixel)
+{
+ __imel_draw_line_part (image, x0, y0, x1, y1, true, brush, pixel);
+}
+
+/* Draw the pixels of the row @y from @x0 to @x1 included, clipped to @image */
+void __imel_draw_fill_span (ImelImage *image, long x0, long x1, long y, bool brush, ImelPixel pixel)
+{
+ if ( y < 0 || y >= (long) image->height )
+      return;
+
+ x0 = ( x0 < 0 ) ? 0 : x0;
+ x1 = ( x1 >= (long) image->width ) ? (long) image->width - 1 : x1;
+ if ( x0 > x1 )
+      return;
+
+ __imel_draw_span (image, x0, y, x1 - x0 + 1, brush, pixel);
+}
+
+/* Blend @pixel on @length pixels of the row @y from @x, each one with the
+ * opacity in @coverage, clipped to @image. Brushes aren't used. */
+void __imel_draw_cover_span (ImelImage *image, long x, long y, const unsigned char *coverage, long length,
+                             ImelPixel pixel)
+{
+ if ( y < 0 || y >= (long) image->height )
+      return;
+
+ if ( x < 0 ) {
+      coverage -= x;
+      length += x;
+      x = 0;
+ }
+
+ length = ( x + length > (long) image->width ) ? (long) image->width - x : length;
+ if ( length <= 0 )
+      return;
+
+ __imel_kernels ()->cover_row (image->pixel[y] + x, coverage, length, pixel);
+}
+
+/* Blend @pixel on the pixel at (@x, @y) with @coverage in [0, 1] */
+static void __imel_draw_cover (ImelImage *image, double x, double y, double coverage, ImelPixel pixel)
+{
+ unsigned char c;
+
+ if ( x < 0 || y < 0 || x >= image->width || y >= image->height || coverage <= 0 )
+      return;
+
+ c = ( coverage >= 1 ) ? 255 : (unsigned char) (coverage * 255 + 0.5);
+ __imel_draw_cover_span (image, (long) x, (long) y, &c, 1, pixel);
+}
+
+/* Split @coverage between the pixel at @v on the minor axis of a curve
+ * and the next one, (u, v) are (y, x) if @swap */
+static void __imel_draw_cover_pair (ImelImage *image, double u, double v, double coverage, bool swap,
+                                    ImelPixel pixel)
+{
+ double base = floor (v), part = v - base;
+
+ if ( swap ) {
+      __imel_draw_cover (image, base, u, (1 - part) * coverage, pixel);
+      __imel_draw_cover (image, base + 1, u, part * coverage, pixel);
+ }
+ else {
+      __imel_draw_cover (image, u, base, (1 - part) * coverage, pixel);
+      __imel_draw_cover (image, u, base + 1, part * coverage, pixel);
+ }
+}
+
+/* Half widths of the rows of an ellipse with axes @a and @b, for rows
+ * asked from dy = b down to 0: the largest dx with
+ * dx^2 b^2 + dy^2 a^2 < a^2 b^2, or <= if @closed, -1 if there isn't.
+ * The width only grows, so each row costs a few integer steps. Axes too
+ * long for 64 bit products use a square root for each row. */
+static void __imel_draw_ellipse_rows_init (__ImelEllipseRows *rows, int64_t a, int64_t b, bool closed)
+{
+ rows->a = a;
+ rows->b = b;
+ rows->h = -1;
+ rows->closed = closed;
+ rows->exact = a <= __IMEL_DRAW_AXIS_EXACT && b <= __IMEL_DRAW_AXIS_EXACT;
+ rows->a2 = (uint64_t) (a * a);
+ rows->b2 = (uint64_t) (b * b);
+ rows->limit = rows->a2 * rows->b2;
+}
+
+static int64_t __imel_draw_ellipse_row (__ImelEllipseRows *rows, int64_t dy)
+{
+ uint64_t edge = (uint64_t) (dy * dy) * rows->a2, step;
+ double v;
+
+ if ( ! rows->exact ) {
+      v = 1.0 - ((double) dy * dy) / ((double) rows->b * rows->b);
+      v = ( v > 0 ) ? rows->a * sqrt (v) : 0;
+      rows->h = rows->closed ? (int64_t) floor (v) : (int64_t) ceil (v) - 1;
+      rows->h = ( v <= 0 && ! rows->closed ) ? -1 : rows->h;
+      return rows->h;
+ }
+
+ for ( ; ; rows->h++ ) {
+       step = (uint64_t) ((rows->h + 1) * (rows->h + 1)) * rows->b2 + edge;
+       if ( rows->closed ? step > rows->limit : step >= rows->limit )
+            break;
+ }
+
+ return rows->h;
+}
+
+/* Fill the box from (x0, y0) to (x1, y1) grown by @a on the sides and by
+ * @b on top and bottom, with the corners rounded by an ellipse of axes
+ * @a and @b. One span for each row. */
+void __imel_draw_fill_round_box (ImelImage *image, long x0, long y0, long x1, long y1,
+                                 long a, long b, bool closed, bool brush, ImelPixel pixel)
+{
+ __ImelEllipseRows rows;
+ int64_t dy, h = 0;
+ long y;
+
+ if ( x0 > x1 || y0 > y1 || (! closed && (a <= 0 || b <= 0)) )
+      return;
+
+ if ( a > 0 && b > 0 ) {
+      __imel_draw_ellipse_rows_init (&rows, a, b, closed);
+
+      for ( dy = b; dy > 0; dy-- ) {
+            if ( (h = __imel_draw_ellipse_row (&rows, dy)) < 0 )
+                 continue;
+
+            __imel_draw_fill_span (image, x0 - h, x1 + h, y0 - dy, brush, pixel);
+            __imel_draw_fill_span (image, x0 - h, x1 + h, y1 + dy, brush, pixel);
+      }
+
+      h = __imel_draw_ellipse_row (&rows, 0);
+ }
+
+ y = ( y0 < 0 ) ? 0 : y0;
+ y1 = ( y1 >= (long) image->height ) ? (long) image->height - 1 : y1;
+ for ( ; y <= y1; y++ )
+       __imel_draw_fill_span (image, x0 - h, x1 + h, y, brush, pixel);
+}
+
+/* Values of dx on the row @dy with (ux, uy) x (dx, dy) >= 0, in [*lo, *hi] */
+static void __imel_draw_half_plane (double ux, double uy, long dy, long *lo, long *hi)
+{
+ double t;
+
+ if ( fabs (uy) < 1e-12 ) {
+      if ( ux * dy < 0 )
+           *lo = *hi + 1;
+      return;
+ }
+
+ /* Clamped before the conversion, the bounds are the ones of a row */
+ t = (ux * dy) / uy;
+ t = ( t > *hi + 1 ) ? *hi + 1 : ( t < *lo - 1 ) ? *lo - 1 : t;
+ if ( uy > 0 )
+      *hi = ( floor (t + 1e-9) < *hi ) ? (long) floor (t + 1e-9) : *hi;
+ else *lo = ( ceil (t - 1e-9) > *lo ) ? (long) ceil (t - 1e-9) : *lo;
+}
+
+/* Draw the part of the row @dy of a circle, from -@h to @h, inside the
+ * sector that goes from the direction (ax, ay) to (bx, by). A sector
+ * wider than half a turn is the union of two half planes, else their
+ * intersection. */
+static void __imel_draw_fill_sector_row (ImelImage *image, long cx, long cy, long dy, long h,
+                                         double ax, double ay, double bx, double by,
+                                         bool reflex, bool brush, ImelPixel pixel)
+{
+ long lo[2], hi[2];
+
+ if ( h < 0 )
+      return;
+
+ lo[0] = lo[1] = -h;
+ hi[0] = hi[1] = h;
+
+ __imel_draw_half_plane (ax, ay, dy, &lo[0], &hi[0]);
+ __imel_draw_half_plane (-bx, -by, dy, &lo[1], &hi[1]);
+
+ if ( ! reflex ) {
+      lo[0] = ( lo[1] > lo[0] ) ? lo[1] : lo[0];
+      hi[0] = ( hi[1] < hi[0] ) ? hi[1] : hi[0];
+      if ( lo[0] <= hi[0] )
+           __imel_draw_fill_span (image, cx + lo[0], cx + hi[0], cy + dy, brush, pixel);
+      return;
+ }
+
+ if ( lo[0] <= hi[0] && lo[1] <= hi[1] && lo[1] <= hi[0] + 1 && lo[0] <= hi[1] + 1 ) {
+      __imel_draw_fill_span (image, cx + (( lo[0] < lo[1] ) ? lo[0] : lo[1]),
+                             cx + (( hi[0] > hi[1] ) ? hi[0] : hi[1]), cy + dy, brush, pixel);
+      return;
+ }
+
+ if ( lo[0] <= hi[0] )
+      __imel_draw_fill_span (image, cx + lo[0], cx + hi[0], cy + dy, brush, pixel);
+ if ( lo[1] <= hi[1] )
+      __imel_draw_fill_span (image, cx + lo[1], cx + hi[1], cy + dy, brush, pixel);
+}
+
+/* Prepare @outline to draw in @image around (cx, cy) with semi-axes @a
+ * and @b. FALSE if the outline is all outside of @image, the points are
+ * checked one by one only if it's partly outside. */
+static bool __imel_draw_outline_init (__ImelOutline *outline, ImelImage *image, long cx, long cy,
+                                      long a, long b, ImelPixel pixel)
+{
+ outline->image = image;
+ outline->cx = cx;
+ outline->cy = cy;
+ outline->pixel = pixel;
+ outline->brush = global_brush != NULL;
+ outline->arc = false;
+ outline->clip = cx - a < 0 || cy - b < 0 || cx + a >= (long) image->width || cy + b >= (long) image->height;
+
+ return cx + a >= 0 && cy + b >= 0 && cx - a < (long) image->width && cy - b < (long) image->height;
+}
+
+/* Draw only the points from the direction @start to @end, in radians */
+static void __imel_draw_outline_set_arc (__ImelOutline *outline, double start, double end)
+{
+ outline->arc = true;
+ outline->reflex = end - start > PI;
+ outline->ax = (int64_t) floor (cos (start) * __IMEL_DRAW_ARC_SCALE + 0.5);
+ outline->ay = (int64_t) floor (sin (start) * __IMEL_DRAW_ARC_SCALE + 0.5);
+ outline->bx = (int64_t) floor (cos (end) * __IMEL_DRAW_ARC_SCALE + 0.5);
+ outline->by = (int64_t) floor (sin (end) * __IMEL_DRAW_ARC_SCALE + 0.5);
+}
+
+/* TRUE if the point at (dx, dy) from the center is inside the arc: on one
+ * of its sides or strictly between them */
+static bool __imel_draw_outline_in_arc (const __ImelOutline *outline, int64_t dx, int64_t dy)
+{
+ int64_t a = outline->ax * dy - outline->ay * dx, b = dx * outline->by - dy * outline->bx;
+
+ if ( (! a && outline->ax * dx + outline->ay * dy > 0) || (! b && outline->bx * dx + outline->by * dy > 0) )
+      return true;
+
+ return outline->reflex ? a > 0 || b > 0 : a > 0 && b > 0;
+}
+
+static void __imel_draw_outline_point (__ImelOutline *outline, long dx, long dy)
+{
+ long x = outline->cx + dx, y = outline->cy + dy;
+
+ if ( outline->arc && ! __imel_draw_outline_in_arc (outline, dx, dy) )
+      return;
+
+ if ( outline->clip && (x < 0 || y < 0 || x >= (long) outline->image->width ||
+                        y >= (long) outline->image->height) )
+      return;
+
+ if ( outline->brush )
+      __imel_draw_span (outline->image, x, y, 1, true, outline->pixel);
+ else imel_pixel_copy (&(outline->image->pixel[y][x]), outline->pixel);
+}
+
+/* Draw the points at (+-dx, +-dy), each once */
+static void __imel_draw_outline_quad (__ImelOutline *outline, long dx, long dy)
+{
+ __imel_draw_outline_point (outline, dx, dy);
+ if ( dx )
+      __imel_draw_outline_point (outline, -dx, dy);
+
+ if ( dy ) {
+      __imel_draw_outline_point (outline, dx, -dy);
+      if ( dx )
+           __imel_draw_outline_point (outline, -dx, -dy);
+ }
+}
+
+/* Midpoint circle: the points of the octant from the top are found by
+ * integer steps and mirrored to the other seven */
+static void __imel_draw_circle_outline (__ImelOutline *outline, long radius)
+{
+ int64_t x = 0, y = radius, d = 1 - radius;
+
+ for ( ; x <= y; x++ ) {
+       __imel_draw_outline_quad (outline, x, y);
+       if ( x != y )
+            __imel_draw_outline_quad (outline, y, x);
+
+       if ( d < 0 )
+            d += 2 * x + 3;
+       else {
+            d += 2 * (x - y) + 5;
+            y--;
+       }
+ }
+}
+
+/* Midpoint ellipse: the points of a quarter are found by integer steps,
+ * along x while the border at the next midpoint is closer to horizontal,
+ * then along y, and mirrored to the other three. Longer axes take the border of the rows of
+ * __imel_draw_ellipse_row (). */
+static void __imel_draw_ellipse_outline (__ImelOutline *outline, long a, long b)
+{
+ int64_t a2 = (int64_t) a * a, b2 = (int64_t) b * b, x = 0, y = b, d, h, last = -1, i;
+ __ImelEllipseRows rows;
+
+ if ( a > __IMEL_DRAW_AXIS_MIDPOINT || b > __IMEL_DRAW_AXIS_MIDPOINT ) {
+      __imel_draw_ellipse_rows_init (&rows, a, b, true);
+      for ( ; y >= 0; y--, last = h ) {
+            h = __imel_draw_ellipse_row (&rows, y);
+            for ( i = ( last + 1 < h ) ? last + 1 : h; i <= h; i++ )
+                  __imel_draw_outline_quad (outline, i, y);
+      }
+      return;
+ }
+
+ /* Four times the value at the midpoint of the next two choices */
+ d = 4 * b2 - 4 * a2 * b + a2;
+ for ( ; 2 * b2 * (x + 1) < a2 * (2 * y - 1); x++ ) {
+       __imel_draw_outline_quad (outline, x, y);
+
+       if ( d < 0 )
+            d += 4 * b2 * (2 * x + 3);
+       else {
+            d += 4 * b2 * (2 * x + 3) - 8 * a2 * (y - 1);
+            y--;
+       }
+ }
+
+ d = (b2 * (2 * x + 1) * (2 * x + 1) - 4 * a2 * b2) + 4 * a2 * (y - 1) * (y - 1);
+ for ( ; y >= 0; y-- ) {
+       /* A thin ellipse can reach the long axis before its end */
+       if ( ! y ) {
+            for ( h = ( x > a ) ? x : a; x <= h; x++ )
+                 __imel_draw_outline_quad (outline, x, 0);
+            break;
+       }
+
+       __imel_draw_outline_quad (outline, x, y);
+
+       if ( d > 0 )
+            d -= 4 * a2 * (2 * y - 3);
+       else {
+            d += 8 * b2 * (x + 1) - 4 * a2 * (2 * y - 3);
+            x++;
+       }
+ }
+}
+
+/* Draw the outline of the ellipse or circle as a single stroke of the
+ * brush */
+static void __imel_draw_outline (__ImelOutline *outline, long a, long b)
+{
+ bool sweep = outline->brush && __imel_brush_sweep_begin ();
+
+ if ( a == b )
+      __imel_draw_circle_outline (outline, a);
+ else __imel_draw_ellipse_outline (outline, a, b);
+
+ if ( sweep )
+      __imel_brush_sweep_end (outline->image, outline->pixel);
+}
+
 /**
  * @brief Draw a filled circle
  * 
  * This function draw a circle filled with color and level passed in @p pxl at
  * coordinate \f$(x,y)\f$ with a radius of @p radius pixels.
+ * The circle is drawn a row at a time, with the width of each row found
+ * by integer steps.
  * 
  * @param image Image where draw the circle
  * @param x Coordinate x of the circle center
@@ -176,14 +831,10 @@ void __imel_draw_put_pixel (ImelImage *image, ImelSize x, ImelSize y, ImelPixel
  */
 void imel_draw_filled_circle (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius, ImelPixel pxl)
 {
- ImelSize sx, ex = x + radius + 1, sy = y - radius - 1, ey = y + radius + 1;
-
  return_if_fail (image);
-  
- while ( ++sy < ey )
-     for ( sx = x - radius; sx < ex; sx++ )
-           if ( (pow (((int) sx) - ((int) x), 2) + pow (((int) sy) - ((int) y), 2)) < pow (radius, 2) )
-                __imel_draw_point (image, sx, sy, pxl);
+
+ __imel_draw_fill_round_box (image, x, y, x, y, radius, radius, false, global_brush != NULL, pxl);
+ image->generation++;
 }
 
 /**
@@ -203,8 +854,6 @@ void imel_draw_filled_circle (ImelImage *image, ImelSize x, ImelSize y, ImelSize
  */
 void imel_draw_rect (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2, ImelPixel pixel, bool fill)
 {
- ImelSize h;
-
  return_if_fail (image);
 
  if ( y1 > y2 ) {
@@ -212,17 +861,17 @@ void imel_draw_rect (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, Im
       size_swap (&y1, &y2);
  }
 
+ if ( fill ) {
+      __imel_draw_fill_round_box (image, ( x1 < x2 ) ? x1 : x2, y1, ( x1 < x2 ) ? x2 : x1, y2,
+                                  0, 0, true, global_brush != NULL, pixel);
+      image->generation++;
+      return;
+ }
+
  imel_draw_line (image, x1, y1, x2, y1, pixel);
  imel_draw_line (image, x1, y1, x1, y2, pixel);
  imel_draw_line (image, x2, y1, x2, y2, pixel);
  imel_draw_line (image, x1, y2, x2 + 1, y2, pixel);
-      
- if ( !fill ) {
-      return;
- }
-
- for ( h = y1; h < y2; h++ )
-       imel_draw_line (image, x1, h, x2, h, pixel);
 }
 
 /**
@@ -266,13 +915,10 @@ bool imel_draw_rect_with_rounded_angles (ImelImage *image, ImelSize x1, ImelSize
       return true;
  }
  
- imel_draw_filled_arch (image, x[0] + radius, y[0] + radius, radius, DEG_TO_RAD (180), DEG_TO_RAD (270), pixel);
- imel_draw_filled_arch (image, x[1] - radius, y[0] + radius, radius, DEG_TO_RAD (270), DEG_TO_RAD (360), pixel);
- imel_draw_filled_arch (image, x[0] + radius, y[1] - radius, radius, DEG_TO_RAD (90), DEG_TO_RAD (180), pixel);
- imel_draw_filled_arch (image, x[1] - radius, y[1] - radius, radius, DEG_TO_RAD (0), DEG_TO_RAD (90), pixel);
- 
- imel_draw_rect (image, x[0] + (radius - 3), y[0],  x[1] - radius, y[1], pixel, true);
- imel_draw_rect (image, x[0], y[0] + (radius - 3), x[1],  y[1] - (radius - 3), pixel, true);
+ __imel_draw_fill_round_box (image, (long) (x[0] + radius), (long) (y[0] + radius),
+                             (long) (x[1] - radius), (long) (y[1] - radius), radius, radius, true,
+                             global_brush != NULL, pixel);
+ image->generation++;
  return true;
 }
 
@@ -299,13 +945,38 @@ void imel_draw_point_from_array (ImelImage *image, ImelSize n_points, ImelPoint
  
  for ( i = 0; i < n_points; i++ )
        __imel_draw_point (image, points[i]->x, points[i]->y, points[i]->pixel);
+
+ image->generation++;
+}
+
+/**
+ * @brief Draw more point at the same time
+ * 
+ * This function draw all the @p points in the @p image
+ * 
+ * @param image Image where draw the points
+ * @param points Points to draw
+ * @see imel_draw_point_from_array
+ */
+void imel_draw_point_array (ImelImage *image, const ImelPointArray *points)
+{
+ ImelSize i;
+
+ return_if_fail (image && points);
+
+ for ( i = 0; i < points->n_points; i++ )
+       __imel_draw_point (image, points->point[i].x, points->point[i].y, points->point[i].pixel);
+
+ image->generation++;
 }
 
 /**
  * @brief Draw an ellipse
  * 
  * This function draw an ellipse in @p image with center in coordinate
- * \f$(x,y)\f$ with @p a width and @p b height. 
+ * \f$(x,y)\f$ with @p a width and @p b height. The axes are truncated to
+ * integers and the border is found by the midpoint algorithm, with integer
+ * steps for a quarter of the ellipse mirrored to the others.
  * 
  * @param image Image where draw the ellipse
  * @param x Coordinate x of the ellipse center
@@ -314,33 +985,29 @@ void imel_draw_point_from_array (ImelImage *image, ImelSize n_points, ImelPoint
  * @param b Length of the vertical axis
  * @param pxl Color and level of the ellipse
  */
-void imel_draw_ellipse (ImelImage *image, ImelSize x, ImelSize y, double a, double b, ImelPixel pxl) 
-{ 
- double angle; 
- ImelSize Ox = x + a, Oy = y, X, Y; 
-  
- return_if_fail (image) ; 
- 
- if ( a == b ) {
+void imel_draw_ellipse (ImelImage *image, ImelSize x, ImelSize y, double a, double b, ImelPixel pxl)
+{
+ __ImelOutline outline;
+
+ return_if_fail (image && a >= 0 && b >= 0);
+
+ if ( (long) a == (long) b ) {
       imel_draw_circle (image, x, y, (ImelSize) a, pxl);
       return;
  }
- 
- __imel_draw_point (image, Ox - 1, y - 1, pxl);
- 
- for ( angle = 0.00174532; angle < 6.281439987; angle += 0.00174532, Ox = X, Oy = Y ) { 
-         X = (ImelSize) (((double) x) + a * cos (angle)); 
-         Y = (ImelSize) (((double) y) + b * sin (angle)); 
 
-         imel_draw_line (image, X, Y, Ox, Oy, pxl); 
- } 
-} 
+ if ( __imel_draw_outline_init (&outline, image, x, y, (long) a, (long) b, pxl) )
+      __imel_draw_outline (&outline, (long) a, (long) b);
+
+ image->generation++;
+}
 
 /**
  * @brief Draw a filled ellipse
  * 
  * This function draw a filled ellipse in @p image with center in coordinate
- * \f$(x,y)\f$ with @p a width and @p b height. 
+ * \f$(x,y)\f$ with @p a width and @p b height. The axes are truncated to
+ * integers and the ellipse is drawn a row at a time.
  * 
  * @param image Image where draw the ellipse
  * @param x Coordinate x of the ellipse center
@@ -351,24 +1018,64 @@ void imel_draw_ellipse (ImelImage *image, ImelSize x, ImelSize y, double a, doub
  */
 void imel_draw_filled_ellipse (ImelImage *image, ImelSize x, ImelSize y, double a, double b, ImelPixel pxl)
 {
- double angle; 
- ImelSize Ox = x + a, Oy = y, X, Y; 
-  
- return_if_fail (image) ; 
- 
- if ( a == b ) {
-      imel_draw_filled_circle (image, x, y, (ImelSize) a, pxl);
-      return;
+ return_if_fail (image && a >= 0 && b >= 0);
+
+ __imel_draw_fill_round_box (image, x, y, x, y, (long) a, (long) b, false, global_brush != NULL, pxl);
+ image->generation++;
+}
+
+/**
+ * @brief Draw an anti-aliased ellipse
+ * 
+ * This function draws in @p image an ellipse with center in coordinate
+ * \f$(x,y)\f$, horizontal semi-axis @p a and vertical semi-axis @p b.
+ * Where the border is closer to horizontal each column covers two pixels
+ * on each side, elsewhere each row does, blended with @p pxl in
+ * proportion to the distance from the border as in
+ * #imel_draw_antialiased_line. Only the columns and rows inside @p image
+ * are computed.
+ * 
+ * @param image Image where draw the ellipse
+ * @param x Center coordinate x
+ * @param y Center coordinate y
+ * @param a Horizontal semi-axis
+ * @param b Vertical semi-axis
+ * @param pxl Color and level of the ellipse
+ * @see imel_draw_ellipse
+ * @see imel_draw_antialiased_circle
+ */
+void imel_draw_antialiased_ellipse (ImelImage *image, double x, double y, double a, double b, ImelPixel pxl)
+{
+ double limit, first, last, d, i;
+
+ return_if_fail (image && __IMEL_FINITE (x) && __IMEL_FINITE (y) && a > 0 && b > 0 && __IMEL_FINITE (a) && __IMEL_FINITE (b));
+
+ /* Columns where the slope of the border is at most 1 */
+ limit = a * a / sqrt (a * a + b * b);
+ first = ceil (( x - limit > 0 ) ? x - limit : 0);
+ last = floor (( x + limit < image->width - 1.0 ) ? x + limit : image->width - 1.0);
+ for ( i = first; i <= last; i++ ) {
+       d = (i - x) / a;
+       d = b * sqrt (( d * d < 1 ) ? 1 - d * d : 0);
+       __imel_draw_cover_pair (image, i, y - d, 1, false, pxl);
+       __imel_draw_cover_pair (image, i, y + d, 1, false, pxl);
  }
- 
- __imel_draw_point (image, Ox - 1, y - 1, pxl);
- 
- for ( angle = 0.00174532; angle < 6.281439987; angle += 0.00174532, Ox = X, Oy = Y ) { 
-         X = (ImelSize) (((double) x) + a * cos (angle)); 
-         Y = (ImelSize) (((double) y) + b * sin (angle)); 
 
-         imel_draw_rect (image, X, y, Ox, Oy, pxl, true); 
- } 
+ /* Rows where it's over 1 */
+ limit = b * b / sqrt (a * a + b * b);
+ first = floor (( y - limit > 0 ) ? y - limit : 0);
+ last = ceil (( y + limit < image->height - 1.0 ) ? y + limit : image->height - 1.0);
+ for ( i = first; i <= last; i++ ) {
+       if ( fabs (i - y) >= limit )
+            continue;
+
+       d = (i - y) / b;
+       d = a * sqrt (1 - d * d);
+       __imel_draw_cover_pair (image, i, x - d, 1, true, pxl);
+       __imel_draw_cover_pair (image, i, x + d, 1, true, pxl);
+ }
+
+ image->generation++;
 }
 
 bool check_size (ImelImage *image, ImelSize xy, bool hw)
@@ -390,6 +1097,9 @@ bool check_size (ImelImage *image, ImelSize xy, bool hw)
  * to coordinate \f$(\_x_2,\_y_2)\f$ with a color and level gradient from @p start
  * to @p end.
  * 
+ * The line has the pixels of #imel_draw_line, each one shaded by a fixed
+ * point step for the pixels along its longest axis.
+ * 
  * @param image Image where draw the line
  * @param _x1 Start x coordinate
  * @param _y1 Start y coordinate
@@ -403,61 +1113,18 @@ bool check_size (ImelImage *image, ImelSize xy, bool hw)
 bool imel_draw_gradient_line (ImelImage *image, ImelSize _x1, ImelSize _y1, ImelSize _x2, 
                               ImelSize _y2, ImelPixel start, ImelPixel end)
 {
- long int x[2] = { (long int) _x1, (long int) _x2 };
- long int y[2] = { (long int) _y1, (long int) _y2 };
- double dx, dy, px, py;
- long int step = -1;
- ImelPixel pxl, rpxl;
- 
- return_var_if_fail (image, false);
-
- if ( (_y1 == _y2 && _x1 > _x2) || (_x1 == _x2 && _y1 > _y2)
-   || ((((_x1 * 100) / (_x2 ? _x2 : 1)) <= ((_y1 * 100) / (_y2 ? _y2 : 1))) && _x1 > _x2) ) {
-           long_int_swap (&(y[0]), &(y[1]));
-           long_int_swap (&(x[0]), &(x[1]));
- }
-
- if ( _y1 == _y2 && _x1 > _x2 )
-      x[1]++;
+ __ImelLineStyle style;
 
- dx = x[1] - x[0];
- dy = y[1] - y[0];
- 
- if ( !dx && dx == dy )
-      __imel_draw_point (image, x[0], y[0], start);
-      
- if ( dx >= dy ) {
-      step = (end.level - start.level) / dx;
-      if ( step < 0 )
-           rpxl.level = start.level - step;
-      else rpxl.level = start.level;
-      
-      for ( px = x[0]; px < x[1]; px++ ) {
-            pxl = imel_pixel_union (start, end, (255 * py) / y[1]);
-            rpxl = imel_pixel_new (pxl.red, pxl.green, pxl.blue, rpxl.level + step);
-            
-            py = ((px - x[0]) / dx) * dy + y[0];
-
-            __imel_draw_point (image, px, py, rpxl);
-      }
-
-      return true;
- }
-
- step = (end.level - start.level) / dy;
- if ( step < 0 )
-      rpxl.level = start.level - step;
- else rpxl.level = start.level;
- 
- for ( py = y[0]; py < y[1]; py++ ) {
-       pxl = imel_pixel_union (start, end, (255 * py) / y[1]);
-       rpxl = imel_pixel_new (pxl.red, pxl.green, pxl.blue, rpxl.level + step);
-       
-       px = ((py - y[0]) / dy) * dx + x[0];
+ return_var_if_fail (image, false);
 
-       __imel_draw_point (image, px, py, rpxl);
+ if ( _x1 == _x2 && _y1 == _y2 )
+      __imel_draw_point (image, _x1, _y1, start);
+ else {
+      __imel_draw_line_style_init (&style, _x1, _y1, _x2, _y2, 1, 0, start, end);
+      __imel_draw_line_style (image, _x1, _y1, _x2, _y2, true, global_brush != NULL, &style, start);
  }
 
+ image->generation++;
  return true;
 }
 
@@ -467,6 +1134,10 @@ bool imel_draw_gradient_line (ImelImage *image, ImelSize _x1, ImelSize _y1, Imel
  * This function draw a line in @p image from coordinate \f$(\_sx,\_sy)\f$ to 
  * coordinate \f$(\_ex,\_ey)\f$ with a color and level passed in @p pixel
  * 
+ * The line is rasterized with integer steps along its longest axis and
+ * clipped to @p image before drawing, so the parts outside cost nothing.
+ * The last point on the longest axis isn't drawn.
+ * 
  * @param image Image where draw the line
  * @param _sx Start x coordinate
  * @param _sy Start y coordinate
@@ -477,61 +1148,77 @@ bool imel_draw_gradient_line (ImelImage *image, ImelSize _x1, ImelSize _y1, Imel
  */
 bool imel_draw_line (ImelImage *image, ImelSize _sx, ImelSize _sy, ImelSize _ex, ImelSize _ey, ImelPixel pixel)
 {
- double dx, dy, j, p;
- double sx = (double) _sx, sy = (double) _sy, ex = (double) _ex, ey = (double) _ey;
- 
  return_var_if_fail (image, false);
- 
- dx = sx - ex;
- dy = sy - ey;
- 
- if ( _sy == _ey ) {
-	  for ( j = _sx; j < _ex; j++ )
-	        __imel_draw_point (image, j, _sy, pixel); 
-	  
-	  return true;
- }
- 
- if ( _sx == _ex ) {
-	  for ( j = _sy; j < _ey; j++ ) 
-	        __imel_draw_point (image, _sx, j, pixel);
-	  
-	  return true;
- }
-  
- if ( !dx || !dy ) {
-      __imel_draw_point (image, ex, ey, pixel);
-      __imel_draw_point (image, sx, sy, pixel);
-      
-      return true;
- }
- 
- if ( abs (dx) > abs (dy) ) {
-      if ( sx > ex ) {
-           double_swap (&sx, &ex);
-           double_swap (&sy, &ey);
-      }
-      
-      for ( j = sx; j < ex; j++ ) {
-            p = ((j - sx) / dx) * dy + sy;
-            __imel_draw_point (image, j, p, pixel);
-      }
-      
-      return true;
+
+ __imel_draw_line_raster (image, _sx, _sy, _ex, _ey, global_brush != NULL, pixel);
+
+ image->generation++;
+ return true;
+}
+
+/**
+ * @brief Draw an anti-aliased line
+ * 
+ * This function draws in @p image a line from coordinate
+ * \f$(x_1,y_1)\f$ to coordinate \f$(x_2,y_2)\f$ with the Xiaolin Wu's
+ * algorithm: on each step along the longest axis the line covers two
+ * pixels, blended with @p pixel in proportion to the distance from the
+ * line. The coordinates can have a fractional part, the center of a pixel
+ * is at integer coordinates.
+ * 
+ * The pixels are blended a row at a time by the same kernels used by
+ * #imel_image_union. As with #imel_pixel_copy the pixels with a level
+ * higher than the one of @p pixel are kept and a negative level of
+ * @p pixel is its alpha. The brush isn't used.
+ * 
+ * @param image Image where draw the line
+ * @param x1 Start x coordinate
+ * @param y1 Start y coordinate
+ * @param x2 End x coordinate
+ * @param y2 End y coordinate
+ * @param pixel Color and level of the line
+ * @return FALSE if @p image isn't a valid image or a coordinate isn't
+ * finite, else TRUE
+ * @see imel_draw_line
+ */
+bool imel_draw_antialiased_line (ImelImage *image, double x1, double y1, double x2, double y2, ImelPixel pixel)
+{
+ double u[2], v[2], end[2], gradient, gap, first, last, size;
+ bool steep;
+ long s;
+ int i;
+
+ return_var_if_fail (image && __IMEL_FINITE (x1) && __IMEL_FINITE (y1) && __IMEL_FINITE (x2) && __IMEL_FINITE (y2), false);
+
+ steep = fabs (y2 - y1) > fabs (x2 - x1);
+ u[0] = steep ? y1 : x1;
+ v[0] = steep ? x1 : y1;
+ u[1] = steep ? y2 : x2;
+ v[1] = steep ? x2 : y2;
+ if ( u[0] > u[1] ) {
+      gap = u[0], u[0] = u[1], u[1] = gap;
+      gap = v[0], v[0] = v[1], v[1] = gap;
  }
- else {
-      if ( sy > ey ) {
-           double_swap (&sx, &ex);
-           double_swap (&sy, &ey);
-      }
-      
-      for ( j = sy; j < ey; j++ ) {
-            p = ((j - sy) / dy) * dx + sx;
-            __imel_draw_point (image, p, j, pixel);
-      }
-      
-      return true;
+
+ gradient = ( u[1] > u[0] ) ? (v[1] - v[0]) / (u[1] - u[0]) : 1.0;
+ size = steep ? image->height : image->width;
+
+ /* The ends cover only the part of their pixel inside the line */
+ for ( i = 0; i < 2; i++ ) {
+       end[i] = floor (u[i] + 0.5);
+       gap = u[i] + 0.5 - end[i];
+       __imel_draw_cover_pair (image, end[i], v[i] + gradient * (end[i] - u[i]), i ? gap : 1 - gap,
+                               steep, pixel);
  }
+
+ first = ( end[0] + 1 > 0 ) ? end[0] + 1 : 0;
+ last = ( end[1] - 1 < size - 1 ) ? end[1] - 1 : size - 1;
+ if ( first <= last )
+      for ( s = (long) first; s <= (long) last; s++ )
+            __imel_draw_cover_pair (image, s, v[0] + gradient * (s - u[0]), 1, steep, pixel);
+
+ image->generation++;
+ return true;
 }
 
 /**
@@ -540,7 +1227,7 @@ bool imel_draw_line (ImelImage *image, ImelSize _sx, ImelSize _sy, ImelSize _ex,
  * This function draw a line in @p image from coordinate \f$(\_x_1,\_y_1)\f$ 
  * to coordinate \f$(\_x_2,\_y_2)\f$ with a color and level passed in 
  * @p pixel, where each point of the line is linked to a coordinate 
- * \f$(ox,oy)\f$.
+ * \f$(ox,oy)\f$. The triangle is filled with the polygon filler.
  * 
  * @param image Image where draw the line
  * @param _x1 Start x coordinate
@@ -555,51 +1242,21 @@ bool imel_draw_line (ImelImage *image, ImelSize _sx, ImelSize _sy, ImelSize _ex,
 bool imel_draw_filled_line (ImelImage *image, ImelSize _x1, ImelSize _y1, ImelSize _x2, ImelSize _y2, 
                             ImelSize ox, ImelSize oy, ImelPixel pixel)
 {
- long int x[2] = { (long int) _x1, (long int) _x2 };
- long int y[2] = { (long int) _y1, (long int) _y2 };
- double dx, dy, px, py;
+ __ImelPolygon polygon;
 
  return_var_if_fail (image, false);
- 
- if ( _y1 == _y2 && _x1 == _x2 ) {
-      imel_draw_line (image, _y1, _x1, ox, oy, pixel);
-      return true;
- }
- 
- if ( (_x1 > _x2 && _y1 > _y2) ) {
-      long_int_swap (&(y[0]), &(y[1]));
-      long_int_swap (&(x[0]), &(x[1]));
- }
-
- dx = x[1] - x[0];
- dy = y[1] - y[0];
- 
- imel_draw_line (image, x[0], y[0], ox, oy, pixel);
- if ( abs (dx) >= abs (dy) ) {
-      if ( x[0] > x[1] ) {
-           long_int_swap (&(y[0]), &(y[1]));
-           long_int_swap (&(x[0]), &(x[1]));
-      }
-      
-      for ( px = x[0]; px < x[1]; px++ ) {
-            py = ((px - x[0]) / dx) * dy + y[0];
-
-            imel_draw_line (image, px, py, ox, oy, pixel);
-      }
-
-      return true;
- }
 
- if ( y[0] > y[1] ) {
-      long_int_swap (&(y[0]), &(y[1]));
-      long_int_swap (&(x[0]), &(x[1]));
- }
-      
- for ( py = y[0]; py < y[1]; py++ ) {
-       px = ((py - y[0]) / dy) * dx + x[0];
+ __imel_polygon_init (&polygon);
+ __imel_polygon_add_edge (&polygon, _x1, _y1, _x2, _y2);
+ __imel_polygon_add_edge (&polygon, _x2, _y2, ox, oy);
+ __imel_polygon_add_edge (&polygon, ox, oy, _x1, _y1);
+ __imel_polygon_fill (image, &polygon, IMEL_FILL_RULE_EVEN_ODD, global_brush != NULL, pixel);
+ __imel_polygon_clear (&polygon);
 
-       imel_draw_line (image, px, py, ox, oy, pixel);
- }
+ /* The sides, the filler leaves out the ones at the right and bottom */
+ imel_draw_line (image, _x1, _y1, _x2, _y2, pixel);
+ imel_draw_line (image, _x2, _y2, ox, oy, pixel);
+ imel_draw_line (image, ox, oy, _x1, _y1, pixel);
 
  return true;
 }
@@ -716,6 +1373,31 @@ void imel_draw_figure (ImelImage *image, ImelSize n_points, ImelPoint **starts,
                          ends[i]->x, ends[i]->y, pixel);
 }
 
+/**
+ * @brief Draw a non contiguous figure
+ * 
+ * Same as #imel_draw_figure, the number of lines is the smallest between
+ * the number of points in @p starts and in @p ends.
+ * 
+ * @param image Image where draw the figure
+ * @param starts Start points
+ * @param ends End points
+ * @param pixel Color and level of the figure 
+ * @see imel_draw_figure
+ */
+void imel_draw_figure_array (ImelImage *image, const ImelPointArray *starts, const ImelPointArray *ends,
+                             ImelPixel pixel)
+{
+ ImelSize i, n;
+
+ return_if_fail (image && starts && ends);
+
+ n = ( starts->n_points < ends->n_points ) ? starts->n_points : ends->n_points;
+ for ( i = 0; i < n; i++ ) 
+       imel_draw_line (image, starts->point[i].x, starts->point[i].y,
+                       ends->point[i].x, ends->point[i].y, pixel);
+}
+
 /**
  * @brief Draw a contiguous figure
  * 
@@ -760,6 +1442,28 @@ void imel_draw_contiguous_figure (ImelImage *image, ImelSize n_points, ImelPoint
                          points[i + 1]->x, points[i + 1]->y, pixel);
 }
 
+/**
+ * @brief Draw a contiguous figure
+ * 
+ * Same as #imel_draw_contiguous_figure. The figure isn't closed, to close
+ * it add again the first point at the end of @p points.
+ * 
+ * @param image Image where draw the figure
+ * @param points Points to link togheter
+ * @param pixel Color and level of the figure
+ * @see imel_draw_contiguous_figure
+ */
+void imel_draw_contiguous_figure_array (ImelImage *image, const ImelPointArray *points, ImelPixel pixel)
+{
+ ImelSize i;
+
+ return_if_fail (image && points);
+
+ for ( i = 1; i < points->n_points; i++ )
+       imel_draw_line (image, points->point[i - 1].x, points->point[i - 1].y,
+                       points->point[i].x, points->point[i].y, pixel);
+}
+
 /**
  * @brief Draw a Bèzier's curve
  * 
@@ -793,29 +1497,63 @@ void imel_draw_contiguous_figure (ImelImage *image, ImelSize n_points, ImelPoint
  * @param y3 End coordinate y of the curve
  * @param x4 Second reference coordinate x
  * @param y4 Second reference coordinate y
- * @param _p Number of steps to draw the curve, -1 to set default steps ( 1024 )
+ * @param _p Number of lines to draw the curve, -1 to use the lines needed to
+ *           stay within a quarter of pixel from it
  * @param pixel Color and level of the curve 
  */
 void imel_draw_curve (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2, 
                       ImelSize x3, ImelSize y3, ImelSize x4, ImelSize y4, int _p, ImelPixel pixel)
 {
-  float t;
-  float x = x1, y = y1;
-  float lx, ly;
-  float a, b;
-  float p = 1.0f / (( _p < 0 ) ? 1024 : _p);
-  
-  return_if_fail (image);
-  
-  for( b = 1 - (a = (t = 0)); t < 1; b = 1 - (a = (t += p)) ) {
-       lx = x;
-       ly = y;
-       x = (x1 * pow (b, 3)) + 3 * x2 * pow (b, 2) * a + 3 * x4 * b * pow (a, 2) + x3 * pow (a, 3);
-       y = (y1 * pow (b, 3)) + 3 * y2 * pow (b, 2) * a + 3 * y4 * b * pow (a, 2) + y3 * pow (a, 3);
-
-       imel_draw_line (image, lx, ly, x, y, pixel);
-  }
-  imel_draw_line (image, x, y, x3, y3, pixel);
+ double x[4], y[4];
+
+ return_if_fail (image);
+
+ x[0] = x1;
+ x[1] = x2;
+ x[2] = x4;
+ x[3] = x3;
+ y[0] = y1;
+ y[1] = y2;
+ y[2] = y4;
+ y[3] = y3;
+
+ __imel_path_draw_curve (image, x, y, 3, _p, pixel, pixel);
+ image->generation++;
+}
+
+/**
+ * @brief Draw a quadratic Bèzier's curve
+ *
+ * This function draws a Bèzier's curve in @p image from \f$(x_1,y_1)\f$ to
+ * \f$(x_3,y_3)\f$ with a single reference point. The curve is split in
+ * lines that stay within a quarter of pixel from it.
+ *
+ * @param image Image where draw the curve
+ * @param x1 Start coordinate x of the curve
+ * @param y1 Start coordinate y of the curve
+ * @param x2 Reference coordinate x
+ * @param y2 Reference coordinate y
+ * @param x3 End coordinate x of the curve
+ * @param y3 End coordinate y of the curve
+ * @param pixel Color and level of the curve
+ * @see imel_draw_curve
+ */
+void imel_draw_quadratic_curve (ImelImage *image, ImelSize x1, ImelSize y1, ImelSize x2, ImelSize y2,
+                                ImelSize x3, ImelSize y3, ImelPixel pixel)
+{
+ double x[3], y[3];
+
+ return_if_fail (image);
+
+ x[0] = x1;
+ x[1] = x2;
+ x[2] = x3;
+ y[0] = y1;
+ y[1] = y2;
+ y[2] = y3;
+
+ __imel_path_draw_curve (image, x, y, 2, -1, pixel, pixel);
+ image->generation++;
 }
 
 /**
@@ -841,6 +1579,29 @@ void imel_draw_line_connecting_all_points (ImelImage *image, ImelPoint **points,
                                     points[k]->x, points[k]->y, pxl);
 }
 
+/**
+ * @brief Draw lines between all points passed
+ * 
+ * Same as #imel_draw_line_connecting_all_points.
+ * 
+ * @param image Image where draw these lines
+ * @param points Points to link
+ * @param pxl Color and level of the lines
+ * @see imel_draw_line_connecting_all_points
+ */
+void imel_draw_line_connecting_point_array (ImelImage *image, const ImelPointArray *points, ImelPixel pxl)
+{
+ ImelSize j, k;
+ 
+ return_if_fail (image && points);
+ 
+ for ( j = 0; j < points->n_points; j++ )
+       for ( k = 0; k < points->n_points; k++ )
+             if ( k != j )
+                  imel_draw_line (image, points->point[j].x, points->point[j].y,
+                                  points->point[k].x, points->point[k].y, pxl);
+}
+
 /**
  * @brief Draw a Bèzier's curve with gradient
  * 
@@ -856,7 +1617,8 @@ void imel_draw_line_connecting_all_points (ImelImage *image, ImelPoint **points,
  * @param y3 End coordinate y of the curve
  * @param x4 Second reference coordinate x
  * @param y4 Second reference coordinate y
- * @param _p Number of steps to draw the curve, -1 to set default steps ( 1024 )
+ * @param _p Number of lines to draw the curve, -1 to use lines about two
+ *           pixels long, so the colors change smoothly
  * @param start Start color and level of the curve 
  * @param end End color and level of the curve
  * @see imel_draw_curve
@@ -865,34 +1627,21 @@ void imel_draw_gradient_curve (ImelImage *image, ImelSize x1, ImelSize y1, ImelS
                                ImelSize x3, ImelSize y3, ImelSize x4, ImelSize y4, int _p, 
                                ImelPixel start, ImelPixel end)
 {
-  float t;
-  float x = x1, y = y1;
-  float lx, ly;
-  float a, b;
-  int s = -1, e = (( _p < 0) ? 1024 : _p );
-  float p = 1.0f / (( _p < 0 ) ? 1024 : _p);
-  long int step = -1;
-  ImelPixel pxl, rpxl;
-  
-  return_if_fail (image);
-  
-  step = (end.level - start.level) / e;
-  if ( step < 0 )
-       rpxl.level = start.level - step;
-  else rpxl.level = start.level;
-  
-  for( b = 1 - (a = (t = 0)); t < 1.0f; b = 1 - (a = (t += p)) ) {
-       pxl = imel_pixel_union (start, end, (255.0f * ++s) / e);
-       rpxl = imel_pixel_new (pxl.red, pxl.green, pxl.blue, rpxl.level + step);
-       
-       lx = x;
-       ly = y;
-       x = (x1 * pow (b, 3)) + 3 * x2 * pow (b, 2) * a + 3 * x4 * b * pow (a, 2) + x3 * pow (a, 3);
-       y = (y1 * pow (b, 3)) + 3 * y2 * pow (b, 2) * a + 3 * y4 * b * pow (a, 2) + y3 * pow (a, 3);
+ double x[4], y[4];
+
+ return_if_fail (image);
 
-       imel_draw_line (image, lx, ly, x, y, rpxl);
-  }
-  imel_draw_line (image, x, y, x3, y3, rpxl);
+ x[0] = x1;
+ x[1] = x2;
+ x[2] = x4;
+ x[3] = x3;
+ y[0] = y1;
+ y[1] = y2;
+ y[2] = y4;
+ y[3] = y3;
+
+ __imel_path_draw_curve (image, x, y, 3, _p, start, end);
+ image->generation++;
 }
 
 /**
@@ -902,6 +1651,9 @@ void imel_draw_gradient_curve (ImelImage *image, ImelSize x1, ImelSize y1, ImelS
  * to coordinate \f$(\_x_2,\_y_2)\f$ with small lines length @p size_line pixels and 
  * space between them of @p space_line pixels.
  *
+ * The line has the pixels of #imel_draw_line, the dashes and spaces are
+ * counted along its longest axis from the start.
+ *
  * @param image Image where draw the line
  * @param _x1 Start coordinate x of the line
  * @param _y1 Start coordinate y of the line
@@ -915,10 +1667,7 @@ void imel_draw_gradient_curve (ImelImage *image, ImelSize x1, ImelSize y1, ImelS
 bool imel_draw_dashed_line (ImelImage *image, ImelSize _x1, ImelSize _y1, ImelSize _x2, ImelSize _y2,
                             ImelSize size_line, ImelSize space_line, ImelPixel pixel)
 {
- long int x[2] = { (long int) _x1, (long int) _x2 };
- long int y[2] = { (long int) _y1, (long int) _y2 };
- int j = 0, k;
- double dx, dy, px, py;
+ __ImelLineStyle style;
 
  return_var_if_fail (size_line, true);
  
@@ -927,58 +1676,14 @@ bool imel_draw_dashed_line (ImelImage *image, ImelSize _x1, ImelSize _y1, ImelSi
  
  return_var_if_fail (image, false);
  
- if ( _y1 == _y2 && _x1 == _x2 ) {
-      __imel_draw_point (image, _y1, _x1, pixel);
-      return true;
- }
- 
- if ( (_x1 > _x2 && _y1 > _y2) ) {
-      long_int_swap (&(y[0]), &(y[1]));
-      long_int_swap (&(x[0]), &(x[1]));
- }
-
- dx = x[1] - x[0];
- dy = y[1] - y[0];
- 
- __imel_draw_point (image, x[0], y[0], pixel);
- if ( abs (dx) >= abs (dy) ) {
-      if ( x[0] > x[1] ) {
-           long_int_swap (&(y[0]), &(y[1]));
-           long_int_swap (&(x[0]), &(x[1]));
-      }
-      
-      for ( px = x[0]; px < x[1]; px++ ) {
-            py = ((px - x[0]) / dx) * dy + y[0];
-   
-            if ( j++ < size_line && !k )
-                 __imel_draw_point (image, px, py, pixel);
-
-            if ( j > size_line )
-                 if ( ++k >= space_line )
-                      k = j = 0;
-      }
-
-      return true;
- }
-
- if ( y[0] > y[1] ) {
-      long_int_swap (&(y[0]), &(y[1]));
-      long_int_swap (&(x[0]), &(x[1]));
- }
-      
- for ( py = y[0]; py < y[1]; py++ ) {
-       px = ((py - y[0]) / dy) * dx + x[0];
-
-       if ( j++ < size_line && !k )
-            __imel_draw_point (image, px, py, pixel);
-
-       if ( j > size_line ) {
-            if ( k < space_line )
-                 k++;
-            else k = j = 0;
-       }
+ if ( _y1 == _y2 && _x1 == _x2 )
+      __imel_draw_point (image, _x1, _y1, pixel);
+ else {
+      __imel_draw_line_style_init (&style, _x1, _y1, _x2, _y2, size_line, space_line, pixel, pixel);
+      __imel_draw_line_style (image, _x1, _y1, _x2, _y2, true, global_brush != NULL, &style, pixel);
  }
 
+ image->generation++;
  return true;
 }
 
@@ -1054,7 +1759,10 @@ void imel_draw_grid (ImelImage *image, ImelSize sx, ImelSize sy, ImelSize ex, Im
  * @brief Draw a gradient
  * 
  * This function draw a gradient in @p image, with an @p orientation chosen,
- * from color and level passed in @p start_color to @p end_color.
+ * from color and level passed in @p start_color to @p end_color. The
+ * columns ( or the rows ) from the lower of @p start and @p end to the
+ * higher one, excluded, go from @p start_color to @p end_color; the level
+ * changes like the colors. The brush isn't used.
  * 
  * @param image Image where draw the gradient
  * @param orientation Gradient orientation
@@ -1062,36 +1770,42 @@ void imel_draw_grid (ImelImage *image, ImelSize sx, ImelSize sy, ImelSize ex, Im
  * @param end End row or column ( depends from orientation )
  * @param start_color Start color and level
  * @param end_color End color and level
+ * @see imel_draw_gradient_fill
  */
 void imel_draw_gradient (ImelImage *image, ImelOrientation orientation,
                          ImelSize start, ImelSize end, ImelPixel start_color,
                          ImelPixel end_color)
 {
- ImelSize s = ((start < end) ? start : end) - 1, e = (end < start) ? start : end;
- ImelPixel pxl;
- ImelLevel level;
+ ImelSize s = (start < end) ? start : end, e = (end < start) ? start : end;
+ ImelGradientStop stops[2];
+ ImelGradient gradient;
 
  return_if_fail (image);
- 
- if ( orientation == IMEL_ORIENTATION_HORIZONTAL ) {
-      while ( ++s < e ) {
-              pxl = imel_pixel_union (start_color, end_color, (255 * s) / e);
-              pxl.level = (s * end_color.level ) / (start_color.level ? start_color.level : 1);
-              if ( !start_color.level && pxl.level == 1 )
-                   pxl.level = 0;
-              imel_draw_line (image, s, 0, s, image->height, pxl);
-      }
 
+ if ( s == e )
       return;
- }
 
- while ( ++s < e ) {
-         pxl = imel_pixel_union (start_color, end_color, (255 * s) / e);
-              pxl.level =  (s * end_color.level ) / (start_color.level ? start_color.level : 1);
-              if ( !start_color.level && pxl.level == 1 )
-                   pxl.level = 0;
-         imel_draw_line (image, 0, s, image->width, s, pxl);
+ stops[0].offset = 0;
+ stops[0].pixel = start_color;
+ stops[1].offset = 1;
+ stops[1].pixel = end_color;
+
+ gradient.type = IMEL_GRADIENT_LINEAR;
+ gradient.x1 = gradient.y1 = s;
+ gradient.x2 = gradient.y2 = e;
+ gradient.radius = 0;
+ gradient.angle = 0;
+ gradient.n_stops = gradient.size = 2;
+ gradient.stops = stops;
+
+ if ( orientation == IMEL_ORIENTATION_HORIZONTAL ) {
+      gradient.y1 = gradient.y2 = 0;
+      __imel_gradient_fill (image, &gradient, s, 0, e, image->height);
+      return;
  }
+
+ gradient.x1 = gradient.x2 = 0;
+ __imel_gradient_fill (image, &gradient, 0, s, image->width, e);
 }
 
 /**
@@ -1120,7 +1834,8 @@ bool imel_draw_reg_shape (ImelImage *image, ImelSize x, ImelSize y, ImelSize r,
  * @brief Draw a circle
  * 
  * This function draw a circle in @p image with center in coordinate \f$(x,y)\f$ and 
- * radius @p radius.
+ * radius @p radius. The border is found by the midpoint algorithm, with
+ * integer steps for an eighth of the circle mirrored to the others.
  * 
  * @param image Image where draw the circle
  * @param x Center coordinate x
@@ -1130,36 +1845,33 @@ bool imel_draw_reg_shape (ImelImage *image, ImelSize x, ImelSize y, ImelSize r,
  */
 void imel_draw_circle (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius, ImelPixel pxl)
 {
- long v = ( radius < 127 ) ? 50 : radius >> 2;
- ImelSize sx = x - radius - 1, ex = x + radius + 1; 
- long int po[2] = { -1, -1 }, py[2];
- double p;
+ __ImelOutline outline;
 
  return_if_fail (image);
 
- if ( radius < 6 ) {
-      /* old method */
-      while ( ++sx < ex ) {
-              p = sqrt (pow (((double) radius), 2) - pow (((double) sx - x), 2));
-
-              py[0] = ((long int) y) + ((long int) p);
-              if ( po[0] == -1 && ((ImelSize) py[0]) < image->height ) {
-                   imel_pixel_copy (&(image->pixel[py[0]][sx]), pxl);
-              }
-              else imel_draw_line (image, sx - 1, (po[0] < py[0]) ? po[0] : py[0], sx,
-                                   (po[0] > py[0]) ? po[0] : py[0], pxl);
-              po[0] = py[0];
-
-              py[1] = ((long int) y) - ((long int) p);
-              if ( po[1] == -1 && ((ImelSize) py[1]) < image->height ) {
-                   imel_pixel_copy (&(image->pixel[py[1]][sx]), pxl);
-              }
-              else imel_draw_line (image, sx - 1, (po[1] < py[1]) ? po[1] : py[1], sx,
-                                   (po[1] > py[1]) ? po[1] : py[1], pxl);
-              po[1] = py[1];
-      }
- }  
- else imel_draw_partial_reg_shape (image, x, y, radius, v, 100, 0.0f, pxl);
+ if ( __imel_draw_outline_init (&outline, image, x, y, radius, radius, pxl) )
+      __imel_draw_outline (&outline, radius, radius);
+
+ image->generation++;
+}
+
+/**
+ * @brief Draw an anti-aliased circle
+ * 
+ * This function draws in @p image a circle with center in coordinate
+ * \f$(x,y)\f$ and radius @p radius, as #imel_draw_antialiased_ellipse
+ * with both semi-axes equal to @p radius.
+ * 
+ * @param image Image where draw the circle
+ * @param x Center coordinate x
+ * @param y Center coordinate y
+ * @param radius Radius of the circle
+ * @param pxl Color and level of the circle
+ * @see imel_draw_circle
+ */
+void imel_draw_antialiased_circle (ImelImage *image, double x, double y, double radius, ImelPixel pxl)
+{
+ imel_draw_antialiased_ellipse (image, x, y, radius, radius, pxl);
 }
 
 /**
@@ -1211,7 +1923,8 @@ bool imel_draw_partial_reg_shape (ImelImage *image, ImelSize x, ImelSize y, Imel
  * @brief Draw an arch
  * 
  * This function draw an arch in @p image with center in coordinate \f$(x,y)\f$ 
- * and radius of @p radius pixels. 
+ * and radius of @p radius pixels. The points are the ones of
+ * #imel_draw_circle between the two sides of the arch.
  * 
  * @param image Image where draw the arch
  * @param x Center coordinate x
@@ -1226,7 +1939,7 @@ bool imel_draw_partial_reg_shape (ImelImage *image, ImelSize x, ImelSize y, Imel
 bool imel_draw_arch (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius, 
                      double start_angle, double end_angle, ImelPixel pxl)
 {
- double j, ox, oy, ax, ay;
+ __ImelOutline outline;
  
  return_var_if_fail (image, false);
  
@@ -1236,20 +1949,15 @@ bool imel_draw_arch (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius,
  
  if ( end_angle > DEG_TO_RAD (360) )
       return false;
- 
- ox = ax = ((double) x) + radius * cos (start_angle);
- oy = ay = ((double) y) + radius * sin (start_angle);
- __imel_draw_point (image, (ImelSize) ox, (ImelSize) oy, pxl);
- 
- for ( j = RAD_TO_DEG (start_angle), end_angle = RAD_TO_DEG (end_angle); 
-       j < end_angle; j++, ox = ax, oy = ay ) { 
-       
-       ax = (((double) x) + radius * cos (DEG_TO_RAD (j)));
-       ay = (((double) y) + radius * sin (DEG_TO_RAD (j)));
-       
-       imel_draw_line (image, (ImelSize) ox, (ImelSize) oy, 
-                       (ImelSize) ax, (ImelSize) ay, pxl);       
- }
+
+ if ( ! __imel_draw_outline_init (&outline, image, x, y, radius, radius, pxl) )
+      return true;
+
+ if ( end_angle - start_angle < PI * 2 )
+      __imel_draw_outline_set_arc (&outline, start_angle, end_angle);
+
+ __imel_draw_outline (&outline, radius, radius);
+ image->generation++;
  
  return true;
 }
@@ -1258,7 +1966,8 @@ bool imel_draw_arch (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius,
  * @brief Draw a filled arch
  * 
  * This function draw a filled arch in @p image with center in coordinate \f$(x,y)\f$
- * and radius of @p radius pixels. 
+ * and radius of @p radius pixels. Each row of the circle is cut by the
+ * two sides of the arch, so it's drawn with one or two spans.
  * 
  * @param image Image where draw the arch
  * @param x Center coordinate x
@@ -1273,7 +1982,10 @@ bool imel_draw_arch (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius,
 bool imel_draw_filled_arch (ImelImage *image, ImelSize x, ImelSize y, ImelSize radius, 
                             double start_angle, double end_angle, ImelPixel pxl)
 {
- double j, ox, oy, ax, ay;
+ __ImelEllipseRows rows;
+ double ax, ay, bx, by;
+ long dy, h;
+ bool reflex;
  
  return_var_if_fail (image, false);
  
@@ -1283,21 +1995,29 @@ bool imel_draw_filled_arch (ImelImage *image, ImelSize x, ImelSize y, ImelSize r
  
  if ( end_angle > DEG_TO_RAD (360) )
       return false;
- 
- ox = ax = ((double) x) + radius * cos (start_angle);
- oy = ay = ((double) y) + radius * sin (start_angle);
- imel_draw_line (image, (ImelSize) ox, (ImelSize) oy, x, y, pxl);
- 
- for ( j = RAD_TO_DEG (start_angle), end_angle = RAD_TO_DEG (end_angle); 
-       j < end_angle; j++, ox = ax, oy = ay ) { 
-       
-       ax = (((double) x) + radius * cos (DEG_TO_RAD (j)));
-       ay = (((double) y) + radius * sin (DEG_TO_RAD (j)));
-       
-       imel_draw_filled_line (image, (ImelSize) ox, (ImelSize) oy, 
-                              (ImelSize) ax, (ImelSize) ay, x, y, pxl);       
+
+ if ( ! radius || start_angle == end_angle ) {
+      imel_draw_line (image, (ImelSize) (((double) x) + radius * cos (start_angle)),
+                      (ImelSize) (((double) y) + radius * sin (start_angle)), x, y, pxl);
+      return true;
+ }
+
+ ax = cos (start_angle);
+ ay = sin (start_angle);
+ bx = cos (end_angle);
+ by = sin (end_angle);
+ reflex = end_angle - start_angle > PI;
+
+ __imel_draw_ellipse_rows_init (&rows, radius, radius, true);
+ for ( dy = radius; dy >= 0; dy-- ) {
+       h = __imel_draw_ellipse_row (&rows, dy);
+
+       __imel_draw_fill_sector_row (image, x, y, dy, h, ax, ay, bx, by, reflex, global_brush != NULL, pxl);
+       if ( dy )
+            __imel_draw_fill_sector_row (image, x, y, -dy, h, ax, ay, bx, by, reflex, global_brush != NULL, pxl);
  }
  
+ image->generation++;
  return true;
 }
 
@@ -1338,5 +2058,6 @@ bool imel_draw_spiral (ImelImage *image, ImelSize x, ImelSize y,
        __imel_draw_point (image, (ImelSize) xs, (ImelSize) ys, pxl);
  }
  
+ image->generation++;
  return true;
 }
@@ -30,162 +30,146 @@ extern ImelImage *imel_image_new (ImelSize width, ImelSize height);
 extern ImelColor imel_color_sum (ImelColor a, ImelColor b);
 extern ImelColor imel_color_subtract (ImelColor a, ImelColor b);
 extern void imel_image_free (ImelImage *image);
+extern ImelSize __imel_thread_bands (ImelSize n, ImelSize grain);
+extern void __imel_thread_run (ImelSize n, ImelSize grain, ImelBandFuncPtr func, ImelGenericPtr data);
+extern void __imel_thread_run_bands (ImelSize n, ImelSize bands, ImelBandFuncPtr func, ImelGenericPtr data);
+extern void __imel_point_op_apply (ImelImage *image, const ImelPointOp *point_op);
+extern void imel_point_op_reset (ImelPointOp *point_op);
+extern void imel_point_op_add_brightness (ImelPointOp *point_op, int perc);
+extern void imel_point_op_add_contrast (ImelPointOp *point_op, int s);
+extern void imel_point_op_add_invert (ImelPointOp *point_op);
+extern void __imel_mask_set (ImelImage *image, ImelMask mask, ImelPixel value);
+extern const ImelImageStats *imel_image_get_stats (ImelImage *image);
+
+/* Columns processed together by the vertical pass of the gaussian blur */
+#define __IMEL_BLUR_STRIP 16
+
+typedef struct ___imel_blur {
+               ImelImage *image;
+               float *plane;
+               float *column;      /* Column buffers of each band of strips */
+               double b[4];
+        } __ImelBlur;
 
 static ImelColor abs_color (int expression)
 {
  return (expression < 0) ? 0 : (expression > 255) ? 255 : expression;
 }
 
-void imel_effect_white_black (ImelImagePtr image, ImelGenericPtr data)
+void __imel_effect_white_black_pixel (ImelPixel *p)
 {
  ImelColor c;
+
+ if ( p->level < 0 )
+      return;
+
+ c = (0.3 * p->red) + (0.59 * p->green) + (0.11 * p->blue);
+ imel_pixel_set (p, c, c, c, p->level);
+}
+
+void imel_effect_white_black (ImelImagePtr image, ImelGenericPtr data)
+{
  ImelSize y, x;
- ImelPixel *p;
 
  for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                 continue;
-
-             c = (0.3 * p->red) + (0.59 * p->green) + (0.11 * p->blue);
-             imel_pixel_set (p, c, c, c, p->level);
-       }
+       for ( x = 0; x < image->width; x++ )
+             __imel_effect_white_black_pixel (&(image->pixel[y][x]));
  }
 }
 
-void imel_effect_antique (ImelImagePtr image, ImelGenericPtr data)
+void __imel_effect_antique_pixel (ImelPixel *p)
 {
  ImelColor c;
- ImelSize y, x;
- ImelPixel *p;
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
+ if ( p->level < 0 )
+      return;
 
-             c = ((64 * p->red) + (160 * p->green) + (32 * p->blue)) / 256;
-             imel_pixel_set (p, ((c * 3) + p->red) / 4, ((c * 3) + p->green) / 4,
-                                ((c * 3) + p->blue) / 4, p->level);
-       }
- }
+ c = ((64 * p->red) + (160 * p->green) + (32 * p->blue)) / 256;
+ imel_pixel_set (p, ((c * 3) + p->red) / 4, ((c * 3) + p->green) / 4,
+                    ((c * 3) + p->blue) / 4, p->level);
 }
 
-void imel_effect_invert (ImelImagePtr image, ImelGenericPtr data)
+void imel_effect_antique (ImelImagePtr image, ImelGenericPtr data)
 {
  ImelSize y, x;
- ImelPixel *p;
 
  for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
-             imel_pixel_set (p, 255 - p->red, 255 - p->green, 255 - p->blue, p->level);
-       }
+       for ( x = 0; x < image->width; x++ )
+             __imel_effect_antique_pixel (&(image->pixel[y][x]));
  }
 }
 
-void imel_effect_normalize (ImelImagePtr image, ImelGenericPtr data)
+void imel_effect_invert (ImelImagePtr image, ImelGenericPtr data)
 {
- ImelSize y, x, mask = (ImelSize) data, normalize[3];
- ImelPixel *p;
+ ImelPointOp point_op;
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
+ imel_point_op_reset (&point_op);
+ imel_point_op_add_invert (&point_op);
+ __imel_point_op_apply (image, &point_op);
+}
 
-             normalize[0] += image->pixel[y][x].red;
-             normalize[1] += image->pixel[y][x].green;
-             normalize[2] += image->pixel[y][x].blue;
-       }
- }
+/* Average of the colors of the pixels with a level not negative */
+void __imel_effect_normalize_mean (ImelImage *image, ImelColor *mean)
+{
+ const ImelImageStats *stats = imel_image_get_stats (image);
 
- normalize[0] /= image->height * image->width;
- normalize[1] /= image->height * image->width;
- normalize[2] /= image->height * image->width;
+ memset (mean, 0, 3 * sizeof (ImelColor));
+ return_if_fail (stats);
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
-
-             switch ( mask ) {
-                case IMEL_MASK_RED:
-                      imel_pixel_set (p, normalize[0], p->green, p->blue, p->level);
-                      break;
-                case IMEL_MASK_GREEN:
-                      imel_pixel_set (p, p->red, normalize[1], p->blue, p->level);
-                      break;
-                case IMEL_MASK_BLUE:
-                      imel_pixel_set (p, p->red, p->green, normalize[2], p->level);
-                      break;
-                case IMEL_MASK_RED | IMEL_MASK_GREEN:
-                      imel_pixel_set (p, normalize[0], normalize[1], p->blue, p->level);
-                      break;
-                case IMEL_MASK_RED | IMEL_MASK_BLUE:
-                      imel_pixel_set (p, normalize[0], p->green, normalize[2], p->level);
-                      break;
-                case IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                      imel_pixel_set (p, p->red, normalize[1], normalize[2], p->level);
-                      break;
-              }
-       }
- }
+ memcpy (mean, stats->mean, 3 * sizeof (ImelColor));
 }
 
-void imel_effect_brightness (ImelImagePtr image, ImelGenericPtr data)
+void __imel_effect_normalize_pixel (ImelPixel *p, ImelMask mask, const ImelColor *mean)
 {
- ImelPixel *p;
- int perc = (int) data;
- ImelColor red, green, blue;
- ImelSize y, x, mask = ( perc > -1 ) ? 1 : 0;
+ if ( p->level < 0 )
+      return;
 
- perc = ((perc = ((mask ? perc : perc * -1) * 255) / 100) > 255) ? 
-        255 * (mask ? 1 : -1) : perc * (mask ? 1 : -1);
+ if ( mask & IMEL_MASK_RED )
+      p->red = mean[0];
+ if ( mask & IMEL_MASK_GREEN )
+      p->green = mean[1];
+ if ( mask & IMEL_MASK_BLUE )
+      p->blue = mean[2];
+}
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
-
-             red = ((p->red + perc) > 255) ? 255 : ((p->red + perc) < 0) ? 0 : p->red + perc;
-             green = ((p->green + perc) > 255) ? 255 : ((p->green + perc) < 0) ? 0 : p->green + perc;
-             blue = ((p->blue + perc) > 255) ? 255 : ((p->blue + perc) < 0) ? 0 : p->blue + perc;
-             imel_pixel_set (p, red, green, blue, p->level);
-       }
- }
+void imel_effect_normalize (ImelImagePtr image, ImelGenericPtr data)
+{
+ ImelSize mask = (ImelSize) data;
+ ImelColor mean[3];
+ ImelPixel value;
+
+ __imel_effect_normalize_mean (image, mean);
+
+ imel_pixel_set (&value, mean[0], mean[1], mean[2], 0);
+ __imel_mask_set (image, mask & (IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE), value);
 }
 
-void imel_effect_contrast_stretching (ImelImagePtr image, ImelGenericPtr data)
+void imel_effect_brightness (ImelImagePtr image, ImelGenericPtr data)
 {
- ImelSize x, y;
- ImelPixel *p;
- int tmp_color;
- ImelColor red, green, blue, x0, x1, rgb[2][3] = {
-                                                  { 0xff, 0xff, 0xff },
-                                                  { 0x00, 0x00, 0x00 }
-                                                 };
+ ImelPointOp point_op;
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
-
-             rgb[0][0] = (p->red < rgb[0][0]) ? p->red : rgb[0][0];
-             rgb[0][1] = (p->green < rgb[0][1]) ? p->green : rgb[0][1];
-             rgb[0][2] = (p->blue < rgb[0][2]) ? p->blue : rgb[0][2];
-             rgb[1][0] = (p->red > rgb[1][0]) ? p->red : rgb[1][0];
-             rgb[1][1] = (p->green > rgb[1][1]) ? p->green : rgb[1][1];
-             rgb[1][2] = (p->blue > rgb[1][2]) ? p->blue : rgb[1][2];
-        }
+ imel_point_op_reset (&point_op);
+ imel_point_op_add_brightness (&point_op, (int) data);
+ __imel_point_op_apply (image, &point_op);
+}
+
+/* Build in @point_op the stretching from the darkest to the brightest
+ * channel value of the pixels with a level not negative, the pixels with
+ * negative level are left unchanged */
+void __imel_effect_contrast_stretching_op (ImelImage *image, ImelPointOp *point_op)
+{
+ const ImelImageStats *stats = imel_image_get_stats (image);
+ int tmp_color, i, c;
+ ImelColor x0, x1, rgb[2][3] = {
+                                { 0xff, 0xff, 0xff },
+                                { 0x00, 0x00, 0x00 }
+                               };
+
+ imel_point_op_reset (point_op);
+
+ if ( stats ) {
+      memcpy (rgb[0], stats->min, 3 * sizeof (ImelColor));
+      memcpy (rgb[1], stats->max, 3 * sizeof (ImelColor));
  }
 
  x0 = ( rgb[0][0] < rgb[0][1] ) ? ( rgb[0][0] < rgb[0][2] ) ? rgb[0][0] : rgb[0][2] :
@@ -193,69 +177,33 @@ void imel_effect_contrast_stretching (ImelImagePtr image, ImelGenericPtr data)
  x1 = ( rgb[1][0] > rgb[1][1] ) ? ( rgb[1][0] > rgb[1][2] ) ? rgb[1][0] : rgb[1][2] :
                                   ( rgb[1][1] > rgb[1][2] ) ? rgb[1][1] : rgb[1][2];
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
-
-             if ( x0 != x1 ) {
-                  tmp_color = (255 * (p->red - x0)) / ( x1 - x0 );
-                  red = ( tmp_color > 255 ) ? 255 : ( tmp_color < 0 ) ? 0 : tmp_color;
-             }
-             else red = p->red;
-
-             if ( x0 != x1 ) {
-                  tmp_color = (255 * (p->green - x0)) / ( x1 - x0 );
-                  green = ( tmp_color > 255 ) ? 255 : ( tmp_color < 0 ) ? 0 : tmp_color;
-             }
-             else green = p->green;
-
-             if ( x0 != x1 ) {
-                  tmp_color = (255 * (p->blue - x0)) / ( x1 - x0 );
-                  blue = ( tmp_color > 255 ) ? 255 : ( tmp_color < 0 ) ? 0 : tmp_color;
-             }
-             else blue = p->blue;
-
-             imel_pixel_set (p, red, green, blue, p->level);
+ for ( i = 0; i < 256; i++ ) {
+       if ( x0 < x1 ) {
+            tmp_color = (255 * (i - x0)) / ( x1 - x0 );
+            tmp_color = ( tmp_color > 255 ) ? 255 : ( tmp_color < 0 ) ? 0 : tmp_color;
        }
+       else tmp_color = i;
+
+       for ( c = 0; c < 3; c++ )
+             point_op->lut[c][i] = tmp_color;
  }
 }
 
-void imel_effect_contrast (ImelImagePtr image, ImelGenericPtr data)
+void imel_effect_contrast_stretching (ImelImagePtr image, ImelGenericPtr data)
 {
- int s = (int) data;
- ImelSize y, x;
- ImelPixel *p;
- ImelColor red, green, blue;
- float contrast;
- float contrast_arg = (s > 128) ? 1.0f : (s < -127) ? -1.0f : s / 127.0f;
-
- if ( contrast_arg >= 0.0f ) {
-      contrast_arg = (contrast_arg > 0.99999f) ? 0.99999 : contrast_arg;
-      contrast_arg = 1.0f / (1.0f - contrast_arg);
- }
- else {
-      contrast_arg = (contrast_arg < -1.0f) ? -1.0f : contrast_arg;
-      contrast_arg = 1.0f + contrast_arg;
- }
-
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-
-             contrast = (((((float) p->red) / 255) - 0.5f) * contrast_arg) + 0.5f;
-             red = (contrast > 1.0f) ? 255 : (contrast < 0.0f ) ? 0 : contrast * 255;
+ ImelPointOp point_op;
 
-             contrast = (((((float) p->green) / 255) - 0.5f) * contrast_arg) + 0.5f;
-             green = (contrast > 1.0f) ? 255 : (contrast < 0.0f ) ? 0 : contrast * 255;
+ __imel_effect_contrast_stretching_op (image, &point_op);
+ __imel_point_op_apply (image, &point_op);
+}
 
-             contrast = (((((float) p->blue) / 255) - 0.5f) * contrast_arg) + 0.5f;
-             blue = (contrast > 1.0f) ? 255 : (contrast < 0.0f ) ? 0 : contrast * 255;
+void imel_effect_contrast (ImelImagePtr image, ImelGenericPtr data)
+{
+ ImelPointOp point_op;
 
-             imel_pixel_set (p, red, green, blue, p->level);
-       }
- }
+ imel_point_op_reset (&point_op);
+ imel_point_op_add_contrast (&point_op, (int) data);
+ __imel_point_op_apply (image, &point_op);
 }
 
 void imel_effect_rasterize (ImelImagePtr image, ImelGenericPtr data)
@@ -385,121 +333,302 @@ void imel_effect_direct_antialias (ImelImagePtr image, ImelGenericPtr data)
  }
 }
 
+void __imel_effect_image_add_pixel (ImelPixel *p, ImelPixel q)
+{
+ p->red = imel_color_sum (p->red, q.red);
+ p->green = imel_color_sum (p->green, q.green);
+ p->blue = imel_color_sum (p->blue, q.blue);
+ p->level += q.level;
+}
+
 void imel_effect_image_add (ImelImagePtr image, ImelGenericPtr data)
 {
- static ImelPixel result;
  ImelImage *add_img = (ImelImage *) data;
  ImelSize x, y;
  
  for ( y = 0; y < image->height && y < add_img->height; y++ ) {
-       for ( x = 0; x < image->width && x < add_img->width; x++ ) {
-             result.red = imel_color_sum (image->pixel[y][x].red, add_img->pixel[y][x].red);
-             result.green = imel_color_sum (image->pixel[y][x].green, add_img->pixel[y][x].green);
-             result.blue = imel_color_sum (image->pixel[y][x].blue, add_img->pixel[y][x].blue);
-             result.level = image->pixel[y][x].level + add_img->pixel[y][x].level;
-             
-             imel_pixel_set_from_pixel (&(image->pixel[y][x]), result);
-       }
+       for ( x = 0; x < image->width && x < add_img->width; x++ )
+             __imel_effect_image_add_pixel (&(image->pixel[y][x]), add_img->pixel[y][x]);
  }
 }
 
+void __imel_effect_image_subtract_pixel (ImelPixel *p, ImelPixel q)
+{
+ p->red = imel_color_subtract (p->red, q.red);
+ p->green = imel_color_subtract (p->green, q.green);
+ p->blue = imel_color_subtract (p->blue, q.blue);
+ p->level -= q.level;
+}
+
 void imel_effect_image_subtract (ImelImagePtr image, ImelGenericPtr data)
 {
- static ImelPixel result;
  ImelImage *add_img = (ImelImage *) data;
  ImelSize x, y;
  
  for ( y = 0; y < image->height && y < add_img->height; y++ ) {
-       for ( x = 0; x < image->width && x < add_img->width; x++ ) {
-             result.red = imel_color_subtract (image->pixel[y][x].red, add_img->pixel[y][x].red);
-             result.green = imel_color_subtract (image->pixel[y][x].green, add_img->pixel[y][x].green);
-             result.blue = imel_color_subtract (image->pixel[y][x].blue, add_img->pixel[y][x].blue);
-             result.level = image->pixel[y][x].level - add_img->pixel[y][x].level;
-             
-             imel_pixel_set_from_pixel (&(image->pixel[y][x]), result);
-       }
+       for ( x = 0; x < image->width && x < add_img->width; x++ )
+             __imel_effect_image_subtract_pixel (&(image->pixel[y][x]), add_img->pixel[y][x]);
  }
 }
 
-void imel_effect_color_to_alpha (ImelImagePtr image, ImelGenericPtr data)
+/* @c receives the color to remove as values from 0 to 1 */
+void __imel_effect_color_to_alpha_prepare (const ImelPixel *_c, double *c)
 {
- ImelSize x, y;
- ImelPixel *_c = (ImelPixel *) data, *p;
- double src[4], alpha[4], c[4];
- 
- /** Thank you Gimp's Developers for the your
-     code that i could readjust **/
-    
  c[0] = ((double) _c->red) / 255.f;
  c[1] = ((double) _c->green) / 255.f;
  c[2] = ((double) _c->blue) / 255.f;
  c[3] = (_c->level >= 0) ? 1.f : (_c->level < -255) ? 0.f : 
         -1 * (((double) _c->level) / 255.f);
+}
+
+void __imel_effect_color_to_alpha_pixel (ImelPixel *p, const double *c)
+{
+ double src[4], alpha[4];
+
+ /** Thank you Gimp's Developers for the your
+     code that i could readjust **/
+
+ if ( p->level <= -255 )
+      return;
+      
+ src[0] = ((double) p->red) / 255;
+ src[1] = ((double) p->green) / 255;
+ src[2] = ((double) p->blue) / 255;
+ src[3] = (p->level >= 0) ? 1.f : (p->level < -255) ? 0.f : 
+          -1 * (((double) p->level) / 255.f);
+ 
+ alpha[3] = src[3];
+
+      if (c[0] < 0.0001)
+          alpha[0] = src[0];
+ else if (src[0] > c[0])
+          alpha[0] = (src[0] - c[0]) / (1.f - c[0]);
+ else if (src[0] < c[0])
+          alpha[0] = (c[0] - src[0]) / c[0];
+ else     alpha[0] = 0;
+
+      if (c[1] < 0.0001)
+          alpha[1] = src[1];
+ else if (src[1] > c[1])
+          alpha[1] = (src[1] - c[1]) / (1.f - c[1]);
+ else if (src[1] < c[1])
+          alpha[1] = (c[1] - src[1]) / c[1];
+ else     alpha[1] = 0;
+
+      if (c[2] < 0.0001)
+          alpha[2] = src[2];
+ else if (src[2] > c[2])
+          alpha[2] = (src[2] - c[2]) / (1.f - c[2]);
+ else if (src[2] < c[2])
+          alpha[2] = (c[2] - src[2]) / c[2];
+ else     alpha[2] = 0.f;
+ 
+      if (alpha[0] > alpha[1]) {
+          if ( alpha[0] > alpha[2] )
+               src[3] = alpha[0];
+          else src[3] = alpha[2];
+      }
+ else if (alpha[1] > alpha[2])
+          src[3] = alpha[1];
+ else     src[3] = alpha[2];
+
+ if (src[3] < 0.0001) {
+     p->level = -255;
+     return;
+ }
+ 
+ src[0]   = (src[0] - c[0]) / src[3] + c[0];
+ src[1] = (src[1] - c[1]) / src[3] + c[1];
+ src[2]  = (src[2] - c[2]) / src[3] + c[2];
+
+ src[3] *= alpha[3];
+ 
+ 
+ p->red   = (ImelColor) (255 * src[0]);
+ p->green = (ImelColor) (255 * src[1]);
+ p->blue  = (ImelColor) (255 * src[2]);
+ p->level = (ImelLevel) (-255 * (1.f - src[3]));
+}
+
+void imel_effect_color_to_alpha (ImelImagePtr image, ImelGenericPtr data)
+{
+ ImelSize x, y;
+ double c[4];
+ 
+ __imel_effect_color_to_alpha_prepare ((ImelPixel *) data, c);
  
  for ( y = 0; y < image->height; y++ ) {
+       for ( x = 0; x < image->width; x++ )
+             __imel_effect_color_to_alpha_pixel (&(image->pixel[y][x]), c);
+ }
+}
+
+/* Young - van Vliet recursive gaussian filter: a third order forward pass
+ * followed by the same backward pass. The coefficients only depends on
+ * sigma, so the cost for each pixel is constant. b[0] is the input gain,
+ * b[1..3] the feedback weights. */
+static bool __imel_blur_coefficients (double sigma, double *b)
+{
+ double q, q2, q3, b0;
+
+ if ( sigma < 0.5 )
+      return false;
+
+ q = ( sigma >= 2.5 ) ? 0.98711 * sigma - 0.96330 :
+                        3.97156 - 4.14554 * sqrt (1.0 - 0.26891 * sigma);
+ q2 = q * q;
+ q3 = q2 * q;
+
+ b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+ b[1] = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+ b[2] = -(1.4281 * q2 + 1.26661 * q3) / b0;
+ b[3] = (0.422205 * q3) / b0;
+ b[0] = 1.0 - (b[1] + b[2] + b[3]);
+
+ return true;
+}
+
+/* Filter @n values, each of @stride floats, in place */
+static void __imel_blur_line (float *v, ImelSize n, ImelSize stride, const double *b)
+{
+ ImelSize i, c;
+ double w1, w2, w3, w;
+
+ for ( c = 0; c < stride; c++ ) {
+       w1 = w2 = w3 = v[c];
+       for ( i = 0; i < n; i++ ) {
+             w = b[0] * v[i * stride + c] + b[1] * w1 + b[2] * w2 + b[3] * w3;
+             v[i * stride + c] = w;
+             w3 = w2;
+             w2 = w1;
+             w1 = w;
+       }
+
+       w1 = w2 = w3 = v[(n - 1) * stride + c];
+       for ( i = n; i-- > 0; ) {
+             w = b[0] * v[i * stride + c] + b[1] * w1 + b[2] * w2 + b[3] * w3;
+             v[i * stride + c] = w;
+             w3 = w2;
+             w2 = w1;
+             w1 = w;
+       }
+ }
+}
+
+static void __imel_blur_rows (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelBlur *blur = (__ImelBlur *) data;
+ ImelImage *image = blur->image;
+ ImelSize y, x;
+ float *row;
+
+ (void) band;
+
+ for ( y = start; y < end; y++ ) {
+       row = &blur->plane[y * image->width * 3];
+
        for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             
-             if ( p->level <= -255 )
-                  continue;
-                  
-             src[0] = ((double) p->red) / 255;
-             src[1] = ((double) p->green) / 255;
-             src[2] = ((double) p->blue) / 255;
-             src[3] = (p->level >= 0) ? 1.f : (p->level < -255) ? 0.f : 
-                      -1 * (((double) p->level) / 255.f);
-             
-             alpha[3] = src[3];
-
-                  if (c[0] < 0.0001)
-                      alpha[0] = src[0];
-             else if (src[0] > c[0])
-                      alpha[0] = (src[0] - c[0]) / (1.f - c[0]);
-             else if (src[0] < c[0])
-                      alpha[0] = (c[0] - src[0]) / c[0];
-             else     alpha[0] = 0;
-
-                  if (c[1] < 0.0001)
-                      alpha[1] = src[1];
-             else if (src[1] > c[1])
-                      alpha[1] = (src[1] - c[1]) / (1.f - c[1]);
-             else if (src[1] < c[1])
-                      alpha[1] = (c[1] - src[1]) / c[1];
-             else     alpha[1] = 0;
-
-                  if (c[2] < 0.0001)
-                      alpha[2] = src[2];
-             else if (src[2] > c[2])
-                      alpha[2] = (src[2] - c[2]) / (1.f - c[2]);
-             else if (src[2] < c[2])
-                      alpha[2] = (c[2] - src[2]) / c[2];
-             else     alpha[2] = 0.f;
-             
-                  if (alpha[0] > alpha[1]) {
-                      if ( alpha[0] > alpha[2] )
-                           src[3] = alpha[0];
-                      else src[3] = alpha[2];
-                  }
-             else if (alpha[1] > alpha[2])
-                      src[3] = alpha[1];
-             else     src[3] = alpha[2];
-
-             if (src[3] < 0.0001) {
-                 p->level = -255;
-                 continue;
+             row[x * 3] = image->pixel[y][x].red;
+             row[x * 3 + 1] = image->pixel[y][x].green;
+             row[x * 3 + 2] = image->pixel[y][x].blue;
+       }
+
+       __imel_blur_line (row, image->width, 3, blur->b);
+ }
+}
+
+static ImelColor __imel_blur_color (double value)
+{
+ return ( value <= 0 ) ? 0 : ( value >= 255 ) ? 255 : (ImelColor) (value + 0.5);
+}
+
+/* Vertical pass on strips of __IMEL_BLUR_STRIP columns: every row of a strip
+ * is contiguous in the plane, so the recursion runs on all its columns at
+ * once instead of jumping a whole image row for each sample. */
+static void __imel_blur_strips (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelBlur *blur = (__ImelBlur *) data;
+ ImelImage *image = blur->image;
+ ImelSize strip, sx, w, y, i;
+ double w1[__IMEL_BLUR_STRIP * 3], w2[__IMEL_BLUR_STRIP * 3], w3[__IMEL_BLUR_STRIP * 3], v;
+ const double *b = blur->b;
+ float *column, *in, *out;
+ ImelPixel *p;
+
+ column = &blur->column[band * image->height * __IMEL_BLUR_STRIP * 3];
+
+ for ( strip = start; strip < end; strip++ ) {
+       sx = strip * __IMEL_BLUR_STRIP;
+       w = ( sx + __IMEL_BLUR_STRIP > image->width ) ? (image->width - sx) * 3 : __IMEL_BLUR_STRIP * 3;
+
+       for ( i = 0; i < w; i++ )
+             w1[i] = w2[i] = w3[i] = blur->plane[sx * 3 + i];
+
+       for ( y = 0; y < image->height; y++ ) {
+             in = &blur->plane[(y * image->width + sx) * 3];
+             out = &column[y * __IMEL_BLUR_STRIP * 3];
+
+             for ( i = 0; i < w; i++ ) {
+                   v = b[0] * in[i] + b[1] * w1[i] + b[2] * w2[i] + b[3] * w3[i];
+                   out[i] = v;
+                   w3[i] = w2[i];
+                   w2[i] = w1[i];
+                   w1[i] = v;
              }
-             
-             src[0]   = (src[0] - c[0]) / src[3] + c[0];
-             src[1] = (src[1] - c[1]) / src[3] + c[1];
-             src[2]  = (src[2] - c[2]) / src[3] + c[2];
+       }
 
-             src[3] *= alpha[3];
-             
-             
-             p->red   = (ImelColor) (255 * src[0]);
-             p->green = (ImelColor) (255 * src[1]);
-             p->blue  = (ImelColor) (255 * src[2]);
-             p->level = (ImelLevel) (-255 * (1.f - src[3]));
+       for ( i = 0; i < w; i++ )
+             w1[i] = w2[i] = w3[i] = column[(image->height - 1) * __IMEL_BLUR_STRIP * 3 + i];
+
+       for ( y = image->height; y-- > 0; ) {
+             out = &column[y * __IMEL_BLUR_STRIP * 3];
+
+             for ( i = 0; i < w; i++ ) {
+                   v = b[0] * out[i] + b[1] * w1[i] + b[2] * w2[i] + b[3] * w3[i];
+                   out[i] = v;
+                   w3[i] = w2[i];
+                   w2[i] = w1[i];
+                   w1[i] = v;
+             }
+
+             for ( i = 0; i < w; i += 3 ) {
+                   p = &image->pixel[y][sx + i / 3];
+                   p->red = __imel_blur_color (out[i]);
+                   p->green = __imel_blur_color (out[i + 1]);
+                   p->blue = __imel_blur_color (out[i + 2]);
+             }
        }
  }
 }
+
+void imel_effect_gaussian_blur (ImelImagePtr image, ImelGenericPtr data)
+{
+ __ImelBlur blur;
+ ImelSize strips, bands;
+
+ if ( ! data || ! image->width || ! image->height )
+      return;
+
+ if ( ! __imel_blur_coefficients (*((double *) data), blur.b) )
+      return;
+
+ strips = (image->width + __IMEL_BLUR_STRIP - 1) / __IMEL_BLUR_STRIP;
+ bands = __imel_thread_bands (strips, 2);
+
+ /* Every band of strips has its own column buffer, all allocated before
+  * starting so the image is blurred entirely or not at all */
+ blur.image = image;
+ blur.plane = (float *) malloc (sizeof (float) * image->width * image->height * 3);
+ blur.column = (float *) malloc (sizeof (float) * bands * image->height * __IMEL_BLUR_STRIP * 3);
+ if ( ! blur.plane || ! blur.column ) {
+      free (blur.plane);
+      free (blur.column);
+      return;
+ }
+
+ __imel_thread_run (image->height, 32, __imel_blur_rows, &blur);
+ __imel_thread_run_bands (strips, bands, __imel_blur_strips, &blur);
+
+ free (blur.plane);
+ free (blur.column);
+}
@@ -0,0 +1,406 @@
+/*
+ * "effect_chain.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include "header.h"
+/**
+ * @file effect_chain.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to apply a sequence of effects.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+extern void imel_effect_antialias (ImelImagePtr, ImelGenericPtr);
+extern void imel_effect_direct_antialias (ImelImagePtr, ImelGenericPtr);
+extern void imel_effect_gaussian_blur (ImelImagePtr, ImelGenericPtr);
+extern void imel_effect_rasterize (ImelImagePtr, ImelGenericPtr);
+
+extern void __imel_effect_antique_pixel (ImelPixel *p);
+extern void __imel_effect_color_to_alpha_pixel (ImelPixel *p, const double *c);
+extern void __imel_effect_color_to_alpha_prepare (const ImelPixel *_c, double *c);
+extern void __imel_effect_contrast_stretching_op (ImelImage *image, ImelPointOp *point_op);
+extern void __imel_effect_image_add_pixel (ImelPixel *p, ImelPixel q);
+extern void __imel_effect_image_subtract_pixel (ImelPixel *p, ImelPixel q);
+extern void __imel_effect_normalize_mean (ImelImage *image, ImelColor *mean);
+extern void __imel_effect_normalize_pixel (ImelPixel *p, ImelMask mask, const ImelColor *mean);
+extern void __imel_effect_white_black_pixel (ImelPixel *p);
+
+extern void imel_point_op_reset (ImelPointOp *point_op);
+extern void imel_point_op_add_brightness (ImelPointOp *point_op, int perc);
+extern void imel_point_op_add_contrast (ImelPointOp *point_op, int s);
+extern void imel_point_op_add_invert (ImelPointOp *point_op);
+extern void __imel_point_op_compose_op (ImelPointOp *point_op, const ImelPointOp *next);
+
+extern void __imel_thread_run (ImelSize n, ImelSize grain, ImelBandFuncPtr func, ImelGenericPtr data);
+
+/* Rows of every tile processed by a thread */
+#define __IMEL_CHAIN_TILE 32
+
+/* An effect ready to be applied to single pixels */
+typedef struct ___imel_chain_stage {
+               ImelEffect effect;
+               ImelPointOp point_op;
+               ImelMask mask;
+               ImelColor mean[3];
+               ImelImage *image;
+               double color[4];
+        } __ImelChainStage;
+
+typedef struct ___imel_chain_run {
+               ImelImage *image;
+               __ImelChainStage *stages;
+               ImelSize n_stages;
+        } __ImelChainRun;
+
+/* Effects that need the pixels around the current one, they can't be fused */
+static bool __imel_effect_chain_is_area (ImelEffect effect)
+{
+ return effect == IMEL_EFFECT_RASTERIZE || effect == IMEL_EFFECT_ANTIALIAS ||
+        effect == IMEL_EFFECT_DIRECT_ANTIALIAS || effect == IMEL_EFFECT_GAUSSIAN_BLUR;
+}
+
+/* Effects that need statistics of the whole image before the first pixel */
+static bool __imel_effect_chain_is_barrier (ImelEffect effect)
+{
+ return effect == IMEL_EFFECT_NORMALIZE || effect == IMEL_EFFECT_CONTRAST_STRETCHING;
+}
+
+/* Image operands that are the target itself must see the effects before them */
+static bool __imel_effect_chain_is_alias (const ImelImage *image, const ImelEffectChainItem *item)
+{
+ return ( item->effect == IMEL_EFFECT_IMAGE_ADD || item->effect == IMEL_EFFECT_IMAGE_SUBTRACT ) &&
+        item->argument.image == image;
+}
+
+static void __imel_effect_chain_rows (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelChainRun *run = (__ImelChainRun *) data;
+ __ImelChainStage *stage;
+ ImelSize y, x, i;
+ ImelPixel pixel, *row;
+ const ImelColor (*table)[256];
+
+ (void) band;
+
+ for ( y = start; y < end; y++ ) {
+       row = run->image->pixel[y];
+
+       for ( x = 0; x < run->image->width; x++ ) {
+             pixel = row[x];
+
+             for ( i = 0; i < run->n_stages; i++ ) {
+                   stage = &run->stages[i];
+
+                   switch ( stage->effect ) {
+                      case IMEL_EFFECT_WHITE_BLACK:
+                            __imel_effect_white_black_pixel (&pixel);
+                            break;
+                      case IMEL_EFFECT_ANTIQUE:
+                            __imel_effect_antique_pixel (&pixel);
+                            break;
+                      case IMEL_EFFECT_NORMALIZE:
+                            __imel_effect_normalize_pixel (&pixel, stage->mask, stage->mean);
+                            break;
+                      case IMEL_EFFECT_INVERT:
+                      case IMEL_EFFECT_BRIGHTNESS:
+                      case IMEL_EFFECT_CONTRAST:
+                      case IMEL_EFFECT_CONTRAST_STRETCHING:
+                            if ( pixel.level < 0 )
+                                 table = (const ImelColor (*)[256]) stage->point_op.alpha_lut;
+                            else table = (const ImelColor (*)[256]) stage->point_op.lut;
+                            pixel.red = table[0][pixel.red];
+                            pixel.green = table[1][pixel.green];
+                            pixel.blue = table[2][pixel.blue];
+                            break;
+                      case IMEL_EFFECT_IMAGE_ADD:
+                            if ( y < stage->image->height && x < stage->image->width )
+                                 __imel_effect_image_add_pixel (&pixel, stage->image->pixel[y][x]);
+                            break;
+                      case IMEL_EFFECT_IMAGE_SUBTRACT:
+                            if ( y < stage->image->height && x < stage->image->width )
+                                 __imel_effect_image_subtract_pixel (&pixel, stage->image->pixel[y][x]);
+                            break;
+                      case IMEL_EFFECT_COLOR_TO_ALPHA:
+                            __imel_effect_color_to_alpha_pixel (&pixel, stage->color);
+                            break;
+                      default: break;
+                   }
+             }
+
+             row[x] = pixel;
+       }
+ }
+}
+
+/* Prepare the stage for @item, computing the statistics of @image if needed.
+ * Consecutive lookup table stages are composed in a single one. */
+static void __imel_effect_chain_stage (ImelImage *image, ImelEffectChainItem *item,
+                                       __ImelChainStage *stages, ImelSize *n_stages)
+{
+ __ImelChainStage *stage = &stages[*n_stages], *prev;
+
+ stage->effect = item->effect;
+
+ switch ( item->effect ) {
+    case IMEL_EFFECT_NORMALIZE:
+          stage->mask = item->argument.mask;
+          __imel_effect_normalize_mean (image, stage->mean);
+          break;
+    case IMEL_EFFECT_INVERT:
+          imel_point_op_reset (&stage->point_op);
+          imel_point_op_add_invert (&stage->point_op);
+          break;
+    case IMEL_EFFECT_BRIGHTNESS:
+          imel_point_op_reset (&stage->point_op);
+          imel_point_op_add_brightness (&stage->point_op, item->argument.value);
+          break;
+    case IMEL_EFFECT_CONTRAST:
+          imel_point_op_reset (&stage->point_op);
+          imel_point_op_add_contrast (&stage->point_op, item->argument.value);
+          break;
+    case IMEL_EFFECT_CONTRAST_STRETCHING:
+          __imel_effect_contrast_stretching_op (image, &stage->point_op);
+          break;
+    case IMEL_EFFECT_IMAGE_ADD:
+    case IMEL_EFFECT_IMAGE_SUBTRACT:
+          stage->image = item->argument.image;
+          break;
+    case IMEL_EFFECT_COLOR_TO_ALPHA:
+          __imel_effect_color_to_alpha_prepare (&item->argument.pixel, stage->color);
+          break;
+    default: break;
+ }
+
+ if ( *n_stages ) {
+      prev = &stages[*n_stages - 1];
+
+      if ( (prev->effect == IMEL_EFFECT_INVERT || prev->effect == IMEL_EFFECT_BRIGHTNESS ||
+            prev->effect == IMEL_EFFECT_CONTRAST || prev->effect == IMEL_EFFECT_CONTRAST_STRETCHING) &&
+           (stage->effect == IMEL_EFFECT_INVERT || stage->effect == IMEL_EFFECT_BRIGHTNESS ||
+            stage->effect == IMEL_EFFECT_CONTRAST || stage->effect == IMEL_EFFECT_CONTRAST_STRETCHING) ) {
+           __imel_point_op_compose_op (&prev->point_op, &stage->point_op);
+           return;
+      }
+ }
+
+ (*n_stages)++;
+}
+
+static void __imel_effect_chain_flush (ImelImage *image, __ImelChainStage *stages, ImelSize *n_stages)
+{
+ __ImelChainRun run;
+
+ if ( ! *n_stages )
+      return;
+
+ run.image = image;
+ run.stages = stages;
+ run.n_stages = *n_stages;
+
+ __imel_thread_run (image->height, __IMEL_CHAIN_TILE, __imel_effect_chain_rows, &run);
+ image->generation++;
+
+ *n_stages = 0;
+}
+
+#endif
+
+/**
+ * @brief Make a new effect chain
+ *
+ * This function makes a new empty chain of effects. Effects added to the
+ * chain are applied in order by #imel_effect_chain_apply, consecutive effects
+ * that change each pixel independently from others are applied together
+ * with a single pass over the image.
+ *
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.jpg", 0, NULL);
+ * ImelEffectChain *chain = imel_effect_chain_new ();
+ *
+ * imel_effect_chain_add (chain, IMEL_EFFECT_CONTRAST_STRETCHING);
+ * imel_effect_chain_add (chain, IMEL_EFFECT_BRIGHTNESS, 10);
+ * imel_effect_chain_add (chain, IMEL_EFFECT_ANTIQUE);
+ * imel_effect_chain_apply (image, chain);
+ *
+ * imel_effect_chain_free (chain);
+ * @endcode
+ *
+ * @return A new effect chain or NULL on error.
+ * @see imel_effect_chain_add
+ * @see imel_effect_chain_apply
+ * @see imel_effect_chain_free
+ */
+ImelEffectChain *imel_effect_chain_new (void)
+{
+ ImelEffectChain *chain;
+
+ chain = (ImelEffectChain *) malloc (sizeof (ImelEffectChain));
+ return_var_if_fail (chain, NULL);
+
+ chain->n_items = 0;
+ chain->items = NULL;
+
+ return chain;
+}
+
+/**
+ * @brief Add an effect to a chain
+ *
+ * This function add @p effect at the end of @p chain. The parameter of the
+ * effect is the same requested by #imel_image_apply_effect, it is copied
+ * in the chain (only the image of #IMEL_EFFECT_IMAGE_ADD and
+ * #IMEL_EFFECT_IMAGE_SUBTRACT is kept as reference).
+ *
+ * @param chain Effect chain
+ * @param effect Effect to add
+ * @param ... Option for the @p effect
+ * @return TRUE on success, FALSE on error.
+ * @see ImelEffect
+ * @see imel_effect_chain_new
+ */
+bool imel_effect_chain_add (ImelEffectChain *chain, ImelEffect effect, ...)
+{
+ ImelEffectChainItem *items, item;
+ ImelPixel *pixel;
+ double *sigma;
+ bool valid = true;
+ va_list opt_argument;
+
+ return_var_if_fail (chain && effect <= IMEL_EFFECT_GAUSSIAN_BLUR, false);
+
+ item.effect = effect;
+
+ va_start (opt_argument, effect);
+ switch ( effect ) {
+    case IMEL_EFFECT_NORMALIZE:
+          item.argument.mask = (ImelMask) va_arg (opt_argument, int);
+          break;
+    case IMEL_EFFECT_BRIGHTNESS:
+    case IMEL_EFFECT_CONTRAST:
+    case IMEL_EFFECT_RASTERIZE:
+    case IMEL_EFFECT_ANTIALIAS:
+    case IMEL_EFFECT_DIRECT_ANTIALIAS:
+          item.argument.value = va_arg (opt_argument, int);
+          break;
+    case IMEL_EFFECT_IMAGE_ADD:
+    case IMEL_EFFECT_IMAGE_SUBTRACT:
+          item.argument.image = va_arg (opt_argument, ImelImage *);
+          valid = item.argument.image != NULL;
+          break;
+    case IMEL_EFFECT_COLOR_TO_ALPHA:
+          pixel = va_arg (opt_argument, ImelPixel *);
+          if ( pixel )
+               item.argument.pixel = *pixel;
+          valid = pixel != NULL;
+          break;
+    case IMEL_EFFECT_GAUSSIAN_BLUR:
+          sigma = va_arg (opt_argument, double *);
+          item.argument.sigma = sigma ? *sigma : 0;
+          break;
+    default: break;
+ }
+ va_end (opt_argument);
+
+ return_var_if_fail (valid, false);
+
+ items = (ImelEffectChainItem *) realloc (chain->items, sizeof (ImelEffectChainItem) * (chain->n_items + 1));
+ return_var_if_fail (items, false);
+
+ items[chain->n_items++] = item;
+ chain->items = items;
+
+ return true;
+}
+
+/**
+ * @brief Apply an effect chain to an image
+ *
+ * This function apply all the effects of @p chain to @p image, with the
+ * same result of calling #imel_image_apply_effect for each of them.
+ * Consecutive effects on single pixels are applied together, tile by tile,
+ * and tiles are split between threads. #IMEL_EFFECT_NORMALIZE and
+ * #IMEL_EFFECT_CONTRAST_STRETCHING need the statistics of the image before
+ * starting, effects that use the pixels around the current one
+ * (#IMEL_EFFECT_RASTERIZE, #IMEL_EFFECT_ANTIALIAS, #IMEL_EFFECT_DIRECT_ANTIALIAS
+ * and #IMEL_EFFECT_GAUSSIAN_BLUR) are applied alone: both of them end the
+ * current pass. #IMEL_EFFECT_IMAGE_ADD and #IMEL_EFFECT_IMAGE_SUBTRACT with
+ * @p image itself as operand end the current pass too.
+ *
+ * @param image Image on which apply the effects
+ * @param chain Effect chain
+ * @see imel_effect_chain_new
+ * @see imel_thread_set_count
+ */
+void imel_effect_chain_apply (ImelImage *image, ImelEffectChain *chain)
+{
+ __ImelChainStage *stages;
+ ImelEffectChainItem *item;
+ ImelSize i, n_stages = 0;
+
+ return_if_fail (image && chain);
+
+ if ( ! chain->n_items )
+      return;
+
+ stages = (__ImelChainStage *) malloc (sizeof (__ImelChainStage) * chain->n_items);
+ return_if_fail (stages);
+
+ for ( i = 0; i < chain->n_items; i++ ) {
+       item = &chain->items[i];
+
+       if ( __imel_effect_chain_is_area (item->effect) ) {
+            __imel_effect_chain_flush (image, stages, &n_stages);
+
+            if ( item->effect == IMEL_EFFECT_GAUSSIAN_BLUR )
+                 imel_effect_gaussian_blur (image, &item->argument.sigma);
+            else if ( item->effect == IMEL_EFFECT_RASTERIZE )
+                 imel_effect_rasterize (image, (ImelGenericPtr) (long int) item->argument.value);
+            else if ( item->effect == IMEL_EFFECT_ANTIALIAS )
+                 imel_effect_antialias (image, (ImelGenericPtr) (long int) item->argument.value);
+            else imel_effect_direct_antialias (image, (ImelGenericPtr) (long int) item->argument.value);
+            image->generation++;
+
+            continue;
+       }
+
+       if ( __imel_effect_chain_is_barrier (item->effect) || __imel_effect_chain_is_alias (image, item) )
+            __imel_effect_chain_flush (image, stages, &n_stages);
+
+       __imel_effect_chain_stage (image, item, stages, &n_stages);
+ }
+
+ __imel_effect_chain_flush (image, stages, &n_stages);
+
+ free (stages);
+}
+
+/**
+ * @brief Free an effect chain
+ *
+ * @param chain Effect chain to free
+ * @see imel_effect_chain_new
+ */
+void imel_effect_chain_free (ImelEffectChain *chain)
+{
+ return_if_fail (chain);
+
+ free (chain->items);
+ free (chain);
+}
@@ -0,0 +1,299 @@
+/*
+ * "equalize.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "header.h"
+#include "kernel.h"
+/**
+ * @file equalize.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to equalize the histograms of an
+ *        image, on the whole image or tile by tile.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+/* First element of the @i-th of @tiles parts of @n elements */
+#define __IMEL_TILE_START(i, tiles, n) ((ImelSize) (((uint64_t) (i) * (n)) / (tiles)))
+
+extern void __imel_thread_run (ImelSize n, ImelSize grain, ImelBandFuncPtr func, ImelGenericPtr data);
+extern void __imel_point_op_apply (ImelImage *image, const ImelPointOp *point_op);
+extern const ImelImageStats *imel_image_get_stats (ImelImage *image);
+
+typedef struct ___imel_clahe {
+               ImelImage *image;
+               ImelSize tiles_x;
+               ImelSize tiles_y;
+               double clip_limit;
+               ImelColor (*lut)[3][256]; /* tiles_y * tiles_x tables */
+               ImelSize *tile;           /* left tile of each column */
+               ImelSize *next;           /* right tile of each column */
+               ImelSize *weight;         /* weight of the right tile in 1/256 */
+        } __ImelClahe;
+
+/* Build in @lut the table that makes flat the histogram of @total values.
+ * If @limit isn't 0 the bins are clipped to it and the excess is spread
+ * over all the bins. @histogram is changed. */
+static void __imel_equalize_lut (uint64_t *histogram, uint64_t total, uint64_t limit, ImelColor *lut)
+{
+ uint64_t excess = 0, step, rest, cdf = 0, cdf_min = 0;
+ int i;
+
+ if ( limit ) {
+      for ( i = 0; i < 256; i++ ) {
+            excess += ( histogram[i] > limit ) ? histogram[i] - limit : 0;
+            histogram[i] = ( histogram[i] > limit ) ? limit : histogram[i];
+      }
+
+      /* The rest goes to bins spaced evenly */
+      step = excess >> 8;
+      rest = excess & 0xff;
+      for ( i = 0; i < 256; i++ )
+            histogram[i] += step + ((((i + 1) * rest) >> 8) - ((i * rest) >> 8));
+ }
+
+ for ( i = 0; i < 256 && ! cdf_min; i++ )
+       cdf_min = histogram[i];
+
+ if ( total <= cdf_min ) {
+      for ( i = 0; i < 256; i++ )
+            lut[i] = i;
+      return;
+ }
+
+ for ( i = 0; i < 256; i++ ) {
+       cdf += histogram[i];
+       lut[i] = ( cdf <= cdf_min ) ? 0 : ((cdf - cdf_min) * 255 + ((total - cdf_min) >> 1)) / (total - cdf_min);
+ }
+}
+
+/* Tiles around the @i-th of @n elements split in @tiles parts, the result
+ * is the weight of @next in 1/256 */
+static ImelSize __imel_clahe_weight (ImelSize i, ImelSize n, ImelSize tiles, ImelSize *tile, ImelSize *next)
+{
+ int64_t position;
+
+ /* Distance from the center of the first tile, in 1/256 of tile */
+ position = ((2 * (int64_t) i + 1) * tiles * 256) / (2 * (int64_t) n) - 128;
+ position = ( position < 0 ) ? 0 : position;
+
+ *tile = position >> 8;
+ if ( *tile >= tiles - 1 ) {
+      *tile = *next = tiles - 1;
+      return 0;
+ }
+
+ *next = *tile + 1;
+
+ return position & 0xff;
+}
+
+/* Histograms and lookup tables of the tiles in the rows of tiles [start, end) */
+static void __imel_clahe_tiles (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelClahe *clahe = (__ImelClahe *) data;
+ ImelImage *image = clahe->image;
+ const __ImelKernels *kernels = __imel_kernels ();
+ ImelSize count[__IMEL_HISTOGRAM_COPIES * __IMEL_HISTOGRAM_CHANNELS][256];
+ uint64_t histogram[256], area, limit;
+ ImelSize tx, ty, x0, x1, y0, y1, y;
+ int c, copy, i;
+
+ (void) band;
+
+ for ( ty = start; ty < end; ty++ ) {
+       y0 = __IMEL_TILE_START (ty, clahe->tiles_y, image->height);
+       y1 = __IMEL_TILE_START (ty + 1, clahe->tiles_y, image->height);
+
+       for ( tx = 0; tx < clahe->tiles_x; tx++ ) {
+             x0 = __IMEL_TILE_START (tx, clahe->tiles_x, image->width);
+             x1 = __IMEL_TILE_START (tx + 1, clahe->tiles_x, image->width);
+
+             memset (count, 0, sizeof (count));
+             for ( y = y0; y < y1; y++ )
+                   kernels->histogram_row (image->pixel[y] + x0, x1 - x0, count);
+
+             area = (uint64_t) (x1 - x0) * (y1 - y0);
+             limit = ( clahe->clip_limit < 1.0 ) ? 0 : (uint64_t) (clahe->clip_limit * area / 256);
+             limit = ( clahe->clip_limit >= 1.0 && ! limit ) ? 1 : limit;
+
+             for ( c = 0; c < 3; c++ ) {
+                   for ( i = 0; i < 256; i++ ) {
+                         histogram[i] = 0;
+                         for ( copy = 0; copy < __IMEL_HISTOGRAM_COPIES; copy++ )
+                               histogram[i] += count[copy * __IMEL_HISTOGRAM_CHANNELS + c][i];
+                   }
+
+                   __imel_equalize_lut (histogram, area, limit,
+                                        clahe->lut[ty * clahe->tiles_x + tx][c]);
+             }
+       }
+ }
+}
+
+/* Each pixel is mapped by the tables of the four nearest tiles, mixed
+ * with bilinear weights in 8 bit fixed point */
+static void __imel_clahe_rows (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelClahe *clahe = (__ImelClahe *) data;
+ ImelImage *image = clahe->image;
+ ImelColor (*top)[3][256], (*bottom)[3][256];
+ ImelSize y, x, ty, ty_next, wx, wy;
+ unsigned int value[3], a, b;
+ ImelPixel *p;
+ int c;
+
+ (void) band;
+
+ for ( y = start; y < end; y++ ) {
+       wy = __imel_clahe_weight (y, image->height, clahe->tiles_y, &ty, &ty_next);
+       top = clahe->lut + ty * clahe->tiles_x;
+       bottom = clahe->lut + ty_next * clahe->tiles_x;
+
+       for ( x = 0; x < image->width; x++ ) {
+             p = &(image->pixel[y][x]);
+             wx = clahe->weight[x];
+             value[0] = p->red;
+             value[1] = p->green;
+             value[2] = p->blue;
+
+             for ( c = 0; c < 3; c++ ) {
+                   a = (256 - wx) * top[clahe->tile[x]][c][value[c]] + wx * top[clahe->next[x]][c][value[c]];
+                   b = (256 - wx) * bottom[clahe->tile[x]][c][value[c]] + wx * bottom[clahe->next[x]][c][value[c]];
+                   value[c] = ((256 - wy) * a + wy * b + 0x8000) >> 16;
+             }
+
+             p->red = value[0];
+             p->green = value[1];
+             p->blue = value[2];
+       }
+ }
+}
+
+#endif
+
+/**
+ * @brief Equalize the histograms of an image
+ *
+ * This function spreads the values of each color channel of @p image so
+ * that its histogram becomes as flat as possible. The histograms are the
+ * ones of #imel_image_get_stats, so this function makes only a pass over
+ * the image to apply the result. Levels are unchanged.
+ *
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.jpg", 0, NULL);
+ *
+ * imel_image_equalize (image);
+ * @endcode
+ *
+ * @param image Image to equalize
+ * @see imel_image_equalize_adaptive
+ * @see IMEL_EFFECT_CONTRAST_STRETCHING
+ */
+void imel_image_equalize (ImelImage *image)
+{
+ const ImelImageStats *stats;
+ ImelPointOp point_op;
+ uint64_t histogram[256], total;
+
+ return_if_fail (image);
+
+ stats = imel_image_get_stats (image);
+ return_if_fail (stats);
+
+ total = (uint64_t) image->width * image->height;
+
+ memcpy (histogram, stats->histograms.red, sizeof (histogram));
+ __imel_equalize_lut (histogram, total, 0, point_op.lut[0]);
+ memcpy (histogram, stats->histograms.green, sizeof (histogram));
+ __imel_equalize_lut (histogram, total, 0, point_op.lut[1]);
+ memcpy (histogram, stats->histograms.blue, sizeof (histogram));
+ __imel_equalize_lut (histogram, total, 0, point_op.lut[2]);
+
+ /* Every pixel is equalized, also the ones with negative level */
+ memcpy (point_op.alpha_lut, point_op.lut, sizeof (point_op.lut));
+ __imel_point_op_apply (image, &point_op);
+}
+
+/**
+ * @brief Equalize the histograms of an image tile by tile
+ *
+ * This function applies the Contrast Limited Adaptive Histogram
+ * Equalization ( CLAHE ) to @p image. The image is split in
+ * @p tiles_x x @p tiles_y tiles and each color channel of every tile is
+ * equalized on its own, with the bins of its histogram clipped to
+ * @p clip_limit times the average bin so the noise of flat areas isn't
+ * amplified. Every pixel is mapped mixing the results of the four tiles
+ * nearest to it, so the borders of the tiles aren't visible.
+ *
+ * The histograms of the tiles are computed with a pass over the image and
+ * the pixels are changed with a second one, both split between threads.
+ * Levels are unchanged.
+ *
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.jpg", 0, NULL);
+ *
+ * imel_image_equalize_adaptive (image, 8, 8, 2.0);
+ * @endcode
+ *
+ * @param image Image to equalize
+ * @param tiles_x Number of tiles on the width, at least 1
+ * @param tiles_y Number of tiles on the height, at least 1
+ * @param clip_limit Maximum height of the bins as multiple of the average
+ * one, usually between 2 and 4. Values under 1 disable the limit.
+ * @see imel_image_equalize
+ * @see imel_thread_set_count
+ */
+void imel_image_equalize_adaptive (ImelImage *image, ImelSize tiles_x, ImelSize tiles_y, double clip_limit)
+{
+ __ImelClahe clahe;
+ ImelSize x;
+
+ return_if_fail (image && tiles_x && tiles_y);
+
+ if ( ! image->width || ! image->height )
+      return;
+
+ clahe.image = image;
+ clahe.tiles_x = ( tiles_x > image->width ) ? image->width : tiles_x;
+ clahe.tiles_y = ( tiles_y > image->height ) ? image->height : tiles_y;
+ clahe.clip_limit = clip_limit;
+
+ clahe.lut = (ImelColor (*)[3][256]) malloc (clahe.tiles_x * clahe.tiles_y * sizeof (*clahe.lut));
+ clahe.tile = (ImelSize *) malloc (3 * image->width * sizeof (ImelSize));
+ if ( ! clahe.lut || ! clahe.tile ) {
+      free (clahe.lut);
+      free (clahe.tile);
+      return;
+ }
+
+ clahe.next = clahe.tile + image->width;
+ clahe.weight = clahe.next + image->width;
+ for ( x = 0; x < image->width; x++ )
+       clahe.weight[x] = __imel_clahe_weight (x, image->width, clahe.tiles_x,
+                                              &clahe.tile[x], &clahe.next[x]);
+
+ __imel_thread_run (clahe.tiles_y, 1, __imel_clahe_tiles, &clahe);
+ __imel_thread_run (image->height, 16, __imel_clahe_rows, &clahe);
+ image->generation++;
+
+ free (clahe.lut);
+ free (clahe.tile);
+}
@@ -0,0 +1,344 @@
+/*
+ * "fft.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "header.h"
+/**
+ * @file fft.c
+ * @author Davide Francesco Merico
+ * @brief This file contains the frequency-domain convolution used
+ *        internally by #imel_image_apply_convolution.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#define PI 3.14159265358979323846
+
+/* Smallest side of a FFT tile */
+#define __IMEL_FFT_MIN_TILE 64
+
+/* Radix-2 FFT over complex values stored as (re, im) couples. The table
+ * contains n / 2 couples (cos, sin) of the twiddle factors. */
+static void __imel_fft (double *data, ImelSize n, const double *twiddle, bool inverse)
+{
+ ImelSize i, j, k, len, half, step;
+ double wr, wi, tr, ti, *a, *b;
+
+ for ( i = 1, j = 0; i < n; i++ ) {
+       k = n >> 1;
+       while ( j & k ) {
+               j ^= k;
+               k >>= 1;
+       }
+       j |= k;
+
+       if ( i < j ) {
+            tr = data[2 * i];
+            ti = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = tr;
+            data[2 * j + 1] = ti;
+       }
+ }
+
+ for ( len = 2; len <= n; len <<= 1 ) {
+       half = len >> 1;
+       step = n / len;
+
+       for ( i = 0; i < n; i += len ) {
+             for ( j = 0; j < half; j++ ) {
+                   wr = twiddle[2 * j * step];
+                   wi = inverse ? twiddle[2 * j * step + 1] : -twiddle[2 * j * step + 1];
+
+                   a = &data[2 * (i + j)];
+                   b = &data[2 * (i + j + half)];
+
+                   tr = b[0] * wr - b[1] * wi;
+                   ti = b[0] * wi + b[1] * wr;
+
+                   b[0] = a[0] - tr;
+                   b[1] = a[1] - ti;
+                   a[0] += tr;
+                   a[1] += ti;
+             }
+       }
+ }
+}
+
+static double *__imel_fft_twiddle_new (ImelSize n)
+{
+ ImelSize i;
+ double *twiddle;
+
+ twiddle = (double *) malloc (sizeof (double) * n);
+ return_var_if_fail (twiddle, NULL);
+
+ for ( i = 0; i < n / 2; i++ ) {
+       twiddle[2 * i] = cos (2.0 * PI * i / n);
+       twiddle[2 * i + 1] = sin (2.0 * PI * i / n);
+ }
+
+ return twiddle;
+}
+
+/* Bidimensional FFT of a nx * ny tile. Only the first @rows rows can
+ * contain non-zero values, the remaining ones are skipped on the forward
+ * row pass. @column is a work buffer of 2 * ny doubles. */
+static void __imel_fft_2d (double *data, ImelSize nx, ImelSize ny, ImelSize rows,
+                           const double *twiddle_x, const double *twiddle_y,
+                           double *column, bool inverse)
+{
+ ImelSize x, y;
+
+ if ( ! inverse ) {
+      for ( y = 0; y < rows; y++ )
+            __imel_fft (&data[2 * y * nx], nx, twiddle_x, false);
+ }
+
+ for ( x = 0; x < nx; x++ ) {
+       for ( y = 0; y < ny; y++ ) {
+             column[2 * y] = data[2 * (y * nx + x)];
+             column[2 * y + 1] = data[2 * (y * nx + x) + 1];
+       }
+
+       __imel_fft (column, ny, twiddle_y, inverse);
+
+       for ( y = 0; y < ny; y++ ) {
+             data[2 * (y * nx + x)] = column[2 * y];
+             data[2 * (y * nx + x) + 1] = column[2 * y + 1];
+       }
+ }
+
+ if ( inverse ) {
+      for ( y = 0; y < ny; y++ )
+            __imel_fft (&data[2 * y * nx], nx, twiddle_x, true);
+ }
+}
+
+static ImelSize __imel_fft_size (ImelSize n)
+{
+ ImelSize size = 1;
+
+ while ( size < n )
+         size <<= 1;
+
+ return size;
+}
+
+/* Choose the tile side for a kernel side @k over an image side @n: twice
+ * the kernel is a good trade-off between wasted padding and transform size,
+ * but a tile never needs to be greater than the whole padded image. */
+static ImelSize __imel_fft_tile_size (ImelSize n, ImelSize k)
+{
+ ImelSize size;
+
+ size = __imel_fft_size (2 * k);
+ if ( size < __IMEL_FFT_MIN_TILE )
+      size = __IMEL_FFT_MIN_TILE;
+
+ return min (size, __imel_fft_size (n + k - 1));
+}
+
+/* Estimated cost of the direct and of the FFT convolution, in multiply-add
+ * operations. A complex butterfly is counted as four of them. */
+bool __imel_fft_convolution_is_faster (ImelImage *image, int width, int height)
+{
+ ImelSize nx, ny, tiles;
+ double direct, fft;
+
+ return_var_if_fail (image && width > 0 && height > 0, false);
+
+ nx = __imel_fft_tile_size (image->width, width);
+ ny = __imel_fft_tile_size (image->height, height);
+
+ tiles = ((image->width + nx - width) / (nx - width + 1)) *
+         ((image->height + ny - height) / (ny - height + 1));
+
+ direct = 3.0 * image->width * image->height * width * height;
+ /* Two channels for each complex transform, forward and inverse */
+ fft = tiles * 4.0 * (2.0 * nx * ny * log ((double) nx * ny) / log (2.0) + nx * ny);
+
+ return fft < direct;
+}
+
+/* Index of @i wrapped inside [0, n) */
+static ImelSize __imel_fft_wrap (long int i, ImelSize n)
+{
+ i %= (long int) n;
+
+ return (ImelSize) ((i < 0) ? i + (long int) n : i);
+}
+
+/* Copy @rows rows of results from @band to the image from row @y */
+static void __imel_fft_store (ImelImage *image, const unsigned char *band, ImelSize y, ImelSize rows)
+{
+ ImelSize i, x;
+ ImelPixel *p;
+
+ for ( i = 0; i < rows; i++ ) {
+       for ( x = 0, p = image->pixel[y + i]; x < image->width; x++, p++, band += 3 ) {
+             p->red = band[0];
+             p->green = band[1];
+             p->blue = band[2];
+       }
+ }
+}
+
+/* Frequency-domain version of imel_image_apply_convolution.
+ *
+ * The result is computed in tiles of bx * by pixels. Each one needs the
+ * source pixels of a bx + width - 1 by by + height - 1 area, wrapping
+ * around the image borders like the direct path does, which fits in the
+ * nx * ny transform: the part of the circular convolution that wraps
+ * inside the tile falls out of the bx * by kept values (overlap-save).
+ * Red and green channels are transformed together as real and imaginary
+ * part of the same signal, since the kernel is real the two results
+ * don't mix.
+ *
+ * The tiles go by bands of rows. A band is written back to the image
+ * after the next one is computed, since that one still reads the last
+ * rows of the source band, and the first rows of the image are copied
+ * for the last band, that reads them wrapping around. So only two bands
+ * of results and a few rows are kept besides the tile buffers. */
+bool __imel_fft_convolution (ImelImage *image, double **filter, int width,
+                             int height, double factor, double bias)
+{
+ ImelSize nx, ny, bx, by, sx, sy, bw, bh, x, y, pass, n_top, band_size, row;
+ long int off_x, off_y;
+ double *kernel, *tile, *column, *twiddle_x, *twiddle_y, re, im, scale, v;
+ unsigned char *band[2], *out = NULL;
+ ImelPixel *top, *p;
+ int j, k, c;
+
+ return_var_if_fail (image && filter && width > 0 && height > 0, false);
+
+ nx = __imel_fft_tile_size (image->width, width);
+ ny = __imel_fft_tile_size (image->height, height);
+ bx = nx - width + 1;
+ by = min (ny - height + 1, image->height);
+
+ off_x = width - 1 - width / 2;
+ off_y = height - 1 - height / 2;
+ scale = 1.0 / ((double) nx * ny);
+
+ /* Rows of the image read wrapping around by the last band */
+ n_top = min ((ImelSize) off_y, image->height);
+ band_size = 3 * by * image->width;
+
+ kernel = (double *) calloc (2 * nx * ny, sizeof (double));
+ tile = (double *) malloc (sizeof (double) * 2 * nx * ny);
+ column = (double *) malloc (sizeof (double) * 2 * ny);
+ twiddle_x = __imel_fft_twiddle_new (nx);
+ twiddle_y = __imel_fft_twiddle_new (ny);
+ band[0] = (unsigned char *) malloc (2 * band_size);
+ top = (ImelPixel *) malloc (sizeof (ImelPixel) * (n_top ? n_top : 1) * image->width);
+
+ if ( ! kernel || ! tile || ! column || ! twiddle_x || ! twiddle_y || ! band[0] || ! top ) {
+      free (kernel);
+      free (tile);
+      free (column);
+      free (twiddle_x);
+      free (twiddle_y);
+      free (band[0]);
+      free (top);
+      return false;
+ }
+
+ band[1] = band[0] + band_size;
+ for ( y = 0; y < n_top; y++ )
+       memcpy (&top[y * image->width], image->pixel[y], sizeof (ImelPixel) * image->width);
+
+ /* filter[j][k] is the weight for the pixel (x - width / 2 + j, y - height / 2 + k),
+  * store it mirrored to obtain a convolution */
+ for ( j = 0; j < width; j++ ) {
+       for ( k = 0; k < height; k++ )
+             kernel[2 * ((height - 1 - k) * nx + (width - 1 - j))] = filter[j][k];
+ }
+ __imel_fft_2d (kernel, nx, ny, height, twiddle_x, twiddle_y, column, false);
+
+ for ( sy = 0; sy < image->height; sy += by ) {
+       bh = min (by, image->height - sy);
+       out = band[(sy / by) & 1];
+
+       for ( sx = 0; sx < image->width; sx += bx ) {
+             bw = min (bx, image->width - sx);
+
+             for ( pass = 0; pass < 2; pass++ ) {
+                   memset (tile, 0, sizeof (double) * 2 * nx * ny);
+
+                   for ( y = 0; y < bh + height - 1; y++ ) {
+                         row = __imel_fft_wrap ((long int) (sy + y) + off_y - (height - 1), image->height);
+
+                         for ( x = 0; x < bw + width - 1; x++ ) {
+                               p = ( row < n_top ) ? &top[row * image->width] : image->pixel[row];
+                               p += __imel_fft_wrap ((long int) (sx + x) + off_x - (width - 1), image->width);
+
+                               tile[2 * (y * nx + x)] = pass ? p->blue : p->red;
+                               tile[2 * (y * nx + x) + 1] = pass ? 0 : p->green;
+                         }
+                   }
+
+                   __imel_fft_2d (tile, nx, ny, bh + height - 1, twiddle_x, twiddle_y, column, false);
+
+                   for ( x = 0; x < nx * ny; x++ ) {
+                         re = tile[2 * x] * kernel[2 * x] - tile[2 * x + 1] * kernel[2 * x + 1];
+                         im = tile[2 * x] * kernel[2 * x + 1] + tile[2 * x + 1] * kernel[2 * x];
+                         tile[2 * x] = re * scale;
+                         tile[2 * x + 1] = im * scale;
+                   }
+
+                   __imel_fft_2d (tile, nx, ny, ny, twiddle_x, twiddle_y, column, true);
+
+                   for ( y = 0; y < bh; y++ ) {
+                         for ( x = 0; x < bw; x++ ) {
+                               for ( c = pass ? 2 : 0; c < (pass ? 3 : 2); c++ ) {
+                                     v = factor * tile[2 * ((y + height - 1) * nx + x + width - 1) + (c & 1)] + bias;
+                                     /* Round the FFT noise away before the truncation */
+                                     v = (v < 0) ? -v : v;
+                                     out[3 * (y * image->width + sx + x) + c] = (v >= 255) ? 255 : (int) (v + 1e-6);
+                               }
+                         }
+                   }
+             }
+       }
+
+       /* The previous band isn't read anymore */
+       if ( sy )
+            __imel_fft_store (image, band[((sy / by) - 1) & 1], sy - by, by);
+ }
+
+ sy -= by;
+ __imel_fft_store (image, out, sy, image->height - sy);
+
+ free (kernel);
+ free (tile);
+ free (column);
+ free (twiddle_x);
+ free (twiddle_y);
+ free (band[0]);
+ free (top);
+
+ return true;
+}
+
+#endif
@@ -18,7 +18,9 @@
 */
 
 #include <string.h>
+#include <stdlib.h>
 #include <limits.h>
+#include <pthread.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include "header.h"
@@ -31,24 +33,579 @@
  *
  * These functions allow you to write a string with the internal Imel
  * font or with a truetype font loaded. 
+ *
+ * The glyphs of the internal font are scaled once for each size into an
+ * atlas of coverage masks, kept for the last sizes used. Writing a string
+ * copies the pixel on the covered parts of its masks.
+ *
+ * A truetype font is opened once as an #ImelFont, that keeps the glyphs
+ * rendered by FreeType for the last codes and sizes used. The legacy
+ * functions taking a file name share the fonts opened for the last files.
  * 
  * @note To use a truetype font is used the FreeType library.
  */
  
-static ImelImage *imel_font_make_image                    (char c, ImelSize px, ImelPixel pixel);
-static void      _imel_font_write_char_from_bitmap_image  (ImelImage **image, FT_GlyphSlot glyph_slot, int *x,
-                                                           int y, int max_y, int pixel, ImelPixel pxl);
+ImelFont *imel_font_open           (const char *ttf_file);
+void      imel_font_close          (ImelFont *font);
+bool      imel_font_select_charmap (ImelFont *font, FT_Encoding encoding);
 
 #ifndef DOXYGEN_IGNORE_DOC
 
-extern ImelImage *imel_image_new (ImelSize width, ImelSize height);
 extern ImelPixel imel_pixel_new (ImelColor red, ImelColor green, ImelColor blue, long int level);
-extern ImelImage *imel_image_resize (ImelImage *image, ImelSize width, ImelSize height);
-extern void imel_image_insert_image (ImelImage *dest, ImelImage *src, ImelSize sx, ImelSize sy);
-extern ImelPixel imel_pixel_union (ImelPixel a, ImelPixel b, unsigned char _opacity);
-extern void imel_image_free (ImelImage *image);
-extern void imel_pixel_copy (ImelPixel *, ImelPixel);
-extern void imel_draw_point (ImelImage *, ImelSize, ImelSize, ImelPixel);
+extern void __imel_draw_pixels (ImelPixel *p, long length, ImelPixel pixel);
+extern void __imel_draw_cover_span (ImelImage *image, long x, long y, const unsigned char *coverage, long length,
+                                    ImelPixel pixel);
+
+/* Glyphs of the internal font, each one 7 x 14 */
+#define __IMEL_FONT_GLYPHS 95
+#define __IMEL_FONT_WIDTH 7
+#define __IMEL_FONT_HEIGHT 14
+
+/* Glyph used for the characters not in the font */
+#define __IMEL_FONT_UNKNOWN 0x20
+
+/* Sizes kept in the cache of atlases */
+#define __IMEL_FONT_ATLAS_MAX 8
+
+/* Glyphs kept by a truetype font, if not changed */
+#define __IMEL_FONT_CACHE_SIZE 512
+
+/* Fonts kept open for the functions taking a file name */
+#define __IMEL_FONT_FILES_MAX 4
+
+/* The glyphs scaled to @px x 2 @px. Each glyph has a mask @px wide for
+ * each row of the font, 255 where it's covered else 0, and the rows of
+ * the scaled glyph take the mask of the row in @row. */
+typedef struct ___imel_font_atlas {
+               ImelSize px;
+               unsigned char *mask;
+               ImelSize *row;
+               ImelSize users;     /* Strings being written with the atlas */
+               bool cached;        /* FALSE once dropped from the cache */
+               struct ___imel_font_atlas *next;
+        } __ImelFontAtlas;
+
+/* Atlases from the last used, the list and the counts of users are
+ * changed only with the lock held */
+static __ImelFontAtlas *atlas_cache = NULL;
+static pthread_mutex_t atlas_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void __imel_font_atlas_free (__ImelFontAtlas *atlas)
+{
+ free (atlas->mask);
+ free (atlas->row);
+ free (atlas);
+}
+
+/* Scale the glyphs to @px with the nearest pixel, as imel_image_resize ()
+ * does */
+static __ImelFontAtlas *__imel_font_atlas_new (ImelSize px)
+{
+ __ImelFontAtlas *atlas;
+ ImelSize g, r, w;
+ unsigned char *mask;
+
+ atlas = (__ImelFontAtlas *) malloc (sizeof (__ImelFontAtlas));
+ return_var_if_fail (atlas, NULL);
+
+ atlas->px = px;
+ atlas->users = 0;
+ atlas->cached = true;
+ atlas->next = NULL;
+ atlas->mask = (unsigned char *) malloc ((size_t) __IMEL_FONT_GLYPHS * __IMEL_FONT_HEIGHT * px);
+ atlas->row = (ImelSize *) malloc (sizeof (ImelSize) * 2 * (size_t) px);
+ if ( ! atlas->mask || ! atlas->row ) {
+      __imel_font_atlas_free (atlas);
+      return NULL;
+ }
+
+ for ( r = 0; r < 2 * px; r++ )
+       atlas->row[r] = (ImelSize) (((uint64_t) __IMEL_FONT_HEIGHT * r) / (2 * (uint64_t) px));
+
+ for ( g = 0, mask = atlas->mask; g < __IMEL_FONT_GLYPHS; g++ )
+       for ( r = 0; r < __IMEL_FONT_HEIGHT; r++, mask += px )
+             for ( w = 0; w < px; w++ )
+                   mask[w] = imel_font[g][r][((uint64_t) __IMEL_FONT_WIDTH * w) / px] ? 255 : 0;
+
+ return atlas;
+}
+
+/* Take the atlas of @px from the cache, making it if needed. The atlas
+ * can't be freed until __imel_font_atlas_release (). */
+static __ImelFontAtlas *__imel_font_atlas_acquire (ImelSize px)
+{
+ __ImelFontAtlas *atlas, **link, *old;
+ ImelSize n;
+
+ pthread_mutex_lock (&atlas_lock);
+
+ for ( link = &atlas_cache; *link && (*link)->px != px; link = &((*link)->next) );
+
+ if ( (atlas = *link) )
+      *link = atlas->next;
+ else if ( ! (atlas = __imel_font_atlas_new (px)) ) {
+      pthread_mutex_unlock (&atlas_lock);
+      return NULL;
+ }
+
+ atlas->next = atlas_cache;
+ atlas_cache = atlas;
+ atlas->users++;
+
+ /* Drop the least used sizes, they're freed by their last user */
+ for ( n = 1, link = &(atlas->next); *link; n++ ) {
+       if ( n < __IMEL_FONT_ATLAS_MAX ) {
+            link = &((*link)->next);
+            continue;
+       }
+
+       old = *link;
+       *link = old->next;
+       old->cached = false;
+       if ( ! old->users )
+            __imel_font_atlas_free (old);
+ }
+
+ pthread_mutex_unlock (&atlas_lock);
+
+ return atlas;
+}
+
+static void __imel_font_atlas_release (__ImelFontAtlas *atlas)
+{
+ pthread_mutex_lock (&atlas_lock);
+
+ if ( ! --atlas->users && ! atlas->cached )
+      __imel_font_atlas_free (atlas);
+
+ pthread_mutex_unlock (&atlas_lock);
+}
+
+/* Copy @pixel on the covered part of the glyph of @c with its top left
+ * corner at (@x, @y), clipped to @image */
+static void __imel_font_atlas_draw (const __ImelFontAtlas *atlas, ImelImage *image, long x, long y,
+                                    char c, ImelPixel pixel)
+{
+ long px = atlas->px, w0, w1, h0, h1, h, w, start;
+ unsigned char u = (unsigned char) c;
+ const unsigned char *mask;
+ ImelSize g;
+
+ g = ( u >= 0x20 && u < 0x20 + __IMEL_FONT_GLYPHS ) ? u - 0x20 : __IMEL_FONT_UNKNOWN;
+
+ w0 = ( x < 0 ) ? -x : 0;
+ w1 = ( x + px > (long) image->width ) ? (long) image->width - x : px;
+ h0 = ( y < 0 ) ? -y : 0;
+ h1 = ( y + 2 * px > (long) image->height ) ? (long) image->height - y : 2 * px;
+ if ( w0 >= w1 || h0 >= h1 )
+      return;
+
+ for ( h = h0; h < h1; h++ ) {
+       mask = atlas->mask + ((size_t) g * __IMEL_FONT_HEIGHT + atlas->row[h]) * px;
+
+       for ( w = w0; w < w1; ) {
+             if ( ! mask[w] ) {
+                  w++;
+                  continue;
+             }
+
+             for ( start = w; w < w1 && mask[w]; w++ );
+             __imel_draw_pixels (image->pixel[y + h] + x + start, w - start, pixel);
+       }
+ }
+}
+
+/* A glyph of a truetype font rendered at a size with a render mode,
+ * @coverage has @rows rows of @width bytes */
+typedef struct ___imel_font_glyph {
+               FT_ULong code;
+               ImelSize px;
+               FT_Render_Mode mode;
+               FT_UInt index;      /* Index in the face, for the kerning */
+               bool loaded;        /* FALSE if FreeType can't load it */
+               int left;
+               int top;
+               long advance;
+               ImelSize width;
+               ImelSize rows;
+               unsigned char *coverage;
+               struct ___imel_font_glyph *next;  /* In the same bucket */
+               struct ___imel_font_glyph *newer;
+               struct ___imel_font_glyph *older;
+        } __ImelFontGlyph;
+
+/* The glyphs are found by a hash table of (code, size, render mode) and
+ * dropped from the least recently used. The face and the cache are used only with the
+ * lock held. */
+struct _imel_font {
+               FT_Library library;
+               FT_Face face;
+               ImelSize px;        /* Size set in the face, 0 if none */
+               pthread_mutex_t lock;
+               __ImelFontGlyph **bucket;
+               ImelSize n_buckets;
+               ImelSize n_glyphs;
+               ImelSize max_glyphs;
+               __ImelFontGlyph *newest;
+               __ImelFontGlyph *oldest;
+        };
+
+/* A font of the cache for the functions taking a file name */
+typedef struct ___imel_font_file {
+               char *name;
+               ImelFont *font;
+               ImelSize users;
+               bool cached;
+               struct ___imel_font_file *next;
+        } __ImelFontFile;
+
+static __ImelFontFile *file_cache = NULL;
+static pthread_mutex_t file_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ImelSize __imel_font_hash (FT_ULong code, ImelSize px, FT_Render_Mode mode, ImelSize n_buckets)
+{
+ return (ImelSize) ((code * 2654435761u) ^ ((px * 8 + mode) * 40503u)) & (n_buckets - 1);
+}
+
+static void __imel_font_unlink (ImelFont *font, __ImelFontGlyph *glyph)
+{
+ if ( glyph->newer )
+      glyph->newer->older = glyph->older;
+ else font->newest = glyph->older;
+
+ if ( glyph->older )
+      glyph->older->newer = glyph->newer;
+ else font->oldest = glyph->newer;
+}
+
+static void __imel_font_push (ImelFont *font, __ImelFontGlyph *glyph)
+{
+ glyph->newer = NULL;
+ glyph->older = font->newest;
+ if ( font->newest )
+      font->newest->newer = glyph;
+ else font->oldest = glyph;
+ font->newest = glyph;
+}
+
+/* Remove the least recently used glyph */
+static void __imel_font_drop (ImelFont *font)
+{
+ __ImelFontGlyph *glyph = font->oldest, **link;
+
+ link = &(font->bucket[__imel_font_hash (glyph->code, glyph->px, glyph->mode, font->n_buckets)]);
+ for ( ; *link != glyph; link = &((*link)->next) );
+ *link = glyph->next;
+
+ __imel_font_unlink (font, glyph);
+ free (glyph->coverage);
+ free (glyph);
+ font->n_glyphs--;
+}
+
+/* Row @h of @bitmap, from the top */
+static const unsigned char *__imel_font_bitmap_row (const FT_Bitmap *bitmap, ImelSize h)
+{
+ return bitmap->buffer + (( bitmap->pitch < 0 ) ? (long) (bitmap->rows - 1 - h) * -bitmap->pitch :
+                                                 (long) h * bitmap->pitch);
+}
+
+/* Copy the bitmap of the glyph slot of @font into @glyph, one byte for
+ * each pixel. The three subpixels of the LCD modes are averaged. */
+static bool __imel_font_copy_bitmap (ImelFont *font, __ImelFontGlyph *glyph)
+{
+ FT_Bitmap *bitmap = &(font->face->glyph->bitmap);
+ const unsigned char *row;
+ unsigned char *coverage;
+ ImelSize w, h;
+
+ glyph->width = ( bitmap->pixel_mode == FT_PIXEL_MODE_LCD ) ? bitmap->width / 3 : bitmap->width;
+ glyph->rows = ( bitmap->pixel_mode == FT_PIXEL_MODE_LCD_V ) ? bitmap->rows / 3 : bitmap->rows;
+ glyph->coverage = NULL;
+ if ( ! glyph->width || ! glyph->rows )
+      return true;
+
+ glyph->coverage = (unsigned char *) malloc ((size_t) glyph->width * glyph->rows);
+ return_var_if_fail (glyph->coverage, false);
+
+ for ( h = 0; h < glyph->rows; h++ ) {
+       coverage = glyph->coverage + (size_t) h * glyph->width;
+
+       if ( bitmap->pixel_mode == FT_PIXEL_MODE_LCD_V ) {
+            for ( w = 0; w < glyph->width; w++ )
+                  coverage[w] = (__imel_font_bitmap_row (bitmap, 3 * h)[w] +
+                                 __imel_font_bitmap_row (bitmap, 3 * h + 1)[w] +
+                                 __imel_font_bitmap_row (bitmap, 3 * h + 2)[w]) / 3;
+            continue;
+       }
+
+       row = __imel_font_bitmap_row (bitmap, h);
+       for ( w = 0; w < glyph->width; w++ ) {
+             if ( bitmap->pixel_mode == FT_PIXEL_MODE_MONO )
+                  coverage[w] = ( row[w >> 3] & (0x80 >> (w & 7)) ) ? 255 : 0;
+             else if ( bitmap->pixel_mode == FT_PIXEL_MODE_GRAY )
+                  coverage[w] = row[w];
+             else if ( bitmap->pixel_mode == FT_PIXEL_MODE_LCD )
+                  coverage[w] = (row[3 * w] + row[3 * w + 1] + row[3 * w + 2]) / 3;
+             else coverage[w] = 0;
+       }
+ }
+
+ return true;
+}
+
+/* The glyph of @code at the size set in @font, rendered with @mode if it
+ * isn't in the cache. Valid until the next call. */
+static __ImelFontGlyph *__imel_font_glyph (ImelFont *font, FT_ULong code, FT_Render_Mode mode)
+{
+ __ImelFontGlyph *glyph, **bucket;
+
+ bucket = &(font->bucket[__imel_font_hash (code, font->px, mode, font->n_buckets)]);
+ for ( glyph = *bucket; glyph; glyph = glyph->next ) {
+       if ( glyph->code == code && glyph->px == font->px && glyph->mode == mode ) {
+            __imel_font_unlink (font, glyph);
+            __imel_font_push (font, glyph);
+            return glyph;
+       }
+ }
+
+ glyph = (__ImelFontGlyph *) malloc (sizeof (__ImelFontGlyph));
+ return_var_if_fail (glyph, NULL);
+
+ glyph->code = code;
+ glyph->px = font->px;
+ glyph->mode = mode;
+ glyph->index = FT_Get_Char_Index (font->face, code);
+ glyph->loaded = ! FT_Load_Glyph (font->face, glyph->index, FT_LOAD_TARGET_ (mode)) &&
+                 ! FT_Render_Glyph (font->face->glyph, mode);
+ glyph->left = glyph->loaded ? font->face->glyph->bitmap_left : 0;
+ glyph->top = glyph->loaded ? font->face->glyph->bitmap_top : 0;
+ glyph->advance = glyph->loaded ? font->face->glyph->metrics.horiAdvance >> 6 : 0;
+ glyph->width = glyph->rows = 0;
+ glyph->coverage = NULL;
+
+ if ( glyph->loaded && ! __imel_font_copy_bitmap (font, glyph) ) {
+      free (glyph);
+      return NULL;
+ }
+
+ if ( font->n_glyphs == font->max_glyphs )
+      __imel_font_drop (font);
+
+ glyph->next = *bucket;
+ *bucket = glyph;
+ __imel_font_push (font, glyph);
+ font->n_glyphs++;
+
+ return glyph;
+}
+
+/* Next code of the UTF-8 @string, a byte that doesn't start a valid
+ * sequence is a code by itself */
+static FT_ULong __imel_font_next_code (const char **string)
+{
+ const unsigned char *s = (const unsigned char *) *string;
+ FT_ULong code;
+ int n, i;
+
+ n = ( s[0] >= 0xf0 && s[0] < 0xf8 ) ? 3 : ( s[0] >= 0xe0 ) ? 2 : ( s[0] >= 0xc2 && s[0] < 0xe0 ) ? 1 : 0;
+ n = ( s[0] >= 0xf8 ) ? 0 : n;
+ code = ( n ) ? s[0] & (0x3f >> n) : s[0];
+
+ for ( i = 1; i <= n; i++ ) {
+       if ( (s[i] & 0xc0) != 0x80 ) {
+            (*string)++;
+            return s[0];
+       }
+       code = (code << 6) | (s[i] & 0x3f);
+ }
+
+ *string += n + 1;
+
+ return code;
+}
+
+/* Write @string with @font from (@x, @y), the top of the tallest glyph,
+ * with the glyphs rendered by @mode. Across the image each glyph goes
+ * after the previous one and a line feed starts a new line, else each
+ * character starts a new line. */
+static bool __imel_font_write (ImelFont *font, ImelImage *image, long x, long y, const char *string,
+                               ImelSize px, ImelPixel pixel, FT_Render_Mode mode, bool vertical)
+{
+ __ImelFontGlyph *glyph;
+ const char *s;
+ FT_ULong code;
+ FT_Vector kerning;
+ FT_UInt previous = 0;
+ long pen = x, line = y, top = 0, i;
+ ImelSize h;
+ bool kern;
+
+ pthread_mutex_lock (&(font->lock));
+
+ if ( font->px != px ) {
+      if ( FT_Set_Pixel_Sizes (font->face, 0, px) ) {
+           pthread_mutex_unlock (&(font->lock));
+           return false;
+      }
+      font->px = px;
+ }
+
+ for ( s = string; *s; )
+       if ( (code = __imel_font_next_code (&s)) != '\n' && (glyph = __imel_font_glyph (font, code, mode)) &&
+            glyph->loaded && glyph->top > top )
+            top = glyph->top;
+
+ kern = ! vertical && FT_HAS_KERNING (font->face);
+ for ( s = string, i = 0; *s; i++ ) {
+       code = __imel_font_next_code (&s);
+       if ( vertical ) {
+            pen = x;
+            line = y + i * (long) px;
+       }
+       else if ( code == '\n' ) {
+            line += px;
+            pen = x;
+            previous = 0;
+       }
+
+       if ( code == '\n' )
+            continue;
+
+       if ( ! (glyph = __imel_font_glyph (font, code, mode)) || ! glyph->loaded )
+            continue;
+
+       if ( kern && previous && glyph->index && ! FT_Get_Kerning (font->face, previous, glyph->index,
+                                                                   FT_KERNING_DEFAULT, &kerning) )
+            pen += kerning.x >> 6;
+
+       for ( h = 0; h < glyph->rows; h++ )
+             __imel_draw_cover_span (image, pen + glyph->left, line + (top - glyph->top) + h,
+                                     glyph->coverage + (size_t) h * glyph->width, glyph->width, pixel);
+
+       pen += glyph->advance;
+       previous = glyph->index;
+ }
+
+ pthread_mutex_unlock (&(font->lock));
+ image->generation++;
+
+ return true;
+}
+
+/* Take the font of the file @name from the cache, opening it if needed.
+ * The font can't be closed until __imel_font_file_release (). */
+static __ImelFontFile *__imel_font_file_acquire (const char *name)
+{
+ __ImelFontFile *file, **link, *old;
+ ImelSize n;
+
+ pthread_mutex_lock (&file_lock);
+
+ for ( link = &file_cache; *link && strcmp ((*link)->name, name); link = &((*link)->next) );
+
+ if ( (file = *link) )
+      *link = file->next;
+ else {
+      file = (__ImelFontFile *) malloc (sizeof (__ImelFontFile));
+      if ( file && (file->name = (char *) malloc (strlen (name) + 1)) && (file->font = imel_font_open (name)) ) {
+           strcpy (file->name, name);
+           file->users = 0;
+           file->cached = true;
+      }
+      else {
+           if ( file )
+                free (file->name);
+           free (file);
+           pthread_mutex_unlock (&file_lock);
+           return NULL;
+      }
+ }
+
+ file->next = file_cache;
+ file_cache = file;
+ file->users++;
+
+ /* Drop the least used files, they're closed by their last user */
+ for ( n = 1, link = &(file->next); *link; n++ ) {
+       if ( n < __IMEL_FONT_FILES_MAX ) {
+            link = &((*link)->next);
+            continue;
+       }
+
+       old = *link;
+       *link = old->next;
+       old->cached = false;
+       if ( ! old->users ) {
+            imel_font_close (old->font);
+            free (old->name);
+            free (old);
+       }
+ }
+
+ pthread_mutex_unlock (&file_lock);
+
+ return file;
+}
+
+static void __imel_font_file_release (__ImelFontFile *file)
+{
+ pthread_mutex_lock (&file_lock);
+
+ if ( ! --file->users && ! file->cached ) {
+      imel_font_close (file->font);
+      free (file->name);
+      free (file);
+ }
+
+ pthread_mutex_unlock (&file_lock);
+}
+
+/* Write @string with the font of the file @name for @function. The
+ * optional arguments in @arg_list are pairs of a name and a value, ended
+ * by NULL: "render-type" with an FT_Render_Mode and "charmap" with an
+ * FT_Encoding. With a charmap the font is opened only for this call. */
+static bool __imel_font_write_file (const char *function, ImelImage *image, const char *name, long x, long y,
+                                    const char *string, ImelSize px, ImelPixel pixel, bool vertical,
+                                    va_list arg_list)
+{
+ __ImelFontFile *file = NULL;
+ ImelFont *font = NULL;
+ FT_Render_Mode mode = FT_RENDER_MODE_NORMAL;
+ FT_Encoding encoding = FT_ENCODING_NONE;
+ char *argument;
+ bool done;
+
+ for ( argument = va_arg (arg_list, char *); argument; argument = va_arg (arg_list, char *) ) {
+       if ( ! strcmp (argument, "render-type") )
+            mode = va_arg (arg_list, FT_Render_Mode);
+       else if ( ! strcmp (argument, "charmap") )
+            encoding = va_arg (arg_list, FT_Encoding);
+       else {
+            imel_printf_debug (function, NULL, "warning", "unknown argument");
+            break;
+       }
+ }
+
+ return_var_if_fail (mode < FT_RENDER_MODE_MAX, false);
+
+ if ( encoding != FT_ENCODING_NONE ) {
+      if ( ! (font = imel_font_open (name)) )
+           return false;
+      imel_font_select_charmap (font, encoding);
+ }
+ else if ( (file = __imel_font_file_acquire (name)) )
+      font = file->font;
+ else return false;
+
+ done = __imel_font_write (font, image, x, y, string, px, pixel, mode, vertical);
+
+ if ( file )
+      __imel_font_file_release (file);
+ else imel_font_close (font);
+
+ return done;
+}
 
 #endif
 
@@ -69,22 +626,26 @@ extern void imel_draw_point (ImelImage *, ImelSize, ImelSize, ImelPixel);
 void imel_font_write_string (ImelImage *image, ImelSize x, ImelSize y,
                              const char *string, ImelSize px, ImelPixel pixel)
 {
- int i, len, j;
- ImelImage *c;
+ __ImelFontAtlas *atlas;
+ long line = y, j;
 
  return_if_fail (string && image);
 
- for ( i = j = 0, len = strlen (string); i < len; i++, j++ ) {
-       if ( string[i] == '\n' ) {
-            y += px * 2;
+ if ( ! px || ! (atlas = __imel_font_atlas_acquire (px)) )
+      return;
+
+ for ( j = 0; *string; string++, j++ ) {
+       if ( *string == '\n' ) {
+            line += 2 * (long) px;
             j = -1;
             continue;
        }
-            
-       c = imel_font_make_image (string[i], px, pixel);
-       imel_image_insert_image (image, c, x + (j * px), y);
-       imel_image_free (c);
+
+       __imel_font_atlas_draw (atlas, image, x + j * (long) px, line, *string, pixel);
  }
+
+ __imel_font_atlas_release (atlas);
+ image->generation++;
 }
 
 /**
@@ -104,44 +665,220 @@ void imel_font_write_string (ImelImage *image, ImelSize x, ImelSize y,
 void imel_font_write_vstring (ImelImage *image, ImelSize x, ImelSize y,
                               const char *string, ImelSize px, ImelPixel pixel)
 {
- int i, len;
- ImelImage *c;
+ __ImelFontAtlas *atlas;
+ long i;
 
  return_if_fail (string && image);
 
- for ( i = 0, len = strlen (string); i < len; i++ ) {
-       if ( string[i] == '\n' )
-            continue; 
-            
-       c = imel_font_make_image (string[i], px, pixel);
-       imel_image_insert_image (image, c, x, y + (i * (px * 2)));
-       imel_image_free (c);
- }  
+ if ( ! px || ! (atlas = __imel_font_atlas_acquire (px)) )
+      return;
+
+ for ( i = 0; string[i]; i++ )
+       if ( string[i] != '\n' )
+            __imel_font_atlas_draw (atlas, image, x, y + i * 2 * (long) px, string[i], pixel);
+
+ __imel_font_atlas_release (atlas);
+ image->generation++;
 }
 
-static ImelImage *imel_font_make_image (char c, ImelSize px, ImelPixel pixel)
+/**
+ * @brief Open a truetype font
+ * 
+ * This function opens the font in @p ttf_file with FreeType once, so it
+ * can write many strings. The glyphs are rendered the first time they're
+ * written at a size and kept for the last 512 codes and sizes used.
+ * 
+ * @code
+ * ImelFont *font = imel_font_open ("DejaVuSans.ttf");
+ * 
+ * imel_font_write_text (font, image, 10, 10, "Hello, world", 16, pixel);
+ * imel_font_close (font);
+ * @endcode
+ * 
+ * @param ttf_file TrueType font file name
+ * @return A new font or NULL on error.
+ * @see imel_font_close
+ * @see imel_font_write_text
+ */
+ImelFont *imel_font_open (const char *ttf_file)
 {
- ImelImage *im, *r;
- int x, y, j;
- 
- im = imel_image_new (7, 14);
- j = (c < 127) ? c - 0x20 : 0x20;
- for ( y = 0; y < 14; y++ ) 
-       for ( x = 0; x < 7; x++ )
-             if ( imel_font[j][y][x] ) 
-                  imel_draw_point (im, x, y, pixel);
-
- r = imel_image_resize (im, px, px * 2);
- imel_image_free (im);
- 
- return r;
+ ImelFont *font;
+
+ return_var_if_fail (ttf_file, NULL);
+
+ font = (ImelFont *) malloc (sizeof (ImelFont));
+ return_var_if_fail (font, NULL);
+
+ font->n_buckets = __IMEL_FONT_CACHE_SIZE;
+ font->bucket = (__ImelFontGlyph **) calloc (font->n_buckets, sizeof (__ImelFontGlyph *));
+ if ( ! font->bucket || FT_Init_FreeType (&(font->library)) ) {
+      free (font->bucket);
+      free (font);
+      return NULL;
+ }
+
+ if ( FT_New_Face (font->library, ttf_file, 0, &(font->face)) ) {
+      FT_Done_FreeType (font->library);
+      free (font->bucket);
+      free (font);
+      return NULL;
+ }
+
+ pthread_mutex_init (&(font->lock), NULL);
+ font->px = 0;
+ font->n_glyphs = 0;
+ font->max_glyphs = __IMEL_FONT_CACHE_SIZE;
+ font->newest = font->oldest = NULL;
+
+ return font;
+}
+
+/**
+ * @brief Close a truetype font
+ * 
+ * @param font Font to close
+ * @see imel_font_open
+ */
+void imel_font_close (ImelFont *font)
+{
+ return_if_fail (font);
+
+ while ( font->n_glyphs )
+         __imel_font_drop (font);
+
+ FT_Done_Face (font->face);
+ FT_Done_FreeType (font->library);
+ pthread_mutex_destroy (&(font->lock));
+ free (font->bucket);
+ free (font);
+}
+
+/**
+ * @brief Set how many glyphs a truetype font keeps
+ * 
+ * The glyphs written last are kept up to @p n_glyphs, each code at each
+ * size is a glyph. The glyphs already rendered are dropped.
+ * 
+ * @param font Font to change
+ * @param n_glyphs Most glyphs kept, at least 1
+ * @return TRUE on success, FALSE on error.
+ * @see imel_font_open
+ */
+bool imel_font_set_cache_size (ImelFont *font, ImelSize n_glyphs)
+{
+ __ImelFontGlyph **bucket;
+ ImelSize n = 1;
+
+ return_var_if_fail (font && n_glyphs, false);
+
+ while ( n < n_glyphs && n < (1u << 30) )
+         n <<= 1;
+
+ bucket = (__ImelFontGlyph **) calloc (n, sizeof (__ImelFontGlyph *));
+ return_var_if_fail (bucket, false);
+
+ pthread_mutex_lock (&(font->lock));
+
+ while ( font->n_glyphs )
+         __imel_font_drop (font);
+
+ free (font->bucket);
+ font->bucket = bucket;
+ font->n_buckets = n;
+ font->max_glyphs = n_glyphs;
+
+ pthread_mutex_unlock (&(font->lock));
+
+ return true;
+}
+
+/**
+ * @brief Choose the charmap of a truetype font
+ * 
+ * The codes of the strings written with @p font are looked up in the
+ * charmap of @p encoding. The glyphs already rendered are dropped.
+ * 
+ * @param font Font to change
+ * @param encoding Encoding of the charmap
+ * @return TRUE on success, FALSE if @p font hasn't that charmap.
+ * @see http://www.freetype.org/freetype2/docs/reference/ft2-base_interface.html#FT_Encoding
+ */
+bool imel_font_select_charmap (ImelFont *font, FT_Encoding encoding)
+{
+ bool done;
+
+ return_var_if_fail (font, false);
+
+ pthread_mutex_lock (&(font->lock));
+
+ if ( (done = ! FT_Select_Charmap (font->face, encoding)) )
+      while ( font->n_glyphs )
+              __imel_font_drop (font);
+
+ pthread_mutex_unlock (&(font->lock));
+
+ return done;
+}
+
+/**
+ * @brief Write a string with a truetype font
+ * 
+ * This function writes the UTF-8 @p string in @p image with @p font at
+ * @p px pixels. The top of the tallest glyph of the string is at
+ * coordinate \f$(x,y)\f$, each glyph goes after the previous one, moved
+ * by the kerning of the font, and a line feed starts a new line @p px
+ * pixels below. The glyphs are blended with @p pixel by their coverage,
+ * a row at a time.
+ * 
+ * @param font Font to use
+ * @param image Image where write the @p string
+ * @param x Start x coordinate
+ * @param y Start y coordinate
+ * @param string String to write in @p image
+ * @param px Font size
+ * @param pixel Color and level of the string
+ * @return TRUE on success, FALSE if the size isn't valid for @p font.
+ * @see imel_font_open
+ * @see imel_font_write_vtext
+ */
+bool imel_font_write_text (ImelFont *font, ImelImage *image, ImelSize x, ImelSize y, const char *string,
+                           ImelSize px, ImelPixel pixel)
+{
+ return_var_if_fail (font && image && string && px, false);
+
+ return __imel_font_write (font, image, x, y, string, px, pixel, FT_RENDER_MODE_NORMAL, false);
+}
+
+/**
+ * @brief Write a string in vertical orientation with a truetype font
+ * 
+ * As #imel_font_write_text, but each character starts a new line @p px
+ * pixels below the previous one.
+ * 
+ * @param font Font to use
+ * @param image Image where write the @p string
+ * @param x Start x coordinate
+ * @param y Start y coordinate
+ * @param string String to write in @p image
+ * @param px Font size
+ * @param pixel Color and level of the string
+ * @return TRUE on success, FALSE if the size isn't valid for @p font.
+ * @see imel_font_write_text
+ */
+bool imel_font_write_vtext (ImelFont *font, ImelImage *image, ImelSize x, ImelSize y, const char *string,
+                            ImelSize px, ImelPixel pixel)
+{
+ return_var_if_fail (font && image && string && px, false);
+
+ return __imel_font_write (font, image, x, y, string, px, pixel, FT_RENDER_MODE_NORMAL, true);
 }
 
 /**
  * @brief Write a string with a truetype font
  * 
  * This function write the @p string in @p image from coordinate \f$(\_x,\_y)\f$
- * with a size of @p px.
+ * with a size of @p px, as #imel_font_write_text does. The fonts of the
+ * last files used are kept open.
  * 
  * @param image Image, where write the @p string, passed by address
  * @param ttf_file TrueType font file name
@@ -150,93 +887,37 @@ static ImelImage *imel_font_make_image (char c, ImelSize px, ImelPixel pixel)
  * @param string String to write in @p image
  * @param px Font size
  * @param pixel Color and level of the string
- * @param ... Additional parameters are characterized by a string and a value. 
+ * @param ... Additional parameters are characterized by a string and a value,
+ * ended by NULL. 
  * @note The string for last parameter are "render-type" and "charmap" for the
- * possibily value check the link below.
+ * possibily value check the link below. With "charmap" the font is opened
+ * only for this call.
+ * @see imel_font_open
  * @see http://www.freetype.org/freetype2/docs/reference/ft2-base_interface.html#FT_Render_Mode
  * @see http://www.freetype.org/freetype2/docs/reference/ft2-base_interface.html#FT_Encoding
  */
 bool imel_font_write_string_with_truetype_font (ImelImage **image, char *ttf_file, ImelSize _x, ImelSize y,
                                                 char *string, ImelSize px, ImelPixel pixel, ...)
 {
- FT_Library library;
- FT_Face face;
- int len, i = 0, x = _x, max_y = 0, index, j;
- char *argument;
- const char *opt_argument_list[] = { "render-type", 
-                                     "charmap", NULL };
  va_list arg_list;
- 
- return_var_if_fail (image && ttf_file && string, false);
-
- FT_Init_FreeType (&library);
- if ( FT_New_Face (library, ttf_file, 0, &face) )
-      return false;
-
- FT_Set_Pixel_Sizes (face, 0, px);
- /*
- for ( va_start (arg_list, pixel), argument = va_arg (arg_list, char *);
-       argument; argument = va_arg (arg_list, char *) ) {
-       for ( index = 0, i = -1; opt_argument_list[index]; index++ ) {
-             if ( !strcmp (opt_argument_list[index], argument) ) {
-             	  i = 0;
-             	  break;
-			 }
-	   }
-	   
-	   if ( i )
-	        break;
-	   
-	   switch (index) {
-	   	 case 0: 
-	   	   FT_Render_Glyph (face->glyph, va_arg (arg_list, FT_Render_Mode));
-	   	   break;
-	   	 case 1:
-	   	   FT_Select_Charmap (face, va_arg (arg_list, FT_Encoding));
-	   	   break;
-	   	 default:
-           imel_printf_debug ("imel_font_write_string_with_truetype_font", NULL, "warning",
-                              "unknown argument");
-           index = -1;
-           break;
-	   }
-	   
-	   if ( index == -1 )
-	        break;
- }
- va_end (arg_list);
- */
- for ( len = strlen (string); i < len; i++ ) {
-       if ( FT_Load_Char (face, string[i], FT_LOAD_RENDER) )
-            continue;
+ bool done;
 
-       if ( max_y < face->glyph->bitmap_top )
-            max_y = face->glyph->bitmap_top;
- }
-
- for ( i = 0, j = x; i < len; i++ ) {
-       if ( string[i] == '\n' ) {
-            y += px;
-            j = x;
-            continue;
-       }
-       
-       if ( FT_Load_Char (face, string[i], FT_LOAD_RENDER) )
-            continue;
-        
-       _imel_font_write_char_from_bitmap_image (image, face->glyph, &j, y, max_y, px, pixel);
- }
+ return_var_if_fail (image && *image && ttf_file && string && px, false);
 
- FT_Done_Face (face);
- FT_Done_FreeType (library);
+ va_start (arg_list, pixel);
+ done = __imel_font_write_file ("imel_font_write_string_with_truetype_font", *image, ttf_file, _x, y,
+                                string, px, pixel, false, arg_list);
+ va_end (arg_list);
 
- return true;
+ return done;
 }
+
 /**
  * @brief Write a string in vertical orientation with a truetype font
  * 
  * This function write the @p string in @p image from coordinate \f$(\_x,\_y)\f$
- * with a size of @p px.
+ * with a size of @p px, as #imel_font_write_vtext does. The fonts of the
+ * last files used are kept open.
  * 
  * @param image Image, where write the @p string, passed by address
  * @param ttf_file TrueType font file name
@@ -245,121 +926,26 @@ bool imel_font_write_string_with_truetype_font (ImelImage **image, char *ttf_fil
  * @param string String to write in @p image
  * @param px Font size
  * @param pixel Color and level of the string
- * @param ... Additional parameters are characterized by a string and a value. 
+ * @param ... Additional parameters are characterized by a string and a value,
+ * ended by NULL. 
  * @note The string for last parameter are "render-type" and "charmap" for the
- * possibily value check the link below.
+ * possibily value check the link below. With "charmap" the font is opened
+ * only for this call.
  * @see http://www.freetype.org/freetype2/docs/reference/ft2-base_interface.html#FT_Render_Mode
  * @see http://www.freetype.org/freetype2/docs/reference/ft2-base_interface.html#FT_Encoding
  */
 bool imel_font_write_vstring_with_truetype_font (ImelImage **image, char *ttf_file, ImelSize _x, ImelSize y,
                                                  char *string, ImelSize px, ImelPixel pixel, ...)
 {
- FT_Library library;
- FT_Face face;
- int len, i = 0, x = _x, max_y = 0, index, j;
- char *argument;
- const char *opt_argument_list[] = { "render-type", 
-                                     "charmap", NULL };
  va_list arg_list;
- 
- return_var_if_fail (image && ttf_file && string, false);
+ bool done;
 
- FT_Init_FreeType (&library);
- if ( FT_New_Face (library, ttf_file, 0, &face) )
-      return false;
+ return_var_if_fail (image && *image && ttf_file && string && px, false);
 
- FT_Set_Pixel_Sizes (face, 0, px);
- 
- for ( va_start (arg_list, pixel), argument = va_arg (arg_list, char *);
-       argument; argument = va_arg (arg_list, char *) ) {
-       for ( index = 0, i = -1; opt_argument_list[index]; index++ ) {
-             if ( !strcmp (opt_argument_list[index], argument) ) {
-             	  i = 0;
-             	  break;
-			 }
-	   }
-	   
-	   if ( i )
-	        break;
-	   
-	   switch (index) {
-	   	 case 0: 
-	   	   FT_Render_Glyph (face->glyph, va_arg (arg_list, FT_Render_Mode));
-	   	   break;
-	   	 case 1:
-	   	   FT_Select_Charmap (face, va_arg (arg_list, FT_Encoding));
-	   	   break;
-	   	 default:
-           imel_printf_debug ("imel_font_write_string_with_truetype_font", NULL, "warning",
-                              "unknown argument");
-           index = -1;
-           break;
-	   }
-	   
-	   if ( index == -1 )
-	        break;
- }
+ va_start (arg_list, pixel);
+ done = __imel_font_write_file ("imel_font_write_vstring_with_truetype_font", *image, ttf_file, _x, y,
+                                string, px, pixel, true, arg_list);
  va_end (arg_list);
- 
- for ( len = strlen (string); i < len; i++ ) {
-       if ( FT_Load_Char (face, string[i], FT_LOAD_RENDER) )
-            continue;
-
-       if ( max_y < face->glyph->bitmap_top )
-            max_y = face->glyph->bitmap_top;
- }
-
- for ( i = 0, j = x; i < len; i++, y += px, j = x ) {
-       if ( string[i] == '\n' )
-            continue;
-            
-       if ( FT_Load_Char (face, string[i], FT_LOAD_RENDER) )
-            continue;
-        
-       _imel_font_write_char_from_bitmap_image (image, face->glyph, &j, y, max_y, px, pixel);
- }
-
- FT_Done_Face (face);
- FT_Done_FreeType (library);
-
- return true;
-}
-
-static void _imel_font_write_char_from_bitmap_image (ImelImage **image, FT_GlyphSlot glyph_slot,
-                                                     int *x, int y, int max_y, int pixel, ImelPixel pxl)
-{
- int w, h, _color;
- ImelPixel *p, up;
- FT_Bitmap *bitmap;
- int ry, rx;
-
- return_if_fail (image && glyph_slot && x);
-
- bitmap = &(glyph_slot->bitmap);
- /* ? */
- pixel = 0;
-
- for ( w = 0 ; w < bitmap->width; w++ ) {
-       for ( h = 0; h < bitmap->rows; h++ ) {
-             ry = y + (max_y - glyph_slot->bitmap_top) + h;
-             rx = *x + w + glyph_slot->bitmap_left;
-             
-             if ( ry >= (*image)->height || rx >= (*image)->width )
-                  continue;
-                  
-             p = &((*image)->pixel[ry][rx]);
-             _color = bitmap->buffer[h * bitmap->width + w];
-             
-             if ( !_color )
-                  continue;
-                  
-             up = imel_pixel_union (*p, pxl, _color);
-             if ( p->level < pxl.level )
-                  up.level = -255 + _color;
-                  
-             imel_pixel_copy (p, up);
-       }
- }
 
- *x += glyph_slot->metrics.horiAdvance >> 6;
+ return done;
 }
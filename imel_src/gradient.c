@@ -0,0 +1,503 @@
+/*
+ * "gradient.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <math.h>
+#include "header.h"
+/**
+ * @file gradient.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to fill images with gradients.
+ *
+ * The colors of a gradient are computed once in a ramp with a few entries
+ * for each pixel of the offsets seen in the filled area, so long
+ * gradients don't show bands. Each pixel only needs its position in the gradient:
+ * along the rows of a linear gradient it's a fixed point value increased
+ * by the same step on each pixel, radial and conic gradients compute it
+ * from the distance and the angle from the center.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+extern void imel_pixel_copy (ImelPixel *dest, ImelPixel src);
+extern void __imel_thread_run (ImelSize n, ImelSize grain, ImelBandFuncPtr func, ImelGenericPtr data);
+
+/* Colors in the ramp of the offsets from 0 to 1, at least */
+#define __IMEL_GRADIENT_RAMP 1024
+
+/* Colors in the ramp for each pixel along the gradient */
+#define __IMEL_GRADIENT_DENSITY 4
+
+/* Most colors in a ramp, gradients longer than this in the filled area
+ * share an entry between near pixels */
+#define __IMEL_GRADIENT_RAMP_MAX (1L << 18)
+
+/* Bits of the fractional part of the fixed point positions */
+#define __IMEL_GRADIENT_SHIFT 16
+
+/* Rows with positions farther than this from the ramp use doubles, so the
+ * fixed point positions don't overflow */
+#define __IMEL_GRADIENT_FIXED_LIMIT 1e9
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+typedef struct ___imel_gradient_run {
+               const ImelGradient *gradient;
+               ImelImage *image;
+               long x0;       /* Area to fill, from (x0, y0) to (x1, y1) excluded */
+               long y0;
+               long x1;
+               long y1;
+               ImelPixel *ramp;
+               long n_ramp;
+               double t0;     /* The ramp goes from the offset t0 to t1 */
+               double t1;
+               double scale;  /* Entries of the ramp for each unit of offset */
+               bool opaque;   /* All the colors of the ramp have a level */
+        } __ImelGradientRun;
+
+/* Channel of the ramp at @u between @a and @b, rounded */
+static long __imel_gradient_mix (long a, long b, double u)
+{
+ return a + (long) floor ((b - a) * u + 0.5);
+}
+
+/* Colors of the gradient at the n_ramp offsets from t0 to t1 of @run.
+ * The level is interpolated like the colors: alpha levels fade and
+ * levels change step by step. */
+static void __imel_gradient_ramp (__ImelGradientRun *run)
+{
+ const ImelGradient *gradient = run->gradient;
+ const ImelGradientStop *a, *b;
+ ImelPixel *ramp = run->ramp;
+ ImelSize k = 0;
+ long i;
+ double t, u;
+
+ run->opaque = true;
+
+ for ( i = 0; i < run->n_ramp; i++ ) {
+       t = ( run->scale > 0 ) ? run->t0 + i / run->scale : run->t0;
+       while ( k < gradient->n_stops && gradient->stops[k].offset <= t )
+               k++;
+
+       if ( ! k || k == gradient->n_stops ) {
+            ramp[i] = gradient->stops[k ? k - 1 : 0].pixel;
+            run->opaque &= ramp[i].level >= 0;
+            continue;
+       }
+
+       a = &(gradient->stops[k - 1]);
+       b = &(gradient->stops[k]);
+       u = (t - a->offset) / (b->offset - a->offset);
+
+       ramp[i].red = __imel_gradient_mix (a->pixel.red, b->pixel.red, u);
+       ramp[i].green = __imel_gradient_mix (a->pixel.green, b->pixel.green, u);
+       ramp[i].blue = __imel_gradient_mix (a->pixel.blue, b->pixel.blue, u);
+       ramp[i].level = __imel_gradient_mix (a->pixel.level, b->pixel.level, u);
+       run->opaque &= ramp[i].level >= 0;
+ }
+}
+
+/* Index in the ramp of @run of the offset @t, the offsets out of the ramp
+ * take the color of the nearest end */
+static long __imel_gradient_index (const __ImelGradientRun *run, double t)
+{
+ t = (t - run->t0) * run->scale + 0.5;
+
+ return ( t < 0 ) ? 0 : ( t >= run->n_ramp - 1 ) ? run->n_ramp - 1 : (long) t;
+}
+
+/* Offset of the point (x, y) in a radial or conic gradient */
+static double __imel_gradient_offset (const ImelGradient *gradient, double x, double y)
+{
+ double dx = x - gradient->x1, dy = y - gradient->y1, t;
+
+ if ( gradient->type == IMEL_GRADIENT_RADIAL )
+      return sqrt (dx * dx + dy * dy) / gradient->radius;
+
+ t = (atan2 (dy, dx) - gradient->angle) / (2 * PI);
+
+ return t - floor (t);
+}
+
+/* Fill the rows [start, end) of the area */
+static void __imel_gradient_rows (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelGradientRun *run = (__ImelGradientRun *) data;
+ const ImelGradient *gradient = run->gradient;
+ ImelPixel *d, p;
+ double dx, dy, len2, t, step;
+ int64_t f, df, index;
+ long x, y, width = run->x1 - run->x0;
+
+ (void) band;
+
+ dx = gradient->x2 - gradient->x1;
+ dy = gradient->y2 - gradient->y1;
+ len2 = dx * dx + dy * dy;
+
+ for ( y = run->y0 + (long) start; y < run->y0 + (long) end; y++ ) {
+       d = run->image->pixel[y] + run->x0;
+
+       if ( gradient->type != IMEL_GRADIENT_LINEAR ) {
+            for ( x = run->x0; x < run->x1; x++, d++ ) {
+                  p = run->ramp[__imel_gradient_index (run, __imel_gradient_offset (gradient, x, y))];
+                  if ( run->opaque )
+                       *d = ( d->level > p.level ) ? *d : p;
+                  else imel_pixel_copy (d, p);
+            }
+            continue;
+       }
+
+       /* The offset along a row of a linear gradient grows by the same
+        * step on each pixel */
+       t = ((run->x0 - gradient->x1) * dx + (y - gradient->y1) * dy) / len2;
+       step = dx / len2;
+
+       if ( (fabs (t - run->t0) + fabs (step) * width) * run->scale > __IMEL_GRADIENT_FIXED_LIMIT ) {
+            for ( x = 0; x < width; x++, d++ ) {
+                  p = run->ramp[__imel_gradient_index (run, t + step * x)];
+                  if ( run->opaque )
+                       *d = ( d->level > p.level ) ? *d : p;
+                  else imel_pixel_copy (d, p);
+            }
+            continue;
+       }
+
+       f = (int64_t) floor (((t - run->t0) * run->scale + 0.5) * (1 << __IMEL_GRADIENT_SHIFT) + 0.5);
+       df = (int64_t) floor (step * run->scale * (1 << __IMEL_GRADIENT_SHIFT) + 0.5);
+
+       if ( run->opaque ) {
+            for ( x = 0; x < width; x++, d++, f += df ) {
+                  index = f >> __IMEL_GRADIENT_SHIFT;
+                  index = ( index < 0 ) ? 0 : ( index > run->n_ramp - 1 ) ? run->n_ramp - 1 : index;
+                  p = run->ramp[index];
+                  *d = ( d->level > p.level ) ? *d : p;
+            }
+       }
+       else {
+            for ( x = 0; x < width; x++, d++, f += df ) {
+                  index = f >> __IMEL_GRADIENT_SHIFT;
+                  index = ( index < 0 ) ? 0 : ( index > run->n_ramp - 1 ) ? run->n_ramp - 1 : index;
+                  imel_pixel_copy (d, run->ramp[index]);
+            }
+       }
+ }
+}
+
+static ImelGradient *__imel_gradient_new (ImelGradientType type, double x1, double y1)
+{
+ ImelGradient *gradient;
+
+ gradient = (ImelGradient *) malloc (sizeof (ImelGradient));
+ return_var_if_fail (gradient, NULL);
+
+ gradient->type = type;
+ gradient->x1 = gradient->x2 = x1;
+ gradient->y1 = gradient->y2 = y1;
+ gradient->radius = 0;
+ gradient->angle = 0;
+ gradient->n_stops = 0;
+ gradient->size = 0;
+ gradient->stops = NULL;
+
+ return gradient;
+}
+
+/* Offsets of the gradient of @run seen in its area, in [t0, t1] inside
+ * [0, 1], and entries of the ramp needed for __IMEL_GRADIENT_DENSITY on
+ * each pixel */
+static void __imel_gradient_range (__ImelGradientRun *run)
+{
+ const ImelGradient *gradient = run->gradient;
+ double dx, dy, len2, t, length, far, near, cx, cy;
+ long i;
+
+ /* The farthest corner of the area from the start point */
+ far = 0;
+ for ( i = 0; i < 4; i++ ) {
+       dx = ((i & 1) ? run->x1 - 1 : run->x0) - gradient->x1;
+       dy = ((i & 2) ? run->y1 - 1 : run->y0) - gradient->y1;
+       t = sqrt (dx * dx + dy * dy);
+       far = ( t > far ) ? t : far;
+ }
+
+ if ( gradient->type == IMEL_GRADIENT_LINEAR ) {
+      dx = gradient->x2 - gradient->x1;
+      dy = gradient->y2 - gradient->y1;
+      len2 = dx * dx + dy * dy;
+      length = sqrt (len2);
+
+      run->t0 = 1;
+      run->t1 = 0;
+      for ( i = 0; i < 4; i++ ) {
+            t = ((((i & 1) ? run->x1 - 1 : run->x0) - gradient->x1) * dx +
+                 (((i & 2) ? run->y1 - 1 : run->y0) - gradient->y1) * dy) / len2;
+            run->t0 = ( t < run->t0 ) ? t : run->t0;
+            run->t1 = ( t > run->t1 ) ? t : run->t1;
+      }
+ }
+ else if ( gradient->type == IMEL_GRADIENT_RADIAL ) {
+      cx = ( gradient->x1 < run->x0 ) ? run->x0 : ( gradient->x1 > run->x1 - 1 ) ? run->x1 - 1 : gradient->x1;
+      cy = ( gradient->y1 < run->y0 ) ? run->y0 : ( gradient->y1 > run->y1 - 1 ) ? run->y1 - 1 : gradient->y1;
+      near = sqrt ((cx - gradient->x1) * (cx - gradient->x1) + (cy - gradient->y1) * (cy - gradient->y1));
+      length = gradient->radius;
+
+      run->t0 = near / length;
+      run->t1 = far / length;
+ }
+ else {
+      length = 2 * PI * far;
+
+      run->t0 = 0;
+      run->t1 = 1;
+ }
+
+ run->t0 = ( run->t0 < 0 ) ? 0 : ( run->t0 > 1 ) ? 1 : run->t0;
+ run->t1 = ( run->t1 < run->t0 ) ? run->t0 : ( run->t1 > 1 ) ? 1 : run->t1;
+
+ length *= __IMEL_GRADIENT_DENSITY;
+ length = ( length < __IMEL_GRADIENT_RAMP - 1 ) ? __IMEL_GRADIENT_RAMP - 1 : length;
+
+ t = ceil ((run->t1 - run->t0) * length) + 2;
+ run->n_ramp = ( t > __IMEL_GRADIENT_RAMP_MAX ) ? __IMEL_GRADIENT_RAMP_MAX : (long) t;
+ run->scale = ( run->t1 > run->t0 ) ? (run->n_ramp - 1) / (run->t1 - run->t0) : 0;
+}
+
+/* Fill the area from (x0, y0) to (x1, y1) excluded of @image with
+ * @gradient, clipped to @image */
+void __imel_gradient_fill (ImelImage *image, const ImelGradient *gradient, long x0, long y0, long x1, long y1)
+{
+ __ImelGradientRun *run;
+
+ x0 = ( x0 < 0 ) ? 0 : x0;
+ y0 = ( y0 < 0 ) ? 0 : y0;
+ x1 = ( x1 > (long) image->width ) ? (long) image->width : x1;
+ y1 = ( y1 > (long) image->height ) ? (long) image->height : y1;
+
+ if ( ! gradient->n_stops || x0 >= x1 || y0 >= y1 )
+      return;
+
+ run = (__ImelGradientRun *) malloc (sizeof (__ImelGradientRun));
+ return_if_fail (run);
+
+ run->gradient = gradient;
+ run->image = image;
+ run->x0 = x0;
+ run->y0 = y0;
+ run->x1 = x1;
+ run->y1 = y1;
+ __imel_gradient_range (run);
+
+ run->ramp = (ImelPixel *) malloc (sizeof (ImelPixel) * run->n_ramp);
+ if ( ! run->ramp ) {
+      free (run);
+      return;
+ }
+
+ __imel_gradient_ramp (run);
+
+ __imel_thread_run (y1 - y0, 32, __imel_gradient_rows, run);
+ image->generation++;
+
+ free (run->ramp);
+ free (run);
+}
+
+#endif
+
+/**
+ * @brief Make a new linear gradient
+ *
+ * This function makes a gradient whose colors change along the line from
+ * \f$(x_1,y_1)\f$, the offset 0, to \f$(x_2,y_2)\f$, the offset 1. The
+ * lines perpendicular to it have the same color. The center of a pixel is
+ * at integer coordinates.
+ *
+ * @code
+ * ImelGradient *sky = imel_gradient_new_linear (0, 0, 0, image->height - 1);
+ *
+ * imel_gradient_add_stop (sky, 0, imel_pixel_new (0x1e, 0x3c, 0x8c, 0));
+ * imel_gradient_add_stop (sky, 0.7, imel_pixel_new (0x8c, 0xb4, 0xf0, 0));
+ * imel_gradient_add_stop (sky, 1, imel_pixel_new (0xf0, 0xc8, 0x8c, 0));
+ * imel_draw_gradient_fill (image, sky);
+ * imel_gradient_free (sky);
+ * @endcode
+ *
+ * @param x1 Start coordinate x
+ * @param y1 Start coordinate y
+ * @param x2 End coordinate x
+ * @param y2 End coordinate y
+ * @return A new gradient without colors, or NULL if the points are the
+ * same or not finite.
+ * @see imel_gradient_add_stop
+ * @see imel_draw_gradient_fill
+ */
+ImelGradient *imel_gradient_new_linear (double x1, double y1, double x2, double y2)
+{
+ ImelGradient *gradient;
+
+ return_var_if_fail (__IMEL_FINITE (x1) && __IMEL_FINITE (y1) && __IMEL_FINITE (x2) && __IMEL_FINITE (y2), NULL);
+ return_var_if_fail (x1 != x2 || y1 != y2, NULL);
+
+ gradient = __imel_gradient_new (IMEL_GRADIENT_LINEAR, x1, y1);
+ return_var_if_fail (gradient, NULL);
+
+ gradient->x2 = x2;
+ gradient->y2 = y2;
+
+ return gradient;
+}
+
+/**
+ * @brief Make a new radial gradient
+ *
+ * This function makes a gradient whose colors change with the distance
+ * from \f$(x,y)\f$: the offset 0 is the center and the offset 1 is at
+ * @p radius pixels from it.
+ *
+ * @param x Center coordinate x
+ * @param y Center coordinate y
+ * @param radius Distance of the offset 1 from the center
+ * @return A new gradient without colors, or NULL if a value isn't valid.
+ * @see imel_gradient_add_stop
+ * @see imel_draw_gradient_fill
+ */
+ImelGradient *imel_gradient_new_radial (double x, double y, double radius)
+{
+ ImelGradient *gradient;
+
+ return_var_if_fail (__IMEL_FINITE (x) && __IMEL_FINITE (y) && __IMEL_FINITE (radius) && radius > 0, NULL);
+
+ gradient = __imel_gradient_new (IMEL_GRADIENT_RADIAL, x, y);
+ return_var_if_fail (gradient, NULL);
+
+ gradient->radius = radius;
+
+ return gradient;
+}
+
+/**
+ * @brief Make a new conic gradient
+ *
+ * This function makes a gradient whose colors change with the angle
+ * around \f$(x,y)\f$: the offset 0 is at @p angle radians and the offsets
+ * grow clockwise ( the y axis goes down ) up to 1 after a whole turn.
+ *
+ * @param x Center coordinate x
+ * @param y Center coordinate y
+ * @param angle Angle of the offset 0, in radians
+ * @return A new gradient without colors, or NULL if a value isn't valid.
+ * @see imel_gradient_add_stop
+ * @see imel_draw_gradient_fill
+ */
+ImelGradient *imel_gradient_new_conic (double x, double y, double angle)
+{
+ ImelGradient *gradient;
+
+ return_var_if_fail (__IMEL_FINITE (x) && __IMEL_FINITE (y) && __IMEL_FINITE (angle), NULL);
+
+ gradient = __imel_gradient_new (IMEL_GRADIENT_CONIC, x, y);
+ return_var_if_fail (gradient, NULL);
+
+ gradient->angle = angle;
+
+ return gradient;
+}
+
+/**
+ * @brief Add a color to a gradient
+ *
+ * This function adds @p pixel to @p gradient at @p offset. Between two
+ * colors the channels and the level change linearly, before the first
+ * color and after the last one the gradient keeps their color. Two colors
+ * at the same offset make a sharp change, in the order they were added.
+ *
+ * @param gradient Gradient where add the color
+ * @param offset Position of the color, from 0 to 1
+ * @param pixel Color and level
+ * @return TRUE on success, FALSE on error or if @p offset isn't in
+ * \f$[0,1]\f$.
+ * @see imel_gradient_new_linear
+ */
+bool imel_gradient_add_stop (ImelGradient *gradient, double offset, ImelPixel pixel)
+{
+ ImelGradientStop *stops;
+ ImelSize i;
+
+ return_var_if_fail (gradient && offset >= 0 && offset <= 1, false);
+
+ if ( gradient->n_stops == gradient->size ) {
+      stops = (ImelGradientStop *) realloc (gradient->stops, sizeof (ImelGradientStop) *
+                                            (gradient->size ? gradient->size << 1 : 4));
+      return_var_if_fail (stops, false);
+
+      gradient->stops = stops;
+      gradient->size = gradient->size ? gradient->size << 1 : 4;
+ }
+
+ for ( i = gradient->n_stops; i > 0 && gradient->stops[i - 1].offset > offset; i-- )
+       gradient->stops[i] = gradient->stops[i - 1];
+
+ gradient->stops[i].offset = offset;
+ gradient->stops[i].pixel = pixel;
+ gradient->n_stops++;
+
+ return true;
+}
+
+/**
+ * @brief Free a gradient
+ *
+ * @param gradient Gradient to free
+ * @see imel_gradient_new_linear
+ */
+void imel_gradient_free (ImelGradient *gradient)
+{
+ return_if_fail (gradient);
+
+ free (gradient->stops);
+ free (gradient);
+}
+
+/**
+ * @brief Fill an image with a gradient
+ *
+ * This function draws @p gradient on all the pixels of @p image, as
+ * #imel_pixel_copy does: pixels with a level higher than the one of the
+ * gradient are kept and the negative levels are an alpha. The rows are
+ * split between threads and each pixel is written once. The brush isn't
+ * used.
+ *
+ * @param image Image where draw the gradient
+ * @param gradient Gradient to draw, without colors nothing is drawn
+ * @see imel_gradient_new_linear
+ * @see imel_gradient_new_radial
+ * @see imel_gradient_new_conic
+ * @see imel_thread_set_count
+ */
+void imel_draw_gradient_fill (ImelImage *image, const ImelGradient *gradient)
+{
+ return_if_fail (image && gradient);
+
+ __imel_gradient_fill (image, gradient, 0, 0, image->width, image->height);
+}
@@ -40,7 +40,7 @@
 #include "error.h"
 #include "image_enum.h"
 
-#define IMEL_VERSION_MAJOR 3 /**< Imel version major */
+#define IMEL_VERSION_MAJOR 4 /**< Imel version major */
 #define IMEL_VERSION_MINOR 0 /**< Imel version minor */
 
 #define RGBA_R_MASK(val) (((val) & 0xff000000) >> 24) /**< Mask for red channel in a RGBA value */
@@ -151,7 +151,13 @@ typedef enum _imel_effect {
               * that the resulting image can be retrofit on a different background. It receives as 
               * a parameter the color to be eliminated in the form of pointer to #ImelPixel variable.
               */
-             IMEL_EFFECT_COLOR_TO_ALPHA
+             IMEL_EFFECT_COLOR_TO_ALPHA,
+             /**
+              * Gaussian blur. The cost for each pixel doesn't depend on the radius of the blur. 
+              * When used as a parameter for #imel_image_apply_effect function it takes as a 
+              * parameter the standard deviation (sigma) in the form of pointer to double variable.
+              */
+             IMEL_EFFECT_GAUSSIAN_BLUR
         } ImelEffect;
 
 /**
@@ -188,6 +194,85 @@ typedef enum _imel_logic_operation {
                IMEL_LOGIC_XOR      /**< Logic XOR */
         } ImelLogicOperation;
 
+/**
+ * ImelFillRule type. Specifies which points are inside a polygon whose
+ * sides cross each other.
+ * 
+ * @note Enum values starts from 0.
+ * @see imel_draw_filled_polygon
+ */ 
+typedef enum _imel_fill_rule {
+               IMEL_FILL_RULE_EVEN_ODD = 0, /**< Inside if a line from the point crosses the sides an odd number of times */
+               IMEL_FILL_RULE_NON_ZERO      /**< Inside if the sides don't wind around the point zero times */
+        } ImelFillRule;
+
+/**
+ * ImelConnectivity type. Specifies which pixels touch each other.
+ * 
+ * @see imel_image_get_labels
+ */ 
+typedef enum _imel_connectivity {
+               IMEL_CONNECTIVITY_4 = 4, /**< Pixels that share a side */
+               IMEL_CONNECTIVITY_8 = 8  /**< Pixels that share a side or a corner */
+        } ImelConnectivity;
+
+/**
+ * ImelCanvasCommandType type. Specifies the draw command recorded in an
+ * #ImelCanvas.
+ * 
+ * @note Enum values starts from 0.
+ * @see ImelCanvasCommand
+ */ 
+typedef enum _imel_canvas_command_type {
+               IMEL_CANVAS_POINT = 0,                   /**< #imel_canvas_draw_point */
+               IMEL_CANVAS_LINE,                        /**< #imel_canvas_draw_line */
+               IMEL_CANVAS_RECT,                        /**< #imel_canvas_draw_rect */
+               IMEL_CANVAS_FILLED_CIRCLE,               /**< #imel_canvas_draw_filled_circle */
+               IMEL_CANVAS_FILLED_POLYGON,              /**< #imel_canvas_draw_filled_polygon */
+               IMEL_CANVAS_ANTIALIASED_LINE,            /**< #imel_canvas_draw_antialiased_line */
+               IMEL_CANVAS_ANTIALIASED_CIRCLE,          /**< #imel_canvas_draw_antialiased_circle */
+               IMEL_CANVAS_FILLED_ANTIALIASED_POLYGON,  /**< #imel_canvas_draw_filled_antialiased_polygon */
+               IMEL_CANVAS_IMAGE                        /**< #imel_canvas_insert_image and #imel_canvas_write_string */
+        } ImelCanvasCommandType;
+
+/**
+ * ImelBrushMode type. Specifies how the brush is drawn along lines.
+ *
+ * @note Enum values starts from 0.
+ * @see imel_brush_set_mode
+ */
+typedef enum _imel_brush_mode {
+               IMEL_BRUSH_MODE_STAMP = 0, /**< A copy of the brush on the points of the line */
+               IMEL_BRUSH_MODE_SWEPT      /**< The shape swept by the brush along the line, drawn once with the color of the line */
+        } ImelBrushMode;
+
+/**
+ * ImelGradientType type. Specifies how the colors of an #ImelGradient
+ * change across the image.
+ *
+ * @note Enum values starts from 0.
+ * @see ImelGradient
+ */
+typedef enum _imel_gradient_type {
+               IMEL_GRADIENT_LINEAR = 0, /**< Along the line from a point to another one */
+               IMEL_GRADIENT_RADIAL,     /**< With the distance from a center */
+               IMEL_GRADIENT_CONIC       /**< With the angle around a center */
+        } ImelGradientType;
+
+/**
+ * ImelPathCommand type. Specifies an element of an #ImelPath.
+ *
+ * @note Enum values starts from 0.
+ * @see ImelPathElement
+ */
+typedef enum _imel_path_command {
+               IMEL_PATH_MOVE_TO = 0,   /**< Start a new contour, #imel_path_move_to */
+               IMEL_PATH_LINE_TO,       /**< Straight line, #imel_path_line_to */
+               IMEL_PATH_QUADRATIC_TO,  /**< Quadratic Bèzier's curve, #imel_path_quadratic_to */
+               IMEL_PATH_CUBIC_TO,      /**< Cubic Bèzier's curve, #imel_path_cubic_to */
+               IMEL_PATH_CLOSE          /**< Line back to the start of the contour, #imel_path_close */
+        } ImelPathCommand;
+
 /**
  * ImelFontSize type. Enumerator created to facilitate the insertion of 
  * standard sizes for the internal fonts in Imel whose size is 14px or 
@@ -315,6 +400,22 @@ typedef enum _imel_value {
 	         IMEL_VALUE_PIXEL           /**< Pixel */
 } ImelValue;
 
+/**
+ * ImelCpuLevel type. Specifies the instruction set used by the kernels of
+ * Imel, it's chosen when the library is used the first time.
+ * 
+ * @note Enum values starts from 0
+ * @see imel_cpu_get_level
+ */
+typedef enum _imel_cpu_level {
+             IMEL_CPU_LEVEL_GENERIC = 0, /**< Portable C, no SIMD instruction set required */
+             IMEL_CPU_LEVEL_SSE2,        /**< x86 SSE2 */
+             IMEL_CPU_LEVEL_SSE4_1,      /**< x86 SSE4.1 */
+             IMEL_CPU_LEVEL_AVX2,        /**< x86 AVX2 */
+             IMEL_CPU_LEVEL_AVX512,      /**< x86 AVX-512 ( F and BW ) */
+             IMEL_CPU_LEVEL_NEON         /**< ARM NEON ( AArch64 ) */
+} ImelCpuLevel;
+
 /**
  * @brief Rappresentation of a pixel in Imel library.
  * 
@@ -362,6 +463,8 @@ typedef struct _imel_image {
                ImelSize width;    /**< Image width */
                ImelSize height;   /**< Image height */
                ImelPixel **pixel; /**< 2-dimensional array in [y][x] format. */
+               uint64_t generation;             /**< Incremented by each change of pixels, see #imel_image_touch */
+               struct _imel_image_stats *stats; /**< Cached statistics or NULL, see #imel_image_get_stats */
                /*@}*/
         } ImelImage;
 
@@ -380,6 +483,24 @@ typedef struct _imel_point {
 	           /*@}*/
         } ImelPoint;
 
+/**
+ * @brief Array of points in a single block of memory
+ * 
+ * This type keeps @c n_points points one after the other in @c point, so
+ * making and reading it doesn't need an allocation for each point like the
+ * NULL-terminated arrays of #ImelPoint.
+ * 
+ * @see imel_point_array_new
+ * @see imel_point_array_destroy
+ */
+typedef struct _imel_point_array {
+	           /*@{*/
+               ImelSize n_points; /**< Number of points */
+               ImelSize size;     /**< Number of points allocated */
+               ImelPoint *point;  /**< Points */
+	           /*@}*/
+        } ImelPointArray;
+
 /**
  * @brief Specialized type in reporting errors inside Imel.
  * 
@@ -437,6 +558,253 @@ typedef struct _imel_hsl {
 	           /*@}*/
 	    } ImelHSL;
 
+/**
+ * @brief Histograms of an image
+ * 
+ * All the histograms are computed with a single pass over the image.
+ * 
+ * @see imel_image_get_histograms
+ */
+typedef struct _imel_histograms {
+	           /*@{*/
+	           uint64_t red[256];   /**< Red channel values */
+	           uint64_t green[256]; /**< Green channel values */
+	           uint64_t blue[256];  /**< Blue channel values */
+	           uint64_t luma[256];  /**< Luma values, ( 77 R + 151 G + 28 B ) / 256 */
+	           uint64_t level[256]; /**< Level values clamped to [-255, 0] plus 255: 0 transparent, 255 opaque */
+	           /*@}*/
+	    } ImelHistograms;
+
+/**
+ * @brief Statistics of an image
+ * 
+ * The statistics are computed the first time they are requested and kept
+ * with the image until its pixels change. Minimum, maximum and mean are
+ * computed on the pixels with a level not negative, like the effects do.
+ * 
+ * @see imel_image_get_stats
+ * @see imel_image_touch
+ */
+typedef struct _imel_image_stats {
+	           /*@{*/
+	           uint64_t generation;       /**< Generation of the image when the statistics were computed */
+	           ImelColor min[3];          /**< Minimum of red, green and blue ( 255 without pixels ) */
+	           ImelColor max[3];          /**< Maximum of red, green and blue ( 0 without pixels ) */
+	           ImelColor mean[3];         /**< Mean of red, green and blue */
+	           uint64_t opaque;           /**< Pixels with level not negative */
+	           uint64_t translucent;      /**< Pixels with level between -254 and -1 */
+	           uint64_t transparent;      /**< Pixels with level -255 or lower */
+	           ImelHistograms histograms; /**< Histograms of all the pixels */
+	           /*@}*/
+	    } ImelImageStats;
+
+/**
+ * @brief Statistics of a region of an #ImelLabels
+ * 
+ * @see imel_image_get_labels
+ */
+typedef struct _imel_region {
+	           /*@{*/
+	           uint64_t area;  /**< Number of pixels */
+	           ImelSize x1;    /**< Left side of the bounding box */
+	           ImelSize y1;    /**< Top side of the bounding box */
+	           ImelSize x2;    /**< Right side of the bounding box, included */
+	           ImelSize y2;    /**< Bottom side of the bounding box, included */
+	           double cx;      /**< Coordinate x of the centroid */
+	           double cy;      /**< Coordinate y of the centroid */
+	           ImelPixel mean; /**< Mean color and level */
+	           /*@}*/
+	    } ImelRegion;
+
+/**
+ * @brief Connected regions of an image
+ * 
+ * Each pixel of the image has the number of its region in @c label, row
+ * after row. Regions are numbered from 0 in the order their first pixel
+ * is found reading the image row after row.
+ * 
+ * @see imel_image_get_labels
+ * @see imel_labels_free
+ */
+typedef struct _imel_labels {
+	           /*@{*/
+	           ImelSize width;      /**< Width of the image */
+	           ImelSize height;     /**< Height of the image */
+	           ImelSize *label;     /**< Region of each pixel, the one at (x, y) is label[y * width + x] */
+	           ImelSize n_regions;  /**< Number of regions */
+	           ImelRegion *region;  /**< Statistics of each region */
+	           /*@}*/
+	    } ImelLabels;
+
+/**
+ * @brief Sequence of operations on single color values
+ * 
+ * Each channel of a pixel is replaced by the value in its lookup table, the
+ * operations added to an #ImelPointOp are composed in these tables. Pixels
+ * with negative level have their own tables, where only the operations
+ * that change them are composed.
+ * 
+ * @see imel_point_op_new
+ * @see imel_image_apply_point_op
+ */
+typedef struct _imel_point_op {
+	           /*@{*/
+	           ImelColor lut[3][256];       /**< Lookup tables for red, green and blue channels */
+	           ImelColor alpha_lut[3][256]; /**< Lookup tables for pixels with negative level */
+	           /*@}*/
+	    } ImelPointOp;
+
+/**
+ * @brief Effect recorded in an #ImelEffectChain with its parameter
+ * 
+ * @see imel_effect_chain_add
+ */
+typedef struct _imel_effect_chain_item {
+	           /*@{*/
+	           ImelEffect effect;       /**< Effect to apply */
+	           union {
+	                  int value;        /**< Integer parameter */
+	                  ImelMask mask;    /**< Channels for #IMEL_EFFECT_NORMALIZE */
+	                  ImelImage *image; /**< Image for #IMEL_EFFECT_IMAGE_ADD and #IMEL_EFFECT_IMAGE_SUBTRACT */
+	                  ImelPixel pixel;  /**< Color for #IMEL_EFFECT_COLOR_TO_ALPHA */
+	                  double sigma;     /**< Standard deviation for #IMEL_EFFECT_GAUSSIAN_BLUR */
+	           } argument;              /**< Parameter of the effect */
+	           /*@}*/
+	    } ImelEffectChainItem;
+
+/**
+ * @brief Sequence of effects applied with as few passes as possible
+ * 
+ * @see imel_effect_chain_new
+ * @see imel_effect_chain_apply
+ */
+typedef struct _imel_effect_chain {
+	           /*@{*/
+	           ImelSize n_items;            /**< Number of effects */
+	           ImelEffectChainItem *items;  /**< Effects in order of application */
+	           /*@}*/
+	    } ImelEffectChain;
+
+/**
+ * @brief Draw command recorded in an #ImelCanvas with its bounding box
+ * 
+ * @see imel_canvas_render
+ */
+typedef struct _imel_canvas_command {
+	           /*@{*/
+	           ImelCanvasCommandType type; /**< Command to draw */
+	           ImelPixel pixel;            /**< Color and level */
+	           long x1;                    /**< Left side of the bounding box */
+	           long y1;                    /**< Top side of the bounding box */
+	           long x2;                    /**< Right side of the bounding box, included */
+	           long y2;                    /**< Bottom side of the bounding box, included */
+	           union {
+	                  long value[5];       /**< Coordinates of the commands on whole pixels, and fill of #IMEL_CANVAS_RECT */
+	                  double coord[4];     /**< Coordinates of the anti-aliased lines and circles */
+	                  struct {
+	                         ImelPointArray *points; /**< Copy of the vertices */
+	                         ImelFillRule rule;      /**< Rule to choose the points inside */
+	                  } polygon;           /**< Polygons */
+	                  struct {
+	                         ImelImage *image;       /**< Image to insert */
+	                         long x;                 /**< Coordinate x of the top left corner */
+	                         long y;                 /**< Coordinate y of the top left corner */
+	                         bool owned;             /**< TRUE if the canvas frees @c image */
+	                  } image;             /**< Images and strings */
+	           } argument;                 /**< Parameters of the command */
+	           /*@}*/
+	    } ImelCanvasCommand;
+
+/**
+ * @brief Draw commands recorded to be drawn later tile by tile
+ * 
+ * @see imel_canvas_new
+ * @see imel_canvas_render
+ */
+typedef struct _imel_canvas {
+	           /*@{*/
+	           ImelSize n_commands;         /**< Number of commands */
+	           ImelSize size;               /**< Number of commands allocated */
+	           ImelCanvasCommand *commands; /**< Commands in order of drawing */
+	           /*@}*/
+	    } ImelCanvas;
+
+/**
+ * @brief Color of a gradient at an offset
+ * 
+ * @see imel_gradient_add_stop
+ */
+typedef struct _imel_gradient_stop {
+	           /*@{*/
+	           double offset;   /**< Position in the gradient, from 0 to 1 */
+	           ImelPixel pixel; /**< Color and level */
+	           /*@}*/
+	    } ImelGradientStop;
+
+/**
+ * @brief Linear, radial or conic gradient with many colors
+ * 
+ * @see imel_gradient_new_linear
+ * @see imel_gradient_new_radial
+ * @see imel_gradient_new_conic
+ * @see imel_draw_gradient_fill
+ */
+typedef struct _imel_gradient {
+	           /*@{*/
+	           ImelGradientType type;   /**< Type of gradient */
+	           double x1;               /**< Coordinate x of the start or of the center */
+	           double y1;               /**< Coordinate y of the start or of the center */
+	           double x2;               /**< Coordinate x of the end of a linear gradient */
+	           double y2;               /**< Coordinate y of the end of a linear gradient */
+	           double radius;           /**< Radius of a radial gradient */
+	           double angle;            /**< Start angle of a conic gradient, in radians */
+	           ImelSize n_stops;        /**< Number of colors */
+	           ImelSize size;           /**< Number of colors allocated */
+	           ImelGradientStop *stops; /**< Colors in order of offset */
+	           /*@}*/
+	    } ImelGradient;
+
+/**
+ * @brief Element of an #ImelPath
+ * 
+ * The last point used by the command is its end point, the ones before
+ * are the control points of the curves.
+ * 
+ * @see ImelPathCommand
+ */
+typedef struct _imel_path_element {
+	           /*@{*/
+	           ImelPathCommand command; /**< Type of element */
+	           double x[3];             /**< Coordinates x of the points */
+	           double y[3];             /**< Coordinates y of the points */
+	           /*@}*/
+	    } ImelPathElement;
+
+/**
+ * @brief Contours made of lines and Bèzier's curves
+ * 
+ * @see imel_path_new
+ * @see imel_draw_path
+ */
+typedef struct _imel_path {
+	           /*@{*/
+	           ImelSize n_elements;       /**< Number of elements */
+	           ImelSize size;             /**< Number of elements allocated */
+	           ImelPathElement *elements; /**< Elements in order */
+	           double tolerance;          /**< Largest distance in pixels of the lines drawn from the curves */
+	           /*@}*/
+	    } ImelPath;
+
+/**
+ * @brief A TrueType font opened once, with a cache of its glyphs
+ * 
+ * The fields are private to Imel.
+ * 
+ * @see imel_font_open
+ * @see imel_font_write_text
+ */
+typedef struct _imel_font ImelFont;
+
 /**
  * Pointer to an #ImelImage
  * 
@@ -454,6 +822,12 @@ typedef void *ImelGenericPtr;
  * @note Used internally.
  */
 typedef void (*ImelGenericFuncPtr)(ImelImagePtr,ImelGenericPtr);
+/**
+ * Function called for each band of elements [start, end) when the work
+ * is split between threads, band is the index of the band.
+ * @note Used internally.
+ */
+typedef void (*ImelBandFuncPtr)(ImelSize,ImelSize,ImelSize,ImelGenericPtr);
 
 /** 
  * imel_debug_printf are foundamental for macro #return_if_fail 
@@ -495,6 +869,11 @@ bool imel_printf_debug (const char *function, const char *filename,
              imel_printf_debug (NULL, NULL, "warning", "condition failed.\n"); \
              return; \
         }
+
+#ifndef DOXYGEN_IGNORE_DOC
+/* TRUE if @x is neither infinite nor NaN, without the C99 isfinite () */
+#define __IMEL_FINITE(x) ((x) == (x) && (x) - (x) == 0)
+#endif
         
 #ifdef __cplusplus
  }
@@ -0,0 +1,283 @@
+/*
+ * "histogram.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "header.h"
+#include "kernel.h"
+/**
+ * @file histogram.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to compute the histograms and the
+ *        statistics of an image.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+/* Pixels counted by a band before its 32 bit counts are added to the 64 bit ones */
+#define __IMEL_HISTOGRAM_FLUSH 0x7fffffff
+
+extern ImelSize __imel_thread_bands (ImelSize n, ImelSize grain);
+extern void __imel_thread_run_bands (ImelSize n, ImelSize bands, ImelBandFuncPtr func, ImelGenericPtr data);
+
+typedef struct ___imel_stats_band {
+               ImelHistograms histograms;
+               ImelColor min[3];
+               ImelColor max[3];
+               uint64_t sum[3];
+               uint64_t opaque;
+        } __ImelStatsBand;
+
+typedef struct ___imel_stats_apply {
+               ImelImage *image;
+               __ImelStatsBand *band;
+        } __ImelStatsApply;
+
+/* Add the copies in @count to @histograms and clear them */
+static void __imel_histograms_flush (ImelHistograms *histograms, ImelSize (*count)[256])
+{
+ uint64_t *channel[__IMEL_HISTOGRAM_CHANNELS];
+ int copy, c, i;
+
+ channel[0] = histograms->red;
+ channel[1] = histograms->green;
+ channel[2] = histograms->blue;
+ channel[3] = histograms->luma;
+ channel[4] = histograms->level;
+
+ for ( copy = 0; copy < __IMEL_HISTOGRAM_COPIES; copy++ ) {
+       for ( c = 0; c < __IMEL_HISTOGRAM_CHANNELS; c++ ) {
+             for ( i = 0; i < 256; i++ )
+                   channel[c][i] += count[copy * __IMEL_HISTOGRAM_CHANNELS + c][i];
+       }
+ }
+
+ memset (count, 0, sizeof (ImelSize) * __IMEL_HISTOGRAM_COPIES * __IMEL_HISTOGRAM_CHANNELS * 256);
+}
+
+/* Minimum, maximum and sum of the channels of the pixels with a level not negative */
+static void __imel_stats_row (__ImelStatsBand *band, const ImelPixel *row, ImelSize width)
+{
+ ImelColor min[3], max[3];
+ uint64_t sum[3] = { 0, 0, 0 }, opaque = 0;
+ ImelSize x;
+ bool visible;
+ int c;
+
+ for ( c = 0; c < 3; c++ ) {
+       min[c] = band->min[c];
+       max[c] = band->max[c];
+ }
+
+ for ( x = 0; x < width; x++ ) {
+       visible = row[x].level >= 0;
+
+       min[0] = ( visible && row[x].red < min[0] ) ? row[x].red : min[0];
+       min[1] = ( visible && row[x].green < min[1] ) ? row[x].green : min[1];
+       min[2] = ( visible && row[x].blue < min[2] ) ? row[x].blue : min[2];
+       max[0] = ( visible && row[x].red > max[0] ) ? row[x].red : max[0];
+       max[1] = ( visible && row[x].green > max[1] ) ? row[x].green : max[1];
+       max[2] = ( visible && row[x].blue > max[2] ) ? row[x].blue : max[2];
+       sum[0] += visible ? row[x].red : 0;
+       sum[1] += visible ? row[x].green : 0;
+       sum[2] += visible ? row[x].blue : 0;
+       opaque += visible;
+ }
+
+ for ( c = 0; c < 3; c++ ) {
+       band->min[c] = min[c];
+       band->max[c] = max[c];
+       band->sum[c] += sum[c];
+ }
+ band->opaque += opaque;
+}
+
+static void __imel_stats_rows (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelStatsApply *apply = (__ImelStatsApply *) data;
+ __ImelStatsBand *stats = &apply->band[band];
+ const __ImelKernels *kernels = __imel_kernels ();
+ ImelSize count[__IMEL_HISTOGRAM_COPIES * __IMEL_HISTOGRAM_CHANNELS][256];
+ ImelSize y, width = apply->image->width;
+ uint64_t pixels = 0;
+
+ memset (count, 0, sizeof (count));
+ memset (stats->min, 0xff, sizeof (stats->min));
+
+ for ( y = start; y < end; y++ ) {
+       if ( pixels + width > __IMEL_HISTOGRAM_FLUSH ) {
+            __imel_histograms_flush (&stats->histograms, count);
+            pixels = 0;
+       }
+
+       kernels->histogram_row (apply->image->pixel[y], width, count);
+       __imel_stats_row (stats, apply->image->pixel[y], width);
+       pixels += width;
+ }
+
+ __imel_histograms_flush (&stats->histograms, count);
+}
+
+/* Compute the statistics of @image in @stats with a single pass */
+static bool __imel_stats_compute (ImelImage *image, ImelImageStats *stats)
+{
+ __ImelStatsApply apply;
+ ImelSize bands, i, j, c;
+ uint64_t *sum, *part, total[3] = { 0, 0, 0 }, opaque = 0;
+
+ bands = __imel_thread_bands (image->height, 32);
+ apply.image = image;
+ apply.band = (__ImelStatsBand *) calloc (bands, sizeof (__ImelStatsBand));
+ return_var_if_fail (apply.band, false);
+
+ /* Bands without rows keep these values */
+ for ( i = 0; i < bands; i++ )
+       memset (apply.band[i].min, 0xff, sizeof (apply.band[i].min));
+
+ __imel_thread_run_bands (image->height, bands, __imel_stats_rows, &apply);
+
+ memset (&stats->histograms, 0, sizeof (ImelHistograms));
+ memset (stats->min, 0xff, sizeof (stats->min));
+ memset (stats->max, 0, sizeof (stats->max));
+
+ sum = (uint64_t *) &stats->histograms;
+ for ( i = 0; i < bands; i++ ) {
+       part = (uint64_t *) &apply.band[i].histograms;
+       for ( j = 0; j < sizeof (ImelHistograms) / sizeof (uint64_t); j++ )
+             sum[j] += part[j];
+
+       for ( c = 0; c < 3; c++ ) {
+             stats->min[c] = ( apply.band[i].min[c] < stats->min[c] ) ? apply.band[i].min[c] : stats->min[c];
+             stats->max[c] = ( apply.band[i].max[c] > stats->max[c] ) ? apply.band[i].max[c] : stats->max[c];
+             total[c] += apply.band[i].sum[c];
+       }
+       opaque += apply.band[i].opaque;
+ }
+
+ free (apply.band);
+
+ for ( c = 0; c < 3; c++ )
+       stats->mean[c] = total[c] / ( opaque ? opaque : 1 );
+
+ stats->opaque = opaque;
+ stats->transparent = stats->histograms.level[0];
+ stats->translucent = (uint64_t) image->width * image->height - opaque - stats->transparent;
+ stats->generation = image->generation;
+
+ return true;
+}
+
+#endif
+
+/**
+ * @brief Get the statistics of an image
+ *
+ * This function returns the statistics of @p image: minimum, maximum and
+ * mean of each channel, alpha coverage and all the histograms. They are
+ * computed with a single pass the first time they are requested and kept
+ * until a function of Imel changes the pixels of @p image, so asking them
+ * again on an unchanged image costs nothing.
+ *
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.jpg", 0, NULL);
+ * const ImelImageStats *stats = imel_image_get_stats (image);
+ *
+ * printf ("Mean: %d %d %d\n", stats->mean[0], stats->mean[1], stats->mean[2]);
+ * @endcode
+ *
+ * @param image Image from which get the statistics
+ * @return The statistics of @p image, owned by @p image and valid until its
+ * pixels change, or NULL on error.
+ *
+ * @note If the pixels are changed directly call #imel_image_touch.
+ * @see ImelImageStats
+ * @see imel_image_touch
+ */
+const ImelImageStats *imel_image_get_stats (ImelImage *image)
+{
+ return_var_if_fail (image, NULL);
+
+ if ( image->stats && image->stats->generation == image->generation )
+      return image->stats;
+
+ if ( ! image->stats ) {
+      image->stats = (ImelImageStats *) malloc (sizeof (ImelImageStats));
+      return_var_if_fail (image->stats, NULL);
+ }
+
+ if ( ! __imel_stats_compute (image, image->stats) ) {
+      free (image->stats);
+      image->stats = NULL;
+      return NULL;
+ }
+
+ return image->stats;
+}
+
+/**
+ * @brief Get all the histograms of an image
+ *
+ * This function computes the histograms of red, green, blue, luma and
+ * level values of @p image with a single pass over its rows. The rows
+ * are split between threads, each one with its own counts. The result is
+ * kept with the image, see #imel_image_get_stats.
+ *
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.jpg", 0, NULL);
+ * ImelHistograms *histograms = imel_image_get_histograms (image);
+ *
+ * printf ("Black pixels: %llu\n", (unsigned long long) histograms->luma[0]);
+ * imel_histograms_free (histograms);
+ * @endcode
+ *
+ * @param image Image from which get the histograms
+ * @return The histograms of @p image or NULL on error.
+ *
+ * @see ImelHistograms
+ * @see imel_histograms_free
+ * @see imel_image_get_histogram
+ */
+ImelHistograms *imel_image_get_histograms (ImelImage *image)
+{
+ ImelHistograms *histograms;
+ const ImelImageStats *stats;
+
+ stats = imel_image_get_stats (image);
+ return_var_if_fail (stats, NULL);
+
+ histograms = (ImelHistograms *) malloc (sizeof (ImelHistograms));
+ return_var_if_fail (histograms, NULL);
+
+ *histograms = stats->histograms;
+
+ return histograms;
+}
+
+/**
+ * @brief Free the histograms
+ *
+ * @param histograms Histograms to free
+ * @see imel_image_get_histograms
+ */
+void imel_histograms_free (ImelHistograms *histograms)
+{
+ return_if_fail (histograms);
+
+ free (histograms);
+}
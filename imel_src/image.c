@@ -25,6 +25,7 @@
 #include <math.h>
 #include <time.h>
 #include "header.h"
+#include "kernel.h"
 /**
  * @file image.c
  * @author Davide Francesco Merico
@@ -52,6 +53,7 @@ extern void             imel_effect_normalize             (ImelImagePtr, ImelGen
 extern void             imel_effect_rasterize             (ImelImagePtr, ImelGenericPtr);
 extern void             imel_effect_white_black           (ImelImagePtr, ImelGenericPtr);
 extern void             imel_effect_color_to_alpha        (ImelImagePtr, ImelGenericPtr);
+extern void             imel_effect_gaussian_blur         (ImelImagePtr, ImelGenericPtr);
 
 
 extern bool             imel_pixel_compare                (ImelPixel, ImelPixel, ImelSize);
@@ -72,6 +74,23 @@ extern void             imel_draw_rect                    (ImelImage *, ImelSize
                            
 extern void             imel_font_write_string            (ImelImage *, ImelSize, ImelSize, const char *, ImelSize, ImelPixel);
 
+extern bool             __imel_fft_convolution            (ImelImage *, double **, int, int, double, double);
+extern bool             __imel_fft_convolution_is_faster  (ImelImage *, int, int);
+
+extern ImelSize         __imel_thread_bands               (ImelSize, ImelSize);
+extern void             __imel_thread_run_bands           (ImelSize, ImelSize, ImelBandFuncPtr, ImelGenericPtr);
+
+extern void             __imel_point_op_apply             (ImelImage *, const ImelPointOp *);
+extern void             imel_point_op_add_color           (ImelPointOp *, ImelColor, ImelColor, ImelColor);
+extern void             imel_point_op_add_shift_bpc       (ImelPointOp *, int, int, int);
+extern void             imel_point_op_reset               (ImelPointOp *);
+
+extern const ImelImageStats *imel_image_get_stats      (ImelImage *);
+
+extern void             __imel_mask_apply_noise           (ImelImage *, ImelSize, ImelSize, ImelMask, ImelNoiseOperation, bool);
+extern void             __imel_mask_remove_noise          (ImelImage *, ImelSize, ImelMask, ImelColor);
+extern void             __imel_mask_set                   (ImelImage *, ImelMask, ImelPixel);
+
 extern ImelInfoCut     *imel_info_cut_get_min             (ImelInfoCut *, ImelOrientation);
 extern ImelSize         imel_info_cut_get_split           (ImelImage *, ImelInfoCut *, ImelOrientation);
 extern ImelInfoCut     *imel_info_cut_get_next            (ImelImage *, ImelInfoCut *, ImelSize);
@@ -106,6 +125,8 @@ ImelImage *imel_image_new (ImelSize width, ImelSize height)
  
  l_image->width = width;
  l_image->height = height;
+ l_image->generation = 0;
+ l_image->stats = NULL;
 
  l_image->pixel = (ImelPixel **) malloc (height * sizeof (ImelPixel *)
                                          + __memory_buffer);
@@ -154,6 +175,8 @@ ImelImage *imel_image_new_with_background_color (ImelSize width, ImelSize height
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = width;
  l_image->height = height;
+ l_image->generation = 0;
+ l_image->stats = NULL;
 
  l_image->pixel = (ImelPixel **) malloc (height * sizeof (ImelPixel *)
                                          + __memory_buffer);
@@ -186,6 +209,8 @@ ImelImage *imel_image_copy (ImelImage *image)
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = image->width;
  l_image->height = image->height;
+ l_image->generation = 0;
+ l_image->stats = NULL;
 
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *)
                                          + __memory_buffer);
@@ -200,6 +225,15 @@ ImelImage *imel_image_copy (ImelImage *image)
                              image->pixel[y][x].level);
  }
 
+ /* Same pixels, same statistics */
+ if ( image->stats && image->stats->generation == image->generation ) {
+      l_image->stats = (ImelImageStats *) malloc (sizeof (ImelImageStats));
+      if ( l_image->stats ) {
+           *(l_image->stats) = *(image->stats);
+           l_image->stats->generation = l_image->generation;
+      }
+ }
+
  return l_image;
 }
 
@@ -235,6 +269,24 @@ ImelSize imel_image_get_height (ImelImage *image)
  return image->height;
 }
 
+/**
+ * @brief Mark an image as changed
+ * 
+ * The functions of Imel call this function when they change the pixels
+ * of an image, so the statistics computed by #imel_image_get_stats are
+ * computed again the next time they are requested. Call it after writing
+ * directly in <tt>image->pixel</tt>.
+ * 
+ * @param image Image changed
+ * @see imel_image_get_stats
+ */
+void imel_image_touch (ImelImage *image)
+{
+ return_if_fail (image);
+
+ image->generation++;
+}
+
 /**
  * @brief Free an image
  * 
@@ -257,6 +309,7 @@ void imel_image_free (ImelImage *image)
        free (image->pixel);
  }
 
+ free (image->stats);
  free (image);
 }
 
@@ -287,6 +340,7 @@ void imel_image_apply_effect (ImelImage *image, ImelEffect effect, ...)
                                              imel_effect_image_add,
                                              imel_effect_image_subtract,
                                              imel_effect_color_to_alpha,
+                                             imel_effect_gaussian_blur,
                                              NULL
                                            };
 
@@ -297,6 +351,33 @@ void imel_image_apply_effect (ImelImage *image, ImelEffect effect, ...)
  va_end (opt_argument);
 
  effect_func[effect] (image, argument);
+ image->generation++;
+}
+
+/**
+ * @brief Apply a gaussian blur to an image
+ * 
+ * This function blur @p image with a gaussian filter of standard deviation 
+ * @p sigma. The filter is recursive, so the time needed doesn't depend on
+ * @p sigma. Only the color channels are blurred, levels are unchanged.
+ * 
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.jpg", 0, NULL);
+ * 
+ * imel_image_apply_gaussian_blur (image, 4.5);
+ * @endcode
+ * 
+ * @param image Image to blur
+ * @param sigma Standard deviation of the filter, values under 0.5 leave the image unchanged
+ * @see IMEL_EFFECT_GAUSSIAN_BLUR
+ * @see imel_thread_set_count
+ */
+void imel_image_apply_gaussian_blur (ImelImage *image, double sigma)
+{
+ return_if_fail (image);
+
+ imel_effect_gaussian_blur (image, &sigma);
+ image->generation++;
 }
 
 /**
@@ -318,54 +399,12 @@ void imel_image_apply_effect (ImelImage *image, ImelEffect effect, ...)
  */
 void imel_image_apply_filter (ImelImage *image, ImelMask mask)
 {
- ImelSize y, x;
- ImelPixel *p;
+ ImelPixel value;
 
  return_if_fail (image);
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
-             switch ( mask ) {
-              case IMEL_MASK_RED:
-                     imel_pixel_set (p, 255, p->green, p->blue, p->level);
-                     break;
-              case IMEL_MASK_GREEN:
-                     imel_pixel_set (p, p->red, 255, p->blue, p->level);
-                     break;
-              case IMEL_MASK_BLUE:
-                     imel_pixel_set (p, p->red, p->green, 255, p->level);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN:
-                     imel_pixel_set (p, 255, 255, p->blue, p->level);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_LEVEL:
-                     imel_pixel_set (p, 255, p->red, p->blue, 0);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_LEVEL:
-                     imel_pixel_set (p, 255, 255, p->blue, 0);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_BLUE:
-                     imel_pixel_set (p, 255, p->green, 255, p->level);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                     imel_pixel_set (p, 255, p->green, 255, 0);
-                     break;
-              case IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                     imel_pixel_set (p, p->red, 255, 255, p->level);
-                     break;
-              case IMEL_MASK_GREEN | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                     imel_pixel_set (p, p->red, 255, 255, 0);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                     imel_pixel_set (p, 255, 255, 255, p->level);
-                     break;
-              default: break;
-             }
-       }
- }
+ imel_pixel_set (&value, 255, 255, 255, 0);
+ __imel_mask_set (image, mask, value);
 }
 
 /**
@@ -396,23 +435,16 @@ void imel_image_apply_filter (ImelImage *image, ImelMask mask)
  */
 void imel_image_apply_color (ImelImage *image, ImelColor red, ImelColor green, ImelColor blue, bool mono)
 {
- ImelPixel *p;
- ImelSize x, y;
+ ImelPointOp point_op;
 
  return_if_fail (image);
 
  if ( mono )
       imel_image_apply_effect (image, IMEL_EFFECT_WHITE_BLACK);
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
-             imel_pixel_set (p, ( p->red * red ) / 255, ( p->green * green ) / 255,
-                             ( p->blue * blue ) / 255, p->level);
-        }
- }
+ imel_point_op_reset (&point_op);
+ imel_point_op_add_color (&point_op, red, green, blue);
+ __imel_point_op_apply (image, &point_op);
 }
 
 /**
@@ -436,54 +468,12 @@ void imel_image_apply_color (ImelImage *image, ImelColor red, ImelColor green, I
  */
 void imel_image_remove_base_color (ImelImage *image, ImelMask mask)
 {
- ImelSize y, x;
- ImelPixel *p;
+ ImelPixel value;
 
  return_if_fail (image);
 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             p = &(image->pixel[y][x]);
-             if ( p->level < 0 )
-                  continue;
-             switch ( mask ) {
-              case IMEL_MASK_RED:
-                     imel_pixel_set (p, 0, p->green, p->blue, p->level);
-                     break;
-              case IMEL_MASK_GREEN:
-                     imel_pixel_set (p, p->red, 0, p->blue, p->level);
-                     break;
-              case IMEL_MASK_BLUE:
-                     imel_pixel_set (p, p->red, p->green, 0, p->level);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN:
-                     imel_pixel_set (p, 0, 0, p->blue, p->level);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_LEVEL:
-                     imel_pixel_set (p, 0, p->green, p->blue, -255);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_LEVEL:
-                     imel_pixel_set (p, 0, 0, p->blue, -255);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_BLUE:
-                     imel_pixel_set (p, 0, p->green, 0, p->level);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                     imel_pixel_set (p, 0, p->green, 0, -255);
-                     break;
-              case IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                     imel_pixel_set (p, p->red, 0, 0, p->level);
-                     break;
-              case IMEL_MASK_GREEN | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                     imel_pixel_set (p, p->red, 0, 0, -255);
-                     break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                     imel_pixel_set (p, 0, 0, 0, p->level);
-                     break;
-              default: break;
-             }
-       }
- }
+ imel_pixel_set (&value, 0, 0, 0, -255);
+ __imel_mask_set (image, mask, value);
 }
 
 /**
@@ -547,6 +537,7 @@ void imel_image_apply_color_from_string (ImelImage *image, const char *string, b
                              ( p->blue * blue ) / 255, p->level);
         }
  }
+ image->generation++;
 }
 
 /**
@@ -580,7 +571,9 @@ void imel_image_replace_color (ImelImage *image, ImelPixel src, ImelPixel dest,
  for ( y = 0; y < image->height; y++ )
        for ( x = 0; x < image->width; x++ )
              if ( imel_pixel_compare (image->pixel[y][x], src, tollerance) )
-                  imel_draw_point (image, x, y, dest);
+                  imel_pixel_copy (&(image->pixel[y][x]), dest);
+
+ image->generation++;
 }
 
 /**
@@ -648,7 +641,9 @@ void imel_image_replace_area_color (ImelImage *image, ImelPixel src, ImelPixel d
  for ( y = sy; y < ey; y++ )
        for ( x = sx; x < ex; x++ )
              if ( imel_pixel_compare (image->pixel[y][x], src, tollerance) )
-                  imel_draw_point (image, x, y, dest);
+                  imel_pixel_copy (&(image->pixel[y][x]), dest);
+
+ image->generation++;
 }
 
 /**
@@ -672,27 +667,33 @@ void imel_image_replace_area_color (ImelImage *image, ImelPixel src, ImelPixel d
 ImelImage *imel_image_resize (ImelImage *image, ImelSize width, ImelSize height)
 {
  ImelImage *l_image;
- ImelSize w, h, t[2];
+ ImelSize w, h, *index;
+ const __ImelKernels *kernels = __imel_kernels ();
 
  return_var_if_fail (image, NULL);
 
+ index = (ImelSize *) malloc (width * sizeof (ImelSize) + __memory_buffer);
+ return_var_if_fail (index, NULL);
+
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = width;
  l_image->height = height;
+ l_image->generation = 0;
+ l_image->stats = NULL;
  l_image->pixel = (ImelPixel **) malloc (height * sizeof (ImelPixel *)
                                          + __memory_buffer);
  for ( h = 0; h < height; h++ )
        l_image->pixel[h] = (ImelPixel *) malloc (width * sizeof (ImelPixel)
                                                  + __memory_buffer);
 
- for ( h = 0; h < height; h++ ) {
-       t[0] = (image->height * h) / height;
-       for ( w = 0; w < width; w++ ) {
-             t[1] = (image->width * w) / width;
-             l_image->pixel[h][w].level = image->pixel[t[0]][t[1]].level;
-             imel_pixel_copy (&(l_image->pixel[h][w]), image->pixel[t[0]][t[1]]);
-       }
- }
+ for ( w = 0; w < width; w++ )
+       index[w] = (ImelSize) (((uint64_t) image->width * w) / width);
+
+ for ( h = 0; h < height; h++ )
+       kernels->resize_row (l_image->pixel[h], image->pixel[((uint64_t) image->height * h) / height],
+                            width, index);
+
+ free (index);
 
  return l_image;
 }
@@ -718,6 +719,8 @@ ImelImage *imel_image_rotate_to_left (ImelImage *image)
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = image->height;
  l_image->height = image->width;
+ l_image->generation = 0;
+ l_image->stats = NULL;
 
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *));
  for ( y = 0; y < l_image->height; y++ )
@@ -751,6 +754,8 @@ ImelImage *imel_image_rotate_to_right (ImelImage *image)
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = image->height;
  l_image->height = image->width;
+ l_image->generation = 0;
+ l_image->stats = NULL;
 
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *));
  for ( y = 0; y < l_image->height; y++ )
@@ -784,6 +789,8 @@ ImelImage *imel_image_rotate_complete (ImelImage *image)
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = image->width;
  l_image->height = image->height;
+ l_image->generation = 0;
+ l_image->stats = NULL;
 
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *));
  for ( y = 0; y < l_image->height; y++ )
@@ -815,6 +822,8 @@ ImelImage *imel_image_mirror_horizontal (ImelImage *image)
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = image->width;
  l_image->height = image->height;
+ l_image->generation = 0;
+ l_image->stats = NULL;
 
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *));
  for ( y = 0; y < l_image->height; y++ )
@@ -846,6 +855,8 @@ ImelImage *imel_image_mirror_vertical (ImelImage *image)
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = image->width;
  l_image->height = image->height;
+ l_image->generation = 0;
+ l_image->stats = NULL;
 
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *));
  for ( y = 0; y < l_image->height; y++ )
@@ -965,7 +976,7 @@ ImelImage *imel_image_perspective (ImelImage *image, double rad_angle, ImelOrien
                  k = image->height - j;
         
                  for ( y = 0; y < image->height; y++ )
-                       imel_draw_point (l_image, x, ((k * y) / image->height) + ( j >> 1 ),
+                       imel_pixel_copy (&(l_image->pixel[((k * y) / image->height) + ( j >> 1 )][x]),
                                         image->pixel[y][x]);
            }
       }
@@ -975,7 +986,7 @@ ImelImage *imel_image_perspective (ImelImage *image, double rad_angle, ImelOrien
                  k = image->height - j;
         
                  for ( y = 0; y < image->height; y++ )
-                       imel_draw_point (l_image, x, ((k * y) / image->height) + ( j >> 1 ),
+                       imel_pixel_copy (&(l_image->pixel[((k * y) / image->height) + ( j >> 1 )][x]),
                                         image->pixel[y][x]);
            }
       }
@@ -989,7 +1000,7 @@ ImelImage *imel_image_perspective (ImelImage *image, double rad_angle, ImelOrien
             k = image->width - j;
        
             for ( x = 0; x < image->width; x++ )
-                  imel_draw_point (l_image, ((k * x) / image->width) + ( j >> 1 ), y,
+                  imel_pixel_copy (&(l_image->pixel[y][((k * x) / image->width) + ( j >> 1 )]),
                                    image->pixel[y][x]);
       }
  }
@@ -999,7 +1010,7 @@ ImelImage *imel_image_perspective (ImelImage *image, double rad_angle, ImelOrien
             k = image->width - j;
        
             for ( x = 0; x < image->width; x++ )
-                  imel_draw_point (l_image, ((k * x) / image->width) + ( j >> 1 ), y,
+                  imel_pixel_copy (&(l_image->pixel[y][((k * x) / image->width) + ( j >> 1 )]),
                                    image->pixel[y][x]);
       }
  }
@@ -1274,7 +1285,9 @@ void imel_image_insert_image (ImelImage *dest, ImelImage *src, ImelSize sx, Imel
 
  for ( y = sy; y < dest->height && y < (src->height + sy); y++ )
        for ( x = sx; x < dest->width && x < (src->width + sx); x++ )
-             imel_draw_point (dest, x, y, src->pixel[y-sy][x-sx]);
+             imel_pixel_copy (&(dest->pixel[y][x]), src->pixel[y-sy][x-sx]);
+
+ dest->generation++;
 }
 
 /**
@@ -1300,6 +1313,8 @@ ImelImage *imel_image_apply_logic_operation (ImelImage *img1, ImelImage *img2, I
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  l_image->width = img1->width;
  l_image->height = img1->height;
+ l_image->generation = 0;
+ l_image->stats = NULL;
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *));
 
  for ( y = 0; y < l_image->height; y++ ) {
@@ -1345,6 +1360,40 @@ ImelImage *imel_image_apply_logic_operation (ImelImage *img1, ImelImage *img2, I
  return l_image;
 }
 
+#ifndef DOXYGEN_IGNORE_DOC
+
+/* Histogram of @histogram_type from @histograms, in a new array of 256
+ * elements like the one returned by imel_image_get_histogram () */
+static int *__imel_histogram_from_histograms (const ImelHistograms *histograms, ImelHistogram histogram_type)
+{
+ int *histogram;
+ int i;
+
+ histogram = (int *) calloc (256, sizeof (int));
+ return_var_if_fail (histogram, NULL);
+
+ for ( i = 0; i < 256; i++ ) {
+       switch (histogram_type) {
+          case IMEL_HISTOGRAM_RED:
+                 histogram[i] = (int) histograms->red[i];
+                 break;
+          case IMEL_HISTOGRAM_GREEN:
+                 histogram[i] = (int) histograms->green[i];
+                 break;
+          case IMEL_HISTOGRAM_BLUE:
+                 histogram[i] = (int) histograms->blue[i];
+                 break;
+          case IMEL_HISTOGRAM_COMPLETE:
+                 histogram[i] = (int) (histograms->red[i] + histograms->green[i] + histograms->blue[i]);
+                 break;
+       }
+ }
+
+ return histogram;
+}
+
+#endif
+
 /**
  * @brief Get histogram values from an image
  * 
@@ -1360,35 +1409,12 @@ ImelImage *imel_image_apply_logic_operation (ImelImage *img1, ImelImage *img2, I
  */
 int *imel_image_get_histogram (ImelImage *image, ImelHistogram histogram_type)
 {
- int *histogram = NULL;
- ImelSize x, y;
-
- return_var_if_fail (image, NULL);
-
- histogram = (int *) calloc (256, sizeof (int));
+ const ImelImageStats *stats;
 
- for ( x = 0; x < image->width; x++ ) {
-       for ( y = 0; y < image->height; y++ ) {
-             switch (histogram_type) {
-                case IMEL_HISTOGRAM_RED:
-                       histogram[image->pixel[y][x].red]++;
-                       break;
-                case IMEL_HISTOGRAM_GREEN:
-                       histogram[image->pixel[y][x].green]++;
-                       break;
-                case IMEL_HISTOGRAM_BLUE:
-                       histogram[image->pixel[y][x].blue]++;
-                       break;
-                case IMEL_HISTOGRAM_COMPLETE:
-                       histogram[image->pixel[y][x].red]++;
-                       histogram[image->pixel[y][x].green]++;
-                       histogram[image->pixel[y][x].blue]++;
-                       break;
-             }
-       }
- }
+ stats = imel_image_get_stats (image);
+ return_var_if_fail (stats, NULL);
 
- return histogram;
+ return __imel_histogram_from_histograms (&stats->histograms, histogram_type);
 }
 
 /**
@@ -1413,7 +1439,7 @@ int *imel_image_get_histogram (ImelImage *image, ImelHistogram histogram_type)
  */
 ImelImage *imel_image_get_histogram_image (ImelImage *image, int *__histogram, ImelHistogram histogram_type)
 {
- int *histogram = __histogram ? __histogram : imel_image_get_histogram (image, histogram_type);
+ int *histogram;
  ImelSize i = 0, max;
  ImelImage *l_image;
  ImelPixel pxl = {250, 250, 250, 0};
@@ -1421,6 +1447,9 @@ ImelImage *imel_image_get_histogram_image (ImelImage *image, int *__histogram, I
 
  return_var_if_fail (image, NULL);
 
+ histogram = __histogram ? __histogram : imel_image_get_histogram (image, histogram_type);
+ return_var_if_fail (histogram, NULL);
+
  l_image = imel_image_new_with_background_color (263, 152, pxl);
 
  imel_pixel_set (&pxl, 10, 10, 10, 1);
@@ -1474,6 +1503,9 @@ ImelImage *imel_image_get_histogram_image (ImelImage *image, int *__histogram, I
        imel_draw_line (l_image, 4 + i, 141, 4 + i, 150, pxl);
  }
 
+ if ( ! __histogram )
+      free (histogram);
+
  return l_image;
 }
 
@@ -1496,13 +1528,24 @@ ImelImage *imel_image_get_histogram_image (ImelImage *image, int *__histogram, I
 ImelImage *imel_image_get_histograms_image (ImelImage *image, ImelHistogramLayout layout)
 {
  ImelImage *l_image = NULL, *histogram[4];
+ const ImelImageStats *stats;
+ int *values;
+ int i;
 
- return_var_if_fail (image, NULL);
+ stats = imel_image_get_stats (image);
+ return_var_if_fail (stats, NULL);
+
+ for ( i = 0; i < 4; i++ ) {
+       values = __imel_histogram_from_histograms (&stats->histograms, (ImelHistogram) i);
+       histogram[i] = values ? imel_image_get_histogram_image (image, values, (ImelHistogram) i) : NULL;
+       free (values);
 
- histogram[0] = imel_image_get_histogram_image (image, NULL, IMEL_HISTOGRAM_RED);
- histogram[1] = imel_image_get_histogram_image (image, NULL, IMEL_HISTOGRAM_GREEN);
- histogram[2] = imel_image_get_histogram_image (image, NULL, IMEL_HISTOGRAM_BLUE);
- histogram[3] = imel_image_get_histogram_image (image, NULL, IMEL_HISTOGRAM_COMPLETE);
+       if ( ! histogram[i] ) {
+            while ( i-- )
+                    imel_image_free (histogram[i]);
+            return NULL;
+       }
+ }
 
  switch ( layout ) {
    case IMEL_HISTOGRAM_LAYOUT_VERTICAL:
@@ -1566,6 +1609,7 @@ void imel_image_change_level (ImelImage *image, ImelLevelOperation level_operati
                else image->pixel[y][x].level += level;
          }
  }
+ image->generation++;
 }
 
 /**
@@ -1600,6 +1644,7 @@ void imel_image_change_color_level (ImelImage *image, ImelLevelOperation level_o
                }
          }
  }
+ image->generation++;
 }
 
 /**
@@ -1607,6 +1652,13 @@ void imel_image_change_color_level (ImelImage *image, ImelLevelOperation level_o
  * 
  * This function apply a convolution matrix of chosen size to @p image.
  * 
+ * Every pixel is computed from the original image, the matrix wraps around
+ * the image borders. For large matrices (about 15x15 and up, depending on
+ * the image size) the convolution is computed in the frequency domain: the
+ * image is transformed in tiles through a FFT with the overlap-save
+ * method, so the cost doesn't grow anymore with the matrix area, and only
+ * a few bands of rows are kept in memory. The choice is made automatically.
+ * 
  * @param image Image to apply the @p filter
  * @param filter Convolution matrix
  * @param width Width of matrix
@@ -1619,32 +1671,57 @@ void imel_image_change_color_level (ImelImage *image, ImelLevelOperation level_o
 void imel_image_apply_convolution (ImelImage *image, double **filter, int width,
                                    int height, double factor, double bias)
 {
- ImelSize x, y;
- int imgx, imgy, j, k;
- double rgb[3];
+ ImelSize x, y, shift;
+ long int imgy;
+ int j, k;
+ double *acc;
+ ImelImage *source;
+ const __ImelKernels *kernels = __imel_kernels ();
+
+ return_if_fail (image && filter && width > 0 && height > 0);
+
+ if ( __imel_fft_convolution_is_faster (image, width, height) &&
+      __imel_fft_convolution (image, filter, width, height, factor, bias) ) {
+      image->generation++;
+      return;
+ }
+
+ source = imel_image_copy (image);
+ return_if_fail (source);
 
- return_if_fail (image && filter);
+ acc = (double *) malloc (3 * image->width * sizeof (double));
+ if ( !acc ) {
+      imel_image_free (source);
+      return;
+ }
 
+ /* Each tap of the matrix is added to a whole row of sums, the columns
+  * of the matrix are a shift of the source row ( it wraps at the borders ) */
  for ( y = 0; y < image->height; y++ ) {
+       memset (acc, 0, 3 * image->width * sizeof (double));
+
+       for ( j = 0; j < width; j++ ) {
+             shift = (ImelSize) ((((long int) j - width / 2) % (long int) image->width
+                                  + (long int) image->width) % (long int) image->width);
+
+             for ( k = 0; k < height; k++ ) {
+                   imgy = ((long int) y - height / 2 + k) % (long int) image->height;
+                   imgy += ( imgy < 0 ) ? image->height : 0;
+
+                   kernels->convolution_row (acc, source->pixel[imgy], image->width, shift, filter[j][k]);
+             }
+       }
+
        for ( x = 0; x < image->width; x++ ) {
-               memset (rgb, 0, sizeof (double) * 3);
-               
-               for ( j = 0; j < width; j++ ) {
-                     for ( k = 0; k < height; k++ ) {
-                           imgx = (x - width / 2 + j + image->width) % image->width;
-                           imgy = (y - height / 2 + k + image->height) % image->height;
-
-                           rgb[0] += ((double) image->pixel[imgy][imgx].red) * filter[j][k];
-                           rgb[1] += ((double) image->pixel[imgy][imgx].green) * filter[j][k];
-                           rgb[2] += ((double) image->pixel[imgy][imgx].blue) * filter[j][k];
-                     }
-                }
-
-                image->pixel[y][x].red = min (abs ((int) (factor * rgb[0] + bias)), 255);
-                image->pixel[y][x].green = min (abs ((int) (factor * rgb[1] + bias)), 255);
-                image->pixel[y][x].blue = min (abs ((int) (factor * rgb[2] + bias)), 255);
+             image->pixel[y][x].red = min (abs ((int) (factor * acc[x] + bias)), 255);
+             image->pixel[y][x].green = min (abs ((int) (factor * acc[image->width + x] + bias)), 255);
+             image->pixel[y][x].blue = min (abs ((int) (factor * acc[2 * image->width + x] + bias)), 255);
        }
  }
+
+ free (acc);
+ imel_image_free (source);
+ image->generation++;
 }
 
 /**
@@ -1692,7 +1769,7 @@ void __imel_pattern_image_insert (ImelImage *dest, ImelImage *src, ImelSize sx,
     case IMEL_PATTERN_OPERATION_INSERT: 
           for ( y = sy; y < dest->height && y < (src->height + sy); y++ )
                for ( x = sx; x < dest->width && x < (src->width + sx); x++ )
-                     imel_draw_point (dest, x, y, src->pixel[y-sy][x-sx]);
+                     imel_pixel_copy (&(dest->pixel[y][x]), src->pixel[y-sy][x-sx]);
           break;
     case IMEL_PATTERN_OPERATION_SUM:
           for ( y = sy; y < dest->height && y < (src->height + sy); y++ ) {
@@ -1715,6 +1792,7 @@ void __imel_pattern_image_insert (ImelImage *dest, ImelImage *src, ImelSize sx,
           }
           break;
  }
+ dest->generation++;
 }
 
 /**
@@ -1735,62 +1813,32 @@ void __imel_pattern_image_insert (ImelImage *dest, ImelImage *src, ImelSize sx,
 ImelImage *imel_image_union (ImelImage *img1, ImelImage *img2, unsigned char opacity, ImelAlignment alignment)
 {
  ImelImage *image;
- long int x, y, j, k[2], width[2], height[2];
+ ImelSize y, width, height, x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+ const __ImelKernels *kernels = __imel_kernels ();
+
+ return_var_if_fail (img1 && img2, NULL);
 
  image = imel_image_copy (img1);
- 
- width[0] = (long int) img1->width;
- width[1] = (long int) img2->width;
- height[0] = (long int) img1->height;
- height[1] = (long int) img2->height;
- 
- switch (alignment) {
-   case IMEL_ALIGNMENT_TL:
-        for ( y = 0; y < height[0] && y < height[1]; y++ )
-              for ( x = 0; x < width[0] && x < width[1]; x++ )
-                    image->pixel[y][x] = imel_pixel_union (img1->pixel[y][x], img2->pixel[y][x], opacity);
-        break;
-   case IMEL_ALIGNMENT_TR:
-        if ( width[0] <= width[1] ) {
-             j = width[1] - width[0];
-             for ( y = 0; y < height[0] && y < height[1]; y++ )
-                   for ( x = 0; x < width[0] && x < width[1]; x++ )
-                         image->pixel[y][x] = imel_pixel_union (img1->pixel[y][x], img2->pixel[y][j + x], opacity);
-        }
-        else {
-             j = width[0] - width[1];
-             for ( y = 0; y < height[0] && y < height[1]; y++ )
-                   for ( x = 0; x < width[0] && x < width[1]; x++ )
-                         image->pixel[y][j + x] = imel_pixel_union (img1->pixel[y][j + x], img2->pixel[y][x], opacity);
-        }
-        break;
-   case IMEL_ALIGNMENT_BL:
-        if ( height[0] >= height[1] ) {
-             j = height[0] - height[1];
-             for ( y = 0; y < height[0] && y < height[1]; y++ )
-                   for ( x = 0; x < width[0] && x < width[1]; x++ )
-                         image->pixel[j + y][x] = imel_pixel_union (img1->pixel[j + y][x], img2->pixel[y][x], opacity);
-        }
-        else {
-             j = height[1] - height[0];
-             for ( y = 0; y < height[0] && y < height[1]; y++ )
-                   for ( x = 0; x < width[0] && x < width[1]; x++ )
-                         image->pixel[y][x] = imel_pixel_union (img1->pixel[y][x], img2->pixel[j + y][x], opacity);
-        }
-        break;
-   case IMEL_ALIGNMENT_BR:
-        for ( y = height[0] - 1, k[0] = height[1] - 1; y >= 0 && k[0] >= 0; k[0]--, y-- ) {
-              for ( x = width[0] - 1, k[1] = width[1] - 1; x >= 0 && k[1] >= 0; k[1]--, x-- ) {
-                    image->pixel[y][x] = imel_pixel_union (img1->pixel[y][x], img2->pixel[k[0]][k[1]], opacity);
-                    if ( !k[1] || !x )
-                         break;
-              }
-              if ( !k[0] || !y )
-                   break;
-        }
-        break;
+ return_var_if_fail (image, NULL);
+
+ width = min (img1->width, img2->width);
+ height = min (img1->height, img2->height);
+
+ /* Corner of the common area in img1 ( x1, y1 ) and in img2 ( x2, y2 ) */
+ if ( alignment == IMEL_ALIGNMENT_TR || alignment == IMEL_ALIGNMENT_BR ) {
+      x1 = img1->width - width;
+      x2 = img2->width - width;
  }
 
+ if ( alignment == IMEL_ALIGNMENT_BL || alignment == IMEL_ALIGNMENT_BR ) {
+      y1 = img1->height - height;
+      y2 = img2->height - height;
+ }
+
+ for ( y = 0; y < height; y++ )
+       kernels->blend_row (image->pixel[y1 + y] + x1, img1->pixel[y1 + y] + x1,
+                           img2->pixel[y2 + y] + x2, width, opacity);
+
  return image;
 }
 
@@ -1981,6 +2029,8 @@ void imel_image_shift (ImelImage *image, ImelOrientation orientation, long int m
            }
       }
  }
+
+ image->generation++;
 }
 
 /**
@@ -2067,6 +2117,7 @@ bool imel_image_shift_lines (ImelImage *image, ImelOrientation move_type, ImelSi
       }
  }
  
+ image->generation++;
  return true;
 }
 
@@ -2083,34 +2134,13 @@ bool imel_image_shift_lines (ImelImage *image, ImelOrientation move_type, ImelSi
  */
 void imel_image_shift_bpc (ImelImage *image, int bpc_shift_red, int bpc_shift_green, int bpc_shift_blue)
 {
- static bool flag[3];
- ImelSize x, y;
+ ImelPointOp point_op;
  
  return_if_fail (image);
  
- flag[0] = bpc_shift_red < 1;
- flag[1] = bpc_shift_green < 1;
- flag[2] = bpc_shift_blue < 1;
- 
- bpc_shift_red = abs (bpc_shift_red);
- bpc_shift_green = abs (bpc_shift_green);
- bpc_shift_blue = abs (bpc_shift_blue);
- 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             if ( flag[0] )
-                  image->pixel[y][x].red <<= bpc_shift_red;
-             else image->pixel[y][x].red >>= bpc_shift_red;
-             
-             if ( flag[1] )
-                  image->pixel[y][x].green <<= bpc_shift_green;
-             else image->pixel[y][x].green >>= bpc_shift_green;
-             
-             if ( flag[2] )
-                  image->pixel[y][x].blue <<= bpc_shift_blue;
-             else image->pixel[y][x].blue >>= bpc_shift_blue;
-       }
- }
+ imel_point_op_reset (&point_op);
+ imel_point_op_add_shift_bpc (&point_op, bpc_shift_red, bpc_shift_green, bpc_shift_blue);
+ __imel_point_op_apply (image, &point_op);
 }
 
 /**
@@ -2141,118 +2171,225 @@ void imel_image_shift_bpc (ImelImage *image, int bpc_shift_red, int bpc_shift_gr
  */ 
 void imel_image_remove_noise (ImelImage *image, ImelSize size_q, ImelMask mask, ImelColor tollerance)
 {
- long int y, x, j, k, q = size_q >> 1, z;
- int32_t m[4];
- 
  return_if_fail (image && size_q);
- 
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = z = 0; x < image->width; x++, z = 0 ) {
-             memset (m, 0, sizeof (long int) * 3);
-             
-             for ( j = y - q; j <= (y + q); j++ ) {
-                   for ( k = x - q; k <= (x + q); k++ ) {
-                         if ( (k > -1 && k < image->width) && (j > -1 && j < image->height) ) {
-                              m[0] += (int32_t) image->pixel[j][k].red;
-                              m[1] += (int32_t) image->pixel[j][k].green;
-                              m[2] += (int32_t) image->pixel[j][k].blue;
-                              
-                              if ( image->pixel[j][k].level > -1 )
-                                   m[3] += 0xff + image->pixel[j][k].level;
-                              else m[3] += image->pixel[j][k].level;
-                              
-                              z++;
-                         }
-                   }
+
+ __imel_mask_remove_noise (image, size_q, mask, tollerance);
+}
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+/* Bytes for the column histograms of all the bands, wider images are
+ * filtered in fewer bands */
+#define __IMEL_MEDIAN_MEMORY (64L << 20)
+
+/* Histogram with 16 coarse bins over the 256 fine ones: the median is
+ * found by scanning at most 16 + 16 bins. */
+typedef struct ___imel_median_histogram {
+               uint32_t coarse[16];
+               uint32_t fine[256];
+        } __ImelMedianHistogram;
+
+typedef struct ___imel_median {
+               ImelImage *image;
+               ImelImage *source;
+               long int radius;
+               ImelMask mask;
+               ImelColor tollerance;
+               int channels[3];
+               int n_channels;
+               __ImelMedianHistogram *columns;  /* Column histograms of each band */
+        } __ImelMedian;
+
+static ImelColor __imel_median_channel (const ImelPixel *p, int channel)
+{
+ return ( channel == 0 ) ? p->red : ( channel == 1 ) ? p->green : p->blue;
+}
+
+static void __imel_median_column_row (__ImelMedianHistogram *columns, ImelPixel *row,
+                                      ImelSize width, const int *channels, int n_channels, int sign)
+{
+ ImelSize x;
+ ImelColor v;
+ int c;
+
+ for ( x = 0; x < width; x++ ) {
+       for ( c = 0; c < n_channels; c++ ) {
+             v = __imel_median_channel (&row[x], channels[c]);
+             columns[x * n_channels + c].fine[v] += sign;
+             columns[x * n_channels + c].coarse[v >> 4] += sign;
+       }
+ }
+}
+
+static void __imel_median_add (__ImelMedianHistogram *kernel, const __ImelMedianHistogram *column, int sign)
+{
+ int i;
+
+ for ( i = 0; i < 256; i++ )
+       kernel->fine[i] += sign * column->fine[i];
+ for ( i = 0; i < 16; i++ )
+       kernel->coarse[i] += sign * column->coarse[i];
+}
+
+static ImelColor __imel_median_find (const __ImelMedianHistogram *kernel, uint32_t rank)
+{
+ int c, i;
+
+ for ( c = 0; c < 15 && kernel->coarse[c] <= rank; c++ )
+       rank -= kernel->coarse[c];
+
+ for ( i = c << 4; i < (c << 4) + 15 && kernel->fine[i] <= rank; i++ )
+       rank -= kernel->fine[i];
+
+ return i;
+}
+
+/* Perreault - Hebert median on the rows [start, end): a histogram for each
+ * column holds the pixels of the window rows, the kernel histogram is moved
+ * along the row adding the entering column and removing the leaving one,
+ * so every step costs the same for any window size. */
+static void __imel_median_rows (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelMedian *median = (__ImelMedian *) data;
+ ImelImage *source = median->source, *image = median->image;
+ long int r = median->radius, y, x, rows, cols;
+ __ImelMedianHistogram *columns, kernel[3];
+ const int *channels = median->channels;
+ int n_channels = median->n_channels, c;
+ ImelColor m[3];
+ ImelPixel *p;
+ bool changed;
+
+ columns = &median->columns[band * source->width * n_channels];
+ memset (columns, 0, source->width * n_channels * sizeof (__ImelMedianHistogram));
+
+ for ( y = (long int) start - r; y < (long int) start + r; y++ ) {
+       if ( y > -1 && y < source->height )
+            __imel_median_column_row (columns, source->pixel[y], source->width, channels, n_channels, 1);
+ }
+
+ for ( y = start; y < end; y++ ) {
+       if ( y + r < source->height )
+            __imel_median_column_row (columns, source->pixel[y + r], source->width, channels, n_channels, 1);
+       if ( y > (long int) start && y - r - 1 > -1 )
+            __imel_median_column_row (columns, source->pixel[y - r - 1], source->width, channels, n_channels, -1);
+
+       rows = min (y + r, (long int) source->height - 1) - max (y - r, 0) + 1;
+
+       memset (kernel, 0, sizeof (kernel));
+       for ( x = 0; x < r && x < source->width; x++ ) {
+             for ( c = 0; c < n_channels; c++ )
+                   __imel_median_add (&kernel[c], &columns[x * n_channels + c], 1);
+       }
+
+       for ( x = 0; x < source->width; x++ ) {
+             for ( c = 0; c < n_channels; c++ ) {
+                   if ( x + r < source->width )
+                        __imel_median_add (&kernel[c], &columns[(x + r) * n_channels + c], 1);
+                   if ( x - r - 1 > -1 )
+                        __imel_median_add (&kernel[c], &columns[(x - r - 1) * n_channels + c], -1);
+             }
+
+             cols = min (x + r, (long int) source->width - 1) - max (x - r, 0) + 1;
+             p = &source->pixel[y][x];
+             changed = false;
+
+             for ( c = 0; c < n_channels; c++ ) {
+                   m[c] = __imel_median_find (&kernel[c], (rows * cols) / 2);
+                   if ( ! imel_pixel_compare_level (m[c], __imel_median_channel (p, channels[c]),
+                                                    median->tollerance) )
+                        changed = true;
+             }
+
+             if ( ! changed )
+                  continue;
+
+             for ( c = 0; c < n_channels; c++ ) {
+                   if ( channels[c] == 0 )
+                        image->pixel[y][x].red = m[c];
+                   else if ( channels[c] == 1 )
+                        image->pixel[y][x].green = m[c];
+                   else image->pixel[y][x].blue = m[c];
              }
-             
-             m[0] /= z ? z : 1;
-             m[1] /= z ? z : 1;
-             m[2] /= z ? z : 1;
-             m[3] /= z ? z : 1;
-             
-             switch ( mask ) {
-              case IMEL_MASK_RED:
-                    if ( !imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance) )
-                         imel_pixel_set (&(image->pixel[y][x]), m[0], image->pixel[y][x].green,
-                                         image->pixel[y][x].blue, image->pixel[y][x].level);
-                    break;
-              case IMEL_MASK_GREEN:
-                    if ( !imel_pixel_compare_level (m[1], (ImelLevel) image->pixel[y][x].green, tollerance) )  
-                         imel_pixel_set (&(image->pixel[y][x]), image->pixel[y][x].red, m[1], 
-                                         image->pixel[y][x].blue, image->pixel[y][x].level);
-                    break;
-              case IMEL_MASK_BLUE:
-                    if ( !imel_pixel_compare_level (m[2], (ImelLevel) image->pixel[y][x].blue, tollerance) ) 
-                         imel_pixel_set (&(image->pixel[y][x]), image->pixel[y][x].red, 
-                                         image->pixel[y][x].green, m[2], image->pixel[y][x].level);
-                    break;
-              case IMEL_MASK_LEVEL:
-                    if ( !imel_pixel_compare_level (m[3], image->pixel[y][x].level, tollerance) )
-                         imel_pixel_set (&(image->pixel[y][x]), image->pixel[y][x].red,
-                                         image->pixel[y][x].green, image->pixel[y][x].blue, m[3]);
-                    break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN:
-                    if ( !(imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance)
-                        && imel_pixel_compare_level (m[1], (ImelLevel) image->pixel[y][x].green, tollerance)) )
-                         imel_pixel_set (&(image->pixel[y][x]), m[0], m[1], image->pixel[y][x].blue,
-                                         image->pixel[y][x].level);
-                    break;
-              case IMEL_MASK_RED | IMEL_MASK_LEVEL:
-                    if ( !(imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance) 
-                        && imel_pixel_compare_level (m[3], image->pixel[y][x].level, tollerance)) ) 
-                         imel_pixel_set (&(image->pixel[y][x]), m[0], image->pixel[y][x].green,  
-                                         image->pixel[y][x].blue, m[3]);
-                    break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_LEVEL:
-                    if ( !(imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance)
-                        && imel_pixel_compare_level (m[1], (ImelLevel) image->pixel[y][x].green, tollerance)
-                        && imel_pixel_compare_level (m[3], image->pixel[y][x].level, tollerance)) ) 
-                         imel_pixel_set (&(image->pixel[y][x]), m[0], m[1], image->pixel[y][x].blue, m[3]);
-                    break;
-              case IMEL_MASK_RED | IMEL_MASK_BLUE:
-                    if ( !(imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance) 
-                        && imel_pixel_compare_level (m[2], (ImelLevel) image->pixel[y][x].blue, tollerance)) ) 
-                         imel_pixel_set (&(image->pixel[y][x]), m[0], image->pixel[y][x].green,
-                                         m[2], image->pixel[y][x].level);
-                    break;
-              case IMEL_MASK_RED | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                    if ( !(imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance)
-                        && imel_pixel_compare_level (m[2], (ImelLevel) image->pixel[y][x].blue, tollerance)
-                        && imel_pixel_compare_level (m[3], image->pixel[y][x].level, tollerance)) ) 
-                         imel_pixel_set (&(image->pixel[y][x]), m[0], image->pixel[y][x].green, m[2], m[3]);
-                    break;
-              case IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                    if ( !(imel_pixel_compare_level (m[1], (ImelLevel) image->pixel[y][x].green, tollerance)
-                        && imel_pixel_compare_level (m[2], (ImelLevel) image->pixel[y][x].blue, tollerance)) )
-                         imel_pixel_set (&(image->pixel[y][x]), image->pixel[y][x].red, m[1], m[2],
-                                         image->pixel[y][x].level);
-                    break;
-              case IMEL_MASK_GREEN | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                    if ( !(imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance)
-                        && imel_pixel_compare_level (m[1], (ImelLevel) image->pixel[y][x].green, tollerance)
-                        && imel_pixel_compare_level (m[3], image->pixel[y][x].level, tollerance)) ) 
-                         imel_pixel_set (&(image->pixel[y][x]), image->pixel[y][x].red, m[1], m[2], 
-                                         image->pixel[y][x].level);
-                    break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                    if ( !(imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance)
-                        && imel_pixel_compare_level (m[1], (ImelLevel) image->pixel[y][x].green, tollerance)
-                        && imel_pixel_compare_level (m[2], (ImelLevel) image->pixel[y][x].blue, tollerance)) ) 
-                         imel_pixel_set (&(image->pixel[y][x]), m[0], m[1], m[2], image->pixel[y][x].level);
-                    break;
-              case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                    if ( !(imel_pixel_compare_level (m[0], (ImelLevel) image->pixel[y][x].red, tollerance)
-                        && imel_pixel_compare_level (m[1], (ImelLevel) image->pixel[y][x].green, tollerance)
-                        && imel_pixel_compare_level (m[2], (ImelLevel) image->pixel[y][x].blue, tollerance)
-                        && imel_pixel_compare_level (m[3], image->pixel[y][x].level, tollerance)) ) 
-                         imel_pixel_set (&(image->pixel[y][x]), m[0], m[1], m[2], m[3]);
-                    break;                
-            }
        }
  }
 }
 
+#endif
+
+/**
+ * @brief Remove noise from an image with a median filter
+ * 
+ * This function works like #imel_image_remove_noise, but the value compared with
+ * each pixel is the median of the square around it instead of the average. The
+ * median removes salt and pepper noise without smearing edges.
+ * The time needed for each pixel doesn't depend on @p size_q. Each thread keeps
+ * about 1 KB for each column and channel filtered, wide images use fewer threads
+ * to stay within 64 MB.
+ * 
+ * @code
+ * ImelImage *image = imel_image_new_from ("apply_noise.jpg", 0, NULL);
+ * ImelMask mask = IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE;
+ * 
+ * imel_image_remove_noise_median (image, 5, mask, 24);
+ * @endcode
+ * 
+ * @param image Image with noise
+ * @param size_q Size of the square side where the current pixel are.
+ * @param mask Channels affected from noise.
+ * @param tollerance Tollerance when compare current pixel with the median of others.
+ * 
+ * @note IMEL_MASK_LEVEL is ignored, levels are never changed.
+ * @see imel_image_remove_noise
+ * @see imel_thread_set_count
+ */ 
+void imel_image_remove_noise_median (ImelImage *image, ImelSize size_q, ImelMask mask, ImelColor tollerance)
+{
+ __ImelMedian median;
+ ImelSize bands, size;
+
+ return_if_fail (image && size_q);
+
+ median.n_channels = 0;
+ if ( mask & IMEL_MASK_RED )
+      median.channels[median.n_channels++] = 0;
+ if ( mask & IMEL_MASK_GREEN )
+      median.channels[median.n_channels++] = 1;
+ if ( mask & IMEL_MASK_BLUE )
+      median.channels[median.n_channels++] = 2;
+
+ if ( ! median.n_channels )
+      return;
+
+ /* The histograms of every band are allocated before starting, so the
+  * whole image is filtered or nothing. The bands are as many as fit in
+  * __IMEL_MEDIAN_MEMORY, at least one. */
+ size = image->width * median.n_channels * sizeof (__ImelMedianHistogram);
+ bands = __imel_thread_bands (image->height, 16);
+ if ( bands > 1 && bands * size > __IMEL_MEDIAN_MEMORY )
+      bands = ( __IMEL_MEDIAN_MEMORY / size > 1 ) ? __IMEL_MEDIAN_MEMORY / size : 1;
+
+ median.columns = (__ImelMedianHistogram *) malloc (bands * size);
+ return_if_fail (median.columns);
+
+ median.source = imel_image_copy (image);
+ if ( ! median.source ) {
+      free (median.columns);
+      return;
+ }
+
+ median.image = image;
+ median.radius = size_q >> 1;
+ median.mask = mask;
+ median.tollerance = tollerance;
+
+ __imel_thread_run_bands (image->height, bands, __imel_median_rows, &median);
+ image->generation++;
+
+ imel_image_free (median.source);
+ free (median.columns);
+}
+
 /**
  * @brief Apply a noise to an image
  * 
@@ -2285,10 +2422,6 @@ void imel_image_remove_noise (ImelImage *image, ImelSize size_q, ImelMask mask,
 void imel_image_apply_noise (ImelImage *image, ImelColor noise_range, ImelSize noise_quantity, 
                              ImelMask mask, ImelNoiseOperation operation, bool nepc)
 {
- ImelSize x, y;
- ImelSize noise_value, noise_to_color;
- ImelNoiseOperation __operation;
- 
  if ( !ImelRandom ) {
       srand (time (NULL));
       ImelRandom = 1;
@@ -2296,762 +2429,5 @@ void imel_image_apply_noise (ImelImage *image, ImelColor noise_range, ImelSize n
  
  return_if_fail (image && noise_quantity > 0 && noise_range > 0);
  
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             if ( operation == IMEL_NOISE_OPERATION_RANDOM )
-                  __operation = rand () % 4;
-             else __operation = operation;
-             
-             if ( nepc ) {
-                  noise_value = rand () % noise_range;
-                  
-                  if ( (rand () % noise_quantity) )
-                       continue;
-                       
-                  switch ( mask ) {
-                    case IMEL_MASK_RED:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                           + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                           - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                           * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].red = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_GREEN:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                           + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                           - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                           * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_BLUE:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].blue = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                           + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].blue = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                           - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].blue = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                           * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].blue = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_LEVEL:                               
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_GREEN:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_BLUE:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_GREEN | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) noise_value), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) noise_value), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    break;                
-            }
-       }
-       else {                  
-             if ( (rand () % noise_quantity) )
-                  continue;
-                  
-             switch ( mask ) {
-                    case IMEL_MASK_RED:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                           + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                           - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                           * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].red = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_GREEN:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                           + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                           - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                           * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_BLUE:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].blue = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                           + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].blue = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                           - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].blue = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                           * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].blue = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_LEVEL:                               
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_GREEN:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_BLUE:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_GREEN | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    case IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE | IMEL_MASK_LEVEL:
-                          switch ( __operation ) {
-                             case IMEL_NOISE_OPERATION_SUM:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             + ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_SUBTRACT:
-                                   image->pixel[y][x].red   = (ImelColor) max (((int32_t) image->pixel[y][x].red) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].green = (ImelColor) max (((int32_t) image->pixel[y][x].green) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].blue  = (ImelColor) max (((int32_t) image->pixel[y][x].blue) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   image->pixel[y][x].level = (ImelLevel) max (((int32_t) image->pixel[y][x].level) 
-                                                                             - ((int32_t) (rand () % noise_range)), 0);
-                                   break;
-                             case IMEL_NOISE_OPERATION_MULTIPLY:
-                                   image->pixel[y][x].red   = (ImelColor) min (((int32_t) image->pixel[y][x].red) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].green = (ImelColor) min (((int32_t) image->pixel[y][x].green) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].blue  = (ImelColor) min (((int32_t) image->pixel[y][x].blue) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   image->pixel[y][x].level = (ImelLevel) min (((int32_t) image->pixel[y][x].level) 
-                                                                             * ((int32_t) (rand () % noise_range)), 255);
-                                   break;
-                             case IMEL_NOISE_OPERATION_DIVIDE:
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].red   = image->pixel[y][x].red / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].green = image->pixel[y][x].green / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].blue  = image->pixel[y][x].blue / (noise_value ? noise_value : 1);
-                                   noise_value = rand () % noise_range;
-                                   image->pixel[y][x].level = image->pixel[y][x].level / (noise_value ? noise_value : 1);
-                                   break;
-                          }
-                          break;
-                    break;                
-            }
-       }
-    }
- } 
+ __imel_mask_apply_noise (image, noise_range, noise_quantity, mask, operation, nepc);
 }
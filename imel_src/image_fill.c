@@ -18,137 +18,163 @@
 */
 
 
+#include <stdlib.h>
 #include "header.h"
 /**
  * @file image_fill.c
  * @author Davide Francesco Merico
  * @brief This file contains functions to fill areas of an image
+ *
+ * An area is filled a row at a time: the row of a seed is extended to the
+ * left and to the right while the pixels match, then a seed is kept for
+ * each run of matching pixels in the rows above and below. The seeds wait
+ * in a stack in memory and a bitmap marks the filled pixels, so each
+ * pixel is tested a few times and the order is always the same.
  */
  
 #ifndef DOXYGEN_IGNORE_DOC
 
-extern void         imel_draw_point                           (ImelImage *, ImelSize, ImelSize, ImelPixel);
-extern ImelPoint   *imel_point_new                            (ImelImage *image, ImelSize x, ImelSize y, ImelPixel pixel);
 extern bool         imel_pixel_compare                        (ImelPixel a, ImelPixel b, ImelSize tollerance);
 extern bool         imel_pixel_compare_level                  (ImelLevel a, ImelLevel b, ImelSize tollerance);
-extern ImelPixel    imel_pixel_new                            (ImelColor red, ImelColor green, ImelColor blue, 
-                                                               ImelLevel level);
+extern void         imel_pixel_copy                           (ImelPixel *, ImelPixel);
 
-#endif
+typedef struct ___imel_fill_seed {
+               ImelSize x;
+               ImelSize y;
+        } __ImelFillSeed;
 
-static void         __fill_north                              (ImelImage *image, ImelPoint *position, ImelPixel target_color, 
-                                                               ImelSize tollerance, ImelRef reference);
-static void         __fill_south                              (ImelImage *image, ImelPoint *position, ImelPixel target_color, 
-                                                               ImelSize tollerance, ImelRef reference);
-static void         __fill_west                               (ImelImage *image, ImelPoint *position, ImelPixel target_color, 
-                                                               ImelSize tollerance, ImelRef reference);
-static void         __fill_east                               (ImelImage *image, ImelPoint *position, ImelPixel target_color, 
-                                                               ImelSize tollerance, ImelRef reference);
-
-static void __fill_north (ImelImage *image, ImelPoint *position, ImelPixel target_color, 
-                          ImelSize tollerance, ImelRef reference)
-{ 
- ImelPoint __pvt_pos = { position->x, position->y, position->pixel };
- 
- if ( !position->y ) 
-      return;
+typedef struct ___imel_fill {
+               ImelImage *image;
+               ImelPixel target;    /* Pixel where the fill started */
+               ImelPixel pixel;     /* New color or level */
+               ImelSize tollerance;
+               ImelRef match;       /* What is compared with target */
+               ImelRef write;       /* What is taken from pixel */
+               uint8_t *filled;     /* A bit for each pixel */
+               __ImelFillSeed *seed;
+               size_t n_seeds;
+               size_t size;
+        } __ImelFill;
 
- __pvt_pos.y--;
- 
- if ( (reference == IMEL_REF_COLOR && !imel_pixel_compare (image->pixel[__pvt_pos.y][__pvt_pos.x], target_color, tollerance))
-   || (reference == IMEL_REF_LEVEL && !imel_pixel_compare_level (image->pixel[__pvt_pos.y][__pvt_pos.x].level, 
-                                                                 target_color.level, tollerance)) ) {
-      return;
+#define __IMEL_FILL_INDEX(fill, x, y) ((size_t) (y) * (fill)->image->width + (x))
+#define __IMEL_FILL_IS_FILLED(fill, i) ((fill)->filled[(i) >> 3] & (1 << ((i) & 7)))
+
+/* TRUE if the pixel isn't filled yet and matches the start one */
+static bool __imel_fill_match (__ImelFill *fill, ImelSize x, ImelSize y)
+{
+ size_t i = __IMEL_FILL_INDEX (fill, x, y);
+
+ if ( __IMEL_FILL_IS_FILLED (fill, i) )
+      return false;
+
+ if ( fill->match == IMEL_REF_LEVEL )
+      return imel_pixel_compare_level (fill->image->pixel[y][x].level, fill->target.level, fill->tollerance);
+
+ return imel_pixel_compare (fill->image->pixel[y][x], fill->target, fill->tollerance);
+}
+
+static bool __imel_fill_push (__ImelFill *fill, ImelSize x, ImelSize y)
+{
+ __ImelFillSeed *seed;
+
+ if ( fill->n_seeds == fill->size ) {
+      seed = (__ImelFillSeed *) realloc (fill->seed, sizeof (__ImelFillSeed) * (fill->size << 1));
+      return_var_if_fail (seed, false);
+
+      fill->seed = seed;
+      fill->size <<= 1;
  }
 
- if ( reference == IMEL_REF_LEVEL )
-      image->pixel[__pvt_pos.y][__pvt_pos.x].level = position->pixel.level;
- else imel_draw_point (image,__pvt_pos.x, __pvt_pos.y, position->pixel);
- 
- __fill_north (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_west (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_east (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_south (image, &__pvt_pos, target_color, tollerance, reference);
+ fill->seed[fill->n_seeds].x = x;
+ fill->seed[fill->n_seeds++].y = y;
+
+ return true;
 }
 
-static void __fill_south (ImelImage *image, ImelPoint *position, ImelPixel target_color, 
-                          ImelSize tollerance, ImelRef reference)
+/* Keep a seed for each run of matching pixels in [x0, x1] of the row @y */
+static bool __imel_fill_scan (__ImelFill *fill, ImelSize x0, ImelSize x1, ImelSize y)
 {
- ImelPoint __pvt_pos = { position->x, position->y, position->pixel };
- 
- if ( position->y >= (image->height - 1) ) 
-      return;
+ bool inside = false, match;
+ ImelSize x;
 
- __pvt_pos.y++;
- 
- if ( (reference == IMEL_REF_COLOR && !imel_pixel_compare (image->pixel[__pvt_pos.y][__pvt_pos.x], target_color, tollerance))
-   || (reference == IMEL_REF_LEVEL && !imel_pixel_compare_level (image->pixel[__pvt_pos.y][__pvt_pos.x].level, 
-                                                                 target_color.level, tollerance)) ) {
-      return;
+ for ( x = x0; x <= x1; x++ ) {
+       match = __imel_fill_match (fill, x, y);
+       if ( match && ! inside && ! __imel_fill_push (fill, x, y) )
+            return false;
+       inside = match;
  }
- 
- if ( reference == IMEL_REF_LEVEL )
-      image->pixel[__pvt_pos.y][__pvt_pos.x].level = position->pixel.level;
- else imel_draw_point (image,__pvt_pos.x, __pvt_pos.y, position->pixel);
-                     
- __fill_south (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_west (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_east (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_north (image, &__pvt_pos, target_color, tollerance, reference);
+
+ return true;
 }
 
-static void __fill_west (ImelImage *image, ImelPoint *position, ImelPixel target_color, 
-                         ImelSize tollerance, ImelRef reference)
+/* Fill the pixels in [x0, x1] of the row @y and mark them */
+static void __imel_fill_span (__ImelFill *fill, ImelSize x0, ImelSize x1, ImelSize y)
 {
- ImelPoint __pvt_pos = { position->x, position->y, position->pixel };
- 
- if ( !position->x ) 
-      return;
+ ImelPixel *row = fill->image->pixel[y];
+ size_t i = __IMEL_FILL_INDEX (fill, x0, y);
+ ImelSize x;
 
- __pvt_pos.x--;
- 
- if ( (reference == IMEL_REF_COLOR && !imel_pixel_compare (image->pixel[__pvt_pos.y][__pvt_pos.x], target_color, tollerance))
-   || (reference == IMEL_REF_LEVEL && !imel_pixel_compare_level (image->pixel[__pvt_pos.y][__pvt_pos.x].level, 
-                                                                 target_color.level, tollerance)) ) {
-      return;
+ for ( x = x0; x <= x1; x++, i++ ) {
+       fill->filled[i >> 3] |= 1 << (i & 7);
+
+       if ( fill->write == IMEL_REF_LEVEL )
+            row[x].level = fill->pixel.level;
+       else imel_pixel_copy (&(row[x]), fill->pixel);
  }
- 
- if ( reference == IMEL_REF_LEVEL )
-      image->pixel[__pvt_pos.y][__pvt_pos.x].level = position->pixel.level;
- else imel_draw_point (image,__pvt_pos.x, __pvt_pos.y, position->pixel);
- 
- __fill_west (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_south (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_north (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_east (image, &__pvt_pos, target_color, tollerance, reference);
 }
 
-static void __fill_east (ImelImage *image, ImelPoint *position, ImelPixel target_color, 
-                         ImelSize tollerance, ImelRef reference)
+/* Fill the area around @point of pixels like it by @match with the
+ * @write part of @point->pixel */
+static void __imel_fill (ImelImage *image, ImelPoint *point, ImelSize tollerance, ImelRef match, ImelRef write)
 {
- ImelPoint __pvt_pos = { position->x, position->y, position->pixel };
- 
- if ( position->x >= (image->width - 1) ) 
-      return;
+ __ImelFill fill;
+ ImelSize x0, x1, y;
 
- __pvt_pos.x++;
- 
- if ( (reference == IMEL_REF_COLOR && !imel_pixel_compare (image->pixel[__pvt_pos.y][__pvt_pos.x], target_color, tollerance))
-   || (reference == IMEL_REF_LEVEL && !imel_pixel_compare_level (image->pixel[__pvt_pos.y][__pvt_pos.x].level, 
-                                                                 target_color.level, tollerance)) ) {
+ fill.image = image;
+ fill.target = image->pixel[point->y][point->x];
+ fill.pixel = point->pixel;
+ fill.tollerance = tollerance;
+ fill.match = match;
+ fill.write = write;
+ fill.n_seeds = 0;
+ fill.size = 64;
+ fill.filled = (uint8_t *) calloc (((size_t) image->width * image->height + 7) >> 3, 1);
+ fill.seed = (__ImelFillSeed *) malloc (sizeof (__ImelFillSeed) * fill.size);
+
+ if ( ! fill.filled || ! fill.seed ) {
+      free (fill.filled);
+      free (fill.seed);
       return;
  }
- 
- if ( reference == IMEL_REF_LEVEL )
-      image->pixel[__pvt_pos.y][__pvt_pos.x].level = position->pixel.level;
- else imel_draw_point (image,__pvt_pos.x, __pvt_pos.y, position->pixel);
-                     
- __fill_east (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_north (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_south (image, &__pvt_pos, target_color, tollerance, reference);
- __fill_west (image, &__pvt_pos, target_color, tollerance, reference);
+
+ __imel_fill_push (&fill, point->x, point->y);
+ while ( fill.n_seeds ) {
+         fill.n_seeds--;
+         x0 = x1 = fill.seed[fill.n_seeds].x;
+         y = fill.seed[fill.n_seeds].y;
+
+         if ( ! __imel_fill_match (&fill, x0, y) )
+              continue;
+
+         while ( x0 > 0 && __imel_fill_match (&fill, x0 - 1, y) )
+                 x0--;
+         while ( x1 < image->width - 1 && __imel_fill_match (&fill, x1 + 1, y) )
+                 x1++;
+
+         __imel_fill_span (&fill, x0, x1, y);
+
+         if ( (y + 1 < image->height && ! __imel_fill_scan (&fill, x0, x1, y + 1))
+           || (y > 0 && ! __imel_fill_scan (&fill, x0, x1, y - 1)) )
+              break;
+ }
+
+ free (fill.filled);
+ free (fill.seed);
+ image->generation++;
 }
 
+#endif
+
 /**
  * @brief Fill a specified color area with another color
  * 
@@ -162,22 +188,12 @@ static void __fill_east (ImelImage *image, ImelPoint *position, ImelPixel target
  */ 
 void imel_image_fill_color_with_color (ImelImage *image, ImelPoint *point, ImelSize tollerance)
 {
- ImelPixel _static_color;
-
  return_if_fail (image && point);
  
  if ( !(point->y < image->height && point->x < image->width) )
       return;
-      
- _static_color = imel_pixel_new (image->pixel[point->y][point->x].red,
-                                 image->pixel[point->y][point->x].green,
-                                 image->pixel[point->y][point->x].blue,
-                                 image->pixel[point->y][point->x].level);
-                                 
- __fill_north (image, point, _static_color, tollerance, IMEL_REF_COLOR);
- __fill_south (image, point, _static_color, tollerance, IMEL_REF_COLOR);
- __fill_west (image, point, _static_color, tollerance, IMEL_REF_COLOR);
- __fill_east (image, point, _static_color, tollerance, IMEL_REF_COLOR);
+
+ __imel_fill (image, point, tollerance, IMEL_REF_COLOR, IMEL_REF_COLOR);
 }
 
 /**
@@ -193,22 +209,12 @@ void imel_image_fill_color_with_color (ImelImage *image, ImelPoint *point, ImelS
  */ 
 void imel_image_fill_level_with_color (ImelImage *image, ImelPoint *point, ImelSize tollerance)
 {
- ImelPixel _static_color;
- 
  return_if_fail (image && point);
  
  if ( !(point->y < image->height && point->x < image->width) )
       return;
- 
- _static_color = imel_pixel_new (image->pixel[point->y][point->x].red,
-                                 image->pixel[point->y][point->x].green,
-                                 image->pixel[point->y][point->x].blue,
-                                 image->pixel[point->y][point->x].level);
-                                 
- __fill_north (image, point, _static_color, tollerance, IMEL_REF_COLOR);
- __fill_south (image, point, _static_color, tollerance, IMEL_REF_COLOR);
- __fill_west (image, point, _static_color, tollerance, IMEL_REF_COLOR);
- __fill_east (image, point, _static_color, tollerance, IMEL_REF_COLOR);
+
+ __imel_fill (image, point, tollerance, IMEL_REF_LEVEL, IMEL_REF_COLOR);
 }
 
 /**
@@ -224,23 +230,12 @@ void imel_image_fill_level_with_color (ImelImage *image, ImelPoint *point, ImelS
  */ 
 void imel_image_fill_color_with_level (ImelImage *image, ImelPoint *point, ImelSize tollerance)
 {
- ImelPixel _static_color;
- 
  return_if_fail (image && point);
  
  if ( !(point->y < image->height && point->x < image->width) )
       return;
- 
- _static_color = imel_pixel_new (image->pixel[point->y][point->x].red,
-                                 image->pixel[point->y][point->x].green,
-                                 image->pixel[point->y][point->x].blue,
-                                 image->pixel[point->y][point->x].level);
- 
- __fill_north (image, point, _static_color, tollerance, IMEL_REF_LEVEL);
- __fill_south (image, point, _static_color, tollerance, IMEL_REF_LEVEL);
- __fill_west (image, point, _static_color, tollerance, IMEL_REF_LEVEL);
- __fill_east (image, point, _static_color, tollerance, IMEL_REF_LEVEL);
 
+ __imel_fill (image, point, tollerance, IMEL_REF_COLOR, IMEL_REF_LEVEL);
 }
 
 /**
@@ -256,21 +251,10 @@ void imel_image_fill_color_with_level (ImelImage *image, ImelPoint *point, ImelS
  */ 
 void imel_image_fill_level_with_level (ImelImage *image, ImelPoint *point, ImelSize tollerance)
 {
- ImelPixel _static_color;
- 
  return_if_fail (image && point);
  
  if ( !(point->y < image->height && point->x < image->width) )
       return;
- 
- _static_color = imel_pixel_new (image->pixel[point->y][point->x].red,
-                                 image->pixel[point->y][point->x].green,
-                                 image->pixel[point->y][point->x].blue,
-                                 image->pixel[point->y][point->x].level);
-                                 
-
- __fill_north (image, point, _static_color, tollerance, IMEL_REF_LEVEL);
- __fill_south (image, point, _static_color, tollerance, IMEL_REF_LEVEL);
- __fill_west (image, point, _static_color, tollerance, IMEL_REF_LEVEL);
- __fill_east (image, point, _static_color, tollerance, IMEL_REF_LEVEL);
+
+ __imel_fill (image, point, tollerance, IMEL_REF_LEVEL, IMEL_REF_LEVEL);
 }
@@ -148,6 +148,8 @@ ImelImage *imel_image_new_from_imel (const char *filename, ImelError *error)
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  fread (&(l_image->width), sizeof (ImelSize), 1, of);
  fread (&(l_image->height), sizeof (ImelSize), 1, of);
+ l_image->generation = 0;
+ l_image->stats = NULL;
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *)
                                          + __memory_buffer);
  for ( y = 0; y < l_image->height; y++ ) {
@@ -190,6 +192,8 @@ ImelImage *imel_image_new_from_imel_handle (FILE *of, ImelError *error)
  l_image = (ImelImage *) malloc (sizeof (ImelImage));
  fread (&(l_image->width), sizeof (ImelSize), 1, of);
  fread (&(l_image->height), sizeof (ImelSize), 1, of);
+ l_image->generation = 0;
+ l_image->stats = NULL;
  l_image->pixel = (ImelPixel **) malloc (l_image->height * sizeof (ImelPixel *)
                                          + __memory_buffer);
  for ( y = 0; y < l_image->height; y++ ) {
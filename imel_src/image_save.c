@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <math.h>
 #include "header.h"
+#include "kernel.h"
 
 /**
  * @file image_save.c
@@ -37,7 +38,6 @@
 #ifndef DOXYGEN_IGNORE_DOC
 
 extern ImelColor *imel_color_get_from_pixel (ImelPixel pixel);
-extern uint32_t imel_pixel_get_rgba (ImelPixel pxl);
 
 #endif
 
@@ -48,8 +48,9 @@ static bool imel_image_save_core (ImelImage *image, FREE_IMAGE_FORMAT format, in
  ImelSize x, y;
  RGBQUAD dst_pixel;
  BYTE dst_byte;
- uint32_t rgba;
+ uint32_t rgba, *row;
  va_list list;
+ const __ImelKernels *kernels = __imel_kernels ();
  FreeImageIO io = { NULL, (FI_WriteProc) fwrite, (FI_SeekProc) fseek, (FI_TellProc) ftell };
  
  return_var_if_fail (image, false);
@@ -66,9 +67,24 @@ static bool imel_image_save_core (ImelImage *image, FREE_IMAGE_FORMAT format, in
       return false;
  }
  
+ row = (uint32_t *) malloc (image->width * sizeof (uint32_t) + __memory_buffer);
+ if ( !row ) {
+      imel_printf_debug ("imel_image_save_core", NULL, "warning", strerror (errno));
+
+      if ( error ) {
+           error->code = errno;
+           error->description = strdup (strerror (errno));
+      }
+
+      FreeImage_Unload (bitmap);
+      return false;
+ }
+
  for ( y = 0; y < image->height; y++ ) {
+       kernels->rgba_row (row, image->pixel[y], image->width);
+
        for ( x = 0; x < image->width; x++ ) {
-             rgba = imel_pixel_get_rgba (image->pixel[y][x]);
+             rgba = row[x];
              
              if ( bpp >= 16 ) {
                   dst_pixel.rgbRed   = (BYTE) RGBA_R_MASK (rgba);
@@ -85,6 +101,7 @@ static bool imel_image_save_core (ImelImage *image, FREE_IMAGE_FORMAT format, in
              FreeImage_SetPixelIndex (bitmap, x, image->height - (y + 1), &dst_byte);
        }
  }
+ free (row);
  
  va_start (list, error);
  switch ( save_mode ) {
@@ -0,0 +1,214 @@
+/*
+ * "kernel.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include "header.h"
+#include "kernel.h"
+/**
+ * @file kernel.c
+ * @author Davide Francesco Merico
+ * @brief This file contains the row kernels used by the hot loops of Imel.
+ *
+ * This file is a template: the Makefile builds it once for each instruction
+ * set ( kernel_generic.o, kernel_sse2.o, kernel_avx2.o, ... ) with the target
+ * flags of that instruction set and __IMEL_KERNEL_ISA set to its name. The
+ * loops are written without branches between pixels so the compiler can
+ * vectorize them for the target. Every build gives exactly the same results.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+#ifndef __IMEL_KERNEL_ISA
+#define __IMEL_KERNEL_ISA generic
+#endif
+
+#define __IMEL_KERNEL_PASTE(prefix, isa) prefix##isa
+#define __IMEL_KERNEL_NAME(prefix, isa) __IMEL_KERNEL_PASTE (prefix, isa)
+
+static void __imel_kernel_lut_row (ImelPixel *row, ImelSize width, const ImelColor (*lut)[256],
+                                   const ImelColor (*alpha_lut)[256])
+{
+ const ImelColor (*table)[256];
+ ImelSize x;
+
+ for ( x = 0; x < width; x++ ) {
+       table = ( row[x].level < 0 ) ? alpha_lut : lut;
+       row[x].red = table[0][row[x].red];
+       row[x].green = table[1][row[x].green];
+       row[x].blue = table[2][row[x].blue];
+ }
+}
+
+static void __imel_kernel_blend_row (ImelPixel *dest, const ImelPixel *a, const ImelPixel *b,
+                                     ImelSize width, unsigned char opacity)
+{
+ ImelSize x;
+ unsigned int o, c[3];
+ ImelLevel level;
+ bool use_a, use_b;
+
+ for ( x = 0; x < width; x++ ) {
+       /* Same as imel_pixel_union () */
+       use_b = a[x].level <= -255;
+       use_a = ! use_b && b[x].level <= -255;
+       o = ( b[x].level >= 0 ) ? opacity : (unsigned char) ((-255 - b[x].level) * opacity * -255);
+
+       c[0] = (o * b[x].red) / 255 + ((255 - o) * a[x].red) / 255;
+       c[1] = (o * b[x].green) / 255 + ((255 - o) * a[x].green) / 255;
+       c[2] = (o * b[x].blue) / 255 + ((255 - o) * a[x].blue) / 255;
+       level = ( b[x].level > a[x].level ) ? b[x].level : a[x].level;
+
+       dest[x].red = use_b ? b[x].red : use_a ? a[x].red : ( c[0] > 255 ) ? 255 : c[0];
+       dest[x].green = use_b ? b[x].green : use_a ? a[x].green : ( c[1] > 255 ) ? 255 : c[1];
+       dest[x].blue = use_b ? b[x].blue : use_a ? a[x].blue : ( c[2] > 255 ) ? 255 : c[2];
+       dest[x].level = use_b ? b[x].level : use_a ? a[x].level : level;
+ }
+}
+
+static void __imel_kernel_convolution_row (double *acc, const ImelPixel *src, ImelSize width,
+                                           ImelSize shift, double weight)
+{
+ double *red = acc, *green = acc + width, *blue = acc + 2 * width;
+ const ImelPixel *s = src + shift;
+ ImelSize x, split = width - shift;
+
+ /* [0, split) reads src[x + shift], [split, width) wraps to src[x - split] */
+ for ( x = 0; x < split; x++ ) {
+       red[x] += ((double) s[x].red) * weight;
+       green[x] += ((double) s[x].green) * weight;
+       blue[x] += ((double) s[x].blue) * weight;
+ }
+
+ red += split;
+ green += split;
+ blue += split;
+ for ( x = 0; x < shift; x++ ) {
+       red[x] += ((double) src[x].red) * weight;
+       green[x] += ((double) src[x].green) * weight;
+       blue[x] += ((double) src[x].blue) * weight;
+ }
+}
+
+static void __imel_kernel_resize_row (ImelPixel *dest, const ImelPixel *src, ImelSize width,
+                                      const ImelSize *index)
+{
+ ImelSize x;
+
+ for ( x = 0; x < width; x++ )
+       dest[x] = src[index[x]];
+}
+
+/* Luma with the ITU-R BT.601 weights in 8 bit fixed point, level in [-255, 0] */
+#define __IMEL_KERNEL_HISTOGRAM_PIXEL(count, p, copy) \
+ do { \
+      ImelSize (*__c)[256] = (count) + (copy) * __IMEL_HISTOGRAM_CHANNELS; \
+      ImelLevel __l = ( (p).level < -255 ) ? -255 : ( (p).level > 0 ) ? 0 : (p).level; \
+      \
+      __c[0][(p).red]++; \
+      __c[1][(p).green]++; \
+      __c[2][(p).blue]++; \
+      __c[3][(77 * (p).red + 151 * (p).green + 28 * (p).blue) >> 8]++; \
+      __c[4][__l + 255]++; \
+ } while (0)
+
+static void __imel_kernel_histogram_row (const ImelPixel *row, ImelSize width, ImelSize (*count)[256])
+{
+ ImelSize x;
+
+ for ( x = 0; x < width; x++ )
+       __IMEL_KERNEL_HISTOGRAM_PIXEL (count, row[x], x % __IMEL_HISTOGRAM_COPIES);
+}
+
+static void __imel_kernel_rgba_row (uint32_t *dest, const ImelPixel *src, ImelSize width)
+{
+ ImelSize x;
+ uint32_t alpha;
+
+ for ( x = 0; x < width; x++ ) {
+       /* Same as imel_pixel_get_rgba () */
+       alpha = ( src[x].level >= 0 ) ? 0 : ( src[x].level < -255 ) ? 255 : (uint32_t) -src[x].level;
+       dest[x] = ((uint32_t) src[x].red << 24) | ((uint32_t) src[x].green << 16) |
+                 ((uint32_t) src[x].blue << 8) | alpha;
+ }
+}
+
+/* Luma with the same weights of the histograms, without the final shift */
+static void __imel_kernel_luma_row (uint16_t *dest, const ImelPixel *src, ImelSize width,
+                                    uint16_t *min, uint16_t *max)
+{
+ ImelSize x;
+ uint16_t l, lmin = *min, lmax = *max;
+
+ for ( x = 0; x < width; x++ ) {
+       l = 77 * src[x].red + 151 * src[x].green + 28 * src[x].blue;
+       dest[x] = l;
+       lmin = ( l < lmin ) ? l : lmin;
+       lmax = ( l > lmax ) ? l : lmax;
+ }
+
+ *min = lmin;
+ *max = lmax;
+}
+
+/* Blend @pixel over the row with the opacities in @coverage, 255 is a
+ * pixel covered completely. Like imel_pixel_copy () pixels with a level
+ * higher than the one of @pixel are kept, a negative level of @pixel is
+ * its alpha and a pixel of @dest that is transparent takes the color of
+ * @pixel with the coverage as alpha. */
+static void __imel_kernel_cover_row (ImelPixel *dest, const unsigned char *coverage, ImelSize width,
+                                     ImelPixel pixel)
+{
+ unsigned int alpha, o, c[3];
+ ImelLevel level;
+ ImelSize x;
+ bool clear;
+
+ alpha = ( pixel.level >= 0 ) ? 255 : ( pixel.level <= -255 ) ? 0 : 255 + pixel.level;
+
+ for ( x = 0; x < width; x++ ) {
+       o = (coverage[x] * alpha + 127) / 255;
+       o = ( pixel.level >= 0 && dest[x].level > pixel.level ) ? 0 : o;
+       clear = dest[x].level <= -255;
+
+       c[0] = (o * pixel.red + (255 - o) * dest[x].red + 127) / 255;
+       c[1] = (o * pixel.green + (255 - o) * dest[x].green + 127) / 255;
+       c[2] = (o * pixel.blue + (255 - o) * dest[x].blue + 127) / 255;
+       level = ( pixel.level > dest[x].level ) ? pixel.level : dest[x].level;
+       level = clear ? -255 + (ImelLevel) o : level;
+       level = ( o == 255 ) ? pixel.level : level;
+
+       dest[x].red = ( clear && o ) ? pixel.red : c[0];
+       dest[x].green = ( clear && o ) ? pixel.green : c[1];
+       dest[x].blue = ( clear && o ) ? pixel.blue : c[2];
+       dest[x].level = o ? level : dest[x].level;
+ }
+}
+
+void __IMEL_KERNEL_NAME (__imel_kernels_, __IMEL_KERNEL_ISA) (__ImelKernels *kernels)
+{
+ kernels->lut_row = __imel_kernel_lut_row;
+ kernels->blend_row = __imel_kernel_blend_row;
+ kernels->convolution_row = __imel_kernel_convolution_row;
+ kernels->resize_row = __imel_kernel_resize_row;
+ kernels->histogram_row = __imel_kernel_histogram_row;
+ kernels->rgba_row = __imel_kernel_rgba_row;
+ kernels->luma_row = __imel_kernel_luma_row;
+ kernels->cover_row = __imel_kernel_cover_row;
+}
+
+#endif
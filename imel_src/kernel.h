@@ -0,0 +1,72 @@
+/*
+ * "kernel.h" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+#ifndef IMEL_KERNEL_H
+#define IMEL_KERNEL_H
+/**
+ * @file kernel.h
+ * @author Davide Francesco Merico
+ * @brief This file contains the internal table of the row kernels.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+/* Channels counted by histogram_row: red, green, blue, luma and level */
+#define __IMEL_HISTOGRAM_CHANNELS 5
+
+/* Copies of the counts used by histogram_row, consecutive pixels with the
+ * same value don't wait for the previous increment of the same counter */
+#define __IMEL_HISTOGRAM_COPIES 4
+
+/* Row kernels, kernel.c is built once for each instruction set and
+ * cpu.c binds the best one available when the library is used the
+ * first time. */
+typedef struct ___imel_kernels {
+               /* row[x].channel = lut[channel][row[x].channel], alpha_lut for
+                * pixels with negative level */
+               void (*lut_row)         (ImelPixel *row, ImelSize width, const ImelColor (*lut)[256],
+                                        const ImelColor (*alpha_lut)[256]);
+               /* dest[x] = imel_pixel_union (a[x], b[x], opacity) */
+               void (*blend_row)       (ImelPixel *dest, const ImelPixel *a, const ImelPixel *b,
+                                        ImelSize width, unsigned char opacity);
+               /* acc[c * width + x] += weight * src[(x + shift) % width].channel[c] */
+               void (*convolution_row) (double *acc, const ImelPixel *src, ImelSize width,
+                                        ImelSize shift, double weight);
+               /* dest[x] = src[index[x]] */
+               void (*resize_row)      (ImelPixel *dest, const ImelPixel *src, ImelSize width,
+                                        const ImelSize *index);
+               /* count[copy * __IMEL_HISTOGRAM_CHANNELS + channel][value]++ for red,
+                * green, blue, luma and level, copy is x % __IMEL_HISTOGRAM_COPIES */
+               void (*histogram_row)   (const ImelPixel *row, ImelSize width, ImelSize (*count)[256]);
+               /* dest[x] = imel_pixel_get_rgba (src[x]) */
+               void (*rgba_row)        (uint32_t *dest, const ImelPixel *src, ImelSize width);
+               /* dest[x] = 77 * red + 151 * green + 28 * blue, *min and *max are
+                * lowered and raised to the values of dest */
+               void (*luma_row)        (uint16_t *dest, const ImelPixel *src, ImelSize width,
+                                        uint16_t *min, uint16_t *max);
+               /* dest[x] = pixel over dest[x] with opacity coverage[x] times the
+                * alpha of pixel, see __imel_kernel_cover_row */
+               void (*cover_row)       (ImelPixel *dest, const unsigned char *coverage, ImelSize width,
+                                        ImelPixel pixel);
+        } __ImelKernels;
+
+extern const __ImelKernels *__imel_kernels (void);
+
+#endif
+
+#endif
@@ -0,0 +1,307 @@
+/*
+ * "label.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include "header.h"
+/**
+ * @file label.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to find the connected regions of an
+ *        image.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+extern ImelSize __imel_thread_bands (ImelSize n, ImelSize grain);
+extern void __imel_thread_run_bands (ImelSize n, ImelSize bands, ImelBandFuncPtr func, ImelGenericPtr data);
+void imel_labels_free (ImelLabels *labels);
+
+/* Rows for each band of the first pass */
+#define __IMEL_LABEL_GRAIN 64
+
+typedef struct ___imel_label_apply {
+               ImelImage *image;
+               ImelSize *parent;     /* Union-find forest of the pixels, roots are the first pixel of their region */
+               ImelSize *start;      /* First row of each band */
+               ImelRef reference;
+               int64_t tollerance;
+               ImelConnectivity connectivity;
+        } __ImelLabelApply;
+
+typedef struct ___imel_label_sum {
+               uint64_t x;
+               uint64_t y;
+               uint64_t red;
+               uint64_t green;
+               uint64_t blue;
+               int64_t level;
+        } __ImelLabelSum;
+
+/* Same as imel_pixel_compare () or imel_pixel_compare_level () */
+static bool __imel_label_match (const __ImelLabelApply *apply, const ImelPixel *a, const ImelPixel *b)
+{
+ if ( apply->reference == IMEL_REF_LEVEL )
+      return ( ( a->level < b->level ) ? (int64_t) b->level - a->level
+                                       : (int64_t) a->level - b->level ) <= apply->tollerance;
+
+ return abs (a->red - b->red) <= apply->tollerance && abs (a->green - b->green) <= apply->tollerance
+     && abs (a->blue - b->blue) <= apply->tollerance;
+}
+
+static ImelSize __imel_label_find (ImelSize *parent, ImelSize i)
+{
+ while ( parent[i] != i ) {
+         parent[i] = parent[parent[i]];
+         i = parent[i];
+ }
+
+ return i;
+}
+
+/* The root with the lowest index becomes the root of both */
+static void __imel_label_union (ImelSize *parent, ImelSize a, ImelSize b)
+{
+ a = __imel_label_find (parent, a);
+ b = __imel_label_find (parent, b);
+
+ if ( a < b )
+      parent[b] = a;
+ else if ( b < a )
+      parent[a] = b;
+}
+
+/* Join the pixels of the row @y with the ones of the row above */
+static void __imel_label_join_up (__ImelLabelApply *apply, ImelSize y)
+{
+ ImelSize x, i, width = apply->image->width;
+ const ImelPixel *row = apply->image->pixel[y], *up = apply->image->pixel[y - 1];
+
+ for ( x = 0, i = y * width; x < width; x++, i++ ) {
+       if ( __imel_label_match (apply, &up[x], &row[x]) )
+            __imel_label_union (apply->parent, i - width, i);
+
+       if ( apply->connectivity != IMEL_CONNECTIVITY_8 )
+            continue;
+
+       if ( x && __imel_label_match (apply, &up[x - 1], &row[x]) )
+            __imel_label_union (apply->parent, i - width - 1, i);
+       if ( x + 1 < width && __imel_label_match (apply, &up[x + 1], &row[x]) )
+            __imel_label_union (apply->parent, i - width + 1, i);
+ }
+}
+
+/* First pass on the rows [start, end): the forest touches only the pixels
+ * of the band, so the bands don't need locks */
+static void __imel_label_rows (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelLabelApply *apply = (__ImelLabelApply *) data;
+ ImelSize x, y, i, width = apply->image->width;
+ const ImelPixel *row;
+
+ apply->start[band] = start;
+
+ for ( y = start; y < end; y++ ) {
+       row = apply->image->pixel[y];
+
+       for ( x = 0, i = y * width; x < width; x++, i++ ) {
+             apply->parent[i] = i;
+             if ( x && __imel_label_match (apply, &row[x - 1], &row[x]) )
+                  __imel_label_union (apply->parent, i - 1, i);
+       }
+
+       if ( y > start )
+            __imel_label_join_up (apply, y);
+ }
+}
+
+/* Second pass: number the regions in the order of their roots and sum
+ * their pixels */
+static bool __imel_label_regions (__ImelLabelApply *apply, ImelLabels *labels)
+{
+ __ImelLabelSum *sum = NULL, *grown;
+ ImelSize x, y, i, root, size = 0, n;
+ const ImelPixel *p;
+ ImelRegion *region;
+ double area;
+
+ labels->n_regions = 0;
+ for ( y = 0, i = 0; y < labels->height; y++ ) {
+       for ( x = 0; x < labels->width; x++, i++ ) {
+             root = __imel_label_find (apply->parent, i);
+
+             if ( root == i ) {
+                  if ( labels->n_regions == size ) {
+                       size = size ? size << 1 : 64;
+                       grown = (__ImelLabelSum *) realloc (sum, sizeof (__ImelLabelSum) * size);
+                       region = (ImelRegion *) realloc (labels->region, sizeof (ImelRegion) * size);
+                       sum = grown ? grown : sum;
+                       labels->region = region ? region : labels->region;
+                       if ( ! grown || ! region ) {
+                            free (sum);
+                            return false;
+                       }
+                  }
+
+                  n = labels->n_regions++;
+                  sum[n].x = sum[n].y = sum[n].red = sum[n].green = sum[n].blue = 0;
+                  sum[n].level = 0;
+                  labels->region[n].area = 0;
+                  labels->region[n].x1 = labels->region[n].x2 = x;
+                  labels->region[n].y1 = labels->region[n].y2 = y;
+             }
+
+             n = labels->label[i] = ( root == i ) ? labels->n_regions - 1 : labels->label[root];
+             p = &(apply->image->pixel[y][x]);
+             region = &(labels->region[n]);
+
+             region->area++;
+             region->x1 = ( x < region->x1 ) ? x : region->x1;
+             region->x2 = ( x > region->x2 ) ? x : region->x2;
+             region->y2 = y;
+             sum[n].x += x;
+             sum[n].y += y;
+             sum[n].red += p->red;
+             sum[n].green += p->green;
+             sum[n].blue += p->blue;
+             sum[n].level += p->level;
+       }
+ }
+
+ for ( n = 0; n < labels->n_regions; n++ ) {
+       region = &(labels->region[n]);
+       area = (double) region->area;
+
+       region->cx = sum[n].x / area;
+       region->cy = sum[n].y / area;
+       region->mean.red = (sum[n].red + (region->area >> 1)) / region->area;
+       region->mean.green = (sum[n].green + (region->area >> 1)) / region->area;
+       region->mean.blue = (sum[n].blue + (region->area >> 1)) / region->area;
+       region->mean.level = (ImelLevel) (sum[n].level / (int64_t) region->area);
+ }
+
+ free (sum);
+
+ return true;
+}
+
+#endif
+
+/**
+ * @brief Find the connected regions of an image
+ * 
+ * This function gives a number to each region of @p image: two pixels
+ * that touch each other are in the same region if they are equal within
+ * @p tollerance, like #imel_pixel_compare does for @p reference
+ * #IMEL_REF_COLOR or #imel_pixel_compare_level for #IMEL_REF_LEVEL. For
+ * each region it also returns area, bounding box, centroid and mean
+ * color, so a blob can be found and cut without other passes over the
+ * image.
+ * 
+ * The pixels are joined with a union-find forest. The first pass is split
+ * between threads by bands of rows, then the bands are joined and a
+ * second pass numbers the regions and computes their statistics. The
+ * result is the same with any number of threads.
+ * 
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.png", 0, NULL), *blob;
+ * ImelLabels *labels = imel_image_get_labels (image, IMEL_REF_COLOR, 8, IMEL_CONNECTIVITY_8);
+ * ImelRegion *region = &(labels->region[labels->label[0]]);
+ * 
+ * blob = imel_image_cut (image, region->x1, region->y1, region->x2 + 1, region->y2 + 1);
+ * imel_labels_free (labels);
+ * @endcode
+ * 
+ * @param image Image where find the regions
+ * @param reference What the pixels must have in common
+ * @param tollerance Tollerance between two pixels that touch each other
+ * @param connectivity Which pixels touch each other
+ * @return The regions of @p image or NULL on error.
+ * 
+ * @see ImelLabels
+ * @see imel_labels_free
+ * @see imel_thread_set_count
+ */
+ImelLabels *imel_image_get_labels (ImelImage *image, ImelRef reference, ImelSize tollerance,
+                                   ImelConnectivity connectivity)
+{
+ __ImelLabelApply apply;
+ ImelLabels *labels;
+ ImelSize bands, b;
+ size_t n;
+
+ return_var_if_fail (image && image->width && image->height, NULL);
+
+ n = (size_t) image->width * image->height;
+ return_var_if_fail ((uint64_t) n < (uint64_t) ((ImelSize) -1), NULL);
+
+ labels = (ImelLabels *) malloc (sizeof (ImelLabels));
+ return_var_if_fail (labels, NULL);
+
+ bands = __imel_thread_bands (image->height, __IMEL_LABEL_GRAIN);
+ apply.image = image;
+ apply.reference = reference;
+ apply.tollerance = tollerance;
+ apply.connectivity = connectivity;
+ apply.parent = (ImelSize *) malloc (sizeof (ImelSize) * n);
+ apply.start = (ImelSize *) malloc (sizeof (ImelSize) * bands);
+
+ labels->width = image->width;
+ labels->height = image->height;
+ labels->label = (ImelSize *) malloc (sizeof (ImelSize) * n);
+ labels->region = NULL;
+ labels->n_regions = 0;
+
+ if ( ! apply.parent || ! apply.start || ! labels->label ) {
+      free (apply.parent);
+      free (apply.start);
+      imel_labels_free (labels);
+      return NULL;
+ }
+
+ __imel_thread_run_bands (image->height, bands, __imel_label_rows, &apply);
+
+ /* Join each band with the last row of the previous one */
+ for ( b = 1; b < bands; b++ )
+       __imel_label_join_up (&apply, apply.start[b]);
+
+ if ( ! __imel_label_regions (&apply, labels) ) {
+      imel_labels_free (labels);
+      labels = NULL;
+ }
+
+ free (apply.parent);
+ free (apply.start);
+
+ return labels;
+}
+
+/**
+ * @brief Free the regions of an image
+ * 
+ * @param labels Regions to free
+ * @see imel_image_get_labels
+ */
+void imel_labels_free (ImelLabels *labels)
+{
+ return_if_fail (labels);
+
+ free (labels->label);
+ free (labels->region);
+ free (labels);
+}
@@ -0,0 +1,279 @@
+/*
+ * "mask_kernel.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "header.h"
+/**
+ * @file mask_kernel.c
+ * @author Davide Francesco Merico
+ * @brief This file contains the kernels of the functions that operate on
+ *        the channels selected by an #ImelMask.
+ *
+ * Every kernel is written once as a macro and expanded for each of the 16
+ * values of #ImelMask (and for each #ImelNoiseOperation), so the channel
+ * tests are resolved at compile time and the right kernel is chosen once
+ * for each call instead of once for each pixel.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#define max(a,b) (((a) < (b)) ? (b) : (a))
+
+#define __IMEL_MASKS(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) \
+                        X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15)
+
+#define __IMEL_HAS(M, channel) ((M) & IMEL_MASK_##channel)
+
+/* Set the channels to a value, pixels with negative level are skipped */
+
+typedef void (*__ImelSetKernel) (ImelPixel *, ImelSize, const ImelPixel *);
+
+#define __IMEL_SET_KERNEL(M) \
+static void __imel_mask_set_##M (ImelPixel *row, ImelSize width, const ImelPixel *value) \
+{ \
+ ImelSize x; \
+ bool skip; \
+ \
+ for ( x = 0; x < width; x++ ) { \
+       skip = row[x].level < 0; \
+       if ( __IMEL_HAS (M, RED) ) \
+            row[x].red = skip ? row[x].red : value->red; \
+       if ( __IMEL_HAS (M, GREEN) ) \
+            row[x].green = skip ? row[x].green : value->green; \
+       if ( __IMEL_HAS (M, BLUE) ) \
+            row[x].blue = skip ? row[x].blue : value->blue; \
+       if ( __IMEL_HAS (M, LEVEL) ) \
+            row[x].level = skip ? row[x].level : value->level; \
+ } \
+}
+
+#define __IMEL_SET_ENTRY(M) __imel_mask_set_##M,
+
+__IMEL_MASKS (__IMEL_SET_KERNEL)
+
+static const __ImelSetKernel __imel_mask_set_kernels[16] = { __IMEL_MASKS (__IMEL_SET_ENTRY) };
+
+/* Apply a noise value to the channels */
+
+#define __IMEL_NOISE_SUM(v, n)       min ((int32_t) (v) + (int32_t) (n), 255)
+#define __IMEL_NOISE_SUBTRACT(v, n)  max ((int32_t) (v) - (int32_t) (n), 0)
+#define __IMEL_NOISE_MULTIPLY(v, n)  min ((int32_t) (v) * (int32_t) (n), 255)
+#define __IMEL_NOISE_DIVIDE(v, n)    ((int32_t) (v) / ((n) ? (int32_t) (n) : 1))
+
+#define __IMEL_NOISE_OPERATIONS(X, M) X(M, SUM) X(M, SUBTRACT) X(M, MULTIPLY) X(M, DIVIDE)
+
+typedef struct ___imel_noise {
+               ImelSize range;
+               ImelSize quantity;
+               bool nepc;
+        } __ImelNoise;
+
+typedef void (*__ImelNoiseKernel) (ImelPixel *, ImelSize, const __ImelNoise *);
+typedef void (*__ImelNoisePixel) (ImelPixel *, const ImelSize *);
+
+#define __IMEL_NOISE_PIXEL(M, OP) \
+static void __imel_mask_noise_pixel_##M##_##OP (ImelPixel *p, const ImelSize *n) \
+{ \
+ if ( __IMEL_HAS (M, RED) ) \
+      p->red = __IMEL_NOISE_##OP (p->red, n[0]); \
+ if ( __IMEL_HAS (M, GREEN) ) \
+      p->green = __IMEL_NOISE_##OP (p->green, n[1]); \
+ if ( __IMEL_HAS (M, BLUE) ) \
+      p->blue = __IMEL_NOISE_##OP (p->blue, n[2]); \
+ if ( __IMEL_HAS (M, LEVEL) ) \
+      p->level = __IMEL_NOISE_##OP (p->level, n[3]); \
+}
+
+/* Noise values for a pixel: the same for each channel if nepc is TRUE.
+ * Continues the loop of the kernel if the pixel must be skipped. */
+#define __IMEL_NOISE_VALUES(M, noise, n) \
+ if ( (noise)->nepc ) { \
+      n[0] = n[1] = n[2] = n[3] = rand () % (noise)->range; \
+      if ( rand () % (noise)->quantity ) \
+           continue; \
+ } \
+ else { \
+      if ( rand () % (noise)->quantity ) \
+           continue; \
+      if ( __IMEL_HAS (M, RED) ) \
+           n[0] = rand () % (noise)->range; \
+      if ( __IMEL_HAS (M, GREEN) ) \
+           n[1] = rand () % (noise)->range; \
+      if ( __IMEL_HAS (M, BLUE) ) \
+           n[2] = rand () % (noise)->range; \
+      if ( __IMEL_HAS (M, LEVEL) ) \
+           n[3] = rand () % (noise)->range; \
+ }
+
+#define __IMEL_NOISE_KERNEL(M, OP) \
+static void __imel_mask_noise_##M##_##OP (ImelPixel *row, ImelSize width, const __ImelNoise *noise) \
+{ \
+ ImelSize x, n[4] = { 0, 0, 0, 0 }; \
+ \
+ for ( x = 0; x < width; x++ ) { \
+       __IMEL_NOISE_VALUES (M, noise, n) \
+       __imel_mask_noise_pixel_##M##_##OP (&row[x], n); \
+ } \
+}
+
+/* IMEL_NOISE_OPERATION_RANDOM chooses the operation for each pixel */
+#define __IMEL_NOISE_RANDOM_KERNEL(M) \
+static void __imel_mask_noise_##M##_RANDOM (ImelPixel *row, ImelSize width, const __ImelNoise *noise) \
+{ \
+ static const __ImelNoisePixel operation[4] = { __imel_mask_noise_pixel_##M##_SUM, \
+                                                __imel_mask_noise_pixel_##M##_SUBTRACT, \
+                                                __imel_mask_noise_pixel_##M##_MULTIPLY, \
+                                                __imel_mask_noise_pixel_##M##_DIVIDE }; \
+ ImelSize x, n[4] = { 0, 0, 0, 0 }; \
+ int op; \
+ \
+ for ( x = 0; x < width; x++ ) { \
+       op = rand () % 4; \
+       __IMEL_NOISE_VALUES (M, noise, n) \
+       operation[op] (&row[x], n); \
+ } \
+}
+
+#define __IMEL_NOISE_FOR_MASK(M) \
+        __IMEL_NOISE_OPERATIONS (__IMEL_NOISE_PIXEL, M) \
+        __IMEL_NOISE_OPERATIONS (__IMEL_NOISE_KERNEL, M) \
+        __IMEL_NOISE_RANDOM_KERNEL (M)
+
+#define __IMEL_NOISE_ENTRY(M) { __imel_mask_noise_##M##_SUM, __imel_mask_noise_##M##_SUBTRACT, \
+                                __imel_mask_noise_##M##_MULTIPLY, __imel_mask_noise_##M##_DIVIDE, \
+                                __imel_mask_noise_##M##_RANDOM },
+
+__IMEL_MASKS (__IMEL_NOISE_FOR_MASK)
+
+static const __ImelNoiseKernel __imel_mask_noise_kernels[16][5] = { __IMEL_MASKS (__IMEL_NOISE_ENTRY) };
+
+/* Replace the channels with the average of the square around the pixel if
+ * at least one of them is out of tollerance. The level average counts
+ * levels not negative as 0xff + level. */
+
+typedef void (*__ImelRemoveNoiseKernel) (ImelImage *, long int, long int, ImelColor);
+
+#define __IMEL_IN_TOLLERANCE(a, b, t) ((a) <= (b) + (int64_t) (t) && (a) >= (b) - (int64_t) (t))
+
+#define __IMEL_REMOVE_NOISE_KERNEL(M) \
+static void __imel_mask_remove_noise_##M (ImelImage *image, long int y, long int q, ImelColor t) \
+{ \
+ long int x, j, k, z; \
+ int64_t m[4]; \
+ ImelPixel *p, *s; \
+ bool keep; \
+ \
+ for ( x = 0; x < image->width; x++ ) { \
+       memset (m, 0, sizeof (m)); \
+       z = 0; \
+       \
+       for ( j = max (y - q, 0); j <= y + q && j < image->height; j++ ) { \
+             for ( k = max (x - q, 0); k <= x + q && k < image->width; k++ ) { \
+                   s = &image->pixel[j][k]; \
+                   if ( __IMEL_HAS (M, RED) ) \
+                        m[0] += s->red; \
+                   if ( __IMEL_HAS (M, GREEN) ) \
+                        m[1] += s->green; \
+                   if ( __IMEL_HAS (M, BLUE) ) \
+                        m[2] += s->blue; \
+                   if ( __IMEL_HAS (M, LEVEL) ) \
+                        m[3] += ( s->level > -1 ) ? 0xff + s->level : s->level; \
+                   z++; \
+             } \
+       } \
+       \
+       z = z ? z : 1; \
+       p = &image->pixel[y][x]; \
+       keep = true; \
+       \
+       if ( __IMEL_HAS (M, RED) ) \
+            keep = keep && __IMEL_IN_TOLLERANCE (m[0] / z, (int64_t) p->red, t); \
+       if ( __IMEL_HAS (M, GREEN) ) \
+            keep = keep && __IMEL_IN_TOLLERANCE (m[1] / z, (int64_t) p->green, t); \
+       if ( __IMEL_HAS (M, BLUE) ) \
+            keep = keep && __IMEL_IN_TOLLERANCE (m[2] / z, (int64_t) p->blue, t); \
+       if ( __IMEL_HAS (M, LEVEL) ) \
+            keep = keep && __IMEL_IN_TOLLERANCE (m[3] / z, (int64_t) p->level, t); \
+       \
+       if ( keep ) \
+            continue; \
+       \
+       if ( __IMEL_HAS (M, RED) ) \
+            p->red = m[0] / z; \
+       if ( __IMEL_HAS (M, GREEN) ) \
+            p->green = m[1] / z; \
+       if ( __IMEL_HAS (M, BLUE) ) \
+            p->blue = m[2] / z; \
+       if ( __IMEL_HAS (M, LEVEL) ) \
+            p->level = m[3] / z; \
+ } \
+}
+
+#define __IMEL_REMOVE_NOISE_ENTRY(M) __imel_mask_remove_noise_##M,
+
+__IMEL_MASKS (__IMEL_REMOVE_NOISE_KERNEL)
+
+static const __ImelRemoveNoiseKernel __imel_mask_remove_noise_kernels[16] = { __IMEL_MASKS (__IMEL_REMOVE_NOISE_ENTRY) };
+
+/* Set the channels in @mask to the ones of @value for each pixel with
+ * a level not negative */
+void __imel_mask_set (ImelImage *image, ImelMask mask, ImelPixel value)
+{
+ __ImelSetKernel kernel = __imel_mask_set_kernels[mask & 0x0f];
+ ImelSize y;
+
+ for ( y = 0; y < image->height; y++ )
+       kernel (image->pixel[y], image->width, &value);
+ image->generation++;
+}
+
+void __imel_mask_apply_noise (ImelImage *image, ImelSize range, ImelSize quantity,
+                              ImelMask mask, ImelNoiseOperation operation, bool nepc)
+{
+ __ImelNoiseKernel kernel;
+ __ImelNoise noise;
+ ImelSize y;
+
+ if ( operation > IMEL_NOISE_OPERATION_RANDOM )
+      return;
+
+ kernel = __imel_mask_noise_kernels[mask & 0x0f][operation];
+ noise.range = range;
+ noise.quantity = quantity;
+ noise.nepc = nepc;
+
+ for ( y = 0; y < image->height; y++ )
+       kernel (image->pixel[y], image->width, &noise);
+ image->generation++;
+}
+
+/* The pixels are replaced in place, so the rows must be processed in order */
+void __imel_mask_remove_noise (ImelImage *image, ImelSize size_q, ImelMask mask, ImelColor tollerance)
+{
+ __ImelRemoveNoiseKernel kernel = __imel_mask_remove_noise_kernels[mask & 0x0f];
+ long int y;
+
+ for ( y = 0; y < image->height; y++ )
+       kernel (image, y, size_q >> 1, tollerance);
+ image->generation++;
+}
+
+#endif
@@ -29,6 +29,7 @@
 
 extern ImelImage  *imel_image_copy  (ImelImage *image);
 extern void        imel_image_free  (ImelImage *image);
+extern void        __imel_brush_reset (void);
 
 #endif
 
@@ -52,7 +53,11 @@ bool imel_enable_brush (ImelImage *brush)
 {
  return_var_if_fail (brush, false);
  
+ if ( global_brush )
+      imel_image_free (global_brush);
+ 
  global_brush = imel_image_copy (brush);
+ __imel_brush_reset ();
  
  return true;
 }
@@ -71,6 +76,7 @@ bool imel_disable_brush (void)
  
  imel_image_free (global_brush);
  global_brush = NULL;
+ __imel_brush_reset ();
  
  return true;
 }
@@ -0,0 +1,752 @@
+/*
+ * "path.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <math.h>
+#include "header.h"
+#include "polygon.h"
+/**
+ * @file path.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to draw paths of lines and
+ *        Bèzier's curves.
+ *
+ * The curves are split in lines before drawing them. The number of lines
+ * comes from the Wang's formula: it's the lowest one that keeps all the
+ * points of the lines within the tolerance from the curve, without testing
+ * the lines. The points are then computed by forward differencing, three
+ * additions for each coordinate of each point.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+extern ImelImage *global_brush;
+
+extern void __imel_draw_line_part (ImelImage *image, long x0, long y0, long x1, long y1, bool lower,
+                                   bool brush, ImelPixel pixel);
+extern void __imel_draw_fill_span (ImelImage *image, long x0, long x1, long y, bool brush, ImelPixel pixel);
+extern bool __imel_brush_sweep_begin (void);
+extern void __imel_brush_sweep_end (ImelImage *image, ImelPixel pixel);
+
+/* Default tolerance of the paths, in pixels */
+#define __IMEL_PATH_TOLERANCE 0.25
+
+/* Most lines for a single curve */
+#define __IMEL_PATH_MAX_SEGMENTS 65536
+
+/* Coordinates are kept far from the limits of long */
+#define __IMEL_PATH_BOUND 1e15
+
+typedef struct ___imel_path_point {
+               double x;
+               double y;
+        } __ImelPathPoint;
+
+typedef struct ___imel_path_vertex {
+               long x;
+               long y;
+        } __ImelPathVertex;
+
+/* Points of a contour, from point[first] to point[first + n_points] excluded */
+typedef struct ___imel_path_contour {
+               ImelSize first;
+               ImelSize n_points;
+               bool closed;
+        } __ImelPathContour;
+
+/* A path split in lines */
+typedef struct ___imel_path_flat {
+               __ImelPathPoint *point;
+               ImelSize n_points;
+               ImelSize size;
+               __ImelPathContour *contour;
+               ImelSize n_contours;
+               ImelSize contour_size;
+               bool failed;   /* A point couldn't be allocated */
+        } __ImelPathFlat;
+
+static void __imel_path_flat_init (__ImelPathFlat *flat)
+{
+ flat->point = NULL;
+ flat->n_points = 0;
+ flat->size = 0;
+ flat->contour = NULL;
+ flat->n_contours = 0;
+ flat->contour_size = 0;
+ flat->failed = false;
+}
+
+static void __imel_path_flat_clear (__ImelPathFlat *flat)
+{
+ free (flat->point);
+ free (flat->contour);
+ __imel_path_flat_init (flat);
+}
+
+/* Start a new contour */
+static void __imel_path_flat_contour (__ImelPathFlat *flat)
+{
+ __ImelPathContour *contour;
+
+ if ( flat->n_contours && ! flat->contour[flat->n_contours - 1].n_points )
+      return;
+
+ if ( flat->n_contours == flat->contour_size ) {
+      contour = (__ImelPathContour *) realloc (flat->contour, sizeof (__ImelPathContour) *
+                                               (flat->contour_size ? flat->contour_size << 1 : 8));
+      if ( ! contour ) {
+           flat->failed = true;
+           return;
+      }
+
+      flat->contour = contour;
+      flat->contour_size = flat->contour_size ? flat->contour_size << 1 : 8;
+ }
+
+ flat->contour[flat->n_contours].first = flat->n_points;
+ flat->contour[flat->n_contours].n_points = 0;
+ flat->contour[flat->n_contours++].closed = false;
+}
+
+/* Add a point to the last contour, a point equal to the previous one is
+ * skipped */
+static void __imel_path_flat_add (__ImelPathFlat *flat, double x, double y)
+{
+ __ImelPathContour *contour = &(flat->contour[flat->n_contours - 1]);
+ __ImelPathPoint *point;
+
+ if ( contour->n_points && flat->point[flat->n_points - 1].x == x && flat->point[flat->n_points - 1].y == y )
+      return;
+
+ if ( flat->n_points == flat->size ) {
+      point = (__ImelPathPoint *) realloc (flat->point, sizeof (__ImelPathPoint) *
+                                           (flat->size ? flat->size << 1 : 64));
+      if ( ! point ) {
+           flat->failed = true;
+           return;
+      }
+
+      flat->point = point;
+      flat->size = flat->size ? flat->size << 1 : 64;
+ }
+
+ flat->point[flat->n_points].x = x;
+ flat->point[flat->n_points++].y = y;
+ contour->n_points++;
+}
+
+/* Lines needed by a curve of @degree ( 2 or 3 ) with the points in @x and
+ * @y to stay within @tolerance from it, by the Wang's formula */
+static ImelSize __imel_path_segments (const double *x, const double *y, int degree, double tolerance)
+{
+ double m = 0, dx, dy, d, n;
+ int i;
+
+ for ( i = 0; i + 2 <= degree; i++ ) {
+       dx = x[i] - 2 * x[i + 1] + x[i + 2];
+       dy = y[i] - 2 * y[i + 1] + y[i + 2];
+       d = sqrt (dx * dx + dy * dy);
+       m = ( d > m ) ? d : m;
+ }
+
+ n = ceil (sqrt (degree * (degree - 1) * m / (8 * tolerance)));
+ if ( ! (n < __IMEL_PATH_MAX_SEGMENTS) )
+      return __IMEL_PATH_MAX_SEGMENTS;
+
+ return ( n < 1 ) ? 1 : (ImelSize) n;
+}
+
+/* Add the ends of @n lines along the curve of @degree ( 2 or 3 ) with the
+ * points in @x and @y, the first point excluded */
+static void __imel_path_flat_curve (__ImelPathFlat *flat, const double *x, const double *y, int degree,
+                                    ImelSize n)
+{
+ double px[4], py[4], h = 1.0 / n, d1[2], d2[2], d3[2], a, b, c;
+ ImelSize i;
+ int k;
+
+ /* A quadratic curve is a cubic one with these control points */
+ px[0] = x[0];
+ py[0] = y[0];
+ px[3] = x[degree];
+ py[3] = y[degree];
+ if ( degree == 2 ) {
+      px[1] = x[0] + 2.0 / 3 * (x[1] - x[0]);
+      py[1] = y[0] + 2.0 / 3 * (y[1] - y[0]);
+      px[2] = x[2] + 2.0 / 3 * (x[1] - x[2]);
+      py[2] = y[2] + 2.0 / 3 * (y[1] - y[2]);
+ }
+ else {
+      px[1] = x[1];
+      py[1] = y[1];
+      px[2] = x[2];
+      py[2] = y[2];
+ }
+
+ /* p (t) = a t^3 + b t^2 + c t + p0, with its differences for steps of h */
+ for ( k = 0; k < 2; k++ ) {
+       const double *p = k ? py : px;
+
+       a = -p[0] + 3 * p[1] - 3 * p[2] + p[3];
+       b = 3 * p[0] - 6 * p[1] + 3 * p[2];
+       c = 3 * (p[1] - p[0]);
+
+       d1[k] = a * h * h * h + b * h * h + c * h;
+       d2[k] = 6 * a * h * h * h + 2 * b * h * h;
+       d3[k] = 6 * a * h * h * h;
+ }
+
+ a = px[0];
+ b = py[0];
+ for ( i = 1; i < n; i++ ) {
+       a += d1[0];
+       b += d1[1];
+       d1[0] += d2[0];
+       d1[1] += d2[1];
+       d2[0] += d3[0];
+       d2[1] += d3[1];
+       __imel_path_flat_add (flat, a, b);
+ }
+
+ __imel_path_flat_add (flat, px[3], py[3]);
+}
+
+/* Split @path in lines, FALSE on error */
+static bool __imel_path_flatten (const ImelPath *path, __ImelPathFlat *flat)
+{
+ const ImelPathElement *element;
+ double x[4], y[4], sx = 0, sy = 0, cx = 0, cy = 0;
+ bool open = false;
+ ImelSize i;
+ int k, degree;
+
+ __imel_path_flat_init (flat);
+
+ for ( i = 0; i < path->n_elements && ! flat->failed; i++ ) {
+       element = &(path->elements[i]);
+
+       if ( element->command == IMEL_PATH_CLOSE ) {
+            if ( open )
+                 flat->contour[flat->n_contours - 1].closed = true;
+            open = false;
+            cx = sx;
+            cy = sy;
+            continue;
+       }
+
+       if ( element->command == IMEL_PATH_MOVE_TO || ! open ) {
+            if ( element->command == IMEL_PATH_MOVE_TO ) {
+                 sx = element->x[0];
+                 sy = element->y[0];
+            }
+            else {
+                 sx = cx;
+                 sy = cy;
+            }
+
+            __imel_path_flat_contour (flat);
+            if ( flat->failed )
+                 break;
+
+            __imel_path_flat_add (flat, sx, sy);
+            open = true;
+            cx = sx;
+            cy = sy;
+
+            if ( element->command == IMEL_PATH_MOVE_TO )
+                 continue;
+       }
+
+       degree = ( element->command == IMEL_PATH_CUBIC_TO ) ? 3 : ( element->command == IMEL_PATH_QUADRATIC_TO ) ? 2 : 1;
+       x[0] = cx;
+       y[0] = cy;
+       for ( k = 0; k < degree; k++ ) {
+             x[k + 1] = element->x[k];
+             y[k + 1] = element->y[k];
+       }
+
+       if ( degree == 1 )
+            __imel_path_flat_add (flat, x[1], y[1]);
+       else __imel_path_flat_curve (flat, x, y, degree, __imel_path_segments (x, y, degree, path->tolerance));
+
+       cx = x[degree];
+       cy = y[degree];
+ }
+
+ if ( flat->failed )
+      __imel_path_flat_clear (flat);
+
+ return ! flat->failed;
+}
+
+static long __imel_path_round (double value)
+{
+ if ( ! (value > -__IMEL_PATH_BOUND) )
+      return (long) -__IMEL_PATH_BOUND;
+
+ return ( value < __IMEL_PATH_BOUND ) ? (long) floor (value + 0.5) : (long) __IMEL_PATH_BOUND;
+}
+
+/* Channel between @a and @b at @u, rounded */
+static long __imel_path_mix (long a, long b, double u)
+{
+ return a + (long) floor ((b - a) * u + 0.5);
+}
+
+/* Color of the line @i of @n, from @start to @end */
+static ImelPixel __imel_path_pixel (ImelPixel start, ImelPixel end, ImelSize i, ImelSize n)
+{
+ ImelPixel pixel;
+ double u = ( n > 1 ) ? (double) i / (n - 1) : 0;
+
+ pixel.red = __imel_path_mix (start.red, end.red, u);
+ pixel.green = __imel_path_mix (start.green, end.green, u);
+ pixel.blue = __imel_path_mix (start.blue, end.blue, u);
+ pixel.level = __imel_path_mix (start.level, end.level, u);
+
+ return pixel;
+}
+
+/* Index of the end of the line from @a to @b drawn by
+ * __imel_draw_line_part (), the lower one along the longest axis */
+static ImelSize __imel_path_lower (const __ImelPathVertex *v, ImelSize a, ImelSize b)
+{
+ if ( labs (v[b].x - v[a].x) > labs (v[b].y - v[a].y) )
+      return ( v[a].x < v[b].x ) ? a : b;
+
+ return ( v[a].y < v[b].y ) ? a : b;
+}
+
+/* Draw the lines between the @n points of @point rounded to pixels, each
+ * pixel where two lines meet once. The colors go from @start to @end, a
+ * line at a time. */
+static void __imel_path_stroke (ImelImage *image, const __ImelPathPoint *point, ImelSize n, bool closed,
+                                ImelPixel start, ImelPixel end)
+{
+ __ImelPathVertex *v;
+ ImelSize i, m = 0, n_lines, next, lower;
+ bool brush, sweep, *drawn;
+
+ v = (__ImelPathVertex *) malloc ((sizeof (__ImelPathVertex) + sizeof (bool)) * n);
+ return_if_fail (v);
+ drawn = (bool *) (v + n);
+
+ for ( i = 0; i < n; i++ ) {
+       v[m].x = __imel_path_round (point[i].x);
+       v[m].y = __imel_path_round (point[i].y);
+       if ( ! m || v[m].x != v[m - 1].x || v[m].y != v[m - 1].y )
+            drawn[m++] = false;
+ }
+
+ if ( closed && m > 1 && v[m - 1].x == v[0].x && v[m - 1].y == v[0].y )
+      m--;
+
+ closed = closed && m > 2;
+ n_lines = m - 1 + closed;
+ brush = global_brush != NULL;
+ sweep = brush && __imel_brush_sweep_begin ();
+
+ /* A line draws its lower end only, unless the line before drew it */
+ for ( i = 0; i < n_lines; i++ ) {
+       next = ( i + 1 < m ) ? i + 1 : 0;
+       lower = __imel_path_lower (v, i, next);
+       __imel_draw_line_part (image, v[i].x, v[i].y, v[next].x, v[next].y, ! drawn[lower], brush,
+                              __imel_path_pixel (start, end, i, n_lines));
+       drawn[lower] = true;
+ }
+
+ /* The points left out by both their lines */
+ for ( i = 0; i < m; i++ )
+       if ( ! drawn[i] )
+            __imel_draw_fill_span (image, v[i].x, v[i].x, v[i].y, brush,
+                                   __imel_path_pixel (start, end, ( i < n_lines || ! i ) ? i : n_lines - 1, n_lines));
+
+ if ( sweep )
+      __imel_brush_sweep_end (image, start);
+
+ free (v);
+}
+
+/* Add an element to @path, the current point is the end of the last one */
+static bool __imel_path_add (ImelPath *path, ImelPathCommand command, int n_points, const double *x,
+                             const double *y)
+{
+ ImelPathElement *element;
+ int i;
+
+ for ( i = 0; i < n_points; i++ )
+       return_var_if_fail (__IMEL_FINITE (x[i]) && __IMEL_FINITE (y[i]), false);
+
+ if ( path->n_elements == path->size ) {
+      element = (ImelPathElement *) realloc (path->elements, sizeof (ImelPathElement) *
+                                             (path->size ? path->size << 1 : 16));
+      return_var_if_fail (element, false);
+
+      path->elements = element;
+      path->size = path->size ? path->size << 1 : 16;
+ }
+
+ element = &(path->elements[path->n_elements++]);
+ element->command = command;
+ for ( i = 0; i < 3; i++ ) {
+       element->x[i] = ( i < n_points ) ? x[i] : 0;
+       element->y[i] = ( i < n_points ) ? y[i] : 0;
+ }
+
+ return true;
+}
+
+/* Draw the curve of @degree ( 2 or 3 ) with the points in @x and @y in
+ * @steps lines, or in the lines needed to keep the default tolerance if
+ * @steps isn't positive. The colors go from @start to @end. */
+void __imel_path_draw_curve (ImelImage *image, const double *x, const double *y, int degree, long steps,
+                             ImelPixel start, ImelPixel end)
+{
+ __ImelPathFlat flat;
+ ImelSize n;
+ double length = 0;
+ int i;
+
+ n = __imel_path_segments (x, y, degree, __IMEL_PATH_TOLERANCE);
+ if ( steps > 0 )
+      n = ( steps < __IMEL_PATH_MAX_SEGMENTS ) ? steps : __IMEL_PATH_MAX_SEGMENTS;
+ else if ( start.red != end.red || start.green != end.green || start.blue != end.blue ||
+           start.level != end.level ) {
+      /* Lines of about 2 pixels, so the colors change smoothly */
+      for ( i = 0; i < degree; i++ )
+            length += sqrt ((x[i + 1] - x[i]) * (x[i + 1] - x[i]) + (y[i + 1] - y[i]) * (y[i + 1] - y[i]));
+      if ( length / 2 > n )
+           n = ( length / 2 < __IMEL_PATH_MAX_SEGMENTS ) ? (ImelSize) (length / 2) : __IMEL_PATH_MAX_SEGMENTS;
+ }
+
+ __imel_path_flat_init (&flat);
+ __imel_path_flat_contour (&flat);
+ if ( ! flat.failed )
+      __imel_path_flat_add (&flat, x[0], y[0]);
+ if ( ! flat.failed )
+      __imel_path_flat_curve (&flat, x, y, degree, n);
+
+ if ( ! flat.failed )
+      __imel_path_stroke (image, flat.point, flat.n_points, false, start, end);
+
+ __imel_path_flat_clear (&flat);
+}
+
+#endif
+
+/**
+ * @brief Make a new path
+ *
+ * This function makes a new empty path. A path is made of contours: each
+ * one starts with #imel_path_move_to and goes on with lines and Bèzier's
+ * curves, each element from the end of the previous one. The path can be
+ * drawn as lines with #imel_draw_path or filled with
+ * #imel_draw_filled_path.
+ *
+ * @code
+ * ImelPath *path = imel_path_new ();
+ *
+ * imel_path_move_to (path, 20, 100);
+ * imel_path_cubic_to (path, 20, 20, 180, 20, 180, 100);
+ * imel_path_quadratic_to (path, 100, 180, 20, 100);
+ * imel_path_close (path);
+ *
+ * imel_draw_filled_antialiased_path (image, path, IMEL_FILL_RULE_NON_ZERO, fill);
+ * imel_draw_path (image, path, border);
+ * imel_path_free (path);
+ * @endcode
+ *
+ * @return A new path or NULL on error.
+ * @see imel_path_free
+ */
+ImelPath *imel_path_new (void)
+{
+ ImelPath *path;
+
+ path = (ImelPath *) malloc (sizeof (ImelPath));
+ return_var_if_fail (path, NULL);
+
+ path->n_elements = 0;
+ path->size = 0;
+ path->elements = NULL;
+ path->tolerance = __IMEL_PATH_TOLERANCE;
+
+ return path;
+}
+
+/**
+ * @brief Free a path
+ *
+ * @param path Path to free
+ * @see imel_path_new
+ */
+void imel_path_free (ImelPath *path)
+{
+ return_if_fail (path);
+
+ free (path->elements);
+ free (path);
+}
+
+/**
+ * @brief Set how close the lines drawn are to the curves of a path
+ *
+ * The curves are drawn as lines that stay within @p tolerance pixels from
+ * the curve, the default is 0.25. A higher tolerance uses less lines.
+ *
+ * @param path Path to change
+ * @param tolerance Largest distance from the curves, in pixels
+ * @return TRUE on success, FALSE if @p tolerance isn't positive.
+ * @see imel_path_new
+ */
+bool imel_path_set_tolerance (ImelPath *path, double tolerance)
+{
+ return_var_if_fail (path && tolerance > 0 && __IMEL_FINITE (tolerance), false);
+
+ path->tolerance = tolerance;
+
+ return true;
+}
+
+/**
+ * @brief Start a new contour
+ *
+ * @param path Path where add the contour
+ * @param x Start coordinate x
+ * @param y Start coordinate y
+ * @return TRUE on success, FALSE on error.
+ * @see imel_path_new
+ */
+bool imel_path_move_to (ImelPath *path, double x, double y)
+{
+ return_var_if_fail (path, false);
+
+ return __imel_path_add (path, IMEL_PATH_MOVE_TO, 1, &x, &y);
+}
+
+/**
+ * @brief Add a line to a path
+ *
+ * @param path Path where add the line
+ * @param x End coordinate x
+ * @param y End coordinate y
+ * @return TRUE on success, FALSE on error or if @p path is empty.
+ * @see imel_path_move_to
+ */
+bool imel_path_line_to (ImelPath *path, double x, double y)
+{
+ return_var_if_fail (path && path->n_elements, false);
+
+ return __imel_path_add (path, IMEL_PATH_LINE_TO, 1, &x, &y);
+}
+
+/**
+ * @brief Add a quadratic Bèzier's curve to a path
+ *
+ * @param path Path where add the curve
+ * @param cx Control coordinate x
+ * @param cy Control coordinate y
+ * @param x End coordinate x
+ * @param y End coordinate y
+ * @return TRUE on success, FALSE on error or if @p path is empty.
+ * @see imel_path_move_to
+ */
+bool imel_path_quadratic_to (ImelPath *path, double cx, double cy, double x, double y)
+{
+ double px[2], py[2];
+
+ return_var_if_fail (path && path->n_elements, false);
+
+ px[0] = cx;
+ px[1] = x;
+ py[0] = cy;
+ py[1] = y;
+
+ return __imel_path_add (path, IMEL_PATH_QUADRATIC_TO, 2, px, py);
+}
+
+/**
+ * @brief Add a cubic Bèzier's curve to a path
+ *
+ * @param path Path where add the curve
+ * @param cx1 First control coordinate x
+ * @param cy1 First control coordinate y
+ * @param cx2 Second control coordinate x
+ * @param cy2 Second control coordinate y
+ * @param x End coordinate x
+ * @param y End coordinate y
+ * @return TRUE on success, FALSE on error or if @p path is empty.
+ * @see imel_path_move_to
+ */
+bool imel_path_cubic_to (ImelPath *path, double cx1, double cy1, double cx2, double cy2, double x, double y)
+{
+ double px[3], py[3];
+
+ return_var_if_fail (path && path->n_elements, false);
+
+ px[0] = cx1;
+ px[1] = cx2;
+ px[2] = x;
+ py[0] = cy1;
+ py[1] = cy2;
+ py[2] = y;
+
+ return __imel_path_add (path, IMEL_PATH_CUBIC_TO, 3, px, py);
+}
+
+/**
+ * @brief Close the current contour of a path
+ *
+ * This function adds a line back to the start of the current contour.
+ * The next element, if it isn't #imel_path_move_to, starts a new contour
+ * from the same point.
+ *
+ * @param path Path to close
+ * @return TRUE on success, FALSE on error or if @p path is empty.
+ * @see imel_path_move_to
+ */
+bool imel_path_close (ImelPath *path)
+{
+ return_var_if_fail (path && path->n_elements, false);
+
+ return __imel_path_add (path, IMEL_PATH_CLOSE, 0, NULL, NULL);
+}
+
+/**
+ * @brief Draw the lines of a path
+ *
+ * This function draws the contours of @p path as lines one pixel wide.
+ * The curves are split in lines within the tolerance of @p path and each
+ * point of a contour is drawn once, also where two lines meet.
+ *
+ * @param image Image where draw the path
+ * @param path Path to draw
+ * @param pixel Color and level of the lines
+ * @see imel_path_new
+ * @see imel_draw_filled_path
+ */
+void imel_draw_path (ImelImage *image, const ImelPath *path, ImelPixel pixel)
+{
+ __ImelPathFlat flat;
+ __ImelPathContour *contour;
+ ImelSize i;
+
+ return_if_fail (image && path);
+
+ if ( ! __imel_path_flatten (path, &flat) )
+      return;
+
+ for ( i = 0; i < flat.n_contours; i++ ) {
+       contour = &(flat.contour[i]);
+       if ( contour->n_points )
+            __imel_path_stroke (image, flat.point + contour->first, contour->n_points, contour->closed,
+                                pixel, pixel);
+ }
+
+ image->generation++;
+ __imel_path_flat_clear (&flat);
+}
+
+/**
+ * @brief Fill a path
+ *
+ * This function fills the area inside the contours of @p path, each one
+ * closed by a line back to its start. The points inside are chosen by
+ * @p rule, as #imel_draw_filled_polygon does.
+ *
+ * @param image Image where draw the path
+ * @param path Path to fill
+ * @param rule Rule to choose the points inside the path
+ * @param pixel Color and level of the area
+ * @see imel_path_new
+ * @see imel_draw_filled_antialiased_path
+ */
+void imel_draw_filled_path (ImelImage *image, const ImelPath *path, ImelFillRule rule, ImelPixel pixel)
+{
+ __ImelPathFlat flat;
+ __ImelPathContour *contour;
+ __ImelPathPoint *a, *b;
+ __ImelPolygon polygon;
+ ImelSize i, j;
+
+ return_if_fail (image && path);
+
+ if ( ! __imel_path_flatten (path, &flat) )
+      return;
+
+ __imel_polygon_init (&polygon);
+ for ( i = 0; i < flat.n_contours; i++ ) {
+       contour = &(flat.contour[i]);
+       for ( j = 0; j < contour->n_points; j++ ) {
+             a = &(flat.point[contour->first + j]);
+             b = &(flat.point[contour->first + (( j + 1 < contour->n_points ) ? j + 1 : 0)]);
+             __imel_polygon_add_edge (&polygon, __imel_path_round (a->x), __imel_path_round (a->y),
+                                      __imel_path_round (b->x), __imel_path_round (b->y));
+       }
+ }
+
+ __imel_polygon_fill (image, &polygon, rule, global_brush != NULL, pixel);
+ image->generation++;
+ __imel_polygon_clear (&polygon);
+ __imel_path_flat_clear (&flat);
+}
+
+/**
+ * @brief Fill a path with anti-aliasing
+ *
+ * As #imel_draw_filled_path, but the pixels on the border are blended
+ * with @p pixel in proportion to their area inside the path, as
+ * #imel_draw_filled_antialiased_polygon does.
+ *
+ * @param image Image where draw the path
+ * @param path Path to fill
+ * @param rule Rule to choose the points inside the path
+ * @param pixel Color and level of the area
+ * @see imel_path_new
+ * @see imel_draw_filled_path
+ */
+void imel_draw_filled_antialiased_path (ImelImage *image, const ImelPath *path, ImelFillRule rule,
+                                        ImelPixel pixel)
+{
+ __ImelPathFlat flat;
+ __ImelPathContour *contour;
+ __ImelPathPoint *a, *b;
+ __ImelCoverage coverage;
+ ImelSize i, j;
+
+ return_if_fail (image && path);
+
+ if ( ! __imel_path_flatten (path, &flat) )
+      return;
+
+ __imel_coverage_init (&coverage);
+ for ( i = 0; i < flat.n_contours; i++ ) {
+       contour = &(flat.contour[i]);
+       for ( j = 0; j < contour->n_points; j++ ) {
+             a = &(flat.point[contour->first + j]);
+             b = &(flat.point[contour->first + (( j + 1 < contour->n_points ) ? j + 1 : 0)]);
+             __imel_coverage_add_line (&coverage, a->x, a->y, b->x, b->y);
+       }
+ }
+
+ __imel_coverage_fill (image, &coverage, rule, pixel);
+ image->generation++;
+ __imel_coverage_clear (&coverage);
+ __imel_path_flat_clear (&flat);
+}
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include "header.h"
+#include "kernel.h"
 /**
  * @file point.c
  * @author Davide Francesco Merico
@@ -31,24 +32,310 @@
 extern void imel_pixel_copy (ImelPixel *, ImelPixel);
 extern bool check_size (ImelImage *image, ImelSize xy, bool hw);
 extern double imel_value_convert (ImelValue from_value, double value, ImelValue to_value, ...);
+extern ImelSize __imel_thread_bands (ImelSize n, ImelSize grain);
+extern void __imel_thread_run_bands (ImelSize n, ImelSize bands, ImelBandFuncPtr func, ImelGenericPtr data);
+
+ImelPoint *imel_point_get_point_from_image (ImelImage *image, ImelSize x, ImelSize y);
+ImelPointArray *imel_point_array_new (ImelSize size);
+bool imel_point_array_add (ImelPointArray *array, ImelSize x, ImelSize y, ImelPixel pixel);
+void imel_point_array_destroy (ImelPointArray *array);
+ImelPoint **imel_point_array_to_list (const ImelPointArray *array);
+ImelPointArray *imel_point_get_array_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2, ImelSize _y2,
+                                                long int *lx, long int *ly, ImelValue value_type, double value);
+ImelPointArray *imel_point_get_array_from_reg_shape (ImelSize x, ImelSize y, ImelSize r, long v, double start_angle);
+
+/* Luma of a white pixel, see luma_row in kernel.h */
+#define __IMEL_POINT_LUMA_MAX 65280
+
+/* A pixel found by a search, @key is the luma for the brightest pixels
+ * and __IMEL_POINT_LUMA_MAX - luma for the darkest ones */
+typedef struct ___imel_point_rank {
+               uint32_t key;
+               ImelSize x;
+               ImelSize y;
+        } __ImelPointRank;
+
+typedef struct ___imel_point_band {
+               __ImelPointRank *rank;
+               ImelSize n;
+               ImelSize size;
+               uint32_t key;
+               bool failed;
+        } __ImelPointBand;
+
+typedef struct ___imel_point_search {
+               ImelImage *image;
+               bool brightest;
+               ImelSize k;
+               __ImelPointBand *band;
+               ImelSize n_bands;
+        } __ImelPointSearch;
+
+/* TRUE if @a is after @b in the result: lower key or, with the same key,
+ * found later in row-major order */
+static bool __imel_point_rank_worse (const __ImelPointRank *a, const __ImelPointRank *b)
+{
+ if ( a->key != b->key )
+      return a->key < b->key;
 
-#endif
+ return ( a->y != b->y ) ? a->y > b->y : a->x > b->x;
+}
 
-static ImelPoint *__imel_point_set_new (double x, double y, ImelPixel pixel)
+/* Heap with the worst rank at the top */
+static void __imel_point_heap_down (__ImelPointRank *heap, ImelSize n, ImelSize i)
 {
- ImelPoint *p;
- 
- p = (ImelPoint *) malloc (sizeof (ImelPoint));
- p->x = (ImelSize) x;
- p->y = (ImelSize) y;
- p->pixel.red = pixel.red;
- p->pixel.green = pixel.green;
- p->pixel.blue = pixel.blue;
- p->pixel.level = pixel.level;
- 
- return p;
+ __ImelPointRank tmp;
+ ImelSize child;
+
+ while ( (child = 2 * i + 1) < n ) {
+         if ( child + 1 < n && __imel_point_rank_worse (&heap[child + 1], &heap[child]) )
+              child++;
+         if ( ! __imel_point_rank_worse (&heap[child], &heap[i]) )
+              break;
+
+         tmp = heap[i];
+         heap[i] = heap[child];
+         heap[child] = tmp;
+         i = child;
+ }
+}
+
+static void __imel_point_heap_up (__ImelPointRank *heap, ImelSize i)
+{
+ __ImelPointRank tmp;
+
+ while ( i && __imel_point_rank_worse (&heap[i], &heap[(i - 1) / 2]) ) {
+         tmp = heap[i];
+         heap[i] = heap[(i - 1) / 2];
+         heap[(i - 1) / 2] = tmp;
+         i = (i - 1) / 2;
+ }
+}
+
+/* Add @rank to the heap of @band, keeping only the best @k */
+static void __imel_point_heap_add (__ImelPointBand *band, ImelSize k, __ImelPointRank rank)
+{
+ if ( band->n < k ) {
+      band->rank[band->n] = rank;
+      __imel_point_heap_up (band->rank, band->n++);
+ }
+ else if ( __imel_point_rank_worse (&band->rank[0], &rank) ) {
+      band->rank[0] = rank;
+      __imel_point_heap_down (band->rank, band->n, 0);
+ }
+}
+
+/* Add the pixels of row @y with the best key to the list of @band */
+static void __imel_point_band_ties (__ImelPointBand *band, const uint16_t *luma, ImelSize width,
+                                    ImelSize y, uint32_t key, bool brightest)
+{
+ __ImelPointRank *rank;
+ uint16_t value = brightest ? key : __IMEL_POINT_LUMA_MAX - key;
+ ImelSize x;
+
+ if ( key < band->key )
+      return;
+
+ if ( key > band->key ) {
+      band->key = key;
+      band->n = 0;
+ }
+
+ for ( x = 0; x < width; x++ ) {
+       if ( luma[x] != value )
+            continue;
+
+       if ( band->n == band->size ) {
+            rank = (__ImelPointRank *) realloc (band->rank, (band->size ? 2 * band->size : 64) *
+                                                            sizeof (__ImelPointRank));
+            if ( ! rank ) {
+                 band->failed = true;
+                 return;
+            }
+
+            band->rank = rank;
+            band->size = band->size ? 2 * band->size : 64;
+       }
+
+       band->rank[band->n].key = key;
+       band->rank[band->n].x = x;
+       band->rank[band->n++].y = y;
+ }
+}
+
+static void __imel_point_search_rows (ImelSize start, ImelSize end, ImelSize n_band, ImelGenericPtr data)
+{
+ __ImelPointSearch *search = (__ImelPointSearch *) data;
+ __ImelPointBand *band = &search->band[n_band];
+ const __ImelKernels *kernels = __imel_kernels ();
+ ImelSize y, x, width = search->image->width;
+ __ImelPointRank rank;
+ uint16_t *luma, min, max;
+ uint32_t key;
+
+ luma = (uint16_t *) malloc (width * sizeof (uint16_t));
+ if ( ! luma ) {
+      band->failed = true;
+      return;
+ }
+
+ if ( search->k ) {
+      band->rank = (__ImelPointRank *) malloc (search->k * sizeof (__ImelPointRank));
+      if ( ! band->rank ) {
+           free (luma);
+           band->failed = true;
+           return;
+      }
+ }
+
+ for ( y = start; y < end && ! band->failed; y++ ) {
+       min = __IMEL_POINT_LUMA_MAX;
+       max = 0;
+       kernels->luma_row (luma, search->image->pixel[y], width, &min, &max);
+       key = search->brightest ? max : __IMEL_POINT_LUMA_MAX - min;
+
+       if ( ! search->k ) {
+            __imel_point_band_ties (band, luma, width, y, key, search->brightest);
+            continue;
+       }
+
+       /* Pixels with the key of the worst one kept are after it */
+       if ( band->n == search->k && key <= band->rank[0].key )
+            continue;
+
+       rank.y = y;
+       for ( x = 0; x < width; x++ ) {
+             rank.key = search->brightest ? luma[x] : __IMEL_POINT_LUMA_MAX - luma[x];
+             rank.x = x;
+             __imel_point_heap_add (band, search->k, rank);
+       }
+ }
+
+ free (luma);
+}
+
+static void __imel_point_search_free (__ImelPointSearch *search)
+{
+ ImelSize i;
+
+ for ( i = 0; i < search->n_bands; i++ )
+       free (search->band[i].rank);
+ free (search->band);
+}
+
+/* Search the pixels of @image with the highest luma, or the lowest one if
+ * @brightest is FALSE, with a single pass split between threads. With @k
+ * not 0 the bands keep the best @k pixels, else all the pixels with the
+ * best luma. */
+static bool __imel_point_search (__ImelPointSearch *search, ImelImage *image, bool brightest, ImelSize k)
+{
+ ImelSize i;
+
+ search->image = image;
+ search->brightest = brightest;
+ search->k = k;
+ search->n_bands = __imel_thread_bands (image->height, 16);
+ search->band = (__ImelPointBand *) calloc (search->n_bands, sizeof (__ImelPointBand));
+ return_var_if_fail (search->band, false);
+
+ __imel_thread_run_bands (image->height, search->n_bands, __imel_point_search_rows, search);
+
+ for ( i = 0; i < search->n_bands; i++ ) {
+       if ( search->band[i].failed ) {
+            __imel_point_search_free (search);
+            return false;
+       }
+ }
+
+ return true;
+}
+
+/* Best @k pixels of @image sorted from the best, in @n_points their number */
+static __ImelPointRank *__imel_point_search_best (ImelImage *image, bool brightest, ImelSize k,
+                                                  ImelSize *n_points)
+{
+ __ImelPointSearch search;
+ __ImelPointBand merge;
+ __ImelPointRank tmp;
+ ImelSize i, j;
+
+ *n_points = 0;
+ k = ( k > (uint64_t) image->width * image->height ) ? image->width * image->height : k;
+ return_var_if_fail (k, NULL);
+ return_var_if_fail (__imel_point_search (&search, image, brightest, k), NULL);
+
+ merge.rank = (__ImelPointRank *) malloc (k * sizeof (__ImelPointRank));
+ merge.n = 0;
+ if ( merge.rank ) {
+      for ( i = 0; i < search.n_bands; i++ )
+            for ( j = 0; j < search.band[i].n; j++ )
+                  __imel_point_heap_add (&merge, k, search.band[i].rank[j]);
+
+      /* The worst one is moved at the end until the heap is empty */
+      for ( i = merge.n; i > 1; i-- ) {
+            tmp = merge.rank[0];
+            merge.rank[0] = merge.rank[i - 1];
+            merge.rank[i - 1] = tmp;
+            __imel_point_heap_down (merge.rank, i - 1, 0);
+      }
+      *n_points = merge.n;
+ }
+
+ __imel_point_search_free (&search);
+
+ return merge.rank;
+}
+
+/* All the pixels of @image with the best luma in row-major order */
+static ImelPointArray *__imel_point_search_ties (ImelImage *image, bool brightest)
+{
+ __ImelPointSearch search;
+ ImelPointArray *array;
+ __ImelPointRank *rank;
+ uint32_t key = 0;
+ ImelSize i, j, n = 0;
+
+ return_var_if_fail (image->width && image->height, NULL);
+ return_var_if_fail (__imel_point_search (&search, image, brightest, 0), NULL);
+
+ for ( i = 0; i < search.n_bands; i++ )
+       key = ( search.band[i].n && search.band[i].key > key ) ? search.band[i].key : key;
+ for ( i = 0; i < search.n_bands; i++ )
+       n += ( search.band[i].key == key ) ? search.band[i].n : 0;
+
+ array = imel_point_array_new (n);
+ if ( array ) {
+      for ( i = 0; i < search.n_bands; i++ ) {
+            if ( search.band[i].key != key )
+                 continue;
+
+            for ( j = 0; j < search.band[i].n; j++ ) {
+                  rank = &search.band[i].rank[j];
+                  imel_point_array_add (array, rank->x, rank->y, image->pixel[rank->y][rank->x]);
+            }
+      }
+ }
+
+ __imel_point_search_free (&search);
+
+ return array;
+}
+
+/* Convert @array to a NULL-terminated array and destroy it */
+static ImelPoint **__imel_point_array_to_list_destroy (ImelPointArray *array)
+{
+ ImelPoint **points;
+
+ return_var_if_fail (array, NULL);
+
+ points = imel_point_array_to_list (array);
+ imel_point_array_destroy (array);
+
+ return points;
 }
 
+#endif
+
 static void double_swap (double *a, double *b)
 {
  double c = *a;
@@ -122,6 +409,160 @@ void imel_point_array_free (ImelPoint **points)
  free (points);
 }
 
+/**
+ * @brief Make a new array of points
+ * 
+ * This function makes an empty array of points with room for @p size
+ * points. The array grows when needed.
+ * 
+ * @code
+ * ImelPointArray *points = imel_point_array_new (0);
+ * ImelPixel white = imel_pixel_new (0xff, 0xff, 0xff, 0);
+ * 
+ * imel_point_array_add (points, 10, 10, white);
+ * imel_point_array_add (points, 90, 10, white);
+ * imel_point_array_add (points, 50, 90, white);
+ * imel_draw_contiguous_figure_array (image, points, white);
+ * imel_point_array_destroy (points);
+ * @endcode
+ * 
+ * @param size Number of points to allocate, 0 for the default
+ * @return A new #ImelPointArray or NULL on error
+ * 
+ * @see imel_point_array_add
+ * @see imel_point_array_destroy
+ */
+ImelPointArray *imel_point_array_new (ImelSize size)
+{
+ ImelPointArray *array;
+
+ array = (ImelPointArray *) malloc (sizeof (ImelPointArray));
+ return_var_if_fail (array, NULL);
+
+ array->n_points = 0;
+ array->size = size ? size : 16;
+ array->point = (ImelPoint *) malloc (array->size * sizeof (ImelPoint));
+ if ( !array->point ) {
+      free (array);
+      return NULL;
+ }
+
+ return array;
+}
+
+/**
+ * @brief Add a point to an array
+ * 
+ * @param array Array of points
+ * @param x Point x coordinate
+ * @param y Point y coordinate
+ * @param pixel Point color and level
+ * @return TRUE if the point is added, else FALSE
+ * 
+ * @see imel_point_array_new
+ */
+bool imel_point_array_add (ImelPointArray *array, ImelSize x, ImelSize y, ImelPixel pixel)
+{
+ ImelPoint *point;
+
+ return_var_if_fail (array, false);
+
+ if ( array->n_points == array->size ) {
+      point = (ImelPoint *) realloc (array->point, 2 * array->size * sizeof (ImelPoint));
+      return_var_if_fail (point, false);
+
+      array->point = point;
+      array->size *= 2;
+ }
+
+ point = &(array->point[array->n_points++]);
+ point->x = x;
+ point->y = y;
+ point->pixel = pixel;
+
+ return true;
+}
+
+/**
+ * @brief Free an array of points
+ * 
+ * @param array Array of points to free
+ * @see imel_point_array_new
+ */
+void imel_point_array_destroy (ImelPointArray *array)
+{
+ return_if_fail (array);
+
+ free (array->point);
+ free (array);
+}
+
+/**
+ * @brief Make an array of points from a NULL-terminated one
+ * 
+ * @param points NULL-terminated #ImelPoint array, it isn't changed
+ * @return A new #ImelPointArray with a copy of @p points or NULL on error
+ * 
+ * @see imel_point_array_to_list
+ */
+ImelPointArray *imel_point_array_from_list (ImelPoint **points)
+{
+ ImelPointArray *array;
+ ImelSize n;
+
+ return_var_if_fail (points, NULL);
+
+ for ( n = 0; points[n]; n++ );
+
+ array = imel_point_array_new (n);
+ return_var_if_fail (array, NULL);
+
+ for ( n = 0; points[n]; n++ )
+       if ( ! imel_point_array_add (array, points[n]->x, points[n]->y, points[n]->pixel) ) {
+            imel_point_array_destroy (array);
+            return NULL;
+       }
+
+ return array;
+}
+
+/**
+ * @brief Make a NULL-terminated array of points from an array
+ * 
+ * @param array Array of points, it isn't changed
+ * @return A NULL-terminated #ImelPoint array to free with #imel_point_array_free
+ * or NULL on error
+ * 
+ * @see imel_point_array_from_list
+ */
+ImelPoint **imel_point_array_to_list (const ImelPointArray *array)
+{
+ ImelPoint **points;
+ ImelSize i;
+
+ return_var_if_fail (array, NULL);
+
+ points = (ImelPoint **) malloc ((array->n_points + 1) * sizeof (ImelPoint *));
+ return_var_if_fail (points, NULL);
+
+ for ( i = 0; i < array->n_points; i++ ) {
+       points[i] = (ImelPoint *) malloc (sizeof (ImelPoint));
+
+       if ( ! points[i] ) {
+            while ( i-- )
+                    free (points[i]);
+            free (points);
+
+            return NULL;
+       }
+
+       *(points[i]) = array->point[i];
+ }
+ points[i] = NULL;
+
+ return points;
+}
+
 /**
  * @brief Get a reference point from an image
  * 
@@ -159,9 +600,8 @@ ImelPoint *imel_point_get_point_from_image (ImelImage *image, ImelSize x, ImelSi
 /**
  * @brief Get a line points
  * 
- * This function get all points in the line from coordinate \f$(\_x_1,\_y_1)\f$
- * to coordinate \f$(\_x_2,\_y_2)\f$. You can get the line width and height 
- * respectively from @p lx and @p ly argument. 
+ * Same as #imel_point_get_array_from_line, with the result as
+ * NULL-terminated array.
  * 
  * @param _x1 Start line x coordinate
  * @param _y1 Start line y coordinate
@@ -180,12 +620,39 @@ ImelPoint *imel_point_get_point_from_image (ImelImage *image, ImelSize x, ImelSi
 ImelPoint **imel_point_get_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2, ImelSize _y2, long int *lx, 
                                       long int *ly, ImelValue value_type, double value)
 {
- ImelPoint **points;
+ return __imel_point_array_to_list_destroy (imel_point_get_array_from_line (_x1, _y1, _x2, _y2, lx, ly,
+                                                                            value_type, value));
+}
+
+/**
+ * @brief Get a line points
+ * 
+ * This function get all points in the line from coordinate \f$(\_x_1,\_y_1)\f$
+ * to coordinate \f$(\_x_2,\_y_2)\f$. You can get the line width and height 
+ * respectively from @p lx and @p ly argument. 
+ * 
+ * @param _x1 Start line x coordinate
+ * @param _y1 Start line y coordinate
+ * @param _x2 End line x coordinate
+ * @param _y2 End line y coordinate
+ * @param lx NULL or if passed, this function put inside it the line width
+ * @param ly NULL or if passed, this function put inside it the line height
+ * @param value_type Type of value passed as @p value
+ * @param value Number of points you want to get from the line. The points will be
+ * uniformely distributed.
+ * @return An array with the line points, to free with #imel_point_array_destroy
+ * 
+ * @see ImelValue
+ * @see imel_point_get_from_line
+ */
+ImelPointArray *imel_point_get_array_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2, ImelSize _y2,
+                                                long int *lx, long int *ly, ImelValue value_type, double value)
+{
+ ImelPointArray *points;
  static ImelPixel alpha = { 0, 0, 0, -255 };
  double dx, dy, px, py, pixel, jmp;
  double x[2] = { (double) _x1, (double) _x2 };
  double y[2] = { (double) _y1, (double) _y2 };
- long int j = -1;
   
  if ( _y1 == _y2 && _x1 == _x2 ) {
       if ( lx )
@@ -193,9 +660,9 @@ ImelPoint **imel_point_get_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2,
       if ( ly ) 
            *ly = 0;
            
-      points = (ImelPoint **) malloc (sizeof (ImelPoint *) << 1);
-      *points = __imel_point_set_new (_x1, _y1, alpha);
-      points[1] = NULL;
+      points = imel_point_array_new (1);
+      return_var_if_fail (points, NULL);
+      imel_point_array_add (points, _x1, _y1, alpha);
       
       return points;
  }
@@ -222,7 +689,8 @@ ImelPoint **imel_point_get_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2,
       if ( !jmp )
             jmp = 1;
 
-      points = (ImelPoint **) malloc (sizeof (ImelPoint *) * (1 + (abs ((int) dx) / jmp)));
+      points = imel_point_array_new (2 + (abs ((int) dx) / jmp));
+      return_var_if_fail (points, NULL);
            
       if ( x[0] > x[1] ) {
            double_swap (&(y[0]), &(y[1]));
@@ -232,9 +700,8 @@ ImelPoint **imel_point_get_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2,
       for ( px = x[0]; px < x[1]; px += jmp ) {
             py = ((px - x[0]) / dx) * dy + y[0];
             
-            points[++j] = __imel_point_set_new (px, py, alpha);
+            imel_point_array_add (points, (ImelSize) px, (ImelSize) py, alpha);
       }
-      points[++j] = NULL;
 
       return points;
  }
@@ -247,7 +714,8 @@ ImelPoint **imel_point_get_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2,
  if ( !jmp )
        jmp = 1;
 
- points = (ImelPoint **) malloc (sizeof (ImelPoint *) * (1 + (abs ((int) dy) / jmp)));
+ points = imel_point_array_new (2 + (abs ((int) dy) / jmp));
+ return_var_if_fail (points, NULL);
            
  if ( y[0] > y[1] ) {
       double_swap (&(y[0]), &(y[1]));
@@ -257,9 +725,8 @@ ImelPoint **imel_point_get_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2,
  for ( py = y[0]; py < y[1]; py += jmp ) {
        px = ((py - y[0]) / dy) * dx + x[0];
 
-       points[++j] = __imel_point_set_new (px, py, alpha);
+       imel_point_array_add (points, (ImelSize) px, (ImelSize) py, alpha);
  }
- points[++j] = NULL;
 
  return points;
 }
@@ -267,8 +734,8 @@ ImelPoint **imel_point_get_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2,
 /**
  * @brief Get a regular shape points
  * 
- * This function get the points from a regular shape with center in coordinate
- * \f$(x,y)\f$, @p r radius, @p v vertices and an angle of @p start angle.
+ * Same as #imel_point_get_array_from_reg_shape, with the result as
+ * NULL-terminated array.
  * 
  * @param x Center x coordinate
  * @param y Center y coordinate
@@ -283,23 +750,42 @@ ImelPoint **imel_point_get_from_line (ImelSize _x1, ImelSize _y1, ImelSize _x2,
  */
 ImelPoint **imel_point_get_from_reg_shape (ImelSize x, ImelSize y, ImelSize r, long v, double start_angle)
 {
- int j = -1;
- ImelPoint **points;
+ return __imel_point_array_to_list_destroy (imel_point_get_array_from_reg_shape (x, y, r, v, start_angle));
+}
+
+/**
+ * @brief Get a regular shape points
+ * 
+ * This function get the points from a regular shape with center in coordinate
+ * \f$(x,y)\f$, @p r radius, @p v vertices and an angle of @p start angle.
+ * 
+ * @param x Center x coordinate
+ * @param y Center y coordinate
+ * @param r Radius
+ * @param v Vertices
+ * @param start_angle Start angle in radians
+ * @return An array with the @p v vertices, to free with #imel_point_array_destroy
+ * 
+ * @see imel_point_get_from_reg_shape
+ * @see RAD_TO_DEG
+ * @see DEG_TO_RAD
+ */
+ImelPointArray *imel_point_get_array_from_reg_shape (ImelSize x, ImelSize y, ImelSize r, long v, double start_angle)
+{
+ long j;
+ ImelPointArray *points;
  static ImelPixel alpha = { 0, 0, 0, -255 };
  double increment = 6.283185307f / ((double) v ? v : 1.f);
  
  return_var_if_fail (v > 2 && start_angle < 3.141592654f 
                      && start_angle > -3.141592654f, NULL);
  
- points = (ImelPoint **) malloc (sizeof (ImelPoint *) * (v + 2));
- 
- *points = __imel_point_set_new (((double) x) + (((double) r) * cos (start_angle)), 
-                                 ((double) y) - (((double) r) * sin (start_angle)), alpha);
+ points = imel_point_array_new (v);
+ return_var_if_fail (points, NULL);
 	
- for ( start_angle += increment ; ++j < v ; start_angle += increment )
-       points[j] = __imel_point_set_new (((double) x) + (((double) r) * cos (start_angle)), 
-                                         ((double) y) - (((double) r) * sin (start_angle)), alpha);
- points[j] = NULL;
+ for ( j = 0, start_angle += increment; j < v; j++, start_angle += increment )
+       imel_point_array_add (points, (ImelSize) (((double) x) + (((double) r) * cos (start_angle))), 
+                             (ImelSize) (((double) y) - (((double) r) * sin (start_angle))), alpha);
  
  return points;
 } 
@@ -307,6 +793,9 @@ ImelPoint **imel_point_get_from_reg_shape (ImelSize x, ImelSize y, ImelSize r, l
 /**
  * @brief Get the darkest point of an image
  * 
+ * The luma of each pixel is \f$(77R + 151G + 28B) / 256\f$, with more
+ * pixels with the same luma the first one in row-major order is returned.
+ * 
  * @param image Reference image
  * @return A new #ImelPoint type
  *
@@ -315,26 +804,19 @@ ImelPoint **imel_point_get_from_reg_shape (ImelSize x, ImelSize y, ImelSize r, l
  */
 ImelPoint *imel_point_get_darkest_point (ImelImage *image)
 {
- ImelSize y, x, dx, dy;
- double light, min_light = 255.f;
+ __ImelPointRank *rank;
+ ImelPoint *point;
+ ImelSize n;
  
  return_var_if_fail (image, NULL);
  
- for ( y = 0; y < image->height; y++ ) {
-      for ( x = 0; x < image->width; x++ ) {
-            light = (0.30f * ((double) image->pixel[y][x].red)) 
-                  + (0.59f * ((double) image->pixel[y][x].green))
-                  + (0.11f * ((double) image->pixel[y][x].blue));
-                  
-            if ( light < min_light ) {
-                 min_light = light;
-                 dx = x;
-                 dy = y;
-            }
-      }
- }
+ rank = __imel_point_search_best (image, false, 1, &n);
+ return_var_if_fail (rank, NULL);
  
- return imel_point_get_point_from_image (image, dx, dy);
+ point = imel_point_get_point_from_image (image, rank->x, rank->y);
+ free (rank);
+ 
+ return point;
 }
 
 /**
@@ -345,51 +827,44 @@ ImelPoint *imel_point_get_darkest_point (ImelImage *image)
  * the darkest point.
  * 
  * @param image Reference image
- * @return A new #ImelPoint type
+ * @return A NULL-terminated array with the points in row-major order
  *
  * @see imel_point_get_brightest_point
  * @see imel_point_get_darkest_point
+ * @see imel_point_get_darkest_n_points
+ * @see imel_point_array_free
  */
 ImelPoint **imel_point_get_darkest_points (ImelImage *image)
 {
- ImelPoint **points;
- ImelSize y, x, dx, dy, j = 1;
- double light, min_light = 255.f;
- 
  return_var_if_fail (image, NULL);
  
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             light = (0.30f * ((double) image->pixel[y][x].red)) 
-                   + (0.59f * ((double) image->pixel[y][x].green))
-                   + (0.11f * ((double) image->pixel[y][x].blue));
-                   
-             if ( light < min_light )
-                  min_light = light;
-       }
- }
- 
- points = (ImelPoint **) malloc (j * sizeof (ImelPoint *));
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             light = (0.30f * ((double) image->pixel[y][x].red)) 
-                   + (0.59f * ((double) image->pixel[y][x].green))
-                   + (0.11f * ((double) image->pixel[y][x].blue));
-             
-             if ( light == min_light ) {
-                  points[j - 1] = imel_point_get_point_from_image (image, x, y);
-                  points = (ImelPoint **) realloc (points, ++j * sizeof (ImelPoint *));
-             }
-       }
- }
- points[j - 1] = NULL;
+ return __imel_point_array_to_list_destroy (__imel_point_search_ties (image, false));
+}
+
+/**
+ * @brief Get the darkest points of an image
+ * 
+ * Same as #imel_point_get_darkest_points, with the result as #ImelPointArray.
+ * 
+ * @param image Reference image
+ * @return An array with the points in row-major order, to free with
+ * #imel_point_array_destroy
+ *
+ * @see imel_point_get_darkest_points
+ */
+ImelPointArray *imel_point_get_darkest_array (ImelImage *image)
+{
+ return_var_if_fail (image, NULL);
  
- return points;
+ return __imel_point_search_ties (image, false);
 }
 
 /**
  * @brief Get the brightest point of an image
  * 
+ * The luma of each pixel is \f$(77R + 151G + 28B) / 256\f$, with more
+ * pixels with the same luma the first one in row-major order is returned.
+ * 
  * @param image Reference image
  * @return A new #ImelPoint type
  *
@@ -398,26 +873,19 @@ ImelPoint **imel_point_get_darkest_points (ImelImage *image)
  */
 ImelPoint *imel_point_get_brightest_point (ImelImage *image)
 {
- ImelSize y, x, dx, dy;
- double light, min_light = 0.f;
+ __ImelPointRank *rank;
+ ImelPoint *point;
+ ImelSize n;
  
  return_var_if_fail (image, NULL);
  
- for ( y = 0; y < image->height; y++ ) {
-      for ( x = 0; x < image->width; x++ ) {
-            light = (0.30f * ((double) image->pixel[y][x].red)) 
-                  + (0.59f * ((double) image->pixel[y][x].green))
-                  + (0.11f * ((double) image->pixel[y][x].blue));
-                  
-            if ( light > min_light ) {
-                 min_light = light;
-                 dx = x;
-                 dy = y;
-            }
-      }
- }
+ rank = __imel_point_search_best (image, true, 1, &n);
+ return_var_if_fail (rank, NULL);
  
- return imel_point_get_point_from_image (image, dx, dy);
+ point = imel_point_get_point_from_image (image, rank->x, rank->y);
+ free (rank);
+ 
+ return point;
 }
 
 /**
@@ -428,44 +896,112 @@ ImelPoint *imel_point_get_brightest_point (ImelImage *image)
  * the brightest point.
  * 
  * @param image Reference image
- * @return A new #ImelPoint type
+ * @return A NULL-terminated array with the points in row-major order
  *
  * @see imel_point_get_brightest_point
  * @see imel_point_get_darkest_points
+ * @see imel_point_get_brightest_n_points
+ * @see imel_point_array_free
  */
 ImelPoint **imel_point_get_brightest_points (ImelImage *image)
 {
- ImelPoint **points;
- ImelSize y, x, dx, dy, j = 1;
- double light, min_light = 0.f;
- 
  return_var_if_fail (image, NULL);
  
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             light = (0.30f * ((double) image->pixel[y][x].red)) 
-                   + (0.59f * ((double) image->pixel[y][x].green))
-                   + (0.11f * ((double) image->pixel[y][x].blue));
-                   
-             if ( light > min_light )
-                  min_light = light;
-       }
- }
+ return __imel_point_array_to_list_destroy (__imel_point_search_ties (image, true));
+}
+
+/**
+ * @brief Get the brightest points of an image
+ * 
+ * Same as #imel_point_get_brightest_points, with the result as #ImelPointArray.
+ * 
+ * @param image Reference image
+ * @return An array with the points in row-major order, to free with
+ * #imel_point_array_destroy
+ *
+ * @see imel_point_get_brightest_points
+ */
+ImelPointArray *imel_point_get_brightest_array (ImelImage *image)
+{
+ return_var_if_fail (image, NULL);
  
- points = (ImelPoint **) malloc (j * sizeof (ImelPoint *));
- for ( y = 0; y < image->height; y++ ) {
-       for ( x = 0; x < image->width; x++ ) {
-             light = (0.30f * ((double) image->pixel[y][x].red)) 
-                   + (0.59f * ((double) image->pixel[y][x].green))
-                   + (0.11f * ((double) image->pixel[y][x].blue));
-             
-             if ( light == min_light ) {
-                  points[j - 1] = imel_point_get_point_from_image (image, x, y);
-                  points = (ImelPoint **) realloc (points, ++j * sizeof (ImelPoint *));
-             }
-       }
+ return __imel_point_search_ties (image, true);
+}
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+static ImelPointArray *__imel_point_get_n_points (ImelImage *image, bool brightest, ImelSize n)
+{
+ __ImelPointRank *rank;
+ ImelPointArray *points;
+ ImelSize i, found;
+
+ rank = __imel_point_search_best (image, brightest, n, &found);
+ return_var_if_fail (rank, NULL);
+
+ points = imel_point_array_new (found);
+ if ( points ) {
+      for ( i = 0; i < found; i++ )
+            imel_point_array_add (points, rank[i].x, rank[i].y, image->pixel[rank[i].y][rank[i].x]);
  }
- points[j - 1] = NULL;
- 
+
+ free (rank);
+
  return points;
 }
+
+#endif
+
+/**
+ * @brief Get the darkest points of an image
+ * 
+ * This function returns the @p n pixels of @p image with the lowest luma,
+ * from the darkest one. Pixels with the same luma are sorted in
+ * row-major order. The image is read once and only the best @p n pixels
+ * found are kept, so asking few points of a large image is cheap.
+ * 
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.jpg", 0, NULL);
+ * ImelPointArray *points = imel_point_get_darkest_n_points (image, 10);
+ * ImelSize i;
+ * 
+ * for ( i = 0; i < points->n_points; i++ )
+ *       printf ("%u %u\n", (unsigned) points->point[i].x, (unsigned) points->point[i].y);
+ * imel_point_array_destroy (points);
+ * @endcode
+ * 
+ * @param image Reference image
+ * @param n Number of points to get, less are returned if @p image is smaller
+ * @return An array of points to free with #imel_point_array_destroy or NULL on error
+ * 
+ * @see imel_point_get_darkest_points
+ * @see imel_point_get_brightest_n_points
+ * @see imel_thread_set_count
+ */
+ImelPointArray *imel_point_get_darkest_n_points (ImelImage *image, ImelSize n)
+{
+ return_var_if_fail (image && n, NULL);
+
+ return __imel_point_get_n_points (image, false, n);
+}
+
+/**
+ * @brief Get the brightest points of an image
+ * 
+ * Same as #imel_point_get_darkest_n_points, from the pixel with the
+ * highest luma.
+ * 
+ * @param image Reference image
+ * @param n Number of points to get, less are returned if @p image is smaller
+ * @return An array of points to free with #imel_point_array_destroy or NULL on error
+ * 
+ * @see imel_point_get_brightest_points
+ * @see imel_point_get_darkest_n_points
+ * @see imel_thread_set_count
+ */
+ImelPointArray *imel_point_get_brightest_n_points (ImelImage *image, ImelSize n)
+{
+ return_var_if_fail (image && n, NULL);
+
+ return __imel_point_get_n_points (image, true, n);
+}
@@ -0,0 +1,369 @@
+/*
+ * "point_op.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include "header.h"
+#include "kernel.h"
+/**
+ * @file point_op.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to compose operations on single
+ *        color values and apply them with a single pass.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+extern void __imel_thread_run (ImelSize n, ImelSize grain, ImelBandFuncPtr func, ImelGenericPtr data);
+
+typedef struct ___imel_point_op_apply {
+               ImelImage *image;
+               const ImelPointOp *point_op;
+        } __ImelPointOpApply;
+
+/* Compose @table after the current tables of the channels in @mask. The
+ * tables of pixels with negative level are changed too if @alpha is TRUE,
+ * like the single function does. */
+static void __imel_point_op_compose (ImelPointOp *point_op, ImelMask mask, const ImelColor *table, bool alpha)
+{
+ int c, i;
+
+ for ( c = 0; c < 3; c++ ) {
+       if ( ! (mask & (1 << c)) )
+            continue;
+
+       for ( i = 0; i < 256; i++ ) {
+             point_op->lut[c][i] = table[point_op->lut[c][i]];
+             if ( alpha )
+                  point_op->alpha_lut[c][i] = table[point_op->alpha_lut[c][i]];
+       }
+ }
+}
+
+/* Compose @next after @point_op */
+void __imel_point_op_compose_op (ImelPointOp *point_op, const ImelPointOp *next)
+{
+ int c, i;
+
+ for ( c = 0; c < 3; c++ ) {
+       for ( i = 0; i < 256; i++ ) {
+             point_op->lut[c][i] = next->lut[c][point_op->lut[c][i]];
+             point_op->alpha_lut[c][i] = next->alpha_lut[c][point_op->alpha_lut[c][i]];
+       }
+ }
+}
+
+static void __imel_point_op_rows (ImelSize start, ImelSize end, ImelSize band, ImelGenericPtr data)
+{
+ __ImelPointOpApply *apply = (__ImelPointOpApply *) data;
+ const __ImelKernels *kernels = __imel_kernels ();
+ ImelSize y;
+
+ (void) band;
+
+ for ( y = start; y < end; y++ )
+       kernels->lut_row (apply->image->pixel[y], apply->image->width,
+                         apply->point_op->lut, apply->point_op->alpha_lut);
+}
+
+/* Apply @point_op to @image */
+void __imel_point_op_apply (ImelImage *image, const ImelPointOp *point_op)
+{
+ __ImelPointOpApply apply;
+
+ apply.image = image;
+ apply.point_op = point_op;
+
+ __imel_thread_run (image->height, 64, __imel_point_op_rows, &apply);
+ image->generation++;
+}
+
+#endif
+
+/**
+ * @brief Reset a point operation
+ *
+ * This function reset @p point_op to the identity: applied to an image it
+ * doesn't change anything.
+ *
+ * @param point_op Point operation to reset
+ * @see imel_point_op_new
+ */
+void imel_point_op_reset (ImelPointOp *point_op)
+{
+ int c, i;
+
+ return_if_fail (point_op);
+
+ for ( c = 0; c < 3; c++ )
+       for ( i = 0; i < 256; i++ )
+             point_op->lut[c][i] = point_op->alpha_lut[c][i] = i;
+}
+
+/**
+ * @brief Make a new point operation
+ *
+ * This function makes a new point operation. A point operation is a
+ * sequence of operations that change each color channel as function
+ * of its value only ( brightness, contrast, filters, ... ). All the
+ * operations added are composed in a lookup table for each channel, so
+ * they are applied with a single pass over the image.
+ *
+ * @code
+ * ImelImage *image = imel_image_new_from ("image.jpg", 0, NULL);
+ * ImelPointOp *point_op = imel_point_op_new ();
+ *
+ * imel_point_op_add_brightness (point_op, 10);
+ * imel_point_op_add_contrast (point_op, 30);
+ * imel_point_op_add_color (point_op, 0xfd, 0xb4, 0x55);
+ * imel_image_apply_point_op (image, point_op);
+ *
+ * imel_point_op_free (point_op);
+ * @endcode
+ *
+ * @return A new point operation or NULL on error.
+ * @see imel_image_apply_point_op
+ * @see imel_point_op_free
+ */
+ImelPointOp *imel_point_op_new (void)
+{
+ ImelPointOp *point_op;
+
+ point_op = (ImelPointOp *) malloc (sizeof (ImelPointOp));
+ return_var_if_fail (point_op, NULL);
+
+ imel_point_op_reset (point_op);
+
+ return point_op;
+}
+
+/**
+ * @brief Free a point operation
+ *
+ * @param point_op Point operation to free
+ * @see imel_point_op_new
+ */
+void imel_point_op_free (ImelPointOp *point_op)
+{
+ return_if_fail (point_op);
+
+ free (point_op);
+}
+
+/**
+ * @brief Add a brightness change
+ *
+ * Same as #IMEL_EFFECT_BRIGHTNESS.
+ *
+ * @param point_op Point operation
+ * @param perc Brightness, a value between -100 and +100
+ * @see imel_point_op_new
+ */
+void imel_point_op_add_brightness (ImelPointOp *point_op, int perc)
+{
+ ImelColor table[256];
+ int i, v;
+
+ return_if_fail (point_op);
+
+ perc = ( perc > 100 ) ? 100 : ( perc < -100 ) ? -100 : perc;
+ perc = (perc * 255) / 100;
+
+ for ( i = 0; i < 256; i++ ) {
+       v = i + perc;
+       table[i] = ( v > 255 ) ? 255 : ( v < 0 ) ? 0 : v;
+ }
+
+ __imel_point_op_compose (point_op, IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE, table, false);
+}
+
+/**
+ * @brief Add a contrast change
+ *
+ * Same as #IMEL_EFFECT_CONTRAST.
+ *
+ * @param point_op Point operation
+ * @param s Contrast, a number between -127 and +128
+ * @see imel_point_op_new
+ */
+void imel_point_op_add_contrast (ImelPointOp *point_op, int s)
+{
+ ImelColor table[256];
+ float contrast, contrast_arg = (s > 128) ? 1.0f : (s < -127) ? -1.0f : s / 127.0f;
+ int i;
+
+ return_if_fail (point_op);
+
+ if ( contrast_arg >= 0.0f ) {
+      contrast_arg = (contrast_arg > 0.99999f) ? 0.99999 : contrast_arg;
+      contrast_arg = 1.0f / (1.0f - contrast_arg);
+ }
+ else contrast_arg = 1.0f + contrast_arg;
+
+ for ( i = 0; i < 256; i++ ) {
+       contrast = (((((float) i) / 255) - 0.5f) * contrast_arg) + 0.5f;
+       table[i] = (contrast > 1.0f) ? 255 : (contrast < 0.0f ) ? 0 : contrast * 255;
+ }
+
+ __imel_point_op_compose (point_op, IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE, table, true);
+}
+
+/**
+ * @brief Add a color inversion
+ *
+ * Same as #IMEL_EFFECT_INVERT.
+ *
+ * @param point_op Point operation
+ * @see imel_point_op_new
+ */
+void imel_point_op_add_invert (ImelPointOp *point_op)
+{
+ ImelColor table[256];
+ int i;
+
+ return_if_fail (point_op);
+
+ for ( i = 0; i < 256; i++ )
+       table[i] = 255 - i;
+
+ __imel_point_op_compose (point_op, IMEL_MASK_RED | IMEL_MASK_GREEN | IMEL_MASK_BLUE, table, false);
+}
+
+/**
+ * @brief Add a filter
+ *
+ * Same as #imel_image_apply_filter: set to 255 the channels in @p mask.
+ *
+ * @param point_op Point operation
+ * @param mask Channel, or channels, to set to 255
+ * @note IMEL_MASK_LEVEL is ignored.
+ * @see imel_point_op_new
+ */
+void imel_point_op_add_filter (ImelPointOp *point_op, ImelMask mask)
+{
+ ImelColor table[256];
+ int i;
+
+ return_if_fail (point_op);
+
+ for ( i = 0; i < 256; i++ )
+       table[i] = 255;
+
+ __imel_point_op_compose (point_op, mask, table, false);
+}
+
+/**
+ * @brief Add a base color removal
+ *
+ * Same as #imel_image_remove_base_color: set to 0 the channels in @p mask.
+ *
+ * @param point_op Point operation
+ * @param mask Channel, or channels, to set to 0
+ * @note IMEL_MASK_LEVEL is ignored.
+ * @see imel_point_op_new
+ */
+void imel_point_op_add_remove_base_color (ImelPointOp *point_op, ImelMask mask)
+{
+ ImelColor table[256] = { 0 };
+
+ return_if_fail (point_op);
+
+ __imel_point_op_compose (point_op, mask, table, false);
+}
+
+/**
+ * @brief Add a color
+ *
+ * Same as #imel_image_apply_color with mono set to FALSE.
+ *
+ * @param point_op Point operation
+ * @param red Red value
+ * @param green Green value
+ * @param blue Blue value
+ * @see imel_point_op_new
+ */
+void imel_point_op_add_color (ImelPointOp *point_op, ImelColor red, ImelColor green, ImelColor blue)
+{
+ ImelColor table[3][256];
+ int i;
+
+ return_if_fail (point_op);
+
+ for ( i = 0; i < 256; i++ ) {
+       table[0][i] = (i * red) / 255;
+       table[1][i] = (i * green) / 255;
+       table[2][i] = (i * blue) / 255;
+ }
+
+ __imel_point_op_compose (point_op, IMEL_MASK_RED, table[0], false);
+ __imel_point_op_compose (point_op, IMEL_MASK_GREEN, table[1], false);
+ __imel_point_op_compose (point_op, IMEL_MASK_BLUE, table[2], false);
+}
+
+/**
+ * @brief Add a bit shift
+ *
+ * Same as #imel_image_shift_bpc.
+ *
+ * @param point_op Point operation
+ * @param bpc_shift_red Bits to shift on red channel, to right if positive
+ * @param bpc_shift_green Bits to shift on green channel, to right if positive
+ * @param bpc_shift_blue Bits to shift on blue channel, to right if positive
+ * @see imel_point_op_new
+ */
+void imel_point_op_add_shift_bpc (ImelPointOp *point_op, int bpc_shift_red, int bpc_shift_green,
+                                  int bpc_shift_blue)
+{
+ ImelColor table[256];
+ int i, c, shift[3];
+
+ return_if_fail (point_op);
+
+ shift[0] = bpc_shift_red;
+ shift[1] = bpc_shift_green;
+ shift[2] = bpc_shift_blue;
+
+ for ( c = 0; c < 3; c++ ) {
+       for ( i = 0; i < 256; i++ ) {
+             if ( shift[c] < 1 )
+                  table[i] = ( -shift[c] > 7 ) ? 0 : (ImelColor) (i << -shift[c]);
+             else table[i] = ( shift[c] > 7 ) ? 0 : i >> shift[c];
+       }
+
+       __imel_point_op_compose (point_op, 1 << c, table, true);
+ }
+}
+
+/**
+ * @brief Apply a point operation to an image
+ *
+ * This function apply all the operations added to @p point_op with a
+ * single pass over @p image. Each operation changes the pixels with a
+ * negative level only if its single function does, so the result is the
+ * same as applying them one by one.
+ *
+ * @param image Image to elaborate
+ * @param point_op Point operation to apply
+ * @see imel_point_op_new
+ */
+void imel_image_apply_point_op (ImelImage *image, ImelPointOp *point_op)
+{
+ return_if_fail (image && point_op);
+
+ __imel_point_op_apply (image, point_op);
+}
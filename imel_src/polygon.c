@@ -0,0 +1,683 @@
+/*
+ * "polygon.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "header.h"
+#include "polygon.h"
+/**
+ * @file polygon.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to fill polygons.
+ *
+ * Polygons are filled a row at a time with an active edge table: only
+ * the sides that cross the current row are kept, sorted by the point
+ * where they cross it, and the parts of the row inside the polygon are
+ * drawn as spans. A pixel is inside if its center is, the sides on the
+ * right and on the bottom are left out so polygons that share a side
+ * don't overlap.
+ *
+ * The anti-aliased filler computes instead the area of each pixel covered
+ * by the polygon: each side adds its signed area to a buffer of a few
+ * rows and a running sum along each row gives the coverage, which is
+ * blended by the span kernels.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+extern ImelImage *global_brush;
+
+extern void __imel_draw_fill_span (ImelImage *image, long x0, long x1, long y, bool brush, ImelPixel pixel);
+extern void __imel_draw_cover_span (ImelImage *image, long x, long y, const unsigned char *coverage, long length,
+                                    ImelPixel pixel);
+
+/* Rows of the buffer of the anti-aliased filler */
+#define __IMEL_COVERAGE_ROWS 16
+
+static int __imel_polygon_edge_compare (const void *a, const void *b)
+{
+ const __ImelPolygonEdge *ea = (const __ImelPolygonEdge *) a, *eb = (const __ImelPolygonEdge *) b;
+
+ return ( ea->top < eb->top ) ? -1 : ( ea->top > eb->top );
+}
+
+/* First pixel at the right of the crossing of @edge */
+#define __IMEL_POLYGON_EDGE_CEIL(edge) ((edge)->x + ((edge)->r > 0))
+
+/* Move the crossing of @edge down by @rows rows */
+static void __imel_polygon_edge_advance (__ImelPolygonEdge *edge, int64_t rows)
+{
+ edge->x += rows * edge->q_step;
+ edge->r += rows * edge->r_step;
+ edge->x += edge->r / edge->d;
+ edge->r %= edge->d;
+}
+
+void __imel_polygon_init (__ImelPolygon *polygon)
+{
+ polygon->edge = NULL;
+ polygon->n_edges = 0;
+ polygon->size = 0;
+ polygon->failed = false;
+}
+
+void __imel_polygon_clear (__ImelPolygon *polygon)
+{
+ free (polygon->edge);
+ __imel_polygon_init (polygon);
+}
+
+/* Add the side from (x0, y0) to (x1, y1), horizontal sides are skipped */
+void __imel_polygon_add_edge (__ImelPolygon *polygon, long x0, long y0, long x1, long y1)
+{
+ __ImelPolygonEdge *edge;
+ int64_t dx;
+
+ if ( y0 == y1 || polygon->failed )
+      return;
+
+ if ( polygon->n_edges == polygon->size ) {
+      edge = (__ImelPolygonEdge *) realloc (polygon->edge, sizeof (__ImelPolygonEdge) *
+                                            (polygon->size ? polygon->size << 1 : 16));
+      if ( ! edge ) {
+           polygon->failed = true;
+           return;
+      }
+
+      polygon->edge = edge;
+      polygon->size = polygon->size ? polygon->size << 1 : 16;
+ }
+
+ edge = &(polygon->edge[polygon->n_edges++]);
+ edge->winding = ( y1 > y0 ) ? 1 : -1;
+ if ( y1 < y0 ) {
+      edge->top = y1;
+      edge->bottom = y0;
+      edge->x = x1;
+      dx = x0 - x1;
+ }
+ else {
+      edge->top = y0;
+      edge->bottom = y1;
+      edge->x = x0;
+      dx = x1 - x0;
+ }
+
+ edge->r = 0;
+ edge->d = edge->bottom - edge->top;
+ edge->q_step = dx / edge->d - ( dx % edge->d < 0 );
+ edge->r_step = dx - edge->q_step * edge->d;
+}
+
+/* Sort the edges of @polygon from the top one, as __imel_polygon_fill_at ()
+ * needs */
+void __imel_polygon_sort (__ImelPolygon *polygon)
+{
+ if ( ! polygon->failed && polygon->n_edges )
+      qsort (polygon->edge, polygon->n_edges, sizeof (__ImelPolygonEdge), __imel_polygon_edge_compare);
+}
+
+/* Fill the sorted @polygon in @image with @rule, with the brush only if
+ * @brush is TRUE. The pixel (0, 0) of @image is the point (ox, oy) of
+ * the polygon: only the edges that cross its rows are copied and moved,
+ * so the same polygon can be filled in many images at the same time. */
+void __imel_polygon_fill_at (ImelImage *image, const __ImelPolygon *polygon, long ox, long oy,
+                             ImelFillRule rule, bool brush, ImelPixel pixel)
+{
+ __ImelPolygonEdge **active, *edge, *copy;
+ ImelSize next = 0, n_active = 0, n_copies = 0, n, lo, hi, i, j;
+ long y, bottom = oy + (long) image->height, start = 0;
+ int winding;
+
+ if ( polygon->failed || ! polygon->n_edges || ! image->width )
+      return;
+
+ /* The edges from @n on start below the image */
+ for ( lo = 0, hi = polygon->n_edges; lo < hi; ) {
+       n = lo + (hi - lo) / 2;
+       if ( polygon->edge[n].top < bottom )
+            lo = n + 1;
+       else hi = n;
+ }
+ n = lo;
+
+ for ( i = 0; i < n; i++ )
+       n_copies += polygon->edge[i].bottom > oy;
+
+ if ( ! n_copies )
+      return;
+
+ copy = (__ImelPolygonEdge *) malloc (sizeof (__ImelPolygonEdge) * n_copies);
+ active = (__ImelPolygonEdge **) malloc (sizeof (__ImelPolygonEdge *) * n_copies);
+ if ( ! copy || ! active ) {
+      free (copy);
+      free (active);
+      return;
+ }
+
+ for ( i = j = 0; i < n; i++ ) {
+       if ( polygon->edge[i].bottom > oy )
+            copy[j++] = polygon->edge[i];
+ }
+
+ y = ( copy[0].top < oy ) ? oy : copy[0].top;
+ while ( y < bottom ) {
+         /* Sides that start on this row, the ones above the image are
+          * moved to it */
+         for ( ; next < n_copies && copy[next].top <= y; next++ ) {
+               edge = &(copy[next]);
+               __imel_polygon_edge_advance (edge, y - edge->top);
+               active[n_active++] = edge;
+         }
+
+         for ( i = j = 0; i < n_active; i++ ) {
+               if ( active[i]->bottom > y )
+                    active[j++] = active[i];
+         }
+         n_active = j;
+
+         if ( ! n_active ) {
+              if ( next == n_copies )
+                   break;
+
+              y = copy[next].top;
+              continue;
+         }
+
+         /* The order changes only where sides cross, insertion sort */
+         for ( i = 1; i < n_active; i++ ) {
+               edge = active[i];
+               for ( j = i; j > 0 && __IMEL_POLYGON_EDGE_CEIL (active[j - 1]) > __IMEL_POLYGON_EDGE_CEIL (edge); j-- )
+                     active[j] = active[j - 1];
+               active[j] = edge;
+         }
+
+         if ( rule == IMEL_FILL_RULE_EVEN_ODD ) {
+              for ( i = 0; i + 1 < n_active; i += 2 )
+                    __imel_draw_fill_span (image, __IMEL_POLYGON_EDGE_CEIL (active[i]) - ox,
+                                           __IMEL_POLYGON_EDGE_CEIL (active[i + 1]) - 1 - ox, y - oy, brush, pixel);
+         }
+         else {
+              for ( i = 0, winding = 0; i < n_active; i++ ) {
+                    if ( ! winding )
+                         start = __IMEL_POLYGON_EDGE_CEIL (active[i]);
+
+                    winding += active[i]->winding;
+                    if ( ! winding )
+                         __imel_draw_fill_span (image, start - ox, __IMEL_POLYGON_EDGE_CEIL (active[i]) - 1 - ox,
+                                                y - oy, brush, pixel);
+              }
+         }
+
+         for ( i = 0; i < n_active; i++ ) {
+               edge = active[i];
+               edge->x += edge->q_step;
+               edge->r += edge->r_step;
+               if ( edge->r >= edge->d ) {
+                    edge->r -= edge->d;
+                    edge->x++;
+               }
+         }
+
+         y++;
+ }
+
+ free (copy);
+ free (active);
+}
+
+/* Fill @polygon in @image with @rule, with the brush only if @brush is
+ * TRUE */
+void __imel_polygon_fill (ImelImage *image, __ImelPolygon *polygon, ImelFillRule rule, bool brush, ImelPixel pixel)
+{
+ __imel_polygon_sort (polygon);
+ __imel_polygon_fill_at (image, polygon, 0, 0, rule, brush, pixel);
+}
+
+
+void __imel_coverage_init (__ImelCoverage *coverage)
+{
+ coverage->line = NULL;
+ coverage->n_lines = 0;
+ coverage->size = 0;
+ coverage->failed = false;
+}
+
+void __imel_coverage_clear (__ImelCoverage *coverage)
+{
+ free (coverage->line);
+ __imel_coverage_init (coverage);
+}
+
+/* Add the side from (x0, y0) to (x1, y1), horizontal sides are skipped */
+void __imel_coverage_add_line (__ImelCoverage *coverage, double x0, double y0, double x1, double y1)
+{
+ __ImelCoverageLine *line;
+
+ if ( y0 == y1 || coverage->failed )
+      return;
+
+ if ( ! __IMEL_FINITE (x0) || ! __IMEL_FINITE (y0) || ! __IMEL_FINITE (x1) || ! __IMEL_FINITE (y1) ) {
+      coverage->failed = true;
+      return;
+ }
+
+ if ( coverage->n_lines == coverage->size ) {
+      line = (__ImelCoverageLine *) realloc (coverage->line, sizeof (__ImelCoverageLine) *
+                                             (coverage->size ? coverage->size << 1 : 16));
+      if ( ! line ) {
+           coverage->failed = true;
+           return;
+      }
+
+      coverage->line = line;
+      coverage->size = coverage->size ? coverage->size << 1 : 16;
+ }
+
+ /* From now on a pixel is the square [x, x + 1) x [y, y + 1) */
+ line = &(coverage->line[coverage->n_lines++]);
+ line->x0 = x0 + 0.5;
+ line->y0 = y0 + 0.5;
+ line->x1 = x1 + 0.5;
+ line->y1 = y1 + 0.5;
+}
+
+/* Add to the rows of @acc, @stride cells each, the signed area at the
+ * right of the line from (x0, y0) to (x1, y1) in each cell and the one
+ * at the right of the cell in the next one, so a running sum along a row
+ * gives the coverage. y0 and y1 are in [0, rows], x0 and x1 in
+ * [0, stride - 2]. */
+static void __imel_coverage_accumulate (double *acc, long stride, double x0, double y0, double x1, double y1)
+{
+ double dir = 1.0, dxdy, x, next, dy, d, a, b, s, fa, fb, c0, c1, c2, cm, max = stride - 2;
+ long y, last, ia, ib, i;
+ double *row;
+
+ if ( y0 == y1 )
+      return;
+
+ if ( y0 > y1 ) {
+      dir = -1.0;
+      d = x0, x0 = x1, x1 = d;
+      d = y0, y0 = y1, y1 = d;
+ }
+
+ dxdy = (x1 - x0) / (y1 - y0);
+ x = x0;
+ last = (long) ceil (y1);
+
+ for ( y = (long) y0; y < last; y++, x = next ) {
+       row = acc + y * stride;
+       dy = (( y + 1 < y1 ) ? y + 1 : y1) - (( y > y0 ) ? y : y0);
+       next = x + dxdy * dy;
+       next = ( next < 0 ) ? 0 : ( next > max ) ? max : next;
+       d = dy * dir;
+
+       a = ( x < next ) ? x : next;
+       b = ( x < next ) ? next : x;
+       ia = (long) floor (a);
+       ib = (long) ceil (b);
+
+       /* Inside one cell: the area is the one of a trapezoid */
+       if ( ib <= ia + 1 ) {
+            cm = 0.5 * (x + next) - ia;
+            row[ia] += d - d * cm;
+            row[ia + 1] += d * cm;
+            continue;
+       }
+
+       /* Across many cells: triangles on the ends, the same area in the middle */
+       s = 1.0 / (b - a);
+       fa = a - ia;
+       fb = b - ib + 1;
+       c0 = 0.5 * s * (1 - fa) * (1 - fa);
+       cm = 0.5 * s * fb * fb;
+       row[ia] += d * c0;
+       if ( ib == ia + 2 )
+            row[ia + 1] += d * (1 - c0 - cm);
+       else {
+            c1 = s * (1.5 - fa);
+            row[ia + 1] += d * (c1 - c0);
+            for ( i = ia + 2; i < ib - 1; i++ )
+                  row[i] += d * s;
+            c2 = c1 + (ib - ia - 3) * s;
+            row[ib - 1] += d * (1 - c2 - cm);
+       }
+       row[ib] += d * cm;
+ }
+}
+
+/* Add @line to the rows [top, top + rows) of @acc, where the cell 0 is
+ * the column @left. The parts at the left or at the right of the buffer
+ * are moved on its sides: a side at the left still covers the whole row. */
+static void __imel_coverage_add_to_rows (double *acc, long stride, const __ImelCoverageLine *line,
+                                         long left, long top, long rows)
+{
+ double x[4], y[4], t[4], a, b, max = stride - 2, first, last, swap;
+ int n = 2, i, j;
+
+ a = ( line->y0 < line->y1 ) ? line->y0 : line->y1;
+ b = ( line->y0 < line->y1 ) ? line->y1 : line->y0;
+ if ( b <= top || a >= top + rows )
+      return;
+
+ /* Clip the rows keeping the direction of the side */
+ t[0] = ( line->y0 < top ) ? (top - line->y0) / (line->y1 - line->y0)
+      : ( line->y0 > top + rows ) ? (top + rows - line->y0) / (line->y1 - line->y0) : 0.0;
+ t[1] = ( line->y1 < top ) ? (top - line->y0) / (line->y1 - line->y0)
+      : ( line->y1 > top + rows ) ? (top + rows - line->y0) / (line->y1 - line->y0) : 1.0;
+ first = t[0];
+ last = t[1];
+
+ /* Split where it crosses the sides of the buffer */
+ a = line->x0 - left;
+ b = line->x1 - left;
+ if ( (a < 0) != (b < 0) )
+      t[n++] = -a / (b - a);
+ if ( (a < max) != (b < max) )
+      t[n++] = (max - a) / (b - a);
+
+ for ( i = 1; i < n; i++ ) {
+       for ( j = i; j > 0 && t[j - 1] > t[j]; j-- ) {
+             swap = t[j];
+             t[j] = t[j - 1];
+             t[j - 1] = swap;
+       }
+ }
+
+ for ( i = 0; i < n; i++ ) {
+       x[i] = a + (b - a) * t[i];
+       x[i] = ( x[i] < 0 ) ? 0 : ( x[i] > max ) ? max : x[i];
+       y[i] = line->y0 - top + (line->y1 - line->y0) * t[i];
+       y[i] = ( y[i] < 0 ) ? 0 : ( y[i] > rows ) ? rows : y[i];
+ }
+
+ for ( i = 0; i + 1 < n; i++ ) {
+       if ( t[i] >= first && t[i + 1] <= last )
+            __imel_coverage_accumulate (acc, stride, x[i], y[i], x[i + 1], y[i + 1]);
+ }
+}
+
+/* Fill @coverage in @image with @rule, blending each pixel in proportion
+ * to the area covered. The pixel (0, 0) of @image is the point (ox, oy)
+ * of the polygon, only the sides that cross its rows are used. It can be
+ * called more than once. */
+void __imel_coverage_fill_at (ImelImage *image, const __ImelCoverage *coverage, long ox, long oy,
+                              ImelFillRule rule, ImelPixel pixel)
+{
+ const __ImelCoverageLine *line;
+ double min_x, max_x, min_y, max_y, *acc, *row, sum, value;
+ long left, right, top, bottom, stride, rows, y, x, start;
+ unsigned char *cover;
+ ImelSize i, n = 0, *used;
+ bool after = false;
+
+ if ( coverage->failed || ! coverage->n_lines )
+      return;
+
+ used = (ImelSize *) malloc (sizeof (ImelSize) * coverage->n_lines);
+ return_if_fail (used);
+
+ /* The sides at the left of the image still cover its rows, the ones
+ * at the right only end the rows */
+ for ( i = 0; i < coverage->n_lines; i++ ) {
+       line = &coverage->line[i];
+       if ( (line->y0 <= oy && line->y1 <= oy) ||
+            (line->y0 >= oy + (double) image->height && line->y1 >= oy + (double) image->height) )
+            continue;
+
+       if ( line->x0 >= ox + (double) image->width && line->x1 >= ox + (double) image->width ) {
+            after = true;
+            continue;
+       }
+
+       used[n++] = i;
+ }
+
+ if ( ! n ) {
+      free (used);
+      return;
+ }
+
+ min_x = max_x = coverage->line[used[0]].x0;
+ min_y = max_y = coverage->line[used[0]].y0;
+ for ( i = 0; i < n; i++ ) {
+       line = &coverage->line[used[i]];
+       min_x = ( line->x0 < min_x ) ? line->x0 : min_x;
+       min_x = ( line->x1 < min_x ) ? line->x1 : min_x;
+       max_x = ( line->x0 > max_x ) ? line->x0 : max_x;
+       max_x = ( line->x1 > max_x ) ? line->x1 : max_x;
+       min_y = ( line->y0 < min_y ) ? line->y0 : min_y;
+       min_y = ( line->y1 < min_y ) ? line->y1 : min_y;
+       max_y = ( line->y0 > max_y ) ? line->y0 : max_y;
+       max_y = ( line->y1 > max_y ) ? line->y1 : max_y;
+ }
+ max_x = ( after ) ? ox + (double) image->width : max_x;
+
+ /* Columns and rows of the image touched by the polygon */
+ if ( max_x <= ox || max_y <= oy || min_x >= ox + (double) image->width || min_y >= oy + (double) image->height ) {
+      free (used);
+      return;
+ }
+
+ left = ( min_x > ox ) ? (long) floor (min_x) : ox;
+ right = ( max_x < ox + (double) image->width ) ? (long) ceil (max_x) : ox + (long) image->width;
+ top = ( min_y > oy ) ? (long) floor (min_y) : oy;
+ bottom = ( max_y < oy + (double) image->height ) ? (long) ceil (max_y) : oy + (long) image->height;
+ stride = right - left + 2;
+
+ acc = (double *) calloc (__IMEL_COVERAGE_ROWS * stride, sizeof (double));
+ cover = (unsigned char *) malloc (stride);
+ if ( ! acc || ! cover ) {
+      free (used);
+      free (acc);
+      free (cover);
+      return;
+ }
+
+ for ( ; top < bottom; top += rows ) {
+       rows = ( bottom - top < __IMEL_COVERAGE_ROWS ) ? bottom - top : __IMEL_COVERAGE_ROWS;
+
+       for ( i = 0; i < n; i++ )
+             __imel_coverage_add_to_rows (acc, stride, &(coverage->line[used[i]]), left, top, rows);
+
+       for ( y = 0; y < rows; y++ ) {
+             row = acc + y * stride;
+             for ( x = 0, sum = 0; x < stride - 2; x++ ) {
+                   sum += row[x];
+                   value = fabs (sum);
+                   if ( rule == IMEL_FILL_RULE_EVEN_ODD ) {
+                        value = fmod (value, 2.0);
+                        value = ( value > 1.0 ) ? 2.0 - value : value;
+                   }
+                   else value = ( value > 1.0 ) ? 1.0 : value;
+
+                   cover[x] = (unsigned char) (value * 255 + 0.5);
+             }
+
+             memset (row, 0, sizeof (double) * stride);
+
+             /* Blend the runs of covered pixels */
+             for ( x = 0; x < stride - 2; x = start ) {
+                   for ( ; x < stride - 2 && ! cover[x]; x++ );
+                   for ( start = x; start < stride - 2 && cover[start]; start++ );
+
+                   if ( start > x )
+                        __imel_draw_cover_span (image, left + x - ox, top + y - oy, cover + x, start - x, pixel);
+             }
+       }
+ }
+
+ free (used);
+ free (acc);
+ free (cover);
+}
+
+/* As __imel_coverage_fill_at (), at the top left corner of the polygon */
+void __imel_coverage_fill (ImelImage *image, __ImelCoverage *coverage, ImelFillRule rule, ImelPixel pixel)
+{
+ __imel_coverage_fill_at (image, coverage, 0, 0, rule, pixel);
+}
+
+#endif
+
+/**
+ * @brief Draw a filled polygon
+ * 
+ * This function fills in @p image the polygon with the vertices in
+ * @p points, the last one is linked to the first one. The polygon can be
+ * concave and its sides can cross each other: @p rule tells which parts
+ * are inside. The cost depends on the number of sides and rows, each
+ * pixel is written once.
+ * 
+ * A pixel is inside if its center is, so the pixels on the sides at the
+ * right and at the bottom aren't drawn. To draw them too draw also the
+ * outline with #imel_draw_contiguous_figure_array.
+ * 
+ * @code
+ * ImelImage *image = imel_image_new (100, 100);
+ * ImelPixel red = imel_pixel_new (0xff, 0, 0, 0);
+ * ImelPointArray *star = imel_point_array_new (5);
+ *
+ * imel_point_array_add (star, 50, 5, red);
+ * imel_point_array_add (star, 78, 90, red);
+ * imel_point_array_add (star, 5, 35, red);
+ * imel_point_array_add (star, 95, 35, red);
+ * imel_point_array_add (star, 22, 90, red);
+ *
+ * imel_draw_filled_polygon (image, star, IMEL_FILL_RULE_NON_ZERO, red);
+ * imel_point_array_destroy (star);
+ * @endcode
+ * 
+ * @param image Image where draw the polygon
+ * @param points Vertices of the polygon, at least 3
+ * @param rule Rule to choose the points inside the polygon
+ * @param pixel Color and level of the polygon
+ * @see ImelFillRule
+ * @see imel_draw_filled_reg_shape
+ */
+void imel_draw_filled_polygon (ImelImage *image, const ImelPointArray *points, ImelFillRule rule, ImelPixel pixel)
+{
+ __ImelPolygon polygon;
+ ImelSize i, j;
+
+ return_if_fail (image && points && points->n_points > 2);
+
+ __imel_polygon_init (&polygon);
+ for ( i = 0; i < points->n_points; i++ ) {
+       j = ( i + 1 < points->n_points ) ? i + 1 : 0;
+       __imel_polygon_add_edge (&polygon, points->point[i].x, points->point[i].y,
+                                points->point[j].x, points->point[j].y);
+ }
+
+ __imel_polygon_fill (image, &polygon, rule, global_brush != NULL, pixel);
+ image->generation++;
+ __imel_polygon_clear (&polygon);
+}
+
+/**
+ * @brief Draw a filled anti-aliased polygon
+ * 
+ * This function fills in @p image the polygon with the vertices in
+ * @p points as #imel_draw_filled_polygon, but each pixel is blended with
+ * @p pixel in proportion to its area covered by the polygon, so the sides
+ * are smooth. The center of a pixel is at integer coordinates. Where two
+ * sides cross inside a pixel its coverage is approximated.
+ * 
+ * The coverage is computed a few rows at a time and blended a span at a
+ * time by the same kernels used by #imel_image_union. As with
+ * #imel_pixel_copy the pixels with a level higher than the one of
+ * @p pixel are kept and a negative level of @p pixel is its alpha. The
+ * brush isn't used.
+ * 
+ * @param image Image where draw the polygon
+ * @param points Vertices of the polygon, at least 3
+ * @param rule Rule to choose the points inside the polygon
+ * @param pixel Color and level of the polygon
+ * @see imel_draw_filled_polygon
+ * @see imel_draw_antialiased_line
+ */
+void imel_draw_filled_antialiased_polygon (ImelImage *image, const ImelPointArray *points, ImelFillRule rule,
+                                           ImelPixel pixel)
+{
+ __ImelCoverage coverage;
+ ImelSize i, j;
+
+ return_if_fail (image && points && points->n_points > 2);
+
+ __imel_coverage_init (&coverage);
+ for ( i = 0; i < points->n_points; i++ ) {
+       j = ( i + 1 < points->n_points ) ? i + 1 : 0;
+       __imel_coverage_add_line (&coverage, points->point[i].x, points->point[i].y,
+                                 points->point[j].x, points->point[j].y);
+ }
+
+ __imel_coverage_fill (image, &coverage, rule, pixel);
+ image->generation++;
+ __imel_coverage_clear (&coverage);
+}
+
+/**
+ * @brief Draw a filled regular shape
+ * 
+ * This function fills in @p image a regular shape with center in coordinate
+ * \f$(x,y)\f$, radius @p r, @p v vertices and rotation @p start_angle in
+ * radians. The vertices are the same of #imel_draw_reg_shape, also when
+ * they are outside @p image.
+ * 
+ * @param image Image where draw the shape
+ * @param x Center coordinate x
+ * @param y Center coordinate y
+ * @param r Radius of the shape
+ * @param v Number of vertices
+ * @param start_angle Rotation angle in radians
+ * @param pxl Color and level of the shape
+ * @return TRUE if all values are valid, else FALSE
+ * @see imel_draw_reg_shape
+ * @see imel_draw_filled_polygon
+ */
+bool imel_draw_filled_reg_shape (ImelImage *image, ImelSize x, ImelSize y, ImelSize r, long v,
+                                 double start_angle, ImelPixel pxl)
+{
+ __ImelPolygon polygon;
+ double increment = 6.283185307f / ((double) v ? v : 1.f);
+ long j, fx, fy, ox, oy, px, py;
+
+ return_var_if_fail (image && v > 2 && start_angle < 3.141592654f 
+                     && start_angle > -3.141592654f, false);
+
+ fx = ox = (long) floor (((double) x) + (((double) r) * cos (start_angle)));
+ fy = oy = (long) floor (((double) y) - (((double) r) * sin (start_angle)));
+
+ __imel_polygon_init (&polygon);
+ for ( j = 1; j <= v; j++, ox = px, oy = py ) {
+       start_angle += increment;
+       px = ( j < v ) ? (long) floor (((double) x) + (((double) r) * cos (start_angle))) : fx;
+       py = ( j < v ) ? (long) floor (((double) y) - (((double) r) * sin (start_angle))) : fy;
+
+       __imel_polygon_add_edge (&polygon, ox, oy, px, py);
+ }
+
+ __imel_polygon_fill (image, &polygon, IMEL_FILL_RULE_EVEN_ODD, global_brush != NULL, pxl);
+ image->generation++;
+ __imel_polygon_clear (&polygon);
+
+ return true;
+}
@@ -0,0 +1,87 @@
+/*
+ * "polygon.h" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+#ifndef IMEL_POLYGON_H
+#define IMEL_POLYGON_H
+/**
+ * @file polygon.h
+ * @author Davide Francesco Merico
+ * @brief This file contains the internal edge list of the polygon filler.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+/* A side of a polygon that isn't horizontal, from top to bottom. While
+ * filling, the crossing with the current row is x + r / d, 0 <= r < d,
+ * and each row moves it by q_step + r_step / d. */
+typedef struct ___imel_polygon_edge {
+               long top;        /* First row */
+               long bottom;     /* Row after the last one */
+               long x;
+               int64_t r;
+               int64_t d;
+               int64_t q_step;
+               int64_t r_step;
+               int winding;     /* 1 if the side goes down, else -1 */
+        } __ImelPolygonEdge;
+
+/* Sides of one or more closed contours, in any order */
+typedef struct ___imel_polygon {
+               __ImelPolygonEdge *edge;
+               ImelSize n_edges;
+               ImelSize size;
+               bool failed;     /* An edge couldn't be allocated */
+        } __ImelPolygon;
+
+/* A side of a polygon for the anti-aliased filler, the center of a pixel
+ * is at integer coordinates */
+typedef struct ___imel_coverage_line {
+               double x0;
+               double y0;
+               double x1;
+               double y1;
+        } __ImelCoverageLine;
+
+/* Sides of one or more closed contours for the anti-aliased filler */
+typedef struct ___imel_coverage {
+               __ImelCoverageLine *line;
+               ImelSize n_lines;
+               ImelSize size;
+               bool failed;     /* A side couldn't be allocated */
+        } __ImelCoverage;
+
+extern void __imel_polygon_init     (__ImelPolygon *polygon);
+extern void __imel_polygon_clear    (__ImelPolygon *polygon);
+extern void __imel_polygon_add_edge (__ImelPolygon *polygon, long x0, long y0, long x1, long y1);
+extern void __imel_polygon_sort     (__ImelPolygon *polygon);
+extern void __imel_polygon_fill_at  (ImelImage *image, const __ImelPolygon *polygon, long ox, long oy,
+                                     ImelFillRule rule, bool brush, ImelPixel pixel);
+extern void __imel_polygon_fill     (ImelImage *image, __ImelPolygon *polygon, ImelFillRule rule,
+                                     bool brush, ImelPixel pixel);
+
+extern void __imel_coverage_init     (__ImelCoverage *coverage);
+extern void __imel_coverage_clear    (__ImelCoverage *coverage);
+extern void __imel_coverage_add_line (__ImelCoverage *coverage, double x0, double y0, double x1, double y1);
+extern void __imel_coverage_fill_at  (ImelImage *image, const __ImelCoverage *coverage, long ox, long oy,
+                                      ImelFillRule rule, ImelPixel pixel);
+extern void __imel_coverage_fill     (ImelImage *image, __ImelCoverage *coverage, ImelFillRule rule,
+                                      ImelPixel pixel);
+
+#endif
+
+#endif
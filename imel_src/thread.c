@@ -0,0 +1,164 @@
+/*
+ * "thread.c" (C) Davide Francesco "HdS619" Merico ( hds619@gmail.com )
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "header.h"
+/**
+ * @file thread.c
+ * @author Davide Francesco Merico
+ * @brief This file contains functions to split the work between threads.
+ */
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+#define __IMEL_THREAD_MAX 64
+
+typedef struct ___imel_thread_band {
+               ImelSize start;
+               ImelSize end;
+               ImelSize band;
+               ImelBandFuncPtr func;
+               ImelGenericPtr data;
+        } __ImelThreadBand;
+
+static ImelSize thread_count;
+
+#endif
+
+/**
+ * @brief Set the number of threads
+ *
+ * This function set the maximum number of threads used by the functions
+ * that split their work in bands of rows, like #imel_image_apply_gaussian_blur.
+ *
+ * @param count Number of threads, 0 to use one thread for each online processor.
+ *
+ * @see imel_thread_get_count
+ */
+void imel_thread_set_count (ImelSize count)
+{
+ thread_count = ( count > __IMEL_THREAD_MAX ) ? __IMEL_THREAD_MAX : count;
+}
+
+/**
+ * @brief Get the number of threads
+ *
+ * @return The maximum number of threads used by Imel.
+ *
+ * @see imel_thread_set_count
+ */
+ImelSize imel_thread_get_count (void)
+{
+ long int online;
+
+ if ( thread_count )
+      return thread_count;
+
+ online = sysconf (_SC_NPROCESSORS_ONLN);
+ if ( online < 1 )
+      return 1;
+
+ return ( online > __IMEL_THREAD_MAX ) ? __IMEL_THREAD_MAX : online;
+}
+
+#ifndef DOXYGEN_IGNORE_DOC
+
+/* Number of bands used by __imel_thread_run to split @n elements, every
+ * band contains at least @grain elements. */
+ImelSize __imel_thread_bands (ImelSize n, ImelSize grain)
+{
+ ImelSize bands;
+
+ if ( grain < 1 )
+      grain = 1;
+
+ bands = n / grain;
+ if ( bands > imel_thread_get_count () )
+      bands = imel_thread_get_count ();
+
+ return ( bands < 1 ) ? 1 : bands;
+}
+
+static void *__imel_thread_main (void *data)
+{
+ __ImelThreadBand *band = (__ImelThreadBand *) data;
+
+ band->func (band->start, band->end, band->band, band->data);
+
+ return NULL;
+}
+
+/* Split [0, n) in @bands contiguous bands and call @func for each of
+ * them, every band on its own thread. The last band is processed by the
+ * calling thread. If a thread can't be created its band is processed by
+ * the calling thread too, so the work is always done. The callers that
+ * keep data for each band pass the count they allocated for, since the
+ * number of threads can change meanwhile. */
+void __imel_thread_run_bands (ImelSize n, ImelSize bands, ImelBandFuncPtr func, ImelGenericPtr data)
+{
+ __ImelThreadBand band[__IMEL_THREAD_MAX];
+ pthread_t thread[__IMEL_THREAD_MAX];
+ bool started[__IMEL_THREAD_MAX];
+ ImelSize i;
+
+ if ( ! n )
+      return;
+
+ if ( bands > n )
+      bands = n;
+ if ( bands > __IMEL_THREAD_MAX )
+      bands = __IMEL_THREAD_MAX;
+
+ if ( bands <= 1 ) {
+      func (0, n, 0, data);
+      return;
+ }
+
+ for ( i = 0; i < bands; i++ ) {
+       band[i].start = (ImelSize) (((uint64_t) n * i) / bands);
+       band[i].end = (ImelSize) (((uint64_t) n * (i + 1)) / bands);
+       band[i].band = i;
+       band[i].func = func;
+       band[i].data = data;
+
+       started[i] = ( i + 1 < bands ) &&
+                    ! pthread_create (&thread[i], NULL, __imel_thread_main, &band[i]);
+ }
+
+ for ( i = 0; i < bands; i++ ) {
+       if ( ! started[i] )
+            func (band[i].start, band[i].end, band[i].band, data);
+ }
+
+ for ( i = 0; i + 1 < bands; i++ ) {
+       if ( started[i] )
+            pthread_join (thread[i], NULL);
+ }
+}
+
+/* Split [0, n) in __imel_thread_bands (n, grain) bands, see
+ * __imel_thread_run_bands */
+void __imel_thread_run (ImelSize n, ImelSize grain, ImelBandFuncPtr func, ImelGenericPtr data)
+{
+ __imel_thread_run_bands (n, __imel_thread_bands (n, grain), func, data);
+}
+
+#endif